@@ -19,4 +19,8 @@ target_link_libraries(msceqf_euroc ${PROJECT_NAME}_lib pthread)
 
 add_executable(msceqf_uzhfpv examples/uzhfpv/uzhfpv.cpp)
 target_include_directories(msceqf_uzhfpv PRIVATE ${include_dirs})
-target_link_libraries(msceqf_uzhfpv ${PROJECT_NAME}_lib pthread)
\ No newline at end of file
+target_link_libraries(msceqf_uzhfpv ${PROJECT_NAME}_lib pthread)
+
+add_executable(msceqf_batch examples/batch/batch.cpp)
+target_include_directories(msceqf_batch PRIVATE ${include_dirs})
+target_link_libraries(msceqf_batch ${PROJECT_NAME}_lib pthread)
\ No newline at end of file
@@ -0,0 +1,361 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+#include "msceqf/msceqf.hpp"
+#include "utils/data_parser.hpp"
+#include "utils/sequence_cache.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/trajectory_evaluation.hpp"
+
+/**
+ * @brief Batch evaluation job, a single sequence run with a single configuration
+ *
+ */
+struct Job
+{
+  std::string name_;            //!< Name of the job
+  std::string dataset_;         //!< Dataset of the sequence (euroc or uzhfpv)
+  std::string sequence_;        //!< Folder of the sequence
+  std::string config_;          //!< Configuration file
+  std::string sequence_cache_;  //!< Sequence cache file (optional)
+};
+
+/**
+ * @brief Result of a batch evaluation job
+ *
+ */
+struct JobResult
+{
+  std::string status_ = "ok";       //!< Status of the job ("ok" or the error message)
+  size_t frames_ = 0;               //!< Number of processed frames
+  msceqf::fp duration_ = 0;         //!< Duration of the sequence in seconds
+  msceqf::fp runtime_ = 0;          //!< Wall-clock runtime in seconds
+  utils::trajectoryErrors errors_;  //!< Trajectory errors
+};
+
+/**
+ * @brief Create the data parser of the sequence of the given job
+ *
+ * @param job Job
+ * @return Data parser
+ */
+std::unique_ptr<utils::dataParser> datasetParser(const Job& job)
+{
+  if (job.dataset_ == "euroc")
+  {
+    const std::vector<std::string> imu_header = {"#timestamp [ns]",     "w_RS_S_x [rad s^-1]", "w_RS_S_y [rad s^-1]",
+                                                 "w_RS_S_z [rad s^-1]", "a_RS_S_x [m s^-2]",   "a_RS_S_y [m s^-2]",
+                                                 "a_RS_S_z [m s^-2]"};
+
+    const std::vector<std::string> groundtruth_header = {"#timestamp",
+                                                         "q_RS_x []",
+                                                         "q_RS_y []",
+                                                         "q_RS_z []",
+                                                         "q_RS_w []",
+                                                         "p_RS_R_x [m]",
+                                                         "p_RS_R_y [m]",
+                                                         "p_RS_R_z [m]",
+                                                         "v_RS_R_x [m s^-1]",
+                                                         "v_RS_R_y [m s^-1]",
+                                                         "v_RS_R_z [m s^-1]",
+                                                         "b_w_RS_S_x [rad s^-1]",
+                                                         "b_w_RS_S_y [rad s^-1]",
+                                                         "b_w_RS_S_z [rad s^-1]",
+                                                         "b_a_RS_S_x [m s^-2]",
+                                                         "b_a_RS_S_y [m s^-2]",
+                                                         "b_a_RS_S_z [m s^-2]"};
+
+    const std::vector<std::string> cam_header = {"#timestamp [ns]", "filename"};
+
+    return std::make_unique<utils::dataParser>(
+        job.sequence_ + "/mav0/imu0/data.csv", job.sequence_ + "/mav0/state_groundtruth_estimate0/data.csv",
+        job.sequence_ + "/mav0/cam0/data.csv", job.sequence_ + "/mav0/cam0/data/", imu_header, groundtruth_header,
+        cam_header);
+  }
+
+  if (job.dataset_ == "uzhfpv")
+  {
+    const std::vector<std::string> imu_header = {"timestamp", "ang_vel_x", "ang_vel_y", "ang_vel_z",
+                                                 "lin_acc_x", "lin_acc_y", "lin_acc_z"};
+
+    const std::vector<std::string> groundtruth_header = {"timestamp", "qx", "qy", "qz", "qw", "tx", "ty", "tz"};
+
+    const std::vector<std::string> cam_header = {"timestamp", "image_name"};
+
+    return std::make_unique<utils::dataParser>(job.sequence_ + "/imu.txt", job.sequence_ + "/groundtruth.txt",
+                                               job.sequence_ + "/left_images.txt", job.sequence_ + "/", imu_header,
+                                               groundtruth_header, cam_header, ' ', -0.016684572091862235);
+  }
+
+  throw std::runtime_error("Unknown dataset \"" + job.dataset_ + "\" for job \"" + job.name_ + "\"");
+}
+
+/**
+ * @brief Run the given job without visualization, and evaluate the estimated trajectory against the groundtruth
+ *
+ * @param job Job
+ * @param segment_length Travelled distance of the segments for the RPE
+ * @param executor Thread pool shared by all the jobs
+ * @return Result of the job
+ */
+JobResult runJob(const Job& job, const msceqf::fp& segment_length, const std::shared_ptr<utils::threadPool>& executor)
+{
+  JobResult result;
+  const auto start = std::chrono::steady_clock::now();
+
+  try
+  {
+    msceqf::MSCEqF sys(job.config_, executor);
+
+    std::vector<utils::timedPose> estimate;
+    std::vector<utils::timedPose> groundtruth;
+    msceqf::fp first_timestamp = -1;
+    msceqf::fp last_timestamp = -1;
+
+    const auto replay = [&](auto& source) {
+      while (source.hasNextSensorReading())
+      {
+        auto data = source.nextSensorReading();
+        if (std::holds_alternative<msceqf::Imu>(data))
+        {
+          sys.processMeasurement(std::get<msceqf::Imu>(data));
+          continue;
+        }
+
+        const msceqf::fp timestamp = std::get<msceqf::Camera>(data).timestamp_;
+        sys.processMeasurement(std::get<msceqf::Camera>(data));
+        ++result.frames_;
+        first_timestamp = first_timestamp < 0 ? timestamp : first_timestamp;
+        last_timestamp = timestamp;
+
+        if (!sys.isInit())
+        {
+          continue;
+        }
+
+        // Frames past the end of the groundtruth are not evaluated
+        msceqf::Groundtruth gt;
+        try
+        {
+          gt = source.getCloserGroundtruthAt(timestamp);
+        }
+        catch (const std::runtime_error&)
+        {
+          continue;
+        }
+
+        const auto& est = sys.stateEstimate();
+        estimate.push_back({timestamp, est.P().q(), est.T().p()});
+        groundtruth.push_back({gt.timestamp_, gt.q_, gt.p_});
+      }
+    };
+
+    if (job.sequence_cache_.empty())
+    {
+      auto parser = datasetParser(job);
+      parser->parseAndCheck();
+      replay(*parser);
+    }
+    else
+    {
+      utils::sequenceCache sequence_cache(job.sequence_cache_);
+      replay(sequence_cache);
+    }
+
+    result.duration_ = last_timestamp - first_timestamp;
+    result.errors_ = utils::evaluateTrajectory(estimate, groundtruth, segment_length);
+  }
+  catch (const std::exception& e)
+  {
+    result.status_ = e.what();
+  }
+
+  result.runtime_ = std::chrono::duration<msceqf::fp>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+/**
+ * @brief Format a string as a JSON string
+ *
+ * @param str String
+ * @return JSON string
+ */
+std::string jsonString(const std::string& str)
+{
+  std::string json = "\"";
+  for (const auto& c : str)
+  {
+    if (c == '"' || c == '\\')
+    {
+      json += '\\';
+      json += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20)
+    {
+      json += ' ';
+    }
+    else
+    {
+      json += c;
+    }
+  }
+  return json + "\"";
+}
+
+/**
+ * @brief Format a number as a JSON number (null if not finite)
+ *
+ * @param val Number
+ * @return JSON number
+ */
+std::string jsonNumber(const msceqf::fp& val)
+{
+  if (!std::isfinite(val))
+  {
+    return "null";
+  }
+  std::ostringstream os;
+  os.precision(12);
+  os << val;
+  return os.str();
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 3 && argc != 4)
+  {
+    std::cout << "Usage: ./msceqf_batch <jobs_file> <summary_file> [<num_threads>]" << std::endl;
+    return 1;
+  }
+
+  const std::filesystem::path jobs_path(argv[1]);
+  const std::string summary_path = argv[2];
+  const size_t num_threads = argc == 4 ? std::stoul(argv[3]) : std::thread::hardware_concurrency();
+
+  // Relative paths in the jobs file are relative to the jobs file itself
+  const auto resolve = [&jobs_path](const std::string& path) {
+    if (path.empty() || std::filesystem::path(path).is_absolute())
+    {
+      return path;
+    }
+    return (jobs_path.parent_path() / path).lexically_normal().string();
+  };
+
+  const YAML::Node node = YAML::LoadFile(jobs_path.string());
+  const msceqf::fp segment_length = node["rpe_segment_length"] ? node["rpe_segment_length"].as<msceqf::fp>() : 10.0;
+
+  std::vector<Job> jobs;
+  for (const auto& job_node : node["jobs"])
+  {
+    Job job;
+    job.name_ = job_node["name"].as<std::string>();
+    job.dataset_ = job_node["dataset"].as<std::string>();
+    job.sequence_ = resolve(job_node["sequence"].as<std::string>());
+    job.config_ = resolve(job_node["config"].as<std::string>());
+    job.sequence_cache_ = job_node["sequence_cache"] ? resolve(job_node["sequence_cache"].as<std::string>()) : "";
+    jobs.emplace_back(job);
+  }
+
+  // Sequence caches are created upfront, such that jobs sharing a sequence do not race on its creation
+  std::set<std::string> created_caches;
+  for (const auto& job : jobs)
+  {
+    if (!job.sequence_cache_.empty() && !std::filesystem::exists(job.sequence_cache_) &&
+        created_caches.insert(job.sequence_cache_).second)
+    {
+      utils::Logger::info("Creating sequence cache: " + job.sequence_cache_);
+      auto parser = datasetParser(job);
+      parser->parseAndCheck();
+      utils::writeSequenceCache(*parser, job.sequence_cache_);
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // Jobs and the filter steps of all the MSCEqF instances share the same threads, while OpenCV (whose number of
+  // threads is a process-wide setting) runs single threaded within them
+  cv::setNumThreads(1);
+
+  std::vector<std::future<JobResult>> futures;
+  {
+    auto pool = std::make_shared<utils::threadPool>(num_threads);
+    utils::Logger::info("Running " + std::to_string(jobs.size()) + " jobs on " + std::to_string(pool->size()) +
+                        " threads");
+
+    futures.reserve(jobs.size());
+    for (const auto& job : jobs)
+    {
+      futures.emplace_back(
+          pool->submit([&job, &segment_length, &pool]() { return runJob(job, segment_length, pool); }));
+    }
+
+    // The thread pool is released only after the MSCEqF instances sharing it
+    for (const auto& future : futures)
+    {
+      future.wait();
+    }
+  }
+
+  const msceqf::fp runtime = std::chrono::duration<msceqf::fp>(std::chrono::steady_clock::now() - start).count();
+
+  std::ofstream summary(summary_path);
+  if (!summary)
+  {
+    throw std::runtime_error("Error: could not open file: " + summary_path + ". Exit programm.");
+  }
+
+  summary << "{\n"
+          << "  \"rpe_segment_length\": " << jsonNumber(segment_length) << ",\n"
+          << "  \"threads\": " << num_threads << ",\n"
+          << "  \"runtime\": " << jsonNumber(runtime) << ",\n"
+          << "  \"jobs\": [";
+
+  for (size_t i = 0; i < jobs.size(); ++i)
+  {
+    const JobResult result = futures[i].get();
+    const utils::trajectoryErrors& errors = result.errors_;
+
+    summary << (i == 0 ? "\n" : ",\n") << "    {"
+            << "\"name\": " << jsonString(jobs[i].name_) << ", "
+            << "\"dataset\": " << jsonString(jobs[i].dataset_) << ", "
+            << "\"sequence\": " << jsonString(jobs[i].sequence_) << ", "
+            << "\"config\": " << jsonString(jobs[i].config_) << ", "
+            << "\"status\": " << jsonString(result.status_) << ", "
+            << "\"frames\": " << result.frames_ << ", "
+            << "\"duration\": " << jsonNumber(result.duration_) << ", "
+            << "\"runtime\": " << jsonNumber(result.runtime_) << ", "
+            << "\"realtime_factor\": " << jsonNumber(result.duration_ / result.runtime_) << ", "
+            << "\"poses\": " << errors.poses_ << ", "
+            << "\"ate_position\": " << jsonNumber(errors.ate_position_) << ", "
+            << "\"ate_rotation\": " << jsonNumber(errors.ate_rotation_) << ", "
+            << "\"rpe_segments\": " << errors.segments_ << ", "
+            << "\"rpe_translation\": " << jsonNumber(errors.rpe_translation_) << ", "
+            << "\"rpe_rotation\": " << jsonNumber(errors.rpe_rotation_) << "}";
+
+    utils::Logger::info(jobs[i].name_ + ": " + result.status_ + ", ATE " + std::to_string(errors.ate_position_) +
+                        " m, runtime " + std::to_string(result.runtime_) + " s");
+  }
+
+  summary << "\n  ]\n}" << std::endl;
+
+  return 0;
+}
@@ -12,13 +12,16 @@
 #include "msceqf/msceqf.hpp"
 #include "utils/data_parser.hpp"
 #include "utils/data_writer.hpp"
+#include "utils/sequence_cache.hpp"
+#include "utils/track_cache.hpp"
 
 int main(int argc, char** argv)
 {
-  if (argc != 4)
+  if (argc < 4 || argc > 6)
   {
-    std::cout << "Usage: ./msceqf_euroc <dataset_name> <dataset_folder> <euroc_folder> Each without / at the end."
-              << std::endl;
+    std::cout << "Usage: ./msceqf_euroc <dataset_name> <dataset_folder> <euroc_folder>"
+              << " [<sequence_cache> [<track_cache>]]"
+              << " Each without / at the end." << std::endl;
     return 1;
   }
 
@@ -29,6 +32,8 @@ int main(int argc, char** argv)
   const std::string cam_path = dataset_path + "/mav0/cam0/data.csv";
   const std::string cam_image_path = dataset_path + "/mav0/cam0/data/";
   const std::string groundtruth_path = dataset_path + "/mav0/state_groundtruth_estimate0/data.csv";
+  const std::string cache_path = argc >= 5 ? argv[4] : "";
+  const std::string track_cache_path = argc == 6 ? argv[5] : "";
 
   const std::vector<std::string> imu_header = {"#timestamp [ns]",     "w_RS_S_x [rad s^-1]", "w_RS_S_y [rad s^-1]",
                                                "w_RS_S_z [rad s^-1]", "a_RS_S_x [m s^-2]",   "a_RS_S_y [m s^-2]",
@@ -67,36 +72,87 @@ int main(int argc, char** argv)
     }
   }
 
-  utils::dataParser dataset_parser(imu_path, groundtruth_path, cam_path, cam_image_path, imu_header, groundtruth_header,
-                                   cam_header);
-
-  dataset_parser.parseAndCheck();
-
   utils::dataWriter result_writer(results_path, results_titles, ",");
 
   msceqf::MSCEqF sys(std::string(argv[3]) + "/config/config.yaml");
 
-  const auto timestamps = dataset_parser.getSensorsTimestamps();
-  for (const auto& timestamp : timestamps)
-  {
-    auto data = dataset_parser.consumeSensorReadingAt(timestamp);
-    if (std::holds_alternative<msceqf::Imu>(data))
+  const auto replay = [&](auto& source) {
+    while (source.hasNextSensorReading())
     {
-      auto imu = std::get<msceqf::Imu>(data);
-      sys.processMeasurement(imu);
+      auto data = source.nextSensorReading();
+      const msceqf::fp timestamp = std::visit([](const auto& arg) { return arg.timestamp_; }, data);
+      if (std::holds_alternative<msceqf::Imu>(data))
+      {
+        auto imu = std::get<msceqf::Imu>(data);
+        sys.processMeasurement(imu);
+      }
+      else if (std::holds_alternative<msceqf::Camera>(data))
+      {
+        sys.processMeasurement(std::get<msceqf::Camera>(data));
+        if (sys.isInit())
+        {
+          auto est = sys.stateEstimate();
+          auto cov = sys.covariance().block(0, 0, 9, 9);
+          result_writer << timestamp << est << cov << std::endl;
+        }
+        sys.visualizeImageWithTracks(std::get<msceqf::Camera>(data));
+      }
     }
-    else if (std::holds_alternative<msceqf::Camera>(data))
+  };
+
+  const auto replay_tracks = [&](const utils::sequenceCache& sequence, utils::trackCacheReader& tracks) {
+    size_t imu_idx = 0;
+    while (tracks.hasNextFeatures())
     {
-      sys.processMeasurement(std::get<msceqf::Camera>(data));
+      auto features = tracks.nextFeatures();
+      const msceqf::fp timestamp = features.timestamp_;
+      while (imu_idx < sequence.numImu() && sequence.imu(imu_idx).timestamp_ <= timestamp)
+      {
+        sys.processMeasurement(sequence.imu(imu_idx++));
+      }
+      sys.processMeasurement(features);
       if (sys.isInit())
       {
         auto est = sys.stateEstimate();
         auto cov = sys.covariance().block(0, 0, 9, 9);
         result_writer << timestamp << est << cov << std::endl;
       }
-      sys.visualizeImageWithTracks(std::get<msceqf::Camera>(data));
     }
+  };
+
+  // Replay the dataset, or its binary sequence cache (created from the dataset if it does not exist yet)
+  if (cache_path.empty() || !std::filesystem::exists(cache_path))
+  {
+    utils::dataParser dataset_parser(imu_path, groundtruth_path, cam_path, cam_image_path, imu_header,
+                                     groundtruth_header, cam_header);
+
+    dataset_parser.parseAndCheck();
+
+    if (cache_path.empty())
+    {
+      replay(dataset_parser);
+      return 0;
+    }
+
+    utils::writeSequenceCache(dataset_parser, cache_path);
+  }
+
+  utils::sequenceCache sequence_cache(cache_path);
+
+  // Replay only the backend if the output of the tracker has been recorded already, otherwise record it
+  if (!track_cache_path.empty() && std::filesystem::exists(track_cache_path))
+  {
+    utils::trackCacheReader track_cache(track_cache_path);
+    replay_tracks(sequence_cache, track_cache);
+    return 0;
+  }
+
+  if (!track_cache_path.empty())
+  {
+    sys.recordTracks(track_cache_path);
   }
 
+  replay(sequence_cache);
+
   return 0;
 }
\ No newline at end of file
@@ -34,17 +34,19 @@ class Checker
   Checker(const CheckerOptions& opts);
 
   /**
-   * @brief Perform disparity check on given tracks
+   * @brief Perform disparity check on the given running disparity statistics of the tracks
    *
-   * @param tracks tracks up to date used for disparity check
+   * @param stats Disparity statistics of the tracks up to date used for disparity check
    *
    * @return true if disparity check succeed (diparity above threshold), false if no disparity is detected (disparity
    * below threshold)
    *
-   * @note This method checks only tracks that are as long as the first track. This ideally should avoid to use newly
+   * @note This method checks only tracks that are as long as the longest track. This ideally should avoid to use newly
    * detected/tracked features corresponding to temporary objects moving in front of the camera
+   * @note The statistics are maintained by the track manager as tracks are extended and trimmed, hence this check does
+   * not depend on the number of tracks
    */
-  [[nodiscard]] bool disparityCheck(const Tracks& tracks) const;
+  [[nodiscard]] bool disparityCheck(const DisparityStatistics& stats) const;
 
  private:
   CheckerOptions opts_;  //!< The checker options
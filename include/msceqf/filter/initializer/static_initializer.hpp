@@ -40,11 +40,11 @@ class StaticInitializer
   /**
    * @brief This function detects if the platform is moving based on acceleration measurements and image disparity
    *
-   * @param tracks Tracks up to date used for disparity check
+   * @param stats Disparity statistics of the tracks up to date used for disparity check
    * @return true if motion is detected, flase otherwise
    */
 
-  [[nodiscard]] bool detectMotion(const Tracks& tracks);
+  [[nodiscard]] bool detectMotion(const DisparityStatistics& stats);
 
   /**
    * @brief This fnctions collects a predefined window of IMU measurments and compute the roll and pitch fo the platform
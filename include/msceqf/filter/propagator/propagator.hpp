@@ -58,6 +58,19 @@ class Propagator
    */
   bool propagate(MSCEqFState& X, const SystemState& xi0, fp& timestamp, const fp& new_timestamp);
 
+  /**
+   * @brief Compute the variance of the buffered IMU readings with timestamp between t0 and t1. The variance is given as
+   * the trace of the sample covariance of the acceleration and of the angular velocity, and it is computed in a single
+   * pass without copying the readings.
+   *
+   * @param t0 Start time
+   * @param t1 End time
+   * @param acc_var Variance of the acceleration readings
+   * @param ang_var Variance of the angular velocity readings
+   * @return true if at least two IMU readings are available between t0 and t1, false otherwise
+   */
+  [[nodiscard]] bool imuVariance(const fp& t0, const fp& t1, fp& acc_var, fp& ang_var);
+
  private:
   /**
    * @brief Get IMU readings between t0 and t1 to propagate with, and remove such readings from the IMU buffer.
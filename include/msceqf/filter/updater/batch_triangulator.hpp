@@ -0,0 +1,145 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef BATCH_TRIANGULATOR_HPP
+#define BATCH_TRIANGULATOR_HPP
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "types/fptypes.hpp"
+#include "msceqf/options/msceqf_options.hpp"
+#include "msceqf/state/state.hpp"
+#include "vision/track.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Batch triangulator class. This class implements the nonlinear (Gauss-Newton) refinement of many features at
+ * once. The features are parametrized as anchored inverse depth, and the observations of all the features are laid out
+ * in structure-of-arrays form, such that residuals, Jacobians and normal equations of all the observations are computed
+ * with vectorized array operations, and each feature is refined solving 3x3 normal equations.
+ * Residuals are the differences between the measured and the predicted bearings in the tangent space of the unit
+ * sphere at the measured bearing, hence observations at large angles from the optical axis are handled as well.
+ *
+ * The poses of the clones and their inverses are precomputed once for all the features, for every camera of the rig.
+ */
+class BatchTriangulator
+{
+ public:
+  /**
+   * @brief Batch triangulator constructor
+   *
+   * @param opts Updater options
+   */
+  BatchTriangulator(const UpdaterOptions& opts);
+
+  /**
+   * @brief Precompute the poses of all the clones of the given state, and their inverses, for all the cameras.
+   * This has to be called every time the clones change, before adding features to the batch.
+   *
+   * @param X MSCEqF state
+   */
+  void setClones(const MSCEqFState& X);
+
+  /**
+   * @brief Get the (precomputed) pose of the clone at the given timestamp for the given camera
+   *
+   * @param timestamp Timestamp of the clone
+   * @param cam_id Id of the camera
+   * @return Pose of the clone
+   */
+  [[nodiscard]] const SE3& clone(const fp& timestamp, const uint& cam_id) const;
+
+  /**
+   * @brief Remove all the features from the batch
+   *
+   */
+  void clear();
+
+  /**
+   * @brief Add a feature to the batch
+   *
+   * @param track Track of the feature
+   * @param A_E Anchor E element
+   * @param A_f Initial feature in anchor frame
+   * @return Index of the feature in the batch
+   */
+  size_t addFeature(const Track& track, const SE3& A_E, const Vector3& A_f);
+
+  /**
+   * @brief Refine all the features in the batch.
+   *
+   * @note A feature is restored to its initial value if the refinement does not improve the residual without
+   * converging, or if the refined feature is not within the depth bounds
+   */
+  void refine();
+
+  /**
+   * @brief Get the feature in anchor frame with the given index in the batch
+   *
+   * @param idx Index of the feature in the batch
+   * @return Feature in anchor frame
+   */
+  [[nodiscard]] const Vector3& feature(const size_t& idx) const;
+
+  /**
+   * @brief Get the number of features in the batch
+   *
+   * @return Number of features
+   */
+  [[nodiscard]] inline size_t size() const { return A_fs_.size(); }
+
+ private:
+  /**
+   * @brief Fields of an observation, stored as structure-of-arrays. Each observation holds the tangent basis B of the
+   * unit sphere at the measured bearing and the relative pose (rotation R and translation t) of the observing clone
+   * with respect to the anchor
+   */
+  enum Field
+  {
+    B00,
+    B01,
+    B02,
+    B10,
+    B11,
+    B12,
+    R00,
+    R01,
+    R02,
+    R10,
+    R11,
+    R12,
+    R20,
+    R21,
+    R22,
+    T0,
+    T1,
+    T2,
+    NUM_FIELDS
+  };
+
+  UpdaterOptions opts_;  //!< Updater options
+
+  std::vector<std::map<fp, SE3>> clones_;      //!< Poses of the clones for each camera
+  std::vector<std::map<fp, SE3>> clones_inv_;  //!< Inverse poses of the clones for each camera
+
+  std::array<std::vector<fp>, NUM_FIELDS> observations_;  //!< Observations of all the features (structure-of-arrays)
+  std::vector<size_t> offsets_;                           //!< Index of the first observation of each feature
+  std::vector<Vector3> A_fs_;                             //!< Features in anchor frame
+  std::vector<Vector3> A_fs_init_;                        //!< Initial features in anchor frame
+};
+
+}  // namespace msceqf
+
+#endif  // BATCH_TRIANGULATOR_HPP
@@ -12,16 +12,76 @@
 #ifndef UPDATER_HPP
 #define UPDATER_HPP
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "types/fptypes.hpp"
 #include "msceqf/options/msceqf_options.hpp"
+#include "msceqf/filter/updater/batch_triangulator.hpp"
 #include "msceqf/filter/updater/updater_helper.hpp"
+#include "msceqf/stats/latency_stats.hpp"
 #include "msceqf/system/system.hpp"
 #include "vision/track.hpp"
 
 namespace msceqf
 {
+/**
+ * @brief TriangulationCacheEntry struct.
+ * This struct holds the normal equations of the linear triangulation of a track expressed in the anchor frame,
+ * extended with each new observation as soon as its clone is available, as well as the last refined feature used as
+ * warm start for the nonlinear triangulation.
+ * The normal equations are linearized at the clones at the time each observation is accumulated. They are kept across
+ * updates of the clones and rebuilt only when the anchor changes or when one of the clones of the accumulated
+ * observations is marginalized.
+ */
+struct TriangulationCacheEntry
+{
+  /**
+   * @brief Check if the accumulated normal equations are valid for the given track. Timestamps are strictly increasing
+   * along a track, hence if the observation of any accumulated clone has been removed from the track, the last
+   * accumulated observation is not found at its index anymore
+   *
+   * @param track Track of the feature
+   * @return true if the normal equations can be extended with the new observations of the track, false otherwise
+   */
+  [[nodiscard]] inline bool isValid(const Track& track) const
+  {
+    return num_observations_ > 0 && num_observations_ <= track.size() &&
+           anchor_timestamp_ == track.timestamps_.front() &&
+           last_timestamp_ == track.timestamps_[num_observations_ - 1];
+  }
+
+  /**
+   * @brief Reset the normal equations. The warm start is kept since it is expressed in the origin frame
+   *
+   */
+  inline void reset()
+  {
+    num_observations_ = 0;
+    anchor_timestamp_ = -1;
+    last_timestamp_ = -1;
+    min_cos_ = 1;
+    A_.setZero();
+    b_.setZero();
+    bearings_.clear();
+  }
+
+  size_t num_observations_ = 0;    //!< Number of observations accumulated in the normal equations
+  fp anchor_timestamp_ = -1;       //!< Timestamp of the anchor
+  fp last_timestamp_ = -1;         //!< Timestamp of the last accumulated observation
+  fp min_cos_ = 1;                 //!< Minimum cosine between the accumulated bearings
+  Matrix3 A_ = Matrix3::Zero();    //!< Accumulated A matrix of the normal equations
+  Vector3 b_ = Vector3::Zero();    //!< Accumulated b vector of the normal equations
+  std::vector<Vector3> bearings_;  //!< Bearings in anchor frame of the accumulated observations
+
+  bool has_warm_start_ = false;     //!< Flag indicating whether a refined feature is available
+  Vector3 G0_f_ = Vector3::Zero();  //!< Last refined feature in origin frame
+};
+
 /**
  * @brief Updater class. This class implements the Multi State Constraint update step of the MSCEqF filter.
  *
@@ -29,7 +89,14 @@ namespace msceqf
 class Updater
 {
  public:
-  Updater(const UpdaterOptions& opts, const SystemState& xi0);
+  /**
+   * @brief Updater constructor
+   *
+   * @param opts Updater options
+   * @param xi0 Origin of the system state
+   * @param stats Latency statistics the update stages are recorded into (none if null)
+   */
+  Updater(const UpdaterOptions& opts, const SystemState& xi0, const std::shared_ptr<LatencyStats>& stats = nullptr);
 
   /**
    * @brief Perform a Multi State Constraint update
@@ -39,51 +106,156 @@ class Updater
    * @param ids Indices of the tracks that are evaluated for an update
    *
    * @note Not all the tracks corresponding to the given ids will be used for the update. Tracks that do not contains at
-   * least two views, tracks for which the triangulation fails, and tracks that fail the chi2 test are discarded. The
-   * set ids will change accordingly.
+   * least two views, tracks for which the triangulation fails, and tracks that fail the chi2 test are discarded. If an
+   * update budget is configured, only the best tracks within the budget are used. The set ids will change accordingly.
    */
   void mscUpdate(MSCEqFState& X, const Tracks& tracks, std::unordered_set<uint>& ids);
 
- private:
   /**
-   * @brief Linear feature triangulation (DLT). This triangulates the given features using all the views the features is
-   * seen from.
+   * @brief Perform an update with the latest observation of the persistent features in the MSCEqF state
+   *
+   * @param X MSCEqF state
+   * @param tracks Tracks of the persistent features
+   * @param ids Ids of the persistent features observed at the given timestamp
+   * @param timestamp Timestamp of the latest observation (timestamp of the newest clone)
+   *
+   * @note Persistent features whose residual do not pass the chi2 test are not used in the update
+   */
+  void persistentFeaturesUpdate(MSCEqFState& X,
+                                const Tracks& tracks,
+                                const std::vector<uint>& ids,
+                                const fp& timestamp);
+
+  /**
+   * @brief Delayed initialization of a persistent feature. The feature is triangulated from all the views in its track,
+   * and the stacked Jacobian of the measurements with respect to the feature is QR decomposed. The part of the
+   * measurements in the column space of the feature Jacobian is used to initialize the SOT3 element of the feature and
+   * its (cross) covariance, the remaining part is left for the Multi State Constraint update.
+   *
+   * @param X MSCEqF state
+   * @param track Track of the feature to initialize
+   * @param id Id of the feature to initialize
+   * @param G0_f Triangulated feature in origin frame (before the initialization update)
+   * @return true if the feature has been initialized, false otherwise
+   */
+  [[nodiscard]] bool persistentFeatureInitialization(MSCEqFState& X, const Track& track, const uint& id, Vector3& G0_f);
+
+  /**
+   * @brief Accumulate the observations of the tracks observed at the given timestamp into the normal equations of their
+   * triangulation cache entry. This has to be called once the clone at the given timestamp is available, such that the
+   * cost of the linear triangulation is spread over the lifetime of the tracks.
+   *
+   * @param X MSCEqF state
+   * @param tracks Tracks
+   * @param timestamp Timestamp of the newest clone
+   *
+   * @note If the triangulation refinement is disabled the linear triangulation is the final estimate, hence it is
+   * relinearized at the actual clones whenever a track is triangulated, and nothing is accumulated here
+   */
+  void addObservations(const MSCEqFState& X, const Tracks& tracks, const fp& timestamp);
+
+  /**
+   * @brief Triangulate the feature of the given track. This performs the initial triangulation in anchor frame (frame
+   * of first observation of the feature), refined by the batch triangulator (as a batch of a single feature) if
+   * enabled.
    *
    * @param X MSCEqF state
    * @param track Track of the feature to triangulate
-   * @param A_E Anchor E element
-   * @param A_f Triangulated feature
+   * @param id Id of the track
+   * @param G0_f Triangulated feature in origin frame
    * @return true if the triangulation was succesful, false otherwise
    */
-  [[nodiscard]] bool linearTriangulation(const MSCEqFState& X, const Track& track, const SE3& A_E, Vector3& A_f) const;
+  [[nodiscard]] bool triangulate(const MSCEqFState& X, const Track& track, const uint& id, Vector3& G0_f);
 
   /**
-   * @brief Nonlinear feature triangulation based on gauss newton. The feature is parametrized as anchored inverse depth
-   * to render the optimization problem more stable.
+   * @brief Compute the mean rotation-compensated parallax, in pixels, of the tracks observed at both given timestamps.
+   * This is the statistic used by the parallax marginalization policy to decide if the newest clone is a keyframe.
    *
-   * The optimization problem is build on the cost defined as the sum of the squared distances between the projections
-   * of points on the unit plane.
+   * @param X MSCEqF state
+   * @param tracks Tracks
+   * @param timestamp_a Timestamp of the first clone
+   * @param timestamp_b Timestamp of the second clone
+   * @return Mean parallax in pixels, or a negative value if no track is observed at both timestamps
+   */
+  [[nodiscard]] fp parallax(const MSCEqFState& X,
+                            const Tracks& tracks,
+                            const fp& timestamp_a,
+                            const fp& timestamp_b) const;
+
+ private:
+  /**
+   * @brief Select the tracks to use in the update such that the rows of the C matrix stay within the configured rows
+   * budget, and within the rows budget derived from the time budget and the measured time per row of past updates.
+   * Tracks are ranked by their length weighted by their rotation-compensated parallax, and selected greedily giving
+   * priority to the best track of each cell of a grid over the image, to preserve spatial coverage.
+   *
+   * @param tracks Tracks
+   * @param ids Ids of the candidate tracks, deferred tracks are removed
    *
+   * @note The clones of the batch triangulator have to be set before calling this method
+   */
+  void selectTracks(const Tracks& tracks, std::unordered_set<uint>& ids) const;
+
+  /**
+   * @brief Initial triangulation of the feature of the given track in anchor frame, to be refined by the batch
+   * triangulator. The normal equations of the linear triangulation are extended from the triangulation cache with the
+   * observations not accumulated yet, and the last refined feature is used as warm start if available.
    *
    * @param X MSCEqF state
    * @param track Track of the feature to triangulate
+   * @param id Id of the track
    * @param A_E Anchor E element
    * @param A_f Triangulated feature
+   * @return true if the linear triangulation was succesful, false otherwise
    */
-  void nonlinearTriangulation(const MSCEqFState& X, const Track& track, const SE3& A_E, Vector3& A_f) const;
+  [[nodiscard]] bool initialTriangulation(
+      const MSCEqFState& X, const Track& track, const uint& id, const SE3& A_E, Vector3& A_f);
 
   /**
-   * @brief Compute the residual for the nonlinear optimization
+   * @brief Store the refined feature of the given track as warm start for the next triangulations
    *
-   * @param X MSCEqF state
-   * @param track Track of the feature to triangulate
+   * @param id Id of the track
    * @param A_E Anchor E element
-   * @param A_f Pre-triangulated feature
-   * @param res Residual
-   * @param J Jacobian
+   * @param A_f Refined feature in anchor frame
    */
-  void nonlinearTriangulationResidualJacobian(
-      const MSCEqFState& X, const Track& track, const SE3& A_E, const Vector3& A_f, VectorX& res, MatrixX& J) const;
+  void setWarmStart(const uint& id, const SE3& A_E, const Vector3& A_f);
+
+  /**
+   * @brief Accumulate the observations of the given track that are not part of the normal equations of the given cache
+   * entry yet. The normal equations are rebuilt if they are not valid for the track anymore
+   *
+   * @param X MSCEqF state
+   * @param track Track of the feature
+   * @param entry Triangulation cache entry of the track
+   */
+  void accumulateObservations(const MSCEqFState& X, const Track& track, TriangulationCacheEntry& entry) const;
+
+  /**
+   * @brief Linear feature triangulation (DLT). This solves the normal equations accumulated in the given cache entry
+   * from all the views the features is seen from.
+   *
+   * @param entry Triangulation cache entry of the track
+   * @param A_f Triangulated feature
+   * @return true if the triangulation was succesful, false otherwise
+   */
+  [[nodiscard]] bool linearTriangulation(const TriangulationCacheEntry& entry, Vector3& A_f) const;
+
+  /**
+   * @brief Remove from the triangulation cache the entries of tracks that do not exist anymore
+   *
+   * @param tracks Tracks
+   */
+  void pruneTriangulationCache(const Tracks& tracks);
+
+  /**
+   * @brief Insert the columns of the calibration states into the map of the columns of the C matrix. These are the
+   * intrinsics of the primary camera if calibrated, and the extrinsics (and intrinsics if calibrated) of the secondary
+   * cameras
+   *
+   * @param X MSCEqF state
+   * @param cols Total number of columns of the C matrix, incremented by the columns of the calibration states
+   */
+  void insertCalibrationCols(const MSCEqFState& X, size_t& cols);
 
   /**
    * @brief Perfom the update step of the MSCEqF filter
@@ -106,8 +278,15 @@ class Updater
 
   ColsMap cols_map_;  //!< Map of the columns of the C matrix and residual delta
 
+  std::unordered_map<uint, TriangulationCacheEntry> triangulation_cache_;  //!< Triangulation cache mapped by track ids
+  BatchTriangulator batch_triangulator_;                                   //!< Batch nonlinear triangulator
+
   std::vector<uint> update_ids_;  //!< Ids of the tracks used in the update
   size_t total_size_;             //!< Total size of C matrix and residual for update
+
+  fp ms_per_row_;  //!< Measured time per row of the MSC update (exponential moving average)
+
+  std::shared_ptr<LatencyStats> stats_;  //!< Latency statistics (none if null)
 };
 
 }  // namespace msceqf
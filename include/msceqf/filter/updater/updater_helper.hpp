@@ -19,6 +19,7 @@
 #include "types/fptypes.hpp"
 #include "msceqf/state/state.hpp"
 #include "utils/tools.hpp"
+#include "vision/track.hpp"
 
 namespace msceqf
 {
@@ -28,26 +29,63 @@ using VectorXBlockRowRef = Ref<VectorX::RowsBlockXpr>;  //!< Block row reference
 using ColsMap = utils::InsertionOrderedMap<MSCEqFState::MSCEqFKey, size_t>;  //!< Map of indices for C and delta
 
 /**
- * @brief FeatHelper struct.
- * This struct implements a helper structure holding all the information related to a single feature measurement to
- * be used in the computation of the C matrix, Cf matrix and residual delta, for the MSCEqF update.
+ * @brief PointFeatHelper struct.
+ * This struct implements a helper structure holding all the information related to a single measurement of a feature
+ * given as a point in the origin frame (persistent features), to be used in the computation of the C matrix, Cp matrix
+ * and residual delta, for the MSCEqF update.
  */
-struct FeatHelper
+struct PointFeatHelper
 {
-  FeatHelper(
-      const Vector3& A_f, const Vector2& uv, const Vector2& uvn, const fp& anchor_timestamp, const fp& clone_timestamp)
-      : A_f_(A_f), uv_(uv), uvn_(uvn), anchor_timestamp_(anchor_timestamp), clone_timestamp_(clone_timestamp){};
-
-  const Vector3& A_f_;          //!< Triangulated feature in anchor frame
-  const Vector2& uv_;           //!< (measured) feature coordinates
-  const Vector2& uvn_;          //!< Normalized (measured) feature coordinates
-  const fp& anchor_timestamp_;  //!< Timestamp of the anchor
-  const fp& clone_timestamp_;   //!< Timestamp of the feature measurement
+  PointFeatHelper(const Vector3& G0_f,
+                  const Vector2& uv,
+                  const Vector2& uvn,
+                  const Vector3& bearing,
+                  const fp& clone_timestamp,
+                  const uint& cam_id)
+      : G0_f_(G0_f), uv_(uv), uvn_(uvn), bearing_(bearing), clone_timestamp_(clone_timestamp), cam_id_(cam_id){};
+
+  const Vector3& G0_f_;        //!< Feature in origin frame
+  const Vector2& uv_;          //!< (measured) feature coordinates
+  const Vector2& uvn_;         //!< Normalized (measured) feature coordinates
+  const Vector3& bearing_;     //!< (measured) feature bearing
+  const fp& clone_timestamp_;  //!< Timestamp of the feature measurement
+  const uint& cam_id_;         //!< Id of the camera observing the feature
 };
 
+/**
+ * @brief CameraIntrinsicsHelper struct.
+ * This struct implements a helper structure holding the intrinsics of the camera observing a track, precomputed once
+ * per track to be used in the computation of the C matrix and residual delta of each measurement.
+ */
+struct CameraIntrinsicsHelper
+{
+  Matrix3 K_;         //!< Intrinsic matrix used to compute pixel residuals
+  Matrix3 L_;         //!< Intrinsics state element (identity if intrinsics are not calibrated)
+  Matrix3 K_inv_;     //!< Inverse of the intrinsic matrix
+  Matrix3 L_inv_;     //!< Inverse of the intrinsics state element
+  Matrix2 KL_;        //!< Upper left block of K * L, scaling the differential of the projection
+  fp f_;              //!< Focal length scaling angular residuals to pixels (1 if intrinsics are not calibrated)
+  bool calibrated_;   //!< True if the intrinsics of the camera are calibrated
+  Eigen::Index col_;  //!< Index of the intrinsics columns of the C matrix of the camera
+};
+
+/**
+ * @brief Get the dimension lost due to nullspace projection for the given feature representation
+ *
+ * @param feature_representation Feature representation
+ * @return Dimension lost due to nullspace projection (number of columns of the Cf matrix)
+ */
+[[nodiscard]] constexpr int dimLoss(const FeatureRepresentation& feature_representation)
+{
+  return feature_representation == FeatureRepresentation::ANCHORED_POLAR ? 4 : 3;
+}
+
 /**
  * @brief ProjectionHelper interface.
- * This class provides an interface to the implementation of the projection function as well as its differential.
+ * This class provides an interface to the computation of the C matrix, Cf matrix and residual delta blocks, for the
+ * MSCEqF update. The interface is dispatched once per track, while the implementations are specialized at compile time
+ * on the feature representation and on the calibration of the camera intrinsics, such that the Jacobian of each
+ * measurement is computed by an inlined, allocation-free kernel.
  *
  */
 class ProjectionHelper
@@ -56,39 +94,53 @@ class ProjectionHelper
   virtual ~ProjectionHelper() = default;
 
   /**
-   * @brief Projection function. This function projects a 3D point.
+   * @brief Computes the block rows of the C matrix, the Cf matrix and the block of the residual, corresponding to all
+   * the measurements of the given track. The C matrix and the residual are written starting from the given row.
    *
-   * @param f
-   * @return R3 vector representing a 3D point
-   */
-  [[nodiscard]] virtual Vector3 pi(const Vector3& f) = 0;
-
-  /**
-   * @brief Projection differential function. This function computes the differential of the projection function.
-   *
-   * @param f
-   * @return Differential of the projection function
+   * @param X MSCEqF state
+   * @param xi0 Origin
+   * @param track Track of the feature
+   * @param A_f Triangulated feature in anchor frame
+   * @param C C matrix
+   * @param delta Residual delta
+   * @param Cf Cf matrix (block_rows * track size rows)
+   * @param row_idx Index of the first row of the C matrix and the residual
+   * @param cols_map Map of indices for the C matrix and the residual delta
    */
-  [[nodiscard]] virtual MatrixX dpi(const Vector3& f) = 0;
+  virtual void residualJacobianBlock(const MSCEqFState& X,
+                                     const SystemState& xi0,
+                                     const Track& track,
+                                     const Vector3& A_f,
+                                     MatrixX& C,
+                                     VectorX& delta,
+                                     MatrixX& Cf,
+                                     const size_t& row_idx,
+                                     const ColsMap& cols_map) const = 0;
 
   /**
-   * @brief Computes a block row of the C matrix and a block of the residual, corresponding to the given feature
-   * This method compute the Ct matrix, the Cf matrix and the residual for a given feature.
+   * @brief Computes a block row of the C matrix and a block of the residual, corresponding to the given feature given
+   * as a point in the origin frame. This method compute the Ct matrix, the Cp matrix (differential with respect to the
+   * point in the origin frame) and the residual for a given feature.
    *
    * @param X MSCEqF state
-   * @param feat Feature helper
-   * @param C_block_row Block row of the C matrix
-   * @param delta_block_row Block of the residual delta
-   * @param Cf_block_row Block of the Cf matrix
+   * @param xi0 Origin
+   * @param feat Point feature helper
+   * @param C C matrix
+   * @param delta Residual delta
+   * @param Cp Cp matrix
+   * @param row_idx Index of the row of the C matrix and the residual
+   * @param cp_row_idx Index of the row of the Cp matrix
    * @param cols_map Map of indices for the C matrix and the residual delta
    */
-  virtual void residualJacobianBlock(const MSCEqFState& X,
-                                     const SystemState& xi0,
-                                     const FeatHelper& feat,
-                                     MatrixXBlockRowRef C_block_row,
-                                     VectorXBlockRowRef delta_block_row,
-                                     MatrixXBlockRowRef Cf_block_row,
-                                     const ColsMap& cols_map) = 0;
+  virtual void pointResidualJacobianBlock(const MSCEqFState& X,
+                                          const SystemState& xi0,
+                                          const PointFeatHelper& feat,
+                                          MatrixX& C,
+                                          VectorX& delta,
+                                          MatrixX& Cp,
+                                          const size_t& row_idx,
+                                          const size_t& cp_row_idx,
+                                          const ColsMap& cols_map) const = 0;
 
   /**
    * @brief Get the number of rows of a C matrix block and a residual block
@@ -106,13 +158,62 @@ class ProjectionHelper
 
  protected:
   /// Rule of 5
-  ProjectionHelper(const FeatureRepresentation& feature_representation);
+  ProjectionHelper(const size_t& block_rows, const size_t& dim_loss);
   ProjectionHelper(const ProjectionHelper&) = default;
   ProjectionHelper(ProjectionHelper&&) = default;
   ProjectionHelper& operator=(const ProjectionHelper&) = default;
   ProjectionHelper& operator=(ProjectionHelper&&) = default;
 
-  FeatureRepresentation feature_representation_;  //!< Feature representation
+  /**
+   * @brief Precompute the intrinsics of the camera with the given id.
+   * K = Ki, L = Li, KL = Ki * Li if intrinsics are calibrated, with Ki the intrinsics of the camera at the origin and
+   * Li the In element of the camera, K = L = KL = I otherwise.
+   *
+   * @param X MSCEqF state
+   * @param xi0 Origin
+   * @param cam_id Camera id
+   * @param cols_map Map of indices for the C matrix and the residual delta
+   * @return Camera intrinsics helper
+   */
+  [[nodiscard]] static CameraIntrinsicsHelper cameraIntrinsics(const MSCEqFState& X,
+                                                               const SystemState& xi0,
+                                                               const uint& cam_id,
+                                                               const ColsMap& cols_map);
+
+  /**
+   * @brief Computes the block rows of the C matrix, the Cf matrix and the block of the residual of a track, using the
+   * measurement kernel of the given projection helper. Quantities that are constant along the track (anchor, feature in
+   * origin frame, Jacobian of the feature representation and camera intrinsics) are computed once.
+   *
+   * @tparam Helper Projection helper specialization
+   */
+  template <typename Helper>
+  static void computeResidualJacobianBlock(const MSCEqFState& X,
+                                           const SystemState& xi0,
+                                           const Track& track,
+                                           const Vector3& A_f,
+                                           MatrixX& C,
+                                           VectorX& delta,
+                                           MatrixX& Cf,
+                                           const size_t& row_idx,
+                                           const ColsMap& cols_map);
+
+  /**
+   * @brief Computes a block row of the C matrix, the Cp matrix and the block of the residual of a feature given as a
+   * point in the origin frame, using the measurement kernel of the given projection helper.
+   *
+   * @tparam Helper Projection helper specialization
+   */
+  template <typename Helper>
+  static void computePointResidualJacobianBlock(const MSCEqFState& X,
+                                                const SystemState& xi0,
+                                                const PointFeatHelper& feat,
+                                                MatrixX& C,
+                                                VectorX& delta,
+                                                MatrixX& Cp,
+                                                const size_t& row_idx,
+                                                const size_t& cp_row_idx,
+                                                const ColsMap& cols_map);
 
   size_t block_rows_;  //!< Number of rows of a C matrix block and a residual block
   size_t dim_loss_;    //!< Dimension lost due to nullspace projection
@@ -121,15 +222,22 @@ class ProjectionHelper
 /**
  * @brief ProjectionHelperS2 class.
  * This class provides an implementation of the projection on the unit sphere as well as its differential.
+ * The 3-dimensional residual between the measured and the predicted bearings is reduced to the 2-dimensional tangent
+ * space of the unit sphere at the measured bearing, hence the S2 measurement model does not degrade for features
+ * observed at large angles from the optical axis, and its block size matches the one of the unit plane projection.
  *
+ * @tparam representation Feature representation
+ * @tparam intrinsics_calibration True if the camera intrinsics are calibrated
  */
-class ProjectionHelperS2 : public ProjectionHelper
+template <FeatureRepresentation representation, bool intrinsics_calibration>
+class ProjectionHelperS2 final : public ProjectionHelper
 {
  public:
-  ProjectionHelperS2(const FeatureRepresentation& feature_representation) : ProjectionHelper(feature_representation)
-  {
-    block_rows_ = 3;
-  }
+  static constexpr FeatureRepresentation representation_ = representation;  //!< Feature representation
+  static constexpr int rows_ = 2;                                          //!< Number of rows of a C matrix block
+  static constexpr int cf_cols_ = dimLoss(representation);                 //!< Number of columns of the Cf matrix
+
+  ProjectionHelperS2() : ProjectionHelper(rows_, cf_cols_) {}
 
   /**
    * @brief Projection function. This function projects a 3D point on the unit sphere.
@@ -137,7 +245,7 @@ class ProjectionHelperS2 : public ProjectionHelper
    * @param f
    * @return R3 vector representing a 3D point on the unit sphere
    */
-  [[nodiscard]] Vector3 pi(const Vector3& f) override;
+  [[nodiscard]] static inline Vector3 pi(const Vector3& f) { return f / f.norm(); }
 
   /**
    * @brief Projection differential function. This function computes the differential of the projection function.
@@ -145,48 +253,93 @@ class ProjectionHelperS2 : public ProjectionHelper
    * @param f
    * @return Differential of the S2 projection function
    */
-  [[nodiscard]] MatrixX dpi(const Vector3& f) override;
+  [[nodiscard]] static inline Matrix3 dpi(const Vector3& f)
+  {
+    const fp n = f.norm();
+    return (Matrix3::Identity() - ((f * f.transpose()) / (n * n))) / n;
+  }
 
+  void residualJacobianBlock(const MSCEqFState& X,
+                             const SystemState& xi0,
+                             const Track& track,
+                             const Vector3& A_f,
+                             MatrixX& C,
+                             VectorX& delta,
+                             MatrixX& Cf,
+                             const size_t& row_idx,
+                             const ColsMap& cols_map) const override;
+
+  void pointResidualJacobianBlock(const MSCEqFState& X,
+                                  const SystemState& xi0,
+                                  const PointFeatHelper& feat,
+                                  MatrixX& C,
+                                  VectorX& delta,
+                                  MatrixX& Cp,
+                                  const size_t& row_idx,
+                                  const size_t& cp_row_idx,
+                                  const ColsMap& cols_map) const override;
+
+ private:
   /**
-   * @brief Computes a block row of the C matrix and a block of the residual, corresponding to the given feature
-   * This method compute the Ct matrix, the Cf matrix and the residual for a given feature.
+   * @brief Measurement kernel. Computes the residual and the intrinsics block of the C matrix of a single measurement
+   * of a feature given in the origin frame, and returns the differential of the projection with respect to the
+   * feature in the origin frame D * R^T, where D = f * B * dpi(C_f) and B is the tangent basis at the measured
+   * bearing. The measured bearing is pi(L^-1 * K^-1 * [uv 1]^T) if the intrinsics of the observing camera are
+   * calibrated, since it depends on the intrinsics estimate, hence it is limited to the field of view of the
+   * undistorted image. Otherwise it is the given bearing from the camera model unprojection, which is valid also for
+   * features observed at or beyond 90 degrees from the optical axis
    *
-   * @param X MSCEqF state
-   * @param feat Feature helper
-   * @param C_block_row Block row of the C matrix
-   * @param delta_block_row Block of the residual delta
-   * @param Cf_block_row Block of the Cf matrix
-   * @param cols_map Map of indices for the C matrix and the residual delta
+   * @param intrinsics Camera intrinsics helper
+   * @param clone_E Clone of the measurement
+   * @param G0_f Feature in origin frame
+   * @param uv Measured feature coordinates
+   * @param uvn Measured normalized feature coordinates
+   * @param bearing Measured feature bearing
+   * @param C C matrix
+   * @param delta Residual delta
+   * @param row_idx Index of the row of the C matrix and the residual
+   * @return Differential of the projection with respect to the feature in the origin frame
    */
-  void residualJacobianBlock(const MSCEqFState& X,
-                             const SystemState& xi0,
-                             const FeatHelper& feat,
-                             MatrixXBlockRowRef C_block_row,
-                             VectorXBlockRowRef delta_block_row,
-                             MatrixXBlockRowRef Cf_block_row,
-                             const ColsMap& cols_map) override;
+  [[nodiscard]] static inline Matrix<2, 3> measurementBlock(const CameraIntrinsicsHelper& intrinsics,
+                                                            const SE3& clone_E,
+                                                            const Vector3& G0_f,
+                                                            const Vector2& uv,
+                                                            const Vector2& uvn,
+                                                            const Vector3& bearing,
+                                                            MatrixX& C,
+                                                            VectorX& delta,
+                                                            const Eigen::Index& row_idx);
+
+  friend class ProjectionHelper;  //!< ProjectionHelper runs the measurement kernel along tracks
 };
 
 /**
  * @brief ProjectionHelperZ1 class.
  * This class provides an implementation of the projection on the unit plane as well as its differential.
  *
+ * @tparam representation Feature representation
+ * @tparam intrinsics_calibration True if the camera intrinsics are calibrated
  */
-class ProjectionHelperZ1 : public ProjectionHelper
+template <FeatureRepresentation representation, bool intrinsics_calibration>
+class ProjectionHelperZ1 final : public ProjectionHelper
 {
  public:
-  ProjectionHelperZ1(const FeatureRepresentation& feature_representation) : ProjectionHelper(feature_representation)
-  {
-    block_rows_ = 2;
-  }
+  static constexpr FeatureRepresentation representation_ = representation;  //!< Feature representation
+  static constexpr int rows_ = 2;                                          //!< Number of rows of a C matrix block
+  static constexpr int cf_cols_ = dimLoss(representation);                 //!< Number of columns of the Cf matrix
+
+  ProjectionHelperZ1() : ProjectionHelper(rows_, cf_cols_) {}
 
   /**
    * @brief Projection function. This function projects a 3D point on the unit plane.
    *
    * @param f
-   * @return R2 vector representing a 3D point on the unit plane
+   * @return R3 vector representing a 3D point on the unit plane
    */
-  [[nodiscard]] Vector3 pi(const Vector3& f) override;
+  [[nodiscard]] static inline Vector3 pi(const Vector3& f)
+  {
+    return (Vector3() << f(0) / f(2), f(1) / f(2), 1.0).finished();
+  }
 
   /**
    * @brief Projection differential function. This function computes the differential of the projection function.
@@ -194,55 +347,116 @@ class ProjectionHelperZ1 : public ProjectionHelper
    * @param f
    * @return Differential of the Z1 projection function
    */
-  [[nodiscard]] MatrixX dpi(const Vector3& f) override;
+  [[nodiscard]] static inline Matrix<2, 3> dpi(const Vector3& f)
+  {
+    return (Matrix<2, 3>() << 1.0 / f(2), 0.0, -f(0) / (f(2) * f(2)), 0.0, 1.0 / f(2), -f(1) / (f(2) * f(2)))
+        .finished();
+  }
 
+  void residualJacobianBlock(const MSCEqFState& X,
+                             const SystemState& xi0,
+                             const Track& track,
+                             const Vector3& A_f,
+                             MatrixX& C,
+                             VectorX& delta,
+                             MatrixX& Cf,
+                             const size_t& row_idx,
+                             const ColsMap& cols_map) const override;
+
+  void pointResidualJacobianBlock(const MSCEqFState& X,
+                                  const SystemState& xi0,
+                                  const PointFeatHelper& feat,
+                                  MatrixX& C,
+                                  VectorX& delta,
+                                  MatrixX& Cp,
+                                  const size_t& row_idx,
+                                  const size_t& cp_row_idx,
+                                  const ColsMap& cols_map) const override;
+
+ private:
   /**
-   * @brief Computes a block row of the C matrix and a block of the residual, corresponding to the given feature
-   * This method compute the Ct matrix, the Cf matrix and the residual for a given feature.
+   * @brief Measurement kernel. Computes the residual and the intrinsics block of the C matrix of a single measurement
+   * of a feature given in the origin frame, and returns the differential of the projection with respect to the
+   * feature in the origin frame D * R^T, where D = KL * dpi(C_f) if intrinsics are calibrated, D = dpi(C_f) otherwise
    *
-   * @param X MSCEqF state
-   * @param feat Feature helper
-   * @param C_block_row Block row of the C matrix
-   * @param delta_block_row Block of the residual delta
-   * @param Cf_block_row Block of the Cf matrix
-   * @param cols_map Map of indices for the C matrix and the residual delta
+   * @param intrinsics Camera intrinsics helper
+   * @param clone_E Clone of the measurement
+   * @param G0_f Feature in origin frame
+   * @param uv Measured feature coordinates
+   * @param uvn Measured normalized feature coordinates
+   * @param bearing Measured feature bearing
+   * @param C C matrix
+   * @param delta Residual delta
+   * @param row_idx Index of the row of the C matrix and the residual
+   * @return Differential of the projection with respect to the feature in the origin frame
    */
-  void residualJacobianBlock(const MSCEqFState& X,
-                             const SystemState& xi0,
-                             const FeatHelper& feat,
-                             MatrixXBlockRowRef C_block_row,
-                             VectorXBlockRowRef delta_block_row,
-                             MatrixXBlockRowRef Cf_block_row,
-                             const ColsMap& cols_map) override;
+  [[nodiscard]] static inline Matrix<2, 3> measurementBlock(const CameraIntrinsicsHelper& intrinsics,
+                                                            const SE3& clone_E,
+                                                            const Vector3& G0_f,
+                                                            const Vector2& uv,
+                                                            const Vector2& uvn,
+                                                            const Vector3& bearing,
+                                                            MatrixX& C,
+                                                            VectorX& delta,
+                                                            const Eigen::Index& row_idx);
+
+  friend class ProjectionHelper;  //!< ProjectionHelper runs the measurement kernel along tracks
 };
 
+extern template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_EUCLIDEAN, true>;
+extern template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_EUCLIDEAN, false>;
+extern template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, true>;
+extern template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, false>;
+extern template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_POLAR, true>;
+extern template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_POLAR, false>;
+extern template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_EUCLIDEAN, true>;
+extern template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_EUCLIDEAN, false>;
+extern template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, true>;
+extern template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, false>;
+extern template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_POLAR, true>;
+extern template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_POLAR, false>;
+
 using ProjectionHelperSharedPtr = std::shared_ptr<ProjectionHelper>;
 using ProjectionHelperUniquePtr = std::unique_ptr<ProjectionHelper>;
-using ProjectionHelperZ1SharedPtr = std::shared_ptr<ProjectionHelperZ1>;
-using ProjectionHelperZ1UniquePtr = std::unique_ptr<ProjectionHelperZ1>;
-using ProjectionHelperS2SharedPtr = std::shared_ptr<ProjectionHelperS2>;
-using ProjectionHelperS2UniquePtr = std::unique_ptr<ProjectionHelperS2>;
 
 /**
- * @brief Factory method for ProjectionHelper
+ * @brief Factory method for ProjectionHelper. This method dispatches the given (runtime) feature representation and
+ * intrinsics calibration flag to the corresponding compile-time specialization of the given projection helper
  *
- * @tparam T
+ * @tparam T Projection helper class template
+ * @param feature_representation Feature representation
+ * @param intrinsics_calibration True if the camera intrinsics are calibrated
  * @return ProjectionHelperUniquePtr
  */
-template <typename T>
+template <template <FeatureRepresentation, bool> typename T>
 [[nodiscard]] static ProjectionHelperUniquePtr createProjectionHelper(
-    const FeatureRepresentation& feature_representation)
+    const FeatureRepresentation& feature_representation, const bool& intrinsics_calibration)
 {
-  if constexpr (std::is_base_of_v<ProjectionHelper, T>)
-  {
-    return std::make_unique<T>(feature_representation);
-  }
-  else
+  switch (feature_representation)
   {
-    return nullptr;
+    case FeatureRepresentation::ANCHORED_EUCLIDEAN:
+      if (intrinsics_calibration)
+      {
+        return std::make_unique<T<FeatureRepresentation::ANCHORED_EUCLIDEAN, true>>();
+      }
+      return std::make_unique<T<FeatureRepresentation::ANCHORED_EUCLIDEAN, false>>();
+    case FeatureRepresentation::ANCHORED_INVERSE_DEPTH:
+      if (intrinsics_calibration)
+      {
+        return std::make_unique<T<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, true>>();
+      }
+      return std::make_unique<T<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, false>>();
+    case FeatureRepresentation::ANCHORED_POLAR:
+      if (intrinsics_calibration)
+      {
+        return std::make_unique<T<FeatureRepresentation::ANCHORED_POLAR, true>>();
+      }
+      return std::make_unique<T<FeatureRepresentation::ANCHORED_POLAR, false>>();
   }
+  return nullptr;
 }
 
+
 /**
  * @brief Updater helper struct.
  * This structs implements common helper methods for MSCEqF update.
@@ -258,6 +472,14 @@ struct UpdaterHelper
    */
   [[nodiscard]] static Matrix<2, 4> Xi(const Vector3& f);
 
+  /**
+   * @brief Orthonormal basis of the tangent space of the unit sphere at the given bearing
+   *
+   * @param b Bearing (unit vector)
+   * @return 2x3 matrix whose rows span the tangent space at b
+   */
+  [[nodiscard]] static Matrix<2, 3> tangentBasis(const Vector3& b);
+
   /**
    * @brief Compute the Jacobian for inverse depth parametrization, used in the Cf matrix
    *
@@ -266,6 +488,46 @@ struct UpdaterHelper
    */
   [[nodiscard]] static Matrix3 inverseDepthJacobian(const Vector3& A_f);
 
+  /**
+   * @brief Compute the Jacobian of the feature in the anchor frame with respect to its parametrization, used in the Cf
+   * matrix
+   *
+   * @tparam representation Feature representation
+   * @param A_f Given feature in the anchor frame
+   * @return Jacobian matrix of the feature representation
+   */
+  template <FeatureRepresentation representation>
+  [[nodiscard]] static Matrix<3, dimLoss(representation)> featureJacobian(const Vector3& A_f)
+  {
+    if constexpr (representation == FeatureRepresentation::ANCHORED_EUCLIDEAN)
+    {
+      return Matrix3::Identity();
+    }
+    else if constexpr (representation == FeatureRepresentation::ANCHORED_INVERSE_DEPTH)
+    {
+      return inverseDepthJacobian(A_f);
+    }
+    else
+    {
+      Vector3 A_f0 = (Vector3() << 0.0, 0.0, 1.0).finished();
+      Vector3 thetak = std::acos(A_f0.normalized().dot(A_f.normalized())) * A_f0.cross(A_f).normalized();
+      Matrix<3, 4> J = Matrix<3, 4>::Zero();
+      J.block<3, 3>(0, 0) = SO3::wedge(A_f) * SO3::leftJacobian(thetak);
+      J.block<3, 1>(0, 3) = -A_f;
+      return J;
+    }
+  }
+
+  /**
+   * @brief Compute the differential of the persistent feature in origin frame G0_f = Q^-1 * G0_f0 with respect to a
+   * left perturbation of the SOT3 element Q
+   *
+   * @param Q SOT3 element of the persistent feature
+   * @param G0_f0 Persistent feature of the origin expressed in origin frame
+   * @return Jacobian matrix of the persistent feature
+   */
+  [[nodiscard]] static Matrix<3, 4> persistentFeatureJacobian(const SOT3& Q, const Vector3& G0_f0);
+
   /**
    * @brief Perform in-place nullspace projection of the Cf matrix on the Ct matrix and the residual using QR
    * decomposition
@@ -284,6 +546,18 @@ struct UpdaterHelper
    */
   static void updateQRCompression(MatrixX& C, VectorX& delta);
 
+  /**
+   * @brief Perform in-place compression of the first given rows of the C matrix and the residual using QR
+   * decomposition. The first rows of the C matrix are replaced by the upper triangular (square root information)
+   * factor, and the corresponding rows of the residual by the rotated residual. This allows to fold blocks of rows
+   * into the factor as they are computed, keeping the size of the C matrix bounded.
+   *
+   * @param C C matrix
+   * @param delta Residual
+   * @param rows Number of valid rows of C and residual, set to the number of rows of the factor
+   */
+  static void updateQRAccumulation(MatrixX& C, VectorX& delta, size_t& rows);
+
   /**
    * @brief Perform chi2 test (based on precomputed table) on the given block of the residual
    *
@@ -49,12 +49,25 @@ class ZeroVelocityUpdater
   /**
    * @brief Check whether the zero velocity updater is active
    *
-   * @param tracks tracks up to date used for disparity check
+   * @param stats Disparity statistics of the tracks up to date used for disparity check
    *
    * @return true if the zero velocity updater is active, and therefore the platform is in static phase, false
    * otherwise
    */
-  [[nodiscard]] bool isActive(const Tracks& tracks);
+  [[nodiscard]] bool isActive(const DisparityStatistics& stats);
+
+  /**
+   * @brief Check whether the platform is at standstill based on the IMU readings only. The time spent with IMU readings
+   * whose variance is below the given thresholds is accumulated, and standstill is detected once it exceeds the
+   * standstill window. This does not require the frontend, which can hence be skipped while at standstill.
+   *
+   * @param acc_var Variance of the acceleration readings since the last check
+   * @param ang_var Variance of the angular velocity readings since the last check
+   * @param dt Time elapsed since the last check
+   *
+   * @return true if the zero velocity updater is active and the platform is at standstill, false otherwise
+   */
+  [[nodiscard]] bool isStandstill(const fp& acc_var, const fp& ang_var, const fp& dt);
 
   /**
    * @brief Perform a zero velocity update
@@ -74,6 +87,8 @@ class ZeroVelocityUpdater
   SE23 y_;  //!< Static extended pose
 
   bool motion_;  //!< Flag indicating whether we have moved
+
+  fp standstill_time_;  //!< Time elapsed with IMU readings below the standstill thresholds
 };
 
 }  // namespace msceqf
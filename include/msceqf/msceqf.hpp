@@ -12,7 +12,10 @@
 #ifndef MSCEQF_HPP
 #define MSCEQF_HPP
 
-#include <future>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "msceqf/filter/initializer/static_initializer.hpp"
 #include "msceqf/filter/propagator/propagator.hpp"
@@ -20,7 +23,11 @@
 #include "msceqf/filter/updater/zero_velocity_updater.hpp"
 #include "msceqf/options/msceqf_option_parser.hpp"
 #include "msceqf/state/state.hpp"
+#include "msceqf/stats/latency_stats.hpp"
 #include "vision/track_manager.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/trace_recorder.hpp"
+#include "utils/track_cache.hpp"
 #include "utils/visualizer.hpp"
 
 namespace msceqf
@@ -32,8 +39,16 @@ class MSCEqF
    * @brief MSCEqF Constructor
    *
    * @param params_filepath filepath of the parameter file to be parsed
+   * @param executor thread pool used for the parallel parts of the filter step, it can be shared among multiple MSCEqF
+   * instances to bound the number of threads. If not given, the instance creates its own thread pool
    */
-  MSCEqF(const std::string& params_filepath);
+  MSCEqF(const std::string& params_filepath, const std::shared_ptr<utils::threadPool>& executor = nullptr);
+
+  /**
+   * @brief MSCEqF Destructor. The latency statistics and the trace are written to the configured files (if any)
+   *
+   */
+  ~MSCEqF();
 
   /**
    * @brief Process IMU measurement.
@@ -49,6 +64,27 @@ class MSCEqF
    */
   void processMeasurement(Camera& meas) { processCameraMeasurement(meas); }
 
+  /**
+   * @brief Process camera measurement given as a view on a borrowed grayscale buffer.
+   * Tracking is performed directly on the borrowed memory, no copy of the image is made.
+   *
+   * @param meas Camera view
+   */
+  void processMeasurement(const CameraView& meas)
+  {
+    Camera cam = meas.camera();
+    processCameraMeasurement(cam);
+  }
+
+  /**
+   * @brief Process synchronized camera measurements from a multi-camera rig. The first measurement is the one of the
+   * primary camera, followed by the measurements of the secondary cameras in the order they are defined in the
+   * configuration file.
+   *
+   * @param meas Camera measurements
+   */
+  void processMeasurement(std::vector<Camera>& meas) { processCamerasMeasurement(meas); }
+
   /**
    * @brief Process triangulated features measurement.
    *
@@ -56,6 +92,17 @@ class MSCEqF
    */
   void processMeasurement(TriangulatedFeatures& meas) { processFeaturesMeasurement(meas); }
 
+  /**
+   * @brief Record the output of the tracker (features of each processed frame) in the given track cache file. The
+   * recorded features can be replayed, without running the tracker, as triangulated features measurements.
+   *
+   * @param filename Name of the track cache file
+   *
+   * @note Only single camera measurements are recorded. Since features are normalized with the camera intrinsics at
+   * the time of recording, replays are meaningful as long as camera intrinsics calibration is disabled.
+   */
+  void recordTracks(const std::string& filename);
+
   /**
    * @brief Get a constant reference to the MSCEqF options
    *
@@ -63,6 +110,15 @@ class MSCEqF
    */
   const MSCEqFOptions& options() const;
 
+  /**
+   * @brief Get a constant reference to the latency statistics of the MSCEqF pipeline stages
+   *
+   * @return Latency statistics
+   *
+   * @note Latencies are recorded only if the ENABLE_LATENCY_STATS CMake option is set
+   */
+  const LatencyStats& latencyStats() const;
+
   /**
    * @brief Get a constant reference to the MSCEqF state options
    *
@@ -157,6 +213,22 @@ class MSCEqF
    */
   void processCameraMeasurement(Camera& cam);
 
+  /**
+   * @brief Track the given camera measurement, and record the output of the tracker if requested
+   *
+   * @param cam Camera measurement
+   */
+  void trackCamera(Camera& cam);
+
+  /**
+   * @brief Process synchronized camera measurements from a multi-camera rig. This method behaves as
+   * processCameraMeasurement, with the images of all the cameras processed in parallel. Secondary cameras are assumed
+   * synchronized with the primary camera, hence they share the clone at the primary camera timestamp.
+   *
+   * @param cams Camera measurements (primary camera first)
+   */
+  void processCamerasMeasurement(std::vector<Camera>& cams);
+
   /**
    * @brief Process triangulated features measurement. This method first perform propagation of the filter state from
    * the previous timestamp to the actual timestamp using the IMU measurement collected in between camera images. After
@@ -171,22 +243,48 @@ class MSCEqF
   void processFeaturesMeasurement(TriangulatedFeatures& features);
 
   /**
-   * @brief Try to initialize the origin at the time of the given features measurement.
-   * This method either perform static initialization waiting for motion to be detected or dircetly initialize origin
-   * and filter if zero velocity update is enabled.
+   * @brief Apply the camera-imu time shift and the static mask to the given camera measurement
    *
    * @param cam Camera measurement
+   * @param opts Tracker options of the camera
    */
-  void initialize(Camera& cam);
+  void preprocessCamera(Camera& cam, const TrackerOptions& opts) const;
 
   /**
-   * @brief Try to initialize the origin at the time of the given camera measurement.
+   * @brief Perform a single filter step at the given timestamp. Propagation runs in parallel with the given frontend
+   * function (tracking or features processing), followed by zero velocity update or stochastic cloning, update with the
+   * collected tracks, and marginalization.
+   *
+   * @param timestamp Timestamp of the measurement
+   * @param frontend Frontend function updating the tracks of the track manager
+   */
+  void filterStep(const fp& timestamp, const std::function<void()>& frontend);
+
+  /**
+   * @brief Perform a zero velocity update. The static extended pose measurement is set from the actual estimate at the
+   * first zero velocity update of a static phase, and it is kept for the following ones.
+   *
+   */
+  void zeroVelocityStep();
+
+  /**
+   * @brief Handle the persistent features at the given timestamp. Persistent features that are not tracked anymore are
+   * marginalized, the tracked ones are used for an update, and new persistent features are initialized from the
+   * longest active tracks until the maximum number of persistent features is reached.
+   *
+   * @param timestamp Timestamp of the measurement (timestamp of the newest clone)
+   */
+  void persistentFeaturesStep(const fp& timestamp);
+
+  /**
+   * @brief Try to initialize the origin at the time of the given measurement.
    * This method either perform static initialization waiting for motion to be detected or dircetly initialize origin
    * and filter if zero velocity update is enabled.
    *
-   * @param features features measurement
+   * @param timestamp Timestamp of the measurement
+   * @param frontend Frontend function updating the tracks of the track manager
    */
-  void initialize(TriangulatedFeatures& features);
+  void initialize(const fp& timestamp, const std::function<void()>& frontend);
 
   /**
    * @brief Set origin xi0 with given state from parameters file
@@ -203,6 +301,10 @@ class MSCEqF
   OptionParser parser_;  //!< The parser to parse all the configuration from a yaml file
   MSCEqFOptions opts_;   //!< All the MSCEqF options
 
+  std::shared_ptr<utils::threadPool> executor_;  //!< Thread pool (possibly shared with other instances)
+  std::shared_ptr<LatencyStats> stats_;          //!< Latency statistics of the pipeline stages
+  std::unique_ptr<utils::traceRecorder> trace_;  //!< Trace recorder of the pipeline stages (null if not tracing)
+
   SystemState xi0_;  //!< The origin state of the System
   MSCEqFState X_;    //!< The state of the MSCEqF
   SystemState xi_;   //!< The state of the System in the homogeneous space
@@ -215,7 +317,10 @@ class MSCEqF
   ZeroVelocityUpdater zvupdater_;  //!< The MSCEqF zero velocity updater
   Visualizer visualizer_;          //<! The MSCEqF visualizer
 
+  std::unique_ptr<utils::trackCacheWriter> track_cache_writer_;  //!< Writer of the tracker output (if recording)
+
   std::unordered_set<uint> ids_to_update_;  //!< Ids of track to update
+  std::unordered_set<uint> promoted_ids_;   //!< Ids of track promoted to persistent features in the actual step
 
   fp timestamp_;  //!< The timestamp of the actual estimate
 
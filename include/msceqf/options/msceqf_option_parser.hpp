@@ -43,6 +43,24 @@ namespace msceqf
     MSCEqFOptions parseOptions();
 
   private:
+    /**
+   * @brief Option parser constructor from an already loaded YAML node (used for nested configurations)
+   *
+   * @param node YAML node
+   * @param filepath Parameter file the node belongs to
+   */
+    OptionParser(const YAML::Node &node, const std::string &filepath);
+
+    /**
+   * @brief Parse the secondary cameras. Each secondary camera is defined as an element of the secondary_cameras list,
+   * with the same camera parameters of the primary camera (Kalibr convention). Secondary cameras share the tracker
+   * options of the primary camera. Their extrinsics, with respect to the primary camera, are estimated online as well
+   * as their intrinsics if intrinsics calibration is enabled, with the initial covariance of the primary camera.
+   *
+   * @param opts MSCEqF options
+   */
+    void parseSecondaryCameras(MSCEqFOptions &opts);
+
     /**
    * @brief Read a parameter from the YAML file and store it in a matrix or vector.
    * A vector needs to be specified as [a, b, c, ..., z] in the YAMl file.
@@ -239,6 +257,13 @@ namespace msceqf
    */
     void parseProjectionMethod(ProjectionMethod &proj);
 
+    /**
+   * @brief Parse the clone marginalization policy
+   *
+   * @param policy
+   */
+    void parseMarginalizationPolicy(MarginalizationPolicy &policy);
+
     /**
    * @brief Parse the feature detector type
    *
@@ -15,6 +15,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "types/fptypes.hpp"
+#include "utils/logger.hpp"
 
 namespace msceqf
 {
@@ -92,20 +93,39 @@ enum class MaskType
   DYNAMIC,
 };
 
+/**
+ * @brief The clone marginalization policies. Oldest always marginalizes the oldest clone. Motion and parallax keep
+ * keyframes only, marginalizing the second newest clone if the motion (or the rotation-compensated parallax) between the
+ * newest clone and the last keyframe is below a threshold, and the oldest clone otherwise.
+ *
+ */
+enum class MarginalizationPolicy
+{
+  OLDEST,
+  MOTION,
+  PARALLAX,
+};
+
 /// @note The camera extrinsics are interpreted as IC_S, thus IC_S transofrm vectors in camera frame to vectors in imu
 /// frame according to the following equation: I_x = IC_S * C_x
 struct StateOptions
 {
-  Matrix9 D_init_cov_;                         //!< Initial covariance of the D element of the state
-  Matrix6 delta_init_cov_;                     //!< Initial covariance of the delta element of the state
-  Matrix6 E_init_cov_;                         //!< Initial covariance of the E element of the state
-  Matrix4 L_init_cov_;                         //!< Initial covariance of the L element of the state
-  SE3 initial_camera_extrinsics_;              //!< Initial camera extrinsics
-  In initial_camera_intrinsics_;               //!< Initial camera intrinsics
-  bool enable_camera_intrinsics_calibration_;  //!< Boolean to enable intinsic camera calibration
-  fp gravity_;                                 //!< The magnitude of the gravity vector in m/s^2
-  uint num_clones_;                            //!< The maximum number of stochastic clones
-  uint num_persistent_features_;               //!< The maximum number of persistent (SLAM) features
+  Matrix9 D_init_cov_;                             //!< Initial covariance of the D element of the state
+  Matrix6 delta_init_cov_;                         //!< Initial covariance of the delta element of the state
+  Matrix6 E_init_cov_;                             //!< Initial covariance of the E element of the state
+  Matrix4 L_init_cov_;                             //!< Initial covariance of the L element of the state
+  SE3 initial_camera_extrinsics_;                  //!< Initial camera extrinsics
+  In initial_camera_intrinsics_;                   //!< Initial camera intrinsics
+  bool enable_camera_intrinsics_calibration_;      //!< Boolean to enable intinsic camera calibration
+  fp gravity_;                                     //!< The magnitude of the gravity vector in m/s^2
+  uint num_clones_;                                //!< The maximum number of stochastic clones
+  uint num_persistent_features_;                   //!< The maximum number of persistent (SLAM) features
+  std::vector<SE3> secondary_cameras_extrinsics_;  //!< Initial extrinsics of secondary cameras (C0_S_Ci)
+  std::vector<In> secondary_cameras_intrinsics_;   //!< Initial intrinsics of secondary cameras
+  MarginalizationPolicy marginalization_policy_;   //!< The clone marginalization policy
+  fp keyframe_translation_threshold_;              //!< Minimum translation (in meters) between keyframes
+  fp keyframe_rotation_threshold_;                 //!< Minimum rotation (in degrees) between keyframes
+  fp keyframe_parallax_threshold_;                 //!< Minimum mean parallax (in pixels) between keyframes
 };
 
 struct PropagatorOptions
@@ -131,12 +151,23 @@ struct UpdaterOptions
   fp min_angle_;                                       //!< Minimum angle (in degrees) between views for trianglulation
   fp pixel_std_;                                       //!< The pixel standard deviation
   bool curvature_correction_;                          //!< Boolean to enable the curvature correction
+  uint persistent_feature_min_track_length_;           //!< Minimum track length to promote a persistent feature
+  bool streaming_update_;                              //!< Boolean to enable the streaming update accumulation
+  uint max_update_rows_;                               //!< Maximum rows of the MSC update (0 for unlimited)
+  fp update_time_budget_;                              //!< Time budget of the MSC update in ms (0 for unlimited)
+  fp selection_max_parallax_;                          //!< Parallax cap (normalized coordinates) of the tracks score
+  uint selection_grid_size_;                           //!< Cells per side of the grid for the tracks selection
+  bool use_features_points_;                           //!< Boolean to use given 3D points instead of triangulation
 };
 
 struct ZeroVelocityUpdaterOptions
 {
   ZeroVelocityUpdate zero_velocity_update_;  //!< The zero velocity update method
   bool curvature_correction_;                //!< Boolean to enable the curvature correction on the zero velocity update
+  bool imu_standstill_detection_;            //!< Boolean to enable the IMU-based standstill detection
+  fp imu_standstill_window_;                 //!< The window in seconds of IMU readings with low variance for standstill
+  fp imu_standstill_acc_threshold_;          //!< The acceleration variance threshold for standstill in (m/s^2)^2
+  fp imu_standstill_ang_threshold_;          //!< The angular velocity variance threshold for standstill in (rad/s)^2
 };
 
 struct InitializerOptions
@@ -176,6 +207,17 @@ struct GFTTOptions
   fp quality_level_;  //!< Shi-Tomasi detector quality level (The lower the more feature are detected/accepted)
 };
 
+struct FeatureBudgetOptions
+{
+  bool enable_;                       //!< Boolean to enable the adaptive feature budget controller
+  fp target_frame_time_;              //!< Target frame processing time in milliseconds
+  fp tolerance_;                      //!< Relative band around the target frame time in which nothing is adapted
+  fp smoothing_;                      //!< Smoothing factor (0, 1] of the moving average of the frame processing time
+  uint min_max_features_;             //!< Lower bound for the maximum number of features
+  uint min_detector_pyramid_levels_;  //!< Lower bound for the pyramids levels for feature detection (1-based)
+  uint min_optical_flow_win_size_;    //!< Lower bound for the optical flow window size
+};
+
 struct TrackerOptions
 {
   CameraOptions cam_options_;         //!< The camera options
@@ -190,16 +232,25 @@ struct TrackerOptions
   uint optical_flow_pyramid_levels_;  //!< Pyramids levels for optical flow (1-based)
   uint detector_pyramid_levels_;      //!< Pyramids levels for feature detection (1-based)
   uint optical_flow_win_size_;        //!< Window size for optical flow
-  int opencv_threads_;                //!< Number of threads for opencv
+  int opencv_threads_;                //!< Number of threads for opencv (process-wide)
   fp ransac_reprojection_;            //!< RANSAC reprojection threshold
   FastOptions fast_opts_;             //!< Fast feature detector options
   GFTTOptions gftt_opts_;             //!< Shi-Tomasi feature detector options
+  FeatureBudgetOptions budget_opts_;  //!< Adaptive feature budget options
 };
 
 struct TrackManagerOptions
 {
-  TrackerOptions tracker_options_;  //!< The vision tracker options
-  size_t max_track_length_;         //!< The maximul length of a track
+  TrackerOptions tracker_options_;                          //!< The vision tracker options (primary camera)
+  std::vector<TrackerOptions> secondary_trackers_options_;  //!< The vision tracker options (secondary cameras)
+  size_t max_track_length_;                                 //!< The maximul length of a track
+};
+
+struct SchedulerOptions
+{
+  bool drop_frames_;       //!< Boolean to enable frame dropping (process only the newest frame when behind)
+  fp frame_deadline_;      //!< Per-frame deadline in ms from arrival to end of processing (late frames may be dropped)
+  size_t max_queue_size_;  //!< The maximum number of frames waiting to be processed
 };
 
 struct MSCEqFOptions
@@ -211,6 +262,11 @@ struct MSCEqFOptions
   PropagatorOptions propagator_options_;          //!< The propagator options
   UpdaterOptions updater_options_;                //!< The updater options
   ZeroVelocityUpdaterOptions zvupdater_options_;  //!< The zero velocity updater options
+  SchedulerOptions scheduler_options_;            //!< The measurement scheduler options
+  utils::LoggerLevel logger_level_;               //!< The logger level of the MSCEqF instance
+  std::string latency_stats_filepath_;            //!< File the latency statistics are written to (none if empty)
+  std::string trace_filepath_;                    //!< File the Chrome trace is written to (no tracing if empty)
+  size_t trace_buffer_size_;                      //!< Maximum number of buffered trace events
 };
 
 }  // namespace msceqf
@@ -0,0 +1,149 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef MEASUREMENT_SCHEDULER_HPP
+#define MEASUREMENT_SCHEDULER_HPP
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "msceqf/msceqf.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Statistics of the measurement scheduler
+ *
+ */
+struct SchedulerStats
+{
+  /**
+   * @brief Get a string representation of the statistics
+   *
+   * @return String
+   */
+  std::string toString() const;
+
+  size_t received_ = 0;     //!< Number of received frames
+  size_t processed_ = 0;    //!< Number of processed frames
+  size_t dropped_ = 0;      //!< Number of dropped frames (skipped because behind, expired or the queue was full)
+  size_t expired_ = 0;      //!< Number of frames dropped because they missed their deadline before being processed
+  size_t late_ = 0;         //!< Number of processed frames that missed their deadline
+  fp max_lateness_ = 0;     //!< Maximum lateness (time past the deadline) in milliseconds
+  fp mean_latency_ = 0;     //!< Mean latency (from arrival to end of processing) in milliseconds
+  fp mean_processing_ = 0;  //!< Mean processing time in milliseconds
+};
+
+/**
+ * @brief This class implements a deadline-aware scheduler for camera measurements in front of the MSCEqF.
+ * Camera measurements are queued (sorted by timestamp) as they arrive, and processed once IMU measurements up to their
+ * timestamp are available. When the filter falls behind, that is more than a single frame is ready to be processed,
+ * all the ready frames but the newest one are dropped. A ready frame that already missed its deadline is dropped as
+ * well if a newer frame is queued, since processing it would make the newer frame late too. The newest queued frame is
+ * never dropped for being late, hence the filter is not starved of frames when processing is consistently slow.
+ * Dropping frames does not lose inertial information since propagation integrates all the buffered IMU measurements
+ * from the actual estimate to the newest frame, hence propagation is merged across dropped frames. The scheduler keeps
+ * track of dropped frames and of frames that missed their deadline.
+ *
+ * @note IMU measurements are forwarded directly to the filter. Frames have to be processed from a single thread.
+ */
+class MeasurementScheduler
+{
+ public:
+  using clock = std::chrono::steady_clock;
+  using ProcessedCallback = std::function<void(const Camera&)>;
+
+  /**
+   * @brief MeasurementScheduler constructor
+   *
+   * @param sys MSCEqF system fed by the scheduler
+   */
+  MeasurementScheduler(MSCEqF& sys);
+
+  /**
+   * @brief Forward an IMU measurement to the filter
+   *
+   * @param imu IMU measurement
+   */
+  void push(const Imu& imu);
+
+  /**
+   * @brief Queue a camera measurement
+   *
+   * @param cam Camera measurement
+   */
+  void push(const Camera& cam);
+
+  /**
+   * @brief Queue a camera view. The view is kept alive until the frame is processed or dropped.
+   *
+   * @param cam Camera view
+   */
+  void push(CameraView&& cam);
+
+  /**
+   * @brief Process the queued frames older than the given timestamp (typically the timestamp of the latest IMU
+   * measurement). If frame dropping is enabled and more than one frame is ready, only the newest one is processed. A
+   * frame that already missed its deadline is dropped instead if a newer frame is queued.
+   *
+   * @param timestamp Timestamp up to which frames can be processed
+   * @param callback Callback invoked after each processed frame
+   * @return Number of processed frames
+   */
+  size_t process(const fp& timestamp, const ProcessedCallback& callback = nullptr);
+
+  /**
+   * @brief Get the number of frames waiting to be processed
+   *
+   * @return Number of queued frames
+   */
+  [[nodiscard]] size_t queued() const;
+
+  /**
+   * @brief Get the scheduler statistics
+   *
+   * @return Scheduler statistics
+   */
+  [[nodiscard]] SchedulerStats stats() const;
+
+ private:
+  /**
+   * @brief Frame waiting to be processed
+   *
+   */
+  struct Frame
+  {
+    Camera cam_;                 //!< Camera measurement (references the view buffer if given as view)
+    CameraView view_;            //!< Camera view (empty if the frame has been given as camera measurement)
+    clock::time_point arrival_;  //!< Arrival time
+  };
+
+  /**
+   * @brief Insert a frame in the queue keeping it sorted by timestamp, and drop the oldest frame if the queue is full
+   *
+   * @param frame Frame
+   */
+  void enqueue(Frame&& frame);
+
+  MSCEqF& sys_;            //!< MSCEqF system
+  SchedulerOptions opts_;  //!< Scheduler options
+
+  std::deque<Frame> frames_;  //!< Queued frames sorted by timestamp
+  SchedulerStats stats_;      //!< Scheduler statistics
+  mutable std::mutex mutex_;  //!< Mutex guarding queue and statistics
+};
+
+}  // namespace msceqf
+
+#endif  // MEASUREMENT_SCHEDULER_HPP
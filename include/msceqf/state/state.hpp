@@ -18,6 +18,7 @@
 #include "msceqf/system/system.hpp"
 #include "msceqf/options/msceqf_options.hpp"
 #include "msceqf/state/state_elements.hpp"
+#include "types/camera_key.hpp"
 
 namespace msceqf
 {
@@ -29,7 +30,8 @@ namespace msceqf
 class MSCEqFState
 {
  public:
-  using MSCEqFStateKey = std::variant<MSCEqFStateElementName, uint>;  //!< Key to access the msceqf state map
+  using MSCEqFCameraKey = CameraKey<MSCEqFStateElementName>;  //!< Key of the calibration of the secondary cameras
+  using MSCEqFStateKey = std::variant<MSCEqFStateElementName, uint, MSCEqFCameraKey>;  //!< Key to access the state map
   using MSCEqFKey = std::variant<MSCEqFStateKey, fp>;                 //!< Key to access the msceqf state and clones map
 
   using MSCEqFStateMap = std::unordered_map<MSCEqFStateKey, MSCEqFStateElementSharedPtr>;  //!< MSCEqF state map
@@ -115,6 +117,28 @@ class MSCEqFState
    */
   [[nodiscard]] const In& L() const;
 
+  /**
+   * @brief Get a reference to the SE3 element of the MSCEqF state acting on the extrinsic calibration of the camera
+   * with the given id. For secondary cameras this element acts on the extrinsics with respect to the primary camera.
+   *
+   * @param cam_id Camera id
+   * @return SE3 group element of the MSCEqF state representing the element acting on the camera extrinsics
+   *
+   * @note This function does not introduce any runtime overhead due to casting, because it uses static_pointer_cast
+   */
+  [[nodiscard]] const SE3& E(const uint& cam_id) const;
+
+  /**
+   * @brief Get a reference to the In element of the MSCEqF state acting on the intrinsic calibration of the camera with
+   * the given id
+   *
+   * @param cam_id Camera id
+   * @return In group element of the MSCEqF state representing the element acting on the camera intrinsics
+   *
+   * @note This function does not introduce any runtime overhead due to casting, because it uses static_pointer_cast
+   */
+  [[nodiscard]] const In& L(const uint& cam_id) const;
+
   /**
    * @brief Get a reference to the SOT3 element of the MSCEqF state that correspond to the given feature id
    *
@@ -125,6 +149,28 @@ class MSCEqFState
    */
   [[nodiscard]] const SOT3& Q(const uint& feat_id) const;
 
+  /**
+   * @brief Check if a persistent feature with the given id is part of the MSCEqF state
+   *
+   * @param feat_id Feature id
+   * @return true if the persistent feature is in the state, false otherwise
+   */
+  [[nodiscard]] bool hasPersistentFeature(const uint& feat_id) const;
+
+  /**
+   * @brief Get the ids of the persistent features in the MSCEqF state
+   *
+   * @return Ids of the persistent features
+   */
+  [[nodiscard]] std::vector<uint> persistentFeaturesIds() const;
+
+  /**
+   * @brief Get the amount of persistent features in the MSCEqF state
+   *
+   * @return Number of persistent features
+   */
+  [[nodiscard]] size_t persistentFeaturesSize() const;
+
   /**
    * @brief Get a reference to the SE3 element of the MSCEqF clones that correspond to the given timestamp
    *
@@ -135,6 +181,18 @@ class MSCEqFState
    */
   [[nodiscard]] const SE3& clone(const fp& timestamp) const;
 
+  /**
+   * @brief Get the SE3 element of the MSCEqF clones that correspond to the given timestamp, expressed for the given
+   * camera. For the primary camera (id 0) this is the clone itself, for secondary cameras the clone is composed with
+   * the extrinsics of the secondary camera with respect to the primary camera at the origin, and with the E element of
+   * the secondary camera (clone * C0_S_Ci * E_i).
+   *
+   * @param timestamp Timestamp
+   * @param cam_id Camera id
+   * @return SE3 group element of the MSCEqF clones for the given camera
+   */
+  [[nodiscard]] SE3 clone(const fp& timestamp, const uint& cam_id) const;
+
   /**
    * @brief Get a reference to the index of the state element or the clone element corresponding to the given key
    *
@@ -158,13 +216,31 @@ class MSCEqFState
    */
   [[nodiscard]] inline size_t clonesSize() const { return clones_.size(); }
 
+  /**
+   * @brief Get the timestamps of all the clones, from the oldest to the newest
+   *
+   * @return Timestamps of the clones
+   */
+  [[nodiscard]] std::vector<fp> clonesTimestamps() const;
+
+  /**
+   * @brief Get the timestamp of the oldest clone
+   *
+   * @return Timestamp of the oldest clone
+   */
+  [[nodiscard]] const fp& oldestCloneTimestamp() const;
+
   /**
    * @brief Get the timestamp of the clone to marginalize.
-   * We implement our keyframing strategy here. So far we simply marginalize the oldest clone.
+   * We implement our keyframing strategy here, according to the marginalization policy. With the oldest policy the
+   * oldest clone is marginalized. With the motion and parallax policies the second newest clone is marginalized if the
+   * motion (or the given mean parallax) between the newest clone and the clone preceding the second newest one (last
+   * keyframe) is below threshold, and the oldest clone otherwise.
    *
+   * @param parallax Mean parallax in pixels between the last keyframe and the newest clone, negative if not available
    * @return Timestamp of the clone to marginalize
    */
-  [[nodiscard]] const fp& cloneTimestampToMarginalize() const;
+  [[nodiscard]] const fp& cloneTimestampToMarginalize(const fp& parallax = -1) const;
 
   /**
    * @brief Get a reference to the covariance matrix
@@ -212,7 +288,7 @@ class MSCEqFState
   /**
    * @brief Initialize MSCEqF state element into the state map, and the relative covariance block.
    *
-   * @param key State element name or feature id
+   * @param key State element name, feature id or camera key
    * @param cov_block Corresponding blcok of the covariance matrix
    *
    * @note Note that the MSCEqF states are always initialized at the identity. This is correct since is xi0 that
@@ -228,6 +304,13 @@ class MSCEqFState
    */
   void stochasticCloning(const fp& timestamp);
 
+  /**
+   * @brief Marginalize out the persistent feature with the given id
+   *
+   * @param feat_id Id of the persistent feature to marginalize
+   */
+  void marginalizeFeature(const uint& feat_id);
+
   /**
    * @brief Marginalize out clone at a given timestamp
    *
@@ -235,10 +318,20 @@ class MSCEqFState
    */
   void marginalizeCloneAt(const fp& timestamp);
 
+  /**
+   * @brief Get the key of the calibration element (E or L) of the camera with the given id. This is the name of the
+   * element for the primary camera, and a camera key for the secondary cameras.
+   *
+   * @param name Name of the calibration element (E or L)
+   * @param cam_id Camera id
+   * @return Key of the calibration element
+   */
+  static MSCEqFStateKey cameraKey(const MSCEqFStateElementName& name, const uint& cam_id);
+
   /**
    * @brief Get a string describing the given MSCEqFStateKey
    *
-   * @param key State element name or feature id
+   * @param key State element name, feature id or camera key
    * @return Key as string
    */
   static std::string toString(const MSCEqFStateKey& key);
@@ -267,12 +360,33 @@ class MSCEqFState
    */
   [[nodiscard]] const MSCEqFState operator*(const MSCEqFState& other) const;
 
+  /**
+   * @brief Left multiply the state element or the clone element corresponding to the given key by the exponential
+   * of the given vector (exp(delta) * element).
+   * This method will *NOT* change the covariance matrix.
+   *
+   * @param key State element name, feature id or timestamp of clone
+   * @param delta Perturbation vector, of dimension equal to the dof of the element
+   *
+   * @note *THIS IS MEANT TO BE AN HELPER FUNCTION FOR DEBUG/TESTING*
+   */
+  void updateLeft(const MSCEqFKey& key, const VectorX& delta);
+
  private:
   /**
    * @brief Preallocate space on the MSCEqF state map and clones_map based on given options
    */
   void preallocate();
 
+  /**
+   * @brief Get the name of the state element corresponding to the given key. For the calibration elements of secondary
+   * cameras this is the name of the corresponding element of the primary camera.
+   *
+   * @param key State element name or camera key
+   * @return Name of the state element
+   */
+  [[nodiscard]] static MSCEqFStateElementName elementName(const MSCEqFStateKey& key);
+
   /**
    * @brief Insert given pointer into the MSCEqF state map and check that the pointer is not null.
    *
@@ -299,6 +413,15 @@ class MSCEqFState
    */
   [[nodiscard]] const MSCEqFStateElementSharedPtr& getPtr(const MSCEqFKey& key) const;
 
+  /**
+   * @brief Remove the rows and columns of the covariance starting at the given index, and shift the index of all the
+   * elements (states and clones) following the removed block
+   *
+   * @param idx Index of the block to remove
+   * @param size Size of the block to remove
+   */
+  void removeCovarianceBlock(const uint& idx, const uint& size);
+
   friend class Symmetry;             //!< Symmetry can access private members of MSCEqFState
   friend class Propagator;           //!< Propagator can access private members of MSCEqFState
   friend class Updater;              //!< Updater can access private members of MSCEqFState
@@ -0,0 +1,204 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef LATENCY_STATS_HPP
+#define LATENCY_STATS_HPP
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include "types/fptypes.hpp"
+#include "utils/latency_histogram.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Instrumented stages of the MSCEqF pipeline
+ *
+ */
+enum class LatencyStage
+{
+  CAMERA_MEASUREMENT,     //!< Whole processing of a camera measurement
+  PROPAGATION,            //!< Propagation up to the camera measurement
+  TRACKING,               //!< Frontend (feature tracking)
+  CLONING,                //!< Stochastic cloning
+  UPDATE,                 //!< Multi State Constraint and persistent features updates
+  MARGINALIZATION,        //!< Clone marginalization
+  TRACKER_PREPROCESSING,  //!< Tracker color conversion and equalization
+  TRACKER_PYRAMIDS,       //!< Tracker optical flow pyramids construction
+  TRACKER_DETECTION,      //!< Tracker feature detection
+  TRACKER_OPTICAL_FLOW,   //!< Tracker KLT optical flow
+  TRACKER_RANSAC,         //!< Tracker RANSAC outlier rejection
+  UPDATER_TRIANGULATION,  //!< Updater feature triangulation (linear and nonlinear)
+  UPDATER_JACOBIANS,      //!< Updater residual and Jacobian blocks, and nullspace projection
+  UPDATER_GATING,         //!< Updater chi2 gating
+  UPDATER_COMPRESSION,    //!< Updater QR compression (and streaming accumulation)
+  UPDATER_KALMAN_UPDATE,  //!< Updater Kalman update of the MSCEqF state
+  SIZE,                   //!< Number of stages
+};
+
+/**
+ * @brief Summary of the latency of a stage, latencies are in milliseconds
+ *
+ */
+struct LatencySummary
+{
+  size_t count_ = 0;  //!< Number of recorded latencies
+  fp mean_ = 0;       //!< Mean latency
+  fp min_ = 0;        //!< Minimum latency
+  fp p50_ = 0;        //!< Median latency
+  fp p90_ = 0;        //!< 90th percentile of the latency
+  fp p99_ = 0;        //!< 99th percentile of the latency
+  fp max_ = 0;        //!< Maximum latency
+};
+
+/**
+ * @brief Latency statistics of the MSCEqF pipeline, one lock-free histogram per stage. Stages are timed with scoped
+ * timers (see time()) whose histogram recording is compiled out entirely unless the LATENCY_STATS definition is set
+ * (ENABLE_LATENCY_STATS CMake option), in which case the histograms are not allocated either. The same timers trace the
+ * stages if a trace recorder is set.
+ *
+ */
+class LatencyStats
+{
+ public:
+  static constexpr bool enabled = utils::latency_stats_enabled;  //!< Flag indicating whether stats are compiled in
+
+  /**
+   * @brief Get the name of the given stage
+   *
+   * @param stage Stage
+   * @return Name of the stage
+   */
+  static const char* name(const LatencyStage& stage);
+
+  /**
+   * @brief Time the enclosing scope as the given stage, if stats are given, and trace it as an event named after the
+   * stage, if a trace recorder is set for the calling thread
+   *
+   * @param stats Latency statistics (can be null)
+   * @param stage Stage
+   * @return Scoped timer
+   */
+  static utils::scopedTimer time(const std::shared_ptr<LatencyStats>& stats, const LatencyStage& stage)
+  {
+    return utils::scopedTimer(stats ? stats->slot(stage) : nullptr, name(stage));
+  }
+
+  /**
+   * @brief Record the time accumulated by the given stopwatch as the given stage, if stats are given
+   *
+   * @param stats Latency statistics (can be null)
+   * @param stage Stage
+   * @param watch Stopwatch
+   */
+  static void record(const std::shared_ptr<LatencyStats>& stats,
+                     const LatencyStage& stage,
+                     const utils::stopwatch& watch)
+  {
+    if constexpr (enabled)
+    {
+      if (stats)
+      {
+        stats->slot(stage)->record(watch.nanoseconds());
+      }
+    }
+  }
+
+  /**
+   * @brief Record the given latency as the given stage, if stats are given
+   *
+   * @param stats Latency statistics (can be null)
+   * @param stage Stage
+   * @param ms Latency in milliseconds
+   */
+  static void record(const std::shared_ptr<LatencyStats>& stats, const LatencyStage& stage, const fp& ms)
+  {
+    if constexpr (enabled)
+    {
+      if (stats)
+      {
+        stats->slot(stage)->record(static_cast<uint64_t>(ms * 1e6));
+      }
+    }
+  }
+
+  /**
+   * @brief Get the latency histogram of the given stage (always empty if stats are compiled out)
+   *
+   * @param stage Stage
+   * @return Latency histogram
+   */
+  const utils::latencyHistogram& histogram(const LatencyStage& stage) const;
+
+  /**
+   * @brief Get the latency summary of the given stage
+   *
+   * @param stage Stage
+   * @return Latency summary
+   */
+  LatencySummary summary(const LatencyStage& stage) const;
+
+  /**
+   * @brief Clear the recorded latencies of all the stages
+   *
+   */
+  void reset();
+
+  /**
+   * @brief Get a CSV representation of the latency summaries (one row per stage, latencies in milliseconds). Only the
+   * header is given if stats are compiled out
+   *
+   * @return CSV string
+   */
+  std::string toCsv() const;
+
+  /**
+   * @brief Get a JSON representation of the latency summaries (one object per stage, latencies in milliseconds). No
+   * stage is given if stats are compiled out
+   *
+   * @return JSON string
+   */
+  std::string toJson() const;
+
+  /**
+   * @brief Write the latency summaries to the given file, as JSON if the file has a .json extension, as CSV otherwise.
+   * Nothing is written if stats are compiled out
+   *
+   * @param filename Name of the file
+   */
+  void write(const std::string& filename) const;
+
+ private:
+  /**
+   * @brief Get the latency histogram to record the given stage into
+   *
+   * @param stage Stage
+   * @return Latency histogram, null if stats are compiled out
+   */
+  utils::latencyHistogram* slot(const LatencyStage& stage)
+  {
+#ifdef LATENCY_STATS
+    return &histograms_[static_cast<size_t>(stage)];
+#else
+    static_cast<void>(stage);
+    return nullptr;
+#endif
+  }
+
+#ifdef LATENCY_STATS
+  std::array<utils::latencyHistogram, static_cast<size_t>(LatencyStage::SIZE)> histograms_;  //!< Histogram per stage
+#endif
+};
+}  // namespace msceqf
+
+#endif  // LATENCY_STATS_HPP
@@ -49,10 +49,32 @@ class Symmetry
    */
   [[nodiscard]] static const MatrixX curvatureCorrection(const MSCEqFState& X, const VectorX& inn);
 
+  /**
+   * @brief Apply the curvature correction to the covariance of the given MSCEqF state. Gamma is block diagonal, hence
+   * its exponential is computed block-wise with fixed-size blocks and applied to the corresponding rows and columns of
+   * the covariance only, without forming the full Gamma matrix.
+   *
+   * @param X MSCEqF state (symmetry group element). *The covariance of the state will be modified*
+   * @param inn Innovatiation vector
+   */
+  static void applyCurvatureCorrection(MSCEqFState& X, const VectorX& inn);
+
   static const Matrix5 D;  //!< The D matrix
 
  private:
   Symmetry() = default;
+
+  /**
+   * @brief Apply a single block of the curvature correction, Sigma = exp(Gamma) * Sigma * exp(Gamma)^T, where Gamma
+   * acts on the n rows and columns of the covariance starting at the given index.
+   *
+   * @tparam n Dimension of the block
+   * @param X MSCEqF state (symmetry group element). *The covariance of the state will be modified*
+   * @param idx Index of the block
+   * @param Gamma Block of the Gamma matrix
+   */
+  template <int n>
+  static void applyCurvatureCorrectionBlock(MSCEqFState& X, const Eigen::Index& idx, const Matrix<n, n>& Gamma);
 };
 
 }  // namespace msceqf
@@ -16,6 +16,7 @@
 
 #include "msceqf/system/system_elements.hpp"
 #include "msceqf/options/msceqf_options.hpp"
+#include "types/camera_key.hpp"
 
 namespace msceqf
 {
@@ -28,7 +29,8 @@ namespace msceqf
 class SystemState
 {
  public:
-  using SystemStateKey = std::variant<SystemStateElementName, uint>;  //!< Key to access the system state map
+  using SystemCameraKey = CameraKey<SystemStateElementName>;  //!< Key of the calibration of the secondary cameras
+  using SystemStateKey = std::variant<SystemStateElementName, uint, SystemCameraKey>;  //!< Key to access the state map
   using SystemStateMap = std::unordered_map<SystemStateKey, SystemStateElementSharedPtr>;  //!< System state map
   using SystemStateAlgebraMap = std::unordered_map<SystemStateKey, VectorX>;               //!< System state algebra map
 
@@ -80,6 +82,8 @@ class SystemState
           createSystemStateElement<CameraIntrinsicState>(std::make_tuple(opts.initial_camera_intrinsics_))));
     }
 
+    insertSecondaryCamerasElements();
+
     (insertSystemStateElement(std::forward<decltype(pairs_of_key_ptr)>(pairs_of_key_ptr)), ...);
   }
 
@@ -145,6 +149,26 @@ class SystemState
    */
   [[nodiscard]] const Vector4 k() const;
 
+  /**
+   * @brief return a constant reference to the extrinsics of the camera with the given id as a SE3-torsor.
+   * The extrinsics of the primary camera (id 0) are given with respect to the IMU, while the extrinsics of the
+   * secondary cameras are given with respect to the primary camera (C0_S_Ci)
+   *
+   * @param cam_id Camera id
+   * @return Pose/Transformation element of the system state as a SE3-torsor representing the camera extrinsics
+   */
+  [[nodiscard]] const SE3& S(const uint& cam_id) const;
+
+  /**
+   * @brief return a constant reference to the intrinsics of the camera with the given id as a In-torsor.
+   * If the camera intrinsics are not are not estimated online then the fixed calibration value provided in the options
+   * is returned
+   *
+   * @param cam_id Camera id
+   * @return Intrinsic element of the system state as a In-torsor representing the camera intrinsics
+   */
+  [[nodiscard]] const In& K(const uint& cam_id) const;
+
   /**
    * @brief return a constant reference to a persistent feature element of the system state as a vector, given the
    * feature id
@@ -154,6 +178,21 @@ class SystemState
    */
   [[nodiscard]] const Vector3& f(const uint& feat_id) const;
 
+  /**
+   * @brief Insert a persistent feature element in the system state
+   *
+   * @param feat_id Id of the persistent feature
+   * @param f R3 vector representing the feature
+   */
+  void insertFeature(const uint& feat_id, const Vector3& f);
+
+  /**
+   * @brief Remove a persistent feature element from the system state
+   *
+   * @param feat_id Id of the persistent feature
+   */
+  void removeFeature(const uint& feat_id);
+
   /**
    * @brief return a copy of g*e3 as a vector
    *
@@ -171,7 +210,7 @@ class SystemState
   /**
    * @brief Get a string describing the given SystemStateKey
    *
-   * @param key System state element name or feature id
+   * @param key System state element name, feature id or camera key
    * @return String describing the given key
    */
   static std::string toString(const SystemStateKey& key);
@@ -183,6 +222,13 @@ class SystemState
    */
   void preallocate();
 
+  /**
+   * @brief Insert the extrinsics, and the intrinsics if calibrated, of the secondary cameras initialized from the given
+   * values in the options
+   *
+   */
+  void insertSecondaryCamerasElements();
+
   /**
    * @brief Insert a single element into the state map given a pair of key-ptr. Each pointer points to a state
    * element to be inserted into the state_ map
@@ -12,7 +12,9 @@
 #ifndef INPUT_HPP
 #define INPUT_HPP
 
+#include <functional>
 #include <opencv2/opencv.hpp>
+#include <utility>
 
 #include "types/fptypes.hpp"
 #include "vision/features.hpp"
@@ -94,6 +96,129 @@ struct Camera
   fp timestamp_ = -1;  //!< Timestamp of the Camera reading
 };
 
+/**
+ * @brief Non-owning view of a grayscale (8 bit, single channel) camera image living in an externally owned buffer.
+ * The buffer is borrowed, it is never copied, and it is handed back to its owner through the release callback once the
+ * view is destroyed. A CameraView is move-only, hence the release callback is invoked exactly once.
+ *
+ * @note The buffer has to stay valid and unmodified for the whole lifetime of the view.
+ */
+class CameraView
+{
+ public:
+  using ReleaseCallback = std::function<void()>;
+
+  /**
+   * @brief Default constructor (empty view)
+   *
+   */
+  CameraView() = default;
+
+  /**
+   * @brief CameraView constructor
+   *
+   * @param data Pointer to the first pixel of the borrowed grayscale buffer
+   * @param width Image width in pixels
+   * @param height Image height in pixels
+   * @param stride Number of bytes between the beginning of two consecutive rows
+   * @param timestamp Timestamp of the Camera reading
+   * @param release Callback invoked once the buffer is not needed anymore
+   */
+  CameraView(const uchar* data,
+             const int& width,
+             const int& height,
+             const size_t& stride,
+             const fp& timestamp,
+             ReleaseCallback release = nullptr)
+      : data_(data), width_(width), height_(height), stride_(stride), timestamp_(timestamp), release_(std::move(release))
+  {
+    assert(data_ != nullptr);
+    assert(stride_ >= static_cast<size_t>(width_));
+  }
+
+  CameraView(const CameraView&) = delete;
+  CameraView& operator=(const CameraView&) = delete;
+
+  CameraView(CameraView&& other) noexcept { *this = std::move(other); }
+
+  CameraView& operator=(CameraView&& other) noexcept
+  {
+    if (this != &other)
+    {
+      release();
+      data_ = std::exchange(other.data_, nullptr);
+      width_ = std::exchange(other.width_, 0);
+      height_ = std::exchange(other.height_, 0);
+      stride_ = std::exchange(other.stride_, 0);
+      timestamp_ = std::exchange(other.timestamp_, -1);
+      release_ = std::exchange(other.release_, nullptr);
+    }
+    return *this;
+  }
+
+  ~CameraView() { release(); }
+
+  /**
+   * @brief Get a Camera measurement wrapping the borrowed buffer.
+   * The image of the returned Camera is a header on the borrowed memory (no allocation, no copy), hence it is valid
+   * only as long as this view is alive.
+   *
+   * @return Camera measurement referencing the borrowed buffer
+   */
+  [[nodiscard]] Camera camera() const
+  {
+    Camera cam;
+    if (data_ != nullptr)
+    {
+      cam.image_ = cv::Mat(height_, width_, CV_8UC1, const_cast<uchar*>(data_), stride_);
+    }
+    cam.timestamp_ = timestamp_;
+    return cam;
+  }
+
+  /**
+   * @brief Get the timestamp of the view
+   *
+   * @return Timestamp
+   */
+  [[nodiscard]] const fp& timestamp() const { return timestamp_; }
+
+  /**
+   * @brief Check if the view is empty
+   *
+   * @return true if the view does not reference any buffer, false otherwise
+   */
+  [[nodiscard]] bool empty() const { return data_ == nullptr; }
+
+  /**
+   * @brief Comparison operator with other camera view
+   *
+   */
+  friend bool operator<(const CameraView& lhs, const CameraView& rhs) { return lhs.timestamp_ < rhs.timestamp_; }
+
+ private:
+  /**
+   * @brief Hand the borrowed buffer back to its owner
+   *
+   */
+  void release()
+  {
+    if (release_)
+    {
+      release_();
+      release_ = nullptr;
+    }
+    data_ = nullptr;
+  }
+
+  const uchar* data_ = nullptr;  //!< Pointer to the borrowed grayscale buffer
+  int width_ = 0;                //!< Image width in pixels
+  int height_ = 0;               //!< Image height in pixels
+  size_t stride_ = 0;            //!< Row stride in bytes
+  fp timestamp_ = -1;            //!< Timestamp of the Camera reading
+  ReleaseCallback release_;      //!< Callback that hands the buffer back to its owner
+};
+
 struct TriangulatedFeatures
 {
   /**
@@ -113,7 +238,7 @@ struct TriangulatedFeatures
   friend bool operator<(const fp& timestamp, const TriangulatedFeatures& rhs) { return timestamp < rhs.timestamp_; }
 
   Features features_;            //!< The features detected in the image
-  std::vector<Vector3> points_;  //!< The 3D points corresponding to the features
+  std::vector<Vector3> points_;  //!< The 3D points corresponding to the features in camera frame (optional)
   fp timestamp_ = -1;            //!< Timestamp of the Camera reading
 };
 
@@ -0,0 +1,62 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef CAMERA_KEY_HPP
+#define CAMERA_KEY_HPP
+
+#include <functional>
+
+#include "types/fptypes.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Key of the calibration elements of the secondary cameras. The key is given by the name of the corresponding
+ * calibration element of the primary camera, and by the id of the secondary camera.
+ *
+ * @tparam Name Type of the names of the state elements
+ */
+template <typename Name>
+struct CameraKey
+{
+  Name name_;    //!< Name of the corresponding calibration element of the primary camera
+  uint cam_id_;  //!< Id of the secondary camera (greater than zero)
+
+  /**
+   * @brief Comparison operator with other camera key
+   *
+   */
+  friend bool operator==(const CameraKey& lhs, const CameraKey& rhs)
+  {
+    return lhs.name_ == rhs.name_ && lhs.cam_id_ == rhs.cam_id_;
+  }
+};
+
+}  // namespace msceqf
+
+namespace std
+{
+/**
+ * @brief Hash of a camera key, such that it can be used as (part of the) key of an unordered map
+ *
+ */
+template <typename Name>
+struct hash<msceqf::CameraKey<Name>>
+{
+  size_t operator()(const msceqf::CameraKey<Name>& key) const noexcept
+  {
+    return hash<uint>()(key.cam_id_) * 31 + hash<Name>()(key.name_);
+  }
+};
+
+}  // namespace std
+
+#endif  // CAMERA_KEY_HPP
@@ -97,6 +97,8 @@ using Matrix29 = Eigen::Matrix<fp, 24, 24>;
 
 using MatrixX = Eigen::MatrixXd;
 
+using ArrayX = Eigen::Array<fp, Eigen::Dynamic, 1>;
+
 using Quaternion = Eigen::Quaternion<fp>;
 
 template <int R, int C, int T = Eigen::ColMajor>
@@ -0,0 +1,292 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef CSV_PARSER_HPP_
+#define CSV_PARSER_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "types/fptypes.hpp"
+
+namespace utils
+{
+/**
+ * @brief Read-only memory mapped file
+ *
+ */
+class mappedFile
+{
+ public:
+  /**
+   * @brief Map the given file in memory
+   *
+   * @param filename Name of the file
+   */
+  mappedFile(const std::string& filename) : fd_(-1), data_(nullptr), size_(0)
+  {
+    fd_ = ::open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+      throw std::runtime_error("Error opening file: \"" + filename + "\". Exit programm.");
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+      ::close(fd_);
+      throw std::runtime_error("Error reading file: \"" + filename + "\". Exit programm.");
+    }
+    size_ = static_cast<size_t>(st.st_size);
+
+    if (size_ > 0)
+    {
+      void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+      if (data == MAP_FAILED)
+      {
+        ::close(fd_);
+        throw std::runtime_error("Error mapping file: \"" + filename + "\". Exit programm.");
+      }
+      data_ = static_cast<const char*>(data);
+      ::madvise(data, size_, MADV_SEQUENTIAL);
+    }
+  }
+
+  /**
+   * @brief Unmap and close the file
+   *
+   */
+  ~mappedFile()
+  {
+    if (data_ != nullptr)
+    {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+    if (fd_ >= 0)
+    {
+      ::close(fd_);
+    }
+  }
+
+  mappedFile(const mappedFile&) = delete;
+  mappedFile& operator=(const mappedFile&) = delete;
+
+  /**
+   * @brief Get the content of the file
+   *
+   * @return View of the content of the file
+   */
+  std::string_view view() const { return std::string_view(data_, size_); }
+
+ private:
+  int fd_;            //!< File descriptor
+  const char* data_;  //!< Mapped content of the file
+  size_t size_;       //!< Size of the file in bytes
+};
+
+/**
+ * @brief Columns of a delimited file, stored as structure of arrays (one contiguous array per column)
+ *
+ * @tparam T Type of the fields
+ */
+template <typename T>
+struct csvTable
+{
+  std::vector<std::string> header_;      //!< Lowercase header titles
+  std::vector<std::vector<T>> columns_;  //!< Columns of the file
+  size_t rows_ = 0;                      //!< Number of rows (excluding the header)
+};
+
+using csvColumns = csvTable<msceqf::fp>;  //!< Columns of a delimited file of numbers
+using csvFields = csvTable<std::string>;  //!< Columns of a delimited file of strings (e.g. image paths)
+
+/**
+ * @brief Parse a single number of a delimited file. Numbers are validated without regex, the whole field has to be a
+ * valid decimal number (optionally signed, with optional exponent) or nan (case insensitive).
+ *
+ * @param field Field
+ * @return Parsed number
+ */
+static inline msceqf::fp parseNumber(std::string_view field)
+{
+  if (!field.empty() && field.back() == '\r')
+  {
+    field.remove_suffix(1);
+  }
+
+  if (field.size() == 3 && std::tolower(field[0]) == 'n' && std::tolower(field[1]) == 'a' &&
+      std::tolower(field[2]) == 'n')
+  {
+    return std::numeric_limits<msceqf::fp>::quiet_NaN();
+  }
+
+  // std::from_chars does not accept a leading plus sign
+  if (!field.empty() && field.front() == '+')
+  {
+    field.remove_prefix(1);
+    if (!field.empty() && field.front() == '-')
+    {
+      throw std::runtime_error("Invalid number \"+" + std::string(field) + "\". Exit programm.");
+    }
+  }
+
+  // Infinity and nan are accepted by std::from_chars, but they are not valid numbers here
+  if (field.empty() || !(std::isdigit(static_cast<unsigned char>(field.back())) || field.back() == '.'))
+  {
+    throw std::runtime_error("Invalid number \"" + std::string(field) + "\". Exit programm.");
+  }
+
+  msceqf::fp value;
+  const auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+  if (ec != std::errc() || ptr != field.data() + field.size())
+  {
+    throw std::runtime_error("Invalid number \"" + std::string(field) + "\". Exit programm.");
+  }
+
+  return value;
+}
+
+/**
+ * @brief Parse a delimited file with a single header line. The file is memory mapped, and every field is converted
+ * in place by the given field parser directly into preallocated columns.
+ * Header tokens equal to "#" are skipped and header titles are converted to lowercase. Empty lines are skipped.
+ *
+ * @tparam T Type of the fields
+ * @tparam F Field parser, callable as T(std::string_view)
+ * @param filename Name of the file
+ * @param delimiter Delimiter
+ * @param parse Field parser
+ * @return Parsed columns
+ */
+template <typename T, typename F>
+static inline csvTable<T> parseDelimited(const std::string& filename, const char& delimiter, F&& parse)
+{
+  const mappedFile file(filename);
+  std::string_view content = file.view();
+
+  csvTable<T> csv;
+
+  // Header
+  const size_t header_end = std::min(content.find('\n'), content.size());
+  std::string_view header = content.substr(0, header_end);
+  content.remove_prefix(std::min(header_end + 1, content.size()));
+
+  while (!header.empty())
+  {
+    const size_t end = std::min(header.find(delimiter), header.size());
+    std::string token(header.substr(0, end));
+    header.remove_prefix(std::min(end + 1, header.size()));
+
+    if (!token.empty() && token.back() == '\r')
+    {
+      token.pop_back();
+    }
+    if (token == "#")
+    {
+      continue;
+    }
+    std::transform(token.begin(), token.end(), token.begin(), ::tolower);
+    csv.header_.emplace_back(token);
+  }
+
+  // Preallocate the columns given an upper bound on the number of rows
+  const size_t max_rows = std::count(content.begin(), content.end(), '\n') + 1;
+  csv.columns_.resize(csv.header_.size());
+  for (auto& column : csv.columns_)
+  {
+    column.reserve(max_rows);
+  }
+
+  // Data
+  while (!content.empty())
+  {
+    const size_t line_end = std::min(content.find('\n'), content.size());
+    std::string_view line = content.substr(0, line_end);
+    content.remove_prefix(std::min(line_end + 1, content.size()));
+
+    if (line.empty() || line == "\r")
+    {
+      continue;
+    }
+
+    size_t col = 0;
+    while (true)
+    {
+      const size_t end = std::min(line.find(delimiter), line.size());
+      if (col == csv.columns_.size())
+      {
+        throw std::runtime_error("Number of fields and header titles mismatch in: \"" + filename +
+                                 "\". Exit programm.");
+      }
+      csv.columns_[col++].emplace_back(parse(line.substr(0, end)));
+
+      if (end == line.size())
+      {
+        break;
+      }
+      line.remove_prefix(end + 1);
+    }
+
+    if (col != csv.columns_.size())
+    {
+      throw std::runtime_error("Number of fields and header titles mismatch in: \"" + filename +
+                               "\". Exit programm.");
+    }
+    ++csv.rows_;
+  }
+
+  return csv;
+}
+/**
+ * @brief Parse a delimited file of numbers with a single header line. Numbers are parsed in place with
+ * std::from_chars, without intermediate strings nor regex.
+ *
+ * @param filename Name of the file
+ * @param delimiter Delimiter
+ * @return Parsed columns
+ */
+static inline csvColumns parseCsv(const std::string& filename, const char& delimiter)
+{
+  return parseDelimited<msceqf::fp>(filename, delimiter, &parseNumber);
+}
+
+/**
+ * @brief Parse a delimited file of strings with a single header line. Trailing carriage returns are removed, and the
+ * case of the fields is preserved.
+ *
+ * @param filename Name of the file
+ * @param delimiter Delimiter
+ * @return Parsed columns
+ */
+static inline csvFields parseCsvFields(const std::string& filename, const char& delimiter)
+{
+  return parseDelimited<std::string>(filename, delimiter, [](std::string_view field) {
+    if (!field.empty() && field.back() == '\r')
+    {
+      field.remove_suffix(1);
+    }
+    return std::string(field);
+  });
+}
+}  // namespace utils
+
+#endif  // CSV_PARSER_HPP_
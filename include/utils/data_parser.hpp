@@ -19,12 +19,13 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
-#include <regex>
 #include <unordered_map>
 #include <vector>
 #include <opencv2/opencv.hpp>
 
 #include "sensors/sensor_data.hpp"
+#include "utils/csv_parser.hpp"
+#include "utils/image_prefetcher.hpp"
 #include "utils/tools.hpp"
 
 namespace msceqf
@@ -51,9 +52,13 @@ namespace utils
 class dataParser
 {
  public:
+  using SensorReading = std::variant<msceqf::Imu, msceqf::Camera>;  //!< Sensor reading (imu or camera)
+
   /**
    * @brief Construct the data parser.
-   * The data parser reads the groundtruth data, the imu data and the image data from a file
+   * The data parser reads the groundtruth data, the imu data and the image data from a file.
+   * Images are not read upfront, only their index (timestamps and filenames) is parsed, while images are decoded on
+   * demand by a background thread into a bounded queue, and released once consumed.
    *
    * @param imu_data_filename filename of file containing IMU data
    * @param groundtruth_data_filename filename of file containing groundtruth data
@@ -64,6 +69,7 @@ class dataParser
    * @param image_header_titles  header titles of the image data file
    * @param delimiter delimiter of the data file
    * @param timeoffset time offset between the imu and the camera
+   * @param prefetch_size maximum number of images decoded ahead of consumption
    *
    * @note imu_header_titles has to be provided according to the following order
    * @note [t, ang_x, ang_y, ang_z, acc_x, acc_y, acc_z]
@@ -80,7 +86,8 @@ class dataParser
              const std::vector<std::string>& groundtruth_header_titles,
              const std::vector<std::string>& image_header_titles,
              const char& delimiter = ',',
-             const msceqf::fp& timeoffset = 0.0)
+             const msceqf::fp& timeoffset = 0.0,
+             const size_t& prefetch_size = 8)
       : imu_filename_(imu_data_filename)
       , groundtruth_filename_(groundtruth_data_filename)
       , image_data_filename_(image_data_filename)
@@ -90,12 +97,16 @@ class dataParser
       , image_header_titles_(image_header_titles)
       , imu_data_()
       , groundtruth_data_()
-      , image_data_()
+      , image_index_()
+      , prefetcher_(nullptr)
+      , next_imu_(0)
+      , next_image_(0)
       , read_imu_(false)
       , read_gt_(false)
       , read_images_(false)
       , delim_(delimiter)
       , timeoffset_(timeoffset)
+      , prefetch_size_(prefetch_size)
   {
     for (auto& s : imu_header_titles_)
     {
@@ -132,7 +143,8 @@ class dataParser
       }
 
       Logger::info("Opening and reading: " + groundtruth_filename_ + "...");
-      parseAndCheckGt(gtfile);
+      csvColumns csv = parseCsv(groundtruth_filename_, delim_);
+      parseAndCheckGt(csv);
     }
     else
     {
@@ -147,7 +159,8 @@ class dataParser
       }
 
       Logger::info("Opening and reading: " + imu_filename_ + "...");
-      parseAndCheckImu(imufile);
+      csvColumns csv = parseCsv(imu_filename_, delim_);
+      parseAndCheckImu(csv);
     }
     else
     {
@@ -162,7 +175,8 @@ class dataParser
       }
 
       Logger::info("Opening and reading: " + image_data_filename_ + "...");
-      parseAndCheckImages(imgfile);
+      csvFields csv = parseCsvFields(image_data_filename_, delim_);
+      parseAndCheckImages(csv);
     }
     else
     {
@@ -170,13 +184,13 @@ class dataParser
     }
   }
 
-  void parseAndCheckGt(std::ifstream& gtfile)
+  /**
+   * @brief Check the given parsed groundtruth file and fill the groundtruth data
+   *
+   * @param csv Parsed groundtruth file
+   */
+  void parseAndCheckGt(csvColumns& csv)
   {
-    std::regex regex("^[+-]?((\\d*\\.\\d+)|(\\d+\\.\\d*)|(\\d+))([eE][+-]?\\d+)?|^nan$");
-
-    std::string line;
-    std::vector<std::string> header;
-    std::vector<std::vector<msceqf::fp>> data;
     std::vector<int> groundtruth_indices;
 
     bool have_velocity = false;
@@ -206,181 +220,125 @@ class dataParser
       throw std::runtime_error("Wrong number of groundtruth header titles. Exit programm.");
     }
 
-    int rows_cnt = 0;
-    if (gtfile.good())
+    if (!getIndices(csv.header_, groundtruth_header_titles_, groundtruth_indices))
     {
-      std::getline(gtfile, line);
-      parseLine(line, header);
+      throw std::runtime_error("Required groundtruth missing. Exit programm.");
+    }
 
-      while (std::getline(gtfile, line))
-      {
-        std::vector<msceqf::fp> tmp;
-        parseLine(line, tmp, regex);
-        data.emplace_back(tmp);
-        ++rows_cnt;
-      }
+    const auto value = [&](const size_t& k, const size_t& row) { return csv.columns_[groundtruth_indices[k]][row]; };
+
+    groundtruth_data_.clear();
+    groundtruth_data_.reserve(csv.rows_);
 
-      if (!getIndices(header, groundtruth_header_titles_, groundtruth_indices))
+    for (size_t row = 0; row < csv.rows_; ++row)
+    {
+      msceqf::Groundtruth gt;
+      gt.timestamp_ = value(0, row) > 10e12 ? value(0, row) / 1e9 : value(0, row);
+      gt.q_.x() = value(1, row);
+      gt.q_.y() = value(2, row);
+      gt.q_.z() = value(3, row);
+      gt.q_.w() = value(4, row);
+      gt.q_.normalize();
+
+      gt.p_.x() = value(5, row);
+      gt.p_.y() = value(6, row);
+      gt.p_.z() = value(7, row);
+
+      if (have_velocity)
       {
-        throw std::runtime_error("Required groundtruth missing. Exit programm.");
+        gt.v_.x() = value(8, row);
+        gt.v_.y() = value(9, row);
+        gt.v_.z() = value(10, row);
       }
 
-      groundtruth_data_.clear();
-
-      for (const auto& it : data)
+      if (have_bias)
       {
-        msceqf::Groundtruth gt;
-        gt.timestamp_ = it.at(groundtruth_indices.at(0)) > 10e12 ? it.at(groundtruth_indices.at(0)) / 1e9 :
-                                                                   it.at(groundtruth_indices.at(0));
-        gt.q_.x() = it.at(groundtruth_indices.at(1));
-        gt.q_.y() = it.at(groundtruth_indices.at(2));
-        gt.q_.z() = it.at(groundtruth_indices.at(3));
-        gt.q_.w() = it.at(groundtruth_indices.at(4));
-        gt.q_.normalize();
-
-        gt.p_.x() = it.at(groundtruth_indices.at(5));
-        gt.p_.y() = it.at(groundtruth_indices.at(6));
-        gt.p_.z() = it.at(groundtruth_indices.at(7));
-
-        if (have_velocity)
-        {
-          gt.v_.x() = it.at(groundtruth_indices.at(8));
-          gt.v_.y() = it.at(groundtruth_indices.at(9));
-          gt.v_.z() = it.at(groundtruth_indices.at(10));
-        }
-
-        if (have_bias)
-        {
-          gt.bw_.x() = it.at(groundtruth_indices.at(11));
-          gt.bw_.y() = it.at(groundtruth_indices.at(12));
-          gt.bw_.z() = it.at(groundtruth_indices.at(13));
-
-          gt.ba_.x() = it.at(groundtruth_indices.at(14));
-          gt.ba_.y() = it.at(groundtruth_indices.at(15));
-          gt.ba_.z() = it.at(groundtruth_indices.at(16));
-        }
-
-        groundtruth_data_.emplace_back(gt);
+        gt.bw_.x() = value(11, row);
+        gt.bw_.y() = value(12, row);
+        gt.bw_.z() = value(13, row);
+
+        gt.ba_.x() = value(14, row);
+        gt.ba_.y() = value(15, row);
+        gt.ba_.z() = value(16, row);
       }
-    }
-    else
-    {
-      throw std::runtime_error("Corrupted file. Exit programm.");
+
+      groundtruth_data_.emplace_back(gt);
     }
 
     std::sort(groundtruth_data_.begin(), groundtruth_data_.end());
-
-    gtfile.close();
   }
 
-  void parseAndCheckImu(std::ifstream& imufile)
+  /**
+   * @brief Check the given parsed imu file and fill the imu data
+   *
+   * @param csv Parsed imu file
+   */
+  void parseAndCheckImu(csvColumns& csv)
   {
-    std::regex regex("^[+-]?((\\d*\\.\\d+)|(\\d+\\.\\d*)|(\\d+))([eE][+-]?\\d+)?|^nan$");
-
-    std::string line;
-    std::vector<std::string> header;
-    std::vector<std::vector<msceqf::fp>> data;
     std::vector<int> imu_indices;
 
-    int rows_cnt = 0;
-    if (imufile.good())
+    if (!getIndices(csv.header_, imu_header_titles_, imu_indices))
     {
-      std::getline(imufile, line);
-      parseLine(line, header);
-
-      while (std::getline(imufile, line))
-      {
-        std::vector<msceqf::fp> tmp;
-        parseLine(line, tmp, regex);
-        data.emplace_back(tmp);
-        ++rows_cnt;
-      }
+      throw std::runtime_error("Required imu missing. Exit programm.");
+    }
 
-      if (!getIndices(header, imu_header_titles_, imu_indices))
-      {
-        throw std::runtime_error("Required imu missing. Exit programm.");
-      }
+    const auto value = [&](const size_t& k, const size_t& row) { return csv.columns_[imu_indices[k]][row]; };
 
-      imu_data_.clear();
+    imu_data_.clear();
+    imu_data_.reserve(csv.rows_);
+    next_imu_ = 0;
 
-      for (const auto& it : data)
-      {
-        msceqf::Imu imu;
+    for (size_t row = 0; row < csv.rows_; ++row)
+    {
+      msceqf::Imu imu;
 
-        imu.timestamp_ = it.at(imu_indices.at(0)) > 10e12 ? it.at(imu_indices.at(0)) / 1e9 : it.at(imu_indices.at(0));
+      imu.timestamp_ = value(0, row) > 10e12 ? value(0, row) / 1e9 : value(0, row);
 
-        imu.ang_.x() = it.at(imu_indices.at(1));
-        imu.ang_.y() = it.at(imu_indices.at(2));
-        imu.ang_.z() = it.at(imu_indices.at(3));
+      imu.ang_.x() = value(1, row);
+      imu.ang_.y() = value(2, row);
+      imu.ang_.z() = value(3, row);
 
-        imu.acc_.x() = it.at(imu_indices.at(4));
-        imu.acc_.y() = it.at(imu_indices.at(5));
-        imu.acc_.z() = it.at(imu_indices.at(6));
+      imu.acc_.x() = value(4, row);
+      imu.acc_.y() = value(5, row);
+      imu.acc_.z() = value(6, row);
 
-        imu_data_.emplace_back(imu);
-      }
-    }
-    else
-    {
-      throw std::runtime_error("Corrupted file. Exit programm.");
+      imu_data_.emplace_back(imu);
     }
 
     std::sort(imu_data_.begin(), imu_data_.end());
-
-    imufile.close();
   }
 
-  void parseAndCheckImages(std::ifstream& imgfile)
+  /**
+   * @brief Check the given parsed image file, fill the image index, and start prefetching the images
+   *
+   * @param csv Parsed image file
+   */
+  void parseAndCheckImages(csvFields& csv)
   {
-    std::string line;
-    std::vector<std::string> header;
-    std::vector<std::vector<std::string>> data;
     std::vector<int> image_indices;
 
-    int rows_cnt = 0;
-    if (imgfile.good())
+    if (!getIndices(csv.header_, image_header_titles_, image_indices))
     {
-      std::getline(imgfile, line);
-      parseLine(line, header);
-
-      while (std::getline(imgfile, line))
-      {
-        std::vector<std::string> tmp;
-        parseLine(line, tmp);
-        data.emplace_back(tmp);
-        ++rows_cnt;
-      }
-
-      if (!getIndices(header, image_header_titles_, image_indices))
-      {
-        throw std::runtime_error("Required groundtruth missing. Exit programm.");
-      }
-
-      image_data_.clear();
-
-      for (const auto& it : data)
-      {
-        msceqf::Camera cam;
-
-        cam.timestamp_ = std::stod(it.at(image_indices.at(0))) > 10e12 ? std::stod(it.at(image_indices.at(0))) / 1e9 :
-                                                                         std::stod(it.at(image_indices.at(0)));
-        cam.timestamp_ += timeoffset_;
-
-        cam.image_ = cv::imread(image_data_folder_ + it.at(image_indices.at(1)));
+      throw std::runtime_error("Required image missing. Exit programm.");
+    }
 
-        cam.mask_ = 255 * cv::Mat::ones(cam.image_.rows, cam.image_.cols, CV_8UC1);
+    prefetcher_.reset();
+    image_index_.clear();
+    next_image_ = 0;
+    image_index_.reserve(csv.rows_);
 
-        image_data_.emplace_back(cam);
-      }
-    }
-    else
+    for (size_t row = 0; row < csv.rows_; ++row)
     {
-      throw std::runtime_error("Corrupted file. Exit programm.");
+      const msceqf::fp t = parseNumber(csv.columns_[image_indices[0]][row]);
+      const msceqf::fp timestamp = (t > 10e12 ? t / 1e9 : t) + timeoffset_;
+
+      image_index_.emplace_back(timestamp, image_data_folder_ + csv.columns_[image_indices[1]][row]);
     }
 
-    std::sort(image_data_.begin(), image_data_.end());
+    std::sort(image_index_.begin(), image_index_.end());
 
-    imgfile.close();
+    // Start decoding the first images in background
+    prefetcher_ = std::make_unique<imagePrefetcher>(image_index_, prefetch_size_);
   }
 
   /**
@@ -398,11 +356,11 @@ class dataParser
   const std::vector<msceqf::Groundtruth>& getGroundtruthData() const { return groundtruth_data_; }
 
   /**
-   * @brief Get a constant reference to the image data vector
+   * @brief Get a constant reference to the image index (timestamps and paths of the images)
    *
-   * @return const std::vector<msceqf::Camera>&
+   * @return const imagePrefetcher::ImageIndex&
    */
-  const std::vector<msceqf::Camera>& getImageData() const { return image_data_; }
+  const imagePrefetcher::ImageIndex& getImageIndex() const { return image_index_; }
 
   /**
    * @brief Get a vector containing the timestamps of the sensors measurements (imu and camera).
@@ -417,44 +375,49 @@ class dataParser
     {
       timestamps.emplace_back(imu.timestamp_);
     }
-    for (const auto& cam : image_data_)
+    for (const auto& [timestamp, path] : image_index_)
     {
-      timestamps.emplace_back(cam.timestamp_);
+      timestamps.emplace_back(timestamp);
     }
     std::sort(timestamps.begin(), timestamps.end());
     return timestamps;
   }
 
   /**
-   * @brief Get the sensor (imu or camera) reading at a given timestamp
+   * @brief Check whether there are sensor readings (imu or camera) left to consume with nextSensorReading
    *
-   * @param timestamp
-   * @return const std::variant<msceqf::Imu, msceqf::Camera>
+   * @return true if there are sensor readings left, false otherwise
+   */
+  bool hasNextSensorReading() const { return next_imu_ < imu_data_.size() || next_image_ < image_index_.size(); }
+
+  /**
+   * @brief Consume the next sensor reading (imu or camera) in timestamp order.
+   * The imu and the camera streams, both already sorted, are merged on the fly, hence iterating over a sequence of N
+   * readings is O(N). On exact timestamp ties the imu reading is returned first, such that the propagation up to the
+   * camera timestamp includes it.
+   *
+   * @return const SensorReading
    */
-  const std::variant<msceqf::Imu, msceqf::Camera> consumeSensorReadingAt(const msceqf::fp& timestamp)
+  const SensorReading nextSensorReading()
   {
-    auto imu_it =
-        std::find_if(imu_data_.begin(), imu_data_.end(), [&](const auto& imu) { return imu.timestamp_ == timestamp; });
-    auto cam_it = std::find_if(image_data_.begin(), image_data_.end(),
-                               [&](const auto& cam) { return cam.timestamp_ == timestamp; });
+    if (!hasNextSensorReading())
+    {
+      throw std::runtime_error("No sensor reading left");
+    }
 
-    std::variant<msceqf::Imu, msceqf::Camera> data;
+    SensorReading data;
 
-    if (imu_it != imu_data_.end())
+    if (next_image_ == image_index_.size() ||
+        (next_imu_ < imu_data_.size() && imu_data_[next_imu_].timestamp_ <= image_index_[next_image_].first))
     {
-      data = *imu_it;
-      imu_data_.erase(imu_it);
-      return data;
+      data = imu_data_[next_imu_++];
     }
-
-    if (cam_it != image_data_.end())
+    else
     {
-      data = *cam_it;
-      image_data_.erase(cam_it);
-      return data;
+      data = prefetcher_->consume(next_image_++);
     }
 
-    throw std::runtime_error("No sensor reading found at timestamp " + std::to_string(timestamp));
+    return data;
   }
 
   /**
@@ -465,8 +428,9 @@ class dataParser
    */
   const msceqf::Groundtruth getCloserGroundtruthAt(const msceqf::fp& timestamp) const
   {
-    auto gt = std::find_if(groundtruth_data_.begin(), groundtruth_data_.end(),
-                           [&](const auto& gt) { return gt.timestamp_ > timestamp; });
+    // Groundtruth data is sorted by timestamp
+    auto gt = std::upper_bound(groundtruth_data_.begin(), groundtruth_data_.end(), timestamp,
+                               [](const msceqf::fp& t, const auto& gt) { return t < gt.timestamp_; });
 
     if (gt == groundtruth_data_.end())
     {
@@ -483,62 +447,6 @@ class dataParser
   }
 
  private:
-  /**
-   * @brief Parse a single line of the file
-   * This method parses a single line of a file.
-   * This method perform regex check based on the given regex. By default every string is allowed.
-   *
-   * @param line
-   * @param data
-   * @param regex
-   */
-  template <typename T>
-  void parseLine(std::string& line, std::vector<T>& data, const std::regex regex = std::regex("^.*$"))
-  {
-    std::stringstream ss(line);
-    std::string s;
-
-    while (std::getline(ss, s, delim_))
-    {
-      if (s == "#")
-      {
-        continue;
-      }
-
-      if (s.back() == '\r')
-      {
-        s.pop_back();
-      }
-      std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-      if (!std::regex_match(s, regex))
-      {
-        throw std::runtime_error("Regex match fail. Exit programm.");
-      }
-      if constexpr (std::is_floating_point_v<T>)
-      {
-        if (s.find("nan") == std::string::npos)
-        {
-          if constexpr (std::is_same_v<T, float>)
-          {
-            data.emplace_back(std::stof(s));
-          }
-          else
-          {
-            data.emplace_back(std::stod(s));
-          }
-        }
-        else
-        {
-          data.emplace_back(std::numeric_limits<msceqf::fp>::quiet_NaN());
-        }
-      }
-      else
-      {
-        data.emplace_back(s);
-      }
-    }
-  }
-
   /**
    * @brief Find association between input file header and given titles
    * This function find the indices of the columns of the input file based on its header in order to correctly
@@ -606,7 +514,11 @@ class dataParser
 
   std::vector<msceqf::Imu> imu_data_;                  //!< Raw IMU data read from the file
   std::vector<msceqf::Groundtruth> groundtruth_data_;  //!< Raw GT data read from the file
-  std::vector<msceqf::Camera> image_data_;             //!< Raw IMAGE data read from the file
+  imagePrefetcher::ImageIndex image_index_;            //!< IMAGE index (timestamps and paths) read from the file
+  std::unique_ptr<imagePrefetcher> prefetcher_;        //!< Prefetcher decoding IMAGE data on demand
+
+  size_t next_imu_;    //!< Position of the next IMU reading to consume
+  size_t next_image_;  //!< Position of the next IMAGE to consume
 
   bool read_imu_;     //!< Flag to read IMU data
   bool read_gt_;      //!< Flag to read GT data
@@ -615,6 +527,8 @@ class dataParser
   char delim_;  //!< Delimiter used in the file
 
   msceqf::fp timeoffset_;  //!< Time offset between IMU and IMAGES (camera) [t_imu = t_cam + offset]
+
+  size_t prefetch_size_;  //!< Maximum number of IMAGES decoded ahead of consumption
 };
 }  // namespace utils
 
@@ -0,0 +1,172 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef IMAGE_PREFETCHER_HPP_
+#define IMAGE_PREFETCHER_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "sensors/sensor_data.hpp"
+
+namespace utils
+{
+/**
+ * @brief Image prefetcher. Images of a sequence are decoded in order on a background thread into a bounded queue, such
+ * that at most a given number of decoded images is held in memory at any time. Images are released once consumed.
+ *
+ */
+class imagePrefetcher
+{
+ public:
+  using ImageIndex = std::vector<std::pair<msceqf::fp, std::string>>;  //!< Timestamps and paths of the images
+
+  /**
+   * @brief Construct the image prefetcher and start decoding the images on the background thread
+   *
+   * @param index Timestamps and paths of the images sorted by timestamp
+   * @param capacity Maximum number of decoded images held in memory
+   */
+  imagePrefetcher(const ImageIndex& index, const size_t& capacity)
+      : index_(index)
+      , queue_()
+      , capacity_(std::max(capacity, size_t(1)))
+      , produced_(0)
+      , stop_(false)
+      , mutex_()
+      , not_full_()
+      , not_empty_()
+      , thread_()
+  {
+    thread_ = std::thread(&imagePrefetcher::run, this);
+  }
+
+  /**
+   * @brief Stop the background thread and release the decoded images
+   *
+   */
+  ~imagePrefetcher()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    not_full_.notify_all();
+    thread_.join();
+  }
+
+  imagePrefetcher(const imagePrefetcher&) = delete;
+  imagePrefetcher& operator=(const imagePrefetcher&) = delete;
+
+  /**
+   * @brief Consume the image at the given position of the index, waiting for it to be decoded if needed. Decoded
+   * images that precede the given one are released. If the given image has already been released, it is decoded
+   * synchronously.
+   *
+   * @param idx Position of the image in the index
+   * @return Camera measurement
+   */
+  msceqf::Camera consume(const size_t& idx)
+  {
+    assert(idx < index_.size());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (idx < produced_ - queue_.size())
+    {
+      lock.unlock();
+      return decode(idx);
+    }
+
+    while (true)
+    {
+      not_empty_.wait(lock, [&]() { return !queue_.empty(); });
+
+      const size_t front = produced_ - queue_.size();
+      msceqf::Camera cam = std::move(queue_.front());
+      queue_.pop_front();
+      not_full_.notify_one();
+
+      if (front == idx)
+      {
+        return cam;
+      }
+    }
+  }
+
+ private:
+  /**
+   * @brief Decode the image at the given position of the index
+   *
+   * @param idx Position of the image in the index
+   * @return Camera measurement
+   */
+  msceqf::Camera decode(const size_t& idx) const
+  {
+    msceqf::Camera cam;
+    cam.timestamp_ = index_[idx].first;
+    cam.image_ = cv::imread(index_[idx].second, cv::IMREAD_GRAYSCALE);
+    cam.mask_ = 255 * cv::Mat::ones(cam.image_.rows, cam.image_.cols, CV_8UC1);
+    return cam;
+  }
+
+  /**
+   * @brief Decode the images in order, waiting while the queue is full
+   *
+   */
+  void run()
+  {
+    for (size_t idx = 0; idx < index_.size(); ++idx)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [&]() { return stop_ || queue_.size() < capacity_; });
+        if (stop_)
+        {
+          return;
+        }
+      }
+
+      // Decoding happens outside the lock, such that the consumer is not blocked
+      msceqf::Camera cam = decode(idx);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.emplace_back(std::move(cam));
+        ++produced_;
+      }
+      not_empty_.notify_one();
+    }
+  }
+
+  ImageIndex index_;                  //!< Timestamps and paths of the images
+  std::deque<msceqf::Camera> queue_;  //!< Decoded images not yet consumed
+  size_t capacity_;                   //!< Maximum number of decoded images held in memory
+  size_t produced_;                   //!< Number of images decoded so far
+
+  bool stop_;  //!< Flag to stop the background thread
+
+  std::mutex mutex_;                   //!< Mutex for the queue
+  std::condition_variable not_full_;   //!< Condition variable signaling that the queue is not full
+  std::condition_variable not_empty_;  //!< Condition variable signaling that the queue is not empty
+  std::thread thread_;                 //!< Background decoding thread
+};
+}  // namespace utils
+
+#endif  // IMAGE_PREFETCHER_HPP_
@@ -0,0 +1,343 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef LATENCY_HISTOGRAM_HPP_
+#define LATENCY_HISTOGRAM_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "utils/trace_recorder.hpp"
+
+namespace utils
+{
+#ifdef LATENCY_STATS
+
+static constexpr bool latency_stats_enabled = true;  //!< Latency instrumentation compiled in
+
+#else
+
+static constexpr bool latency_stats_enabled = false;  //!< Latency instrumentation compiled out
+
+#endif
+
+/**
+ * @brief Lock-free latency histogram with HDR-style log-linear buckets. Latencies (in nanoseconds) below 2^(b+1) are
+ * counted exactly, while every larger power of two range is split into 2^b linear buckets, hence the relative error of
+ * the reported values is bounded by 2^-b over the whole range, with a fixed memory footprint. Recording is wait-free
+ * (relaxed atomic increments), such that multiple threads can record into the same histogram concurrently.
+ *
+ */
+class latencyHistogram
+{
+ public:
+  static constexpr uint64_t sub_bucket_bits = 5;                           //!< Linear buckets per power of two (log2)
+  static constexpr uint64_t sub_buckets = uint64_t(1) << sub_bucket_bits;  //!< Linear buckets per power of two
+  static constexpr uint64_t max_exponent = 42;                             //!< Largest power of two (~73 minutes)
+  static constexpr size_t num_buckets = 2 * sub_buckets + (max_exponent - sub_bucket_bits) * sub_buckets;  //!< Buckets
+
+  latencyHistogram() : buckets_(), count_(0), sum_(0), min_(std::numeric_limits<uint64_t>::max()), max_(0)
+  {
+    for (auto& bucket : buckets_)
+    {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  latencyHistogram(const latencyHistogram&) = delete;
+  latencyHistogram& operator=(const latencyHistogram&) = delete;
+
+  /**
+   * @brief Record a latency (thread safe)
+   *
+   * @param ns Latency in nanoseconds
+   */
+  void record(const uint64_t& ns)
+  {
+    buckets_[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t min = min_.load(std::memory_order_relaxed);
+    while (ns < min && !min_.compare_exchange_weak(min, ns, std::memory_order_relaxed))
+    {
+    }
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  /**
+   * @brief Get the number of recorded latencies
+   *
+   * @return Number of recorded latencies
+   */
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Get the mean of the recorded latencies in nanoseconds (zero if none)
+   *
+   * @return Mean latency
+   */
+  double mean() const
+  {
+    const uint64_t n = count();
+    return n > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / n : 0;
+  }
+
+  /**
+   * @brief Get the smallest recorded latency in nanoseconds (zero if none)
+   *
+   * @return Minimum latency
+   */
+  uint64_t min() const { return count() > 0 ? min_.load(std::memory_order_relaxed) : 0; }
+
+  /**
+   * @brief Get the largest recorded latency in nanoseconds (zero if none)
+   *
+   * @return Maximum latency
+   */
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Get the given percentile of the recorded latencies in nanoseconds (zero if none), within the resolution of
+   * the buckets
+   *
+   * @param percentile Percentile in [0, 100]
+   * @return Latency at the given percentile
+   */
+  uint64_t percentile(const double& percentile) const
+  {
+    std::array<uint64_t, num_buckets> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < num_buckets; ++i)
+    {
+      counts[i] = buckets_[i].load(std::memory_order_relaxed);
+      total += counts[i];
+    }
+
+    if (total == 0)
+    {
+      return 0;
+    }
+
+    const uint64_t rank =
+        std::max(uint64_t(1), static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * total)));
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < num_buckets; ++i)
+    {
+      cumulative += counts[i];
+      if (cumulative >= rank)
+      {
+        return std::clamp(bucketValue(i), min(), max());
+      }
+    }
+
+    return max();
+  }
+
+  /**
+   * @brief Clear the recorded latencies. Latencies recorded concurrently with the reset might be partially lost
+   *
+   */
+  void reset()
+  {
+    for (auto& bucket : buckets_)
+    {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  /**
+   * @brief Get the bucket of the given latency
+   *
+   * @param ns Latency in nanoseconds
+   * @return Index of the bucket
+   */
+  static size_t bucket(const uint64_t& ns)
+  {
+    if (ns < 2 * sub_buckets)
+    {
+      return ns;
+    }
+
+    uint64_t exponent = 63;
+    while (!(ns >> exponent))
+    {
+      --exponent;
+    }
+    if (exponent > max_exponent)
+    {
+      return num_buckets - 1;
+    }
+
+    const uint64_t shift = exponent - sub_bucket_bits;
+    return 2 * sub_buckets + (exponent - sub_bucket_bits - 1) * sub_buckets + ((ns >> shift) - sub_buckets);
+  }
+
+  /**
+   * @brief Get the value representing the given bucket (middle of the bucket)
+   *
+   * @param idx Index of the bucket
+   * @return Latency in nanoseconds
+   */
+  static uint64_t bucketValue(const size_t& idx)
+  {
+    if (idx < 2 * sub_buckets)
+    {
+      return idx;
+    }
+
+    const uint64_t shift = (idx - 2 * sub_buckets) / sub_buckets + 1;
+    const uint64_t sub_bucket = (idx - 2 * sub_buckets) % sub_buckets + sub_buckets;
+    return (sub_bucket << shift) + ((uint64_t(1) << shift) >> 1);
+  }
+
+  std::array<std::atomic<uint64_t>, num_buckets> buckets_;  //!< Number of latencies recorded in each bucket
+
+  std::atomic<uint64_t> count_;  //!< Number of recorded latencies
+  std::atomic<uint64_t> sum_;    //!< Sum of the recorded latencies
+  std::atomic<uint64_t> min_;    //!< Minimum recorded latency
+  std::atomic<uint64_t> max_;    //!< Maximum recorded latency
+};
+
+/**
+ * @brief Stopwatch accumulating the time elapsed between multiple start and stop calls. If a name is given, every
+ * measured interval is also traced as a named event into the trace recorder of the calling thread (see traceRecorder).
+ * If the latency instrumentation is compiled out and there is nothing to trace, the stopwatch never reads the clock.
+ *
+ */
+class stopwatch
+{
+ public:
+  using clock = traceRecorder::clock;
+
+  /**
+   * @brief Construct the stopwatch
+   *
+   * @param name Name of the trace events (string literal, no trace event if null)
+   */
+  stopwatch(const char* name = nullptr) : recorder_(name ? traceRecorder::current() : nullptr), name_(name) {}
+
+  /**
+   * @brief Start (or restart) measuring
+   *
+   */
+  void start()
+  {
+    if (latency_stats_enabled || recorder_)
+    {
+      start_ = clock::now();
+    }
+  }
+
+  /**
+   * @brief Stop measuring, accumulate the time elapsed since the last start, and trace it
+   *
+   */
+  void stop()
+  {
+    if (latency_stats_enabled || recorder_)
+    {
+      const auto end = clock::now();
+      elapsed_ += end - start_;
+      if (recorder_)
+      {
+        recorder_->record(name_, start_, end);
+      }
+    }
+  }
+
+  /**
+   * @brief Get the accumulated time in nanoseconds
+   *
+   * @return Accumulated time
+   */
+  uint64_t nanoseconds() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed_).count(); }
+
+ private:
+  traceRecorder* recorder_;                            //!< Trace recorder to record into (if any)
+  const char* name_;                                   //!< Name of the trace events
+  clock::time_point start_ = {};                       //!< Time point of the last start
+  clock::duration elapsed_ = clock::duration::zero();  //!< Accumulated time
+};
+
+/**
+ * @brief Scoped timer recording the lifetime of the scope into a latency histogram, and as a named event into the trace
+ * recorder of the calling thread (see traceRecorder). Histograms are not recorded if the latency instrumentation is
+ * compiled out, and the timer does not read the clock if there is nothing to record.
+ *
+ */
+class scopedTimer
+{
+ public:
+  /**
+   * @brief Start the timer
+   *
+   * @param histogram Histogram to record into (can be null)
+   * @param name Name of the trace event (string literal, no trace event if null)
+   */
+  scopedTimer(latencyHistogram* histogram, const char* name = nullptr)
+      : histogram_(latency_stats_enabled ? histogram : nullptr)
+      , recorder_(name ? traceRecorder::current() : nullptr)
+      , name_(name)
+      , begin_()
+  {
+    if (histogram_ || recorder_)
+    {
+      begin_ = traceRecorder::clock::now();
+    }
+  }
+
+  /**
+   * @brief Record the lifetime of the scope
+   *
+   */
+  ~scopedTimer()
+  {
+    if (histogram_ || recorder_)
+    {
+      const auto end = traceRecorder::clock::now();
+      if (histogram_)
+      {
+        histogram_->record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin_).count());
+      }
+      if (recorder_)
+      {
+        recorder_->record(name_, begin_, end);
+      }
+    }
+  }
+
+  scopedTimer(const scopedTimer&) = delete;
+  scopedTimer& operator=(const scopedTimer&) = delete;
+
+ private:
+  latencyHistogram* histogram_;             //!< Histogram to record into (if any)
+  traceRecorder* recorder_;                 //!< Trace recorder to record into (if any)
+  const char* name_;                        //!< Name of the trace event
+  traceRecorder::clock::time_point begin_;  //!< Begin of the scope
+};
+}  // namespace utils
+
+#endif  // LATENCY_HISTOGRAM_HPP_
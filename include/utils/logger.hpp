@@ -12,8 +12,20 @@
 #ifndef LOGGER_HPP_
 #define LOGGER_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#include "utils/ring_buffer.hpp"
 
 namespace utils
 {
@@ -37,93 +49,369 @@ enum class LoggerLevel
 };
 
 /**
- * @brief Logger
+ * @brief Background sink of the logger. Formatted messages are pushed to a lock-free ring buffer, and written to the
+ * standard output by a dedicated thread, that flushes the output only once the ring buffer has been drained, and
+ * sleeps on a condition variable while there is nothing to write. Hence logging threads never block on the output,
+ * and only take a lock to wake the sink thread up. Messages pushed while the ring buffer is full are dropped and
+ * reported.
+ *
+ */
+class loggerSink
+{
+ public:
+  /**
+   * @brief Construct the sink and start the sink thread
+   *
+   * @param capacity Capacity of the ring buffer (number of messages)
+   */
+  loggerSink(const size_t& capacity)
+      : messages_(capacity)
+      , pushed_(0)
+      , written_(0)
+      , dropped_(0)
+      , waiting_(false)
+      , mutex_()
+      , cv_()
+      , stop_(false)
+      , thread_(&loggerSink::run, this)
+  {
+  }
+
+  /**
+   * @brief Write the pending messages and join the sink thread
+   *
+   */
+  ~loggerSink()
+  {
+    destroyed_.store(true, std::memory_order_release);
+    stop_.store(true);
+    notify();
+    thread_.join();
+  }
+
+  loggerSink(const loggerSink&) = delete;
+  loggerSink& operator=(const loggerSink&) = delete;
+
+  /**
+   * @brief Check whether the sink has been destroyed (at exit)
+   *
+   * @return true if the sink has been destroyed, false otherwise
+   */
+  static bool destroyed() { return destroyed_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Push a formatted message to the ring buffer
+   *
+   * @param message Formatted message
+   */
+  void push(std::string&& message)
+  {
+    if (messages_.push(std::move(message)))
+    {
+      pushed_.fetch_add(1);
+    }
+    else
+    {
+      dropped_.fetch_add(1);
+    }
+
+    if (waiting_.load())
+    {
+      notify();
+    }
+  }
+
+  /**
+   * @brief Wait until all the messages pushed so far have been written
+   *
+   */
+  void flush() const
+  {
+    const size_t pushed = pushed_.load(std::memory_order_acquire);
+    while (written_.load(std::memory_order_acquire) < pushed)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+ private:
+  /**
+   * @brief Write the messages in the ring buffer until the sink is stopped and the ring buffer is empty
+   *
+   */
+  void run()
+  {
+    std::string message;
+    while (true)
+    {
+      // The stop flag is read before draining, such that messages pushed before stopping are always written
+      const bool stop = stop_.load();
+
+      size_t written = 0;
+      while (messages_.pop(message))
+      {
+        std::cout << message;
+        ++written;
+      }
+
+      const size_t dropped = dropped_.exchange(0);
+      if (dropped > 0)
+      {
+        std::cout << "\033[33m[ WARNING]: Logger dropped " << dropped << " messages.\033[0m\n";
+      }
+
+      if (written > 0 || dropped > 0)
+      {
+        std::cout.flush();
+        written_.fetch_add(written, std::memory_order_release);
+      }
+
+      if (stop)
+      {
+        return;
+      }
+
+      if (written == 0 && dropped == 0)
+      {
+        // Sleep until a message is pushed or dropped, or the sink is stopped. The waiting flag is set before checking
+        // the counters (all sequentially consistent), hence a producer either sees the flag or its message is seen.
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting_.store(true);
+        cv_.wait(lock, [this]() { return stop_.load() || dropped_.load() > 0 || pushed_.load() > written_.load(); });
+        waiting_.store(false);
+      }
+    }
+  }
+
+  /**
+   * @brief Wake the sink thread up
+   *
+   */
+  void notify()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_one();
+  }
+
+  ringBuffer<std::string> messages_;  //!< Formatted messages to be written
+
+  std::atomic<size_t> pushed_;   //!< Number of messages pushed
+  std::atomic<size_t> written_;  //!< Number of messages written
+  std::atomic<size_t> dropped_;  //!< Number of messages dropped since the last report
+
+  std::atomic<bool> waiting_;   //!< Flag indicating whether the sink thread is waiting for messages
+  std::mutex mutex_;            //!< Mutex of the condition variable
+  std::condition_variable cv_;  //!< Condition variable the sink thread waits on
+
+  std::atomic<bool> stop_;  //!< Flag to stop the sink thread
+  std::thread thread_;      //!< Sink thread
+
+  static inline std::atomic<bool> destroyed_ = false;  //!< Flag indicating whether the sink has been destroyed
+};
+
+/**
+ * @brief Logger. The logger level is process-wide, unless a thread level is set for the calling thread (see
+ * loggerScope), such that multiple filter instances in the same process can log with their own level.
+ * Messages are formatted only if their level is enabled, and written asynchronously by a background sink (see
+ * loggerSink). Messages that are expensive to build should be given as callables returning the message, such that
+ * they are not built at all when their level is disabled, e.g.
+ * Logger::debug([&]() { return "Created element at time: " + std::to_string(t); });
  *
  */
 class Logger
 {
  public:
   /**
-   * @brief Get the logger level (see LoggerLevel)
+   * @brief Get the logger level (see LoggerLevel) of the calling thread
    *
-   * @return const LoggerLevel&
+   * @return LoggerLevel
    */
-  static const LoggerLevel& getlevel() { return level_; }
+  static LoggerLevel getlevel() { return thread_level_ ? *thread_level_ : level_.load(std::memory_order_relaxed); }
 
   /**
-   * @brief Set the logger level (see LoggerLevel)
+   * @brief Set the process-wide logger level (see LoggerLevel)
    *
    * @param level LoggerLevel
    */
-  static void setLevel(const LoggerLevel& level) { level_ = level; }
+  static void setLevel(const LoggerLevel& level) { level_.store(level, std::memory_order_relaxed); }
+
+  /**
+   * @brief Get the logger level of the calling thread, if any
+   *
+   * @return Logger level of the calling thread, empty if the process-wide level is used
+   */
+  static std::optional<LoggerLevel> threadLevel() { return thread_level_; }
+
+  /**
+   * @brief Set the logger level of the calling thread, overriding the process-wide logger level
+   *
+   * @param level Logger level of the calling thread, empty to use the process-wide level
+   */
+  static void setThreadLevel(const std::optional<LoggerLevel>& level) { thread_level_ = level; }
 
   /**
    * @brief Format a info message and log it in white
    *
-   * @tparam T Type of the message
+   * @tparam T Type of the message (or of a callable returning the message)
    * @param msg message
    */
   template <typename T>
   static void info(const T& msg)
   {
-    static_assert(is_streamable<std::ostream, T>::value);
-    if (level_ == LoggerLevel::INFO || level_ == LoggerLevel::FULL)
+    if (getlevel() <= LoggerLevel::INFO)
     {
-      std::cout << "[ INFO]: " << msg << '.' << std::endl;
+      write("[ INFO]: ", msg, ".\n");
     }
   }
 
   /**
    * @brief Format a error message and log it in red
    *
-   * @tparam T Type of the message
+   * @tparam T Type of the message (or of a callable returning the message)
    * @param msg message
    */
   template <typename T>
   static void err(const T& msg)
   {
-    static_assert(is_streamable<std::ostream, T>::value);
-    if (level_ == LoggerLevel::INFO || level_ == LoggerLevel::WARN || level_ == LoggerLevel::ERR ||
-        level_ == LoggerLevel::FULL)
+    if (getlevel() <= LoggerLevel::ERR)
     {
-      std::cout << "\033[31m[ ERROR]: " << msg << ".\033[0m" << std::endl;
+      write("\033[31m[ ERROR]: ", msg, ".\033[0m\n");
     }
   }
 
   /**
    * @brief Format a warn message and log it in yellow
    *
-   * @tparam T Type of the message
+   * @tparam T Type of the message (or of a callable returning the message)
    * @param msg message
    */
   template <typename T>
   static void warn(const T& msg)
   {
-    static_assert(is_streamable<std::ostream, T>::value);
-    if (level_ == LoggerLevel::INFO || level_ == LoggerLevel::WARN || level_ == LoggerLevel::FULL)
+    if (getlevel() <= LoggerLevel::WARN)
     {
-      std::cout << "\033[33m[ WARNING]: " << msg << ".\033[0m" << std::endl;
+      write("\033[33m[ WARNING]: ", msg, ".\033[0m\n");
     }
   }
 
   /**
    * @brief Format a debug message and log it in blue
    *
-   * @tparam T Type of the message
+   * @tparam T Type of the message (or of a callable returning the message)
    * @param msg message
    */
   template <typename T>
   static void debug(const T& msg)
   {
-    static_assert(is_streamable<std::ostream, T>::value);
-    if (level_ == LoggerLevel::FULL)
+    if (getlevel() <= LoggerLevel::FULL)
+    {
+      write("\033[34m[ DEBUG]: ", msg, ".\033[0m\n");
+    }
+  }
+
+  /**
+   * @brief Wait until all the messages logged so far have been written
+   *
+   */
+  static void flush()
+  {
+    if (!loggerSink::destroyed())
     {
-      std::cout << "\033[34m[ DEBUG]: " << msg << ".\033[0m" << std::endl;
+      sink().flush();
     }
   }
 
  private:
-  static inline LoggerLevel level_ = LoggerLevel::INFO;  //!< Logger level (INFO by default)
+  /**
+   * @brief Get the background sink, started at the first logged message
+   *
+   * @return Background sink
+   */
+  static loggerSink& sink()
+  {
+    static loggerSink sink(sink_capacity_);
+    return sink;
+  }
+
+  /**
+   * @brief Format a message and push it to the background sink. Messages logged after the sink has been destroyed (at
+   * exit) are written directly.
+   *
+   * @tparam T Type of the message (or of a callable returning the message)
+   * @param prefix Prefix of the message
+   * @param msg message
+   * @param suffix Suffix of the message
+   */
+  template <typename T>
+  static void write(const std::string_view& prefix, const T& msg, const std::string_view& suffix)
+  {
+    if constexpr (std::is_invocable_v<const T&>)
+    {
+      write(prefix, msg(), suffix);
+    }
+    else
+    {
+      static_assert(is_streamable<std::ostream, T>::value);
+
+      std::string message;
+      if constexpr (std::is_convertible_v<const T&, std::string_view>)
+      {
+        const std::string_view view = msg;
+        message.reserve(prefix.size() + view.size() + suffix.size());
+        message.append(prefix).append(view).append(suffix);
+      }
+      else
+      {
+        std::ostringstream os;
+        os << prefix << msg << suffix;
+        message = os.str();
+      }
+
+      if (!loggerSink::destroyed())
+      {
+        sink().push(std::move(message));
+      }
+      else
+      {
+        std::cout << message << std::flush;
+      }
+    }
+  }
+
+  static constexpr size_t sink_capacity_ = 8192;  //!< Capacity of the ring buffer of the sink (number of messages)
+
+  static inline std::atomic<LoggerLevel> level_ = LoggerLevel::INFO;         //!< Logger level (INFO by default)
+  static inline thread_local std::optional<LoggerLevel> thread_level_ = {};  //!< Logger level of the thread
+};
+
+/**
+ * @brief Scoped logger level of the calling thread. The previous thread level is restored when the scope ends.
+ *
+ */
+class loggerScope
+{
+ public:
+  /**
+   * @brief Set the logger level of the calling thread for the lifetime of the scope
+   *
+   * @param level Logger level of the calling thread, empty to use the process-wide level
+   */
+  loggerScope(const std::optional<LoggerLevel>& level) : previous_(Logger::threadLevel())
+  {
+    Logger::setThreadLevel(level);
+  }
+
+  /**
+   * @brief Restore the previous logger level of the calling thread
+   *
+   */
+  ~loggerScope() { Logger::setThreadLevel(previous_); }
+
+  loggerScope(const loggerScope&) = delete;
+  loggerScope& operator=(const loggerScope&) = delete;
+
+ private:
+  std::optional<LoggerLevel> previous_;  //!< Previous logger level of the calling thread
 };
 
 }  // namespace utils
@@ -0,0 +1,138 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef RING_BUFFER_HPP_
+#define RING_BUFFER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace utils
+{
+/**
+ * @brief Bounded lock-free ring buffer for multiple producers and a single consumer. Each slot carries a sequence
+ * number telling whether it is free or holds an element, hence producers only contend on the push position, and never
+ * block: pushing to a full ring buffer fails.
+ *
+ * @tparam T Type of the elements (default constructible and move assignable)
+ */
+template <typename T>
+class ringBuffer
+{
+ public:
+  /**
+   * @brief Construct the ring buffer
+   *
+   * @param capacity Capacity of the ring buffer (rounded up to a power of two)
+   */
+  ringBuffer(const size_t& capacity) : slots_(), mask_(0), push_pos_(0), pop_pos_(0)
+  {
+    size_t size = 2;
+    while (size < capacity)
+    {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+
+    slots_ = std::make_unique<Slot[]>(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+      slots_[i].sequence_.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ringBuffer(const ringBuffer&) = delete;
+  ringBuffer& operator=(const ringBuffer&) = delete;
+
+  /**
+   * @brief Push an element (thread safe)
+   *
+   * @param element Element
+   * @return true if the element has been pushed, false if the ring buffer is full
+   */
+  bool push(T&& element)
+  {
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true)
+    {
+      slot = &slots_[pos & mask_];
+      const size_t sequence = slot->sequence_.load(std::memory_order_acquire);
+      if (sequence == pos)
+      {
+        if (push_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (sequence < pos)
+      {
+        return false;
+      }
+      else
+      {
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->element_ = std::move(element);
+    slot->sequence_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pop the oldest element (to be called by the consumer thread only)
+   *
+   * @param element Popped element
+   * @return true if an element has been popped, false if the ring buffer is empty
+   */
+  bool pop(T& element)
+  {
+    Slot& slot = slots_[pop_pos_ & mask_];
+    if (slot.sequence_.load(std::memory_order_acquire) != pop_pos_ + 1)
+    {
+      return false;
+    }
+
+    element = std::move(slot.element_);
+    slot.sequence_.store(pop_pos_ + mask_ + 1, std::memory_order_release);
+    ++pop_pos_;
+    return true;
+  }
+
+  /**
+   * @brief Get the capacity of the ring buffer
+   *
+   * @return Capacity
+   */
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  /**
+   * @brief Slot of the ring buffer
+   *
+   */
+  struct Slot
+  {
+    std::atomic<size_t> sequence_;  //!< Sequence number (position + 1 if holding an element, position if free)
+    T element_;                     //!< Element
+  };
+
+  std::unique_ptr<Slot[]> slots_;  //!< Slots
+  size_t mask_;                    //!< Mask mapping positions to slots (capacity - 1)
+
+  alignas(64) std::atomic<size_t> push_pos_;  //!< Next position to push to (shared by the producers)
+  alignas(64) size_t pop_pos_;                //!< Next position to pop from (owned by the consumer)
+};
+}  // namespace utils
+
+#endif  // RING_BUFFER_HPP_
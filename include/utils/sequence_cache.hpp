@@ -0,0 +1,401 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef SEQUENCE_CACHE_HPP_
+#define SEQUENCE_CACHE_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <variant>
+#include <opencv2/opencv.hpp>
+
+#include "utils/csv_parser.hpp"
+#include "utils/data_parser.hpp"
+
+namespace utils
+{
+/**
+ * @brief Header of the binary sequence cache. The cache is a single file holding, in order, the header, the imu
+ * readings (t, ang_x, ang_y, ang_z, acc_x, acc_y, acc_z), the groundtruth (t, q_x, q_y, q_z, q_w, p_x, p_y, p_z, v_x,
+ * v_y, v_z, bw_x, bw_y, bw_z, ba_x, ba_y, ba_z), the image timestamps, and the raw 8 bit grayscale images. Numbers are
+ * stored as native doubles, and every section starts at a 64 bytes aligned offset, such that the file can be memory
+ * mapped and read in place. The byte order and the size of a double of the writer are recorded in the header, and a
+ * cache written on a different architecture is rejected.
+ *
+ */
+struct sequenceCacheHeader
+{
+  static constexpr char magic[8] = {'M', 'S', 'C', 'E', 'Q', 'F', 'S', 'C'};  //!< Magic identifying the file format
+  static constexpr uint32_t version = 2;                                        //!< Version of the file format
+  static constexpr uint32_t byte_order_mark = 0x01020304;                       //!< Byte order mark
+  static constexpr uint64_t alignment = 64;                                     //!< Alignment of the sections
+  static constexpr size_t imu_fields = 7;                                       //!< Numbers per imu reading
+  static constexpr size_t groundtruth_fields = 17;                              //!< Numbers per groundtruth
+
+  char magic_[8];                     //!< Magic
+  uint32_t version_;                  //!< Version
+  uint32_t byte_order_;               //!< Byte order mark, as stored by the writer
+  uint32_t double_size_;              //!< Size of a double of the writer
+  uint32_t width_;                    //!< Width of the images
+  uint32_t height_;                   //!< Height of the images
+  uint32_t reserved_;                 //!< Reserved (padding)
+  uint64_t num_imu_;                  //!< Number of imu readings
+  uint64_t num_groundtruth_;          //!< Number of groundtruth entries
+  uint64_t num_images_;               //!< Number of images
+  uint64_t imu_offset_;               //!< Offset of the imu readings
+  uint64_t groundtruth_offset_;       //!< Offset of the groundtruth
+  uint64_t image_timestamps_offset_;  //!< Offset of the image timestamps
+  uint64_t images_offset_;            //!< Offset of the images
+};
+
+/**
+ * @brief Convert the data of the given (already parsed) data parser into a binary sequence cache. Images are decoded
+ * one at a time as 8 bit grayscale images, hence memory stays constant during the conversion.
+ *
+ * @param parser Data parser
+ * @param filename Name of the sequence cache file
+ *
+ * @note All the images of the sequence are required to have the same resolution
+ */
+static inline void writeSequenceCache(const dataParser& parser, const std::string& filename)
+{
+  const auto& imu_data = parser.getImuData();
+  const auto& groundtruth_data = parser.getGroundtruthData();
+  const auto& image_index = parser.getImageIndex();
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    throw std::runtime_error("Error opening sequence cache file: \"" + filename + "\". Exit programm.");
+  }
+
+  const auto align = [](const uint64_t& offset) {
+    return (offset + sequenceCacheHeader::alignment - 1) / sequenceCacheHeader::alignment *
+           sequenceCacheHeader::alignment;
+  };
+  const auto pad = [&file](const uint64_t& offset) {
+    const std::vector<char> zeros(offset - static_cast<uint64_t>(file.tellp()), 0);
+    file.write(zeros.data(), zeros.size());
+  };
+
+  sequenceCacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic_, sequenceCacheHeader::magic, sizeof(header.magic_));
+  header.version_ = sequenceCacheHeader::version;
+  header.byte_order_ = sequenceCacheHeader::byte_order_mark;
+  header.double_size_ = sizeof(double);
+  header.num_imu_ = imu_data.size();
+  header.num_groundtruth_ = groundtruth_data.size();
+  header.num_images_ = image_index.size();
+  header.imu_offset_ = align(sizeof(sequenceCacheHeader));
+  header.groundtruth_offset_ = align(header.imu_offset_ + header.num_imu_ * sequenceCacheHeader::imu_fields * 8);
+  header.image_timestamps_offset_ =
+      align(header.groundtruth_offset_ + header.num_groundtruth_ * sequenceCacheHeader::groundtruth_fields * 8);
+  header.images_offset_ = align(header.image_timestamps_offset_ + header.num_images_ * 8);
+
+  // The header is written once the resolution of the images is known
+  pad(header.imu_offset_);
+
+  for (const auto& imu : imu_data)
+  {
+    const double record[sequenceCacheHeader::imu_fields] = {imu.timestamp_, imu.ang_.x(), imu.ang_.y(), imu.ang_.z(),
+                                                            imu.acc_.x(),   imu.acc_.y(), imu.acc_.z()};
+    file.write(reinterpret_cast<const char*>(record), sizeof(record));
+  }
+  pad(header.groundtruth_offset_);
+
+  for (const auto& gt : groundtruth_data)
+  {
+    const double record[sequenceCacheHeader::groundtruth_fields] = {
+        gt.timestamp_, gt.q_.x(),  gt.q_.y(),  gt.q_.z(),  gt.q_.w(),  gt.p_.x(),  gt.p_.y(),  gt.p_.z(), gt.v_.x(),
+        gt.v_.y(),     gt.v_.z(),  gt.bw_.x(), gt.bw_.y(), gt.bw_.z(), gt.ba_.x(), gt.ba_.y(), gt.ba_.z()};
+    file.write(reinterpret_cast<const char*>(record), sizeof(record));
+  }
+  pad(header.image_timestamps_offset_);
+
+  for (const auto& [timestamp, path] : image_index)
+  {
+    const double t = timestamp;
+    file.write(reinterpret_cast<const char*>(&t), sizeof(t));
+  }
+  pad(header.images_offset_);
+
+  for (const auto& [timestamp, path] : image_index)
+  {
+    const cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    if (image.empty())
+    {
+      throw std::runtime_error("Error reading image: \"" + path + "\". Exit programm.");
+    }
+    if (header.width_ == 0)
+    {
+      header.width_ = image.cols;
+      header.height_ = image.rows;
+    }
+    if (image.cols != static_cast<int>(header.width_) || image.rows != static_cast<int>(header.height_))
+    {
+      throw std::runtime_error("Images with different resolution in the same sequence. Exit programm.");
+    }
+    for (int row = 0; row < image.rows; ++row)
+    {
+      file.write(reinterpret_cast<const char*>(image.ptr(row)), image.cols);
+    }
+  }
+
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  if (!file)
+  {
+    throw std::runtime_error("Error writing sequence cache file: \"" + filename + "\". Exit programm.");
+  }
+}
+
+/**
+ * @brief Reader of the binary sequence cache. The cache is memory mapped and read in place, imu and groundtruth
+ * readings are not parsed, and images are not decoded nor copied, but returned as headers on the mapped memory.
+ *
+ */
+class sequenceCache
+{
+ public:
+  using SensorReading = dataParser::SensorReading;  //!< Sensor reading (imu or camera)
+
+  /**
+   * @brief Memory map and validate the given sequence cache
+   *
+   * @param filename Name of the sequence cache file
+   */
+  sequenceCache(const std::string& filename) : file_(filename), header_(), mask_(), next_imu_(0), next_image_(0)
+  {
+    const std::string_view content = file_.view();
+
+    if (content.size() < sizeof(sequenceCacheHeader))
+    {
+      throw std::runtime_error("Corrupted sequence cache: \"" + filename + "\". Exit programm.");
+    }
+    std::memcpy(&header_, content.data(), sizeof(sequenceCacheHeader));
+
+    if (std::memcmp(header_.magic_, sequenceCacheHeader::magic, sizeof(header_.magic_)) != 0 ||
+        header_.version_ != sequenceCacheHeader::version)
+    {
+      throw std::runtime_error("Unsupported sequence cache: \"" + filename + "\". Exit programm.");
+    }
+
+    if (header_.byte_order_ != sequenceCacheHeader::byte_order_mark || header_.double_size_ != sizeof(double))
+    {
+      throw std::runtime_error("Sequence cache written on a different architecture: \"" + filename +
+                               "\". Exit programm.");
+    }
+
+    // Every section has to be aligned and to lie within the file
+    const auto fits = [&content](const uint64_t& offset, const uint64_t& count, const uint64_t& record_size) {
+      return offset % sequenceCacheHeader::alignment == 0 && offset <= content.size() &&
+             (record_size == 0 || count <= (content.size() - offset) / record_size);
+    };
+    const uint64_t image_size = static_cast<uint64_t>(header_.width_) * header_.height_;
+
+    if (!fits(header_.imu_offset_, header_.num_imu_, sequenceCacheHeader::imu_fields * sizeof(double)) ||
+        !fits(header_.groundtruth_offset_, header_.num_groundtruth_,
+              sequenceCacheHeader::groundtruth_fields * sizeof(double)) ||
+        !fits(header_.image_timestamps_offset_, header_.num_images_, sizeof(double)) ||
+        !fits(header_.images_offset_, header_.num_images_, image_size) ||
+        (header_.num_images_ > 0 && image_size == 0))
+    {
+      throw std::runtime_error("Corrupted sequence cache: \"" + filename + "\". Exit programm.");
+    }
+
+    mask_ = 255 * cv::Mat::ones(header_.height_, header_.width_, CV_8UC1);
+  }
+
+  sequenceCache(const sequenceCache&) = delete;
+  sequenceCache& operator=(const sequenceCache&) = delete;
+
+  /**
+   * @brief Get the number of imu readings
+   *
+   * @return Number of imu readings
+   */
+  size_t numImu() const { return header_.num_imu_; }
+
+  /**
+   * @brief Get the number of groundtruth entries
+   *
+   * @return Number of groundtruth entries
+   */
+  size_t numGroundtruth() const { return header_.num_groundtruth_; }
+
+  /**
+   * @brief Get the number of images
+   *
+   * @return Number of images
+   */
+  size_t numImages() const { return header_.num_images_; }
+
+  /**
+   * @brief Get the imu reading at the given position
+   *
+   * @param idx Position of the imu reading
+   * @return Imu reading
+   */
+  const msceqf::Imu imu(const size_t& idx) const
+  {
+    const double* record = section(header_.imu_offset_) + idx * sequenceCacheHeader::imu_fields;
+
+    msceqf::Imu imu;
+    imu.timestamp_ = record[0];
+    imu.ang_ << record[1], record[2], record[3];
+    imu.acc_ << record[4], record[5], record[6];
+    return imu;
+  }
+
+  /**
+   * @brief Get the groundtruth at the given position
+   *
+   * @param idx Position of the groundtruth
+   * @return Groundtruth
+   */
+  const msceqf::Groundtruth groundtruth(const size_t& idx) const
+  {
+    const double* record = section(header_.groundtruth_offset_) + idx * sequenceCacheHeader::groundtruth_fields;
+
+    msceqf::Groundtruth gt;
+    gt.timestamp_ = record[0];
+    gt.q_.x() = record[1];
+    gt.q_.y() = record[2];
+    gt.q_.z() = record[3];
+    gt.q_.w() = record[4];
+    gt.p_ << record[5], record[6], record[7];
+    gt.v_ << record[8], record[9], record[10];
+    gt.bw_ << record[11], record[12], record[13];
+    gt.ba_ << record[14], record[15], record[16];
+    return gt;
+  }
+
+  /**
+   * @brief Get the image at the given position. The image is a header on the mapped memory (no decoding, no copy),
+   * hence it is valid as long as the sequence cache is alive, and it must not be modified.
+   *
+   * @param idx Position of the image
+   * @return Camera measurement
+   */
+  const msceqf::Camera image(const size_t& idx) const
+  {
+    const size_t image_size = static_cast<size_t>(header_.width_) * header_.height_;
+
+    msceqf::Camera cam;
+    cam.timestamp_ = section(header_.image_timestamps_offset_)[idx];
+    cam.image_ = cv::Mat(header_.height_, header_.width_, CV_8UC1,
+                         const_cast<char*>(file_.view().data() + header_.images_offset_ + idx * image_size));
+    cam.mask_ = mask_;
+    return cam;
+  }
+
+  /**
+   * @brief Check whether there are sensor readings (imu or camera) left to consume with nextSensorReading
+   *
+   * @return true if there are sensor readings left, false otherwise
+   */
+  bool hasNextSensorReading() const { return next_imu_ < numImu() || next_image_ < numImages(); }
+
+  /**
+   * @brief Consume the next sensor reading (imu or camera) in timestamp order, with the same ordering of
+   * dataParser::nextSensorReading (imu first on exact timestamp ties).
+   *
+   * @return const SensorReading
+   */
+  const SensorReading nextSensorReading()
+  {
+    if (!hasNextSensorReading())
+    {
+      throw std::runtime_error("No sensor reading left");
+    }
+
+    SensorReading data;
+
+    if (next_image_ == numImages() ||
+        (next_imu_ < numImu() &&
+         section(header_.imu_offset_)[next_imu_ * sequenceCacheHeader::imu_fields] <=
+             section(header_.image_timestamps_offset_)[next_image_]))
+    {
+      data = imu(next_imu_++);
+    }
+    else
+    {
+      data = image(next_image_++);
+    }
+
+    return data;
+  }
+
+  /**
+   * @brief Get Groundtruth data that is closer to a given timestamp
+   *
+   * @param timestamp
+   * @return msceqf::Groundtruth
+   */
+  const msceqf::Groundtruth getCloserGroundtruthAt(const msceqf::fp& timestamp) const
+  {
+    // Binary search over the timestamps of the (sorted) groundtruth
+    size_t lo = 0;
+    size_t hi = numGroundtruth();
+    const double* gt = section(header_.groundtruth_offset_);
+    while (lo < hi)
+    {
+      const size_t mid = lo + (hi - lo) / 2;
+      if (gt[mid * sequenceCacheHeader::groundtruth_fields] > timestamp)
+      {
+        hi = mid;
+      }
+      else
+      {
+        lo = mid + 1;
+      }
+    }
+
+    if (lo == numGroundtruth())
+    {
+      throw std::runtime_error("No groundtruth data found at timestamp " + std::to_string(timestamp));
+    }
+
+    if (lo > 0 && (std::abs(gt[lo * sequenceCacheHeader::groundtruth_fields] - timestamp) >
+                   std::abs(gt[(lo - 1) * sequenceCacheHeader::groundtruth_fields] - timestamp)))
+    {
+      return groundtruth(lo - 1);
+    }
+
+    return groundtruth(lo);
+  }
+
+ private:
+  /**
+   * @brief Get a pointer to the section of numbers starting at the given offset
+   *
+   * @param offset Offset of the section
+   * @return Pointer to the first number of the section
+   */
+  const double* section(const uint64_t& offset) const
+  {
+    return reinterpret_cast<const double*>(file_.view().data() + offset);
+  }
+
+  mappedFile file_;             //!< Memory mapped sequence cache
+  sequenceCacheHeader header_;  //!< Header of the sequence cache
+  cv::Mat mask_;                //!< Mask shared by all the images (no masked regions)
+
+  size_t next_imu_;    //!< Position of the next imu reading to consume
+  size_t next_image_;  //!< Position of the next image to consume
+};
+}  // namespace utils
+
+#endif  // SEQUENCE_CACHE_HPP_
@@ -0,0 +1,264 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "utils/logger.hpp"
+#include "utils/trace_recorder.hpp"
+
+namespace utils
+{
+/**
+ * @brief Task submitted to a thread pool with threadPool::async. The task is executed either by a worker thread, or by
+ * the thread waiting for its result if no worker thread has started it yet. Hence waiting on a task never blocks on
+ * queued work, and tasks can be waited for from within other tasks of the same thread pool without deadlocks.
+ *
+ * @tparam R Result type of the task
+ */
+template <typename R>
+class pooledTask
+{
+ public:
+  /**
+   * @brief Construct the pooled task
+   *
+   * @param task Packaged task
+   * @param claimed Flag indicating whether the task has been claimed for execution
+   */
+  pooledTask(const std::shared_ptr<std::packaged_task<R()>>& task, const std::shared_ptr<std::atomic<bool>>& claimed)
+      : task_(task), claimed_(claimed), future_(task->get_future())
+  {
+  }
+
+  pooledTask(pooledTask&&) = default;
+  pooledTask& operator=(pooledTask&&) = delete;
+
+  /**
+   * @brief Wait for the task to be completed, as std::async futures do, unless its result has already been retrieved
+   *
+   */
+  ~pooledTask()
+  {
+    if (future_.valid())
+    {
+      wait();
+    }
+  }
+
+  /**
+   * @brief Wait for the task to be completed, executing it in the calling thread if not started yet
+   *
+   */
+  void wait()
+  {
+    run();
+    future_.wait();
+  }
+
+  /**
+   * @brief Get the result of the task, executing it in the calling thread if not started yet
+   *
+   * @return Result of the task
+   */
+  R get()
+  {
+    run();
+    return future_.get();
+  }
+
+ private:
+  /**
+   * @brief Execute the task if it has not been claimed yet
+   *
+   */
+  void run()
+  {
+    if (!claimed_->exchange(true))
+    {
+      (*task_)();
+    }
+  }
+
+  std::shared_ptr<std::packaged_task<R()>> task_;  //!< Packaged task
+  std::shared_ptr<std::atomic<bool>> claimed_;     //!< Flag indicating whether the task has been claimed
+  std::future<R> future_;                          //!< Future holding the result of the task
+};
+
+/**
+ * @brief Fixed size thread pool. Tasks are queued and executed in submission order by a fixed number of worker
+ * threads, hence the number of threads is bounded independently of the number of submitted tasks. Tasks are executed
+ * with the logger level and the trace recorder of the thread that submitted them.
+ *
+ */
+class threadPool
+{
+ public:
+  /**
+   * @brief Construct the thread pool and start the worker threads
+   *
+   * @param num_threads Number of worker threads (at least one)
+   */
+  threadPool(const size_t& num_threads) : tasks_(), workers_(), stop_(false), mutex_(), cv_()
+  {
+    const size_t n = std::max(num_threads, size_t(1));
+    workers_.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      workers_.emplace_back(&threadPool::run, this);
+    }
+  }
+
+  /**
+   * @brief Execute the tasks left in the queue, and join the worker threads
+   *
+   */
+  ~threadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_)
+    {
+      worker.join();
+    }
+  }
+
+  threadPool(const threadPool&) = delete;
+  threadPool& operator=(const threadPool&) = delete;
+
+  /**
+   * @brief Submit a task to the thread pool
+   *
+   * @tparam F Type of the task (callable without arguments)
+   * @param f Task
+   * @return Future holding the result of the task (or the exception thrown by the task)
+   */
+  template <typename F>
+  std::future<std::invoke_result_t<F>> submit(F&& f)
+  {
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(scoped(std::forward<F>(f)));
+    auto future = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return future;
+  }
+
+  /**
+   * @brief Submit a task to the thread pool, that is executed in the thread waiting for its result if no worker thread
+   * has started it yet (see pooledTask)
+   *
+   * @tparam F Type of the task (callable without arguments)
+   * @param f Task
+   * @return Pooled task
+   */
+  template <typename F>
+  pooledTask<std::invoke_result_t<F>> async(F&& f)
+  {
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(scoped(std::forward<F>(f)));
+    auto claimed = std::make_shared<std::atomic<bool>>(false);
+    pooledTask<std::invoke_result_t<F>> pooled(task, claimed);
+    enqueue([task, claimed]() {
+      if (!claimed->exchange(true))
+      {
+        (*task)();
+      }
+    });
+    return pooled;
+  }
+
+  /**
+   * @brief Get the number of worker threads
+   *
+   * @return Number of worker threads
+   */
+  size_t size() const { return workers_.size(); }
+
+ private:
+  /**
+   * @brief Wrap the given task such that it is executed with the logger level and the trace recorder of the calling
+   * thread
+   *
+   * @tparam F Type of the task (callable without arguments)
+   * @param f Task
+   * @return Wrapped task
+   */
+  template <typename F>
+  static auto scoped(F&& f)
+  {
+    return [f = std::forward<F>(f), level = Logger::threadLevel(), recorder = traceRecorder::current()]() mutable {
+      loggerScope scope(level);
+      traceScope trace_scope(recorder);
+      return f();
+    };
+  }
+
+  /**
+   * @brief Queue the given task and wake up a worker thread
+   *
+   * @param task Task
+   */
+  void enqueue(std::function<void()>&& task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+  /**
+   * @brief Execute the queued tasks until the thread pool is stopped and the queue is empty
+   *
+   */
+  void run()
+  {
+    while (true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]() { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty())
+        {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::deque<std::function<void()>> tasks_;  //!< Queued tasks
+  std::vector<std::thread> workers_;         //!< Worker threads
+
+  bool stop_;  //!< Flag to stop the worker threads
+
+  std::mutex mutex_;            //!< Mutex for the queue
+  std::condition_variable cv_;  //!< Condition variable signaling new tasks or stop
+};
+}  // namespace utils
+
+#endif  // THREAD_POOL_HPP_
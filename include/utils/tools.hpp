@@ -14,6 +14,7 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <iterator>
 #include <queue>
@@ -228,6 +229,19 @@ static std::vector<T> flatten(const std::vector<std::vector<T>>& vector_of_vecto
  */
 static inline int pow2(const int& n) { return static_cast<int>(std::ldexp(1.0f, n)); }
 
+/**
+ * @brief Time elapsed between two time points in milliseconds
+ *
+ * @param start Start time point
+ * @param end End time point
+ * @return Elapsed time in milliseconds
+ */
+template <typename TimePoint>
+static inline double elapsedMilliseconds(const TimePoint& start, const TimePoint& end)
+{
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
 }  // namespace utils
 
 /**
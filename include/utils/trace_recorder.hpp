@@ -0,0 +1,265 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TRACE_RECORDER_HPP_
+#define TRACE_RECORDER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "utils/ring_buffer.hpp"
+
+namespace utils
+{
+/**
+ * @brief Trace event, a named interval of time spent by a thread
+ *
+ */
+struct traceEvent
+{
+  const char* name_ = nullptr;  //!< Name of the event (string literal)
+  uint32_t tid_ = 0;            //!< Id of the thread
+  int64_t begin_ = 0;           //!< Begin of the event in nanoseconds since the creation of the recorder
+  int64_t duration_ = 0;        //!< Duration of the event in nanoseconds
+};
+
+/**
+ * @brief Recorder of trace events in the Chrome trace format, readable in Perfetto (ui.perfetto.dev) or
+ * chrome://tracing. Events are recorded by the threads that have the recorder set as their current recorder (see
+ * traceScope), into a bounded lock-free buffer: once the buffer is full, further events are dropped and counted.
+ *
+ */
+class traceRecorder
+{
+ public:
+  using clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Construct the trace recorder
+   *
+   * @param capacity Capacity of the buffer (number of events)
+   */
+  traceRecorder(const size_t& capacity) : events_(capacity), origin_(clock::now()), dropped_(0) {}
+
+  traceRecorder(const traceRecorder&) = delete;
+  traceRecorder& operator=(const traceRecorder&) = delete;
+
+  /**
+   * @brief Record an event of the calling thread (thread safe)
+   *
+   * @param name Name of the event (string literal)
+   * @param begin Begin of the event
+   * @param end End of the event
+   */
+  void record(const char* name, const clock::time_point& begin, const clock::time_point& end)
+  {
+    traceEvent event;
+    event.name_ = name;
+    event.tid_ = threadId();
+    event.begin_ = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - origin_).count();
+    event.duration_ = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+
+    if (!events_.push(std::move(event)))
+    {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Get the number of events dropped because the buffer was full
+   *
+   * @return Number of dropped events
+   */
+  size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Write the recorded events to the given file as a Chrome trace (JSON), and clear the buffer
+   *
+   * @param filename Name of the trace file
+   *
+   * @note Writing is not thread safe with respect to other writes, while events can be recorded concurrently
+   */
+  void write(const std::string& filename)
+  {
+    std::ofstream file(filename);
+    if (!file)
+    {
+      throw std::runtime_error("Error opening trace file: \"" + filename + "\". Exit programm.");
+    }
+
+    file << "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": " << dropped() << "},\n"
+         << "\"traceEvents\": [";
+
+    traceEvent event;
+    bool first = true;
+    while (events_.pop(event))
+    {
+      // Timestamps and durations are in microseconds
+      file << (first ? "\n" : ",\n") << "{\"name\": \"" << event.name_ << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": "
+           << event.tid_ << ", \"ts\": " << event.begin_ / 1000 << '.' << padded(event.begin_ % 1000)
+           << ", \"dur\": " << event.duration_ / 1000 << '.' << padded(event.duration_ % 1000) << '}';
+      first = false;
+    }
+
+    file << "\n]}\n";
+  }
+
+  /**
+   * @brief Get the trace recorder of the calling thread, if any
+   *
+   * @return Trace recorder of the calling thread (null if none)
+   */
+  static traceRecorder* current() { return current_; }
+
+  /**
+   * @brief Set the trace recorder of the calling thread
+   *
+   * @param recorder Trace recorder of the calling thread (null if none)
+   */
+  static void setCurrent(traceRecorder* recorder) { current_ = recorder; }
+
+  /**
+   * @brief Record an event of the calling thread into its trace recorder, if any
+   *
+   * @param name Name of the event (string literal)
+   * @param begin Begin of the event
+   * @param end End of the event
+   */
+  static void trace(const char* name, const clock::time_point& begin, const clock::time_point& end)
+  {
+    if (current_)
+    {
+      current_->record(name, begin, end);
+    }
+  }
+
+  /**
+   * @brief Get a small sequential id of the calling thread, stable for the lifetime of the thread
+   *
+   * @return Id of the calling thread
+   */
+  static uint32_t threadId()
+  {
+    static std::atomic<uint32_t> next_id(0);
+    static thread_local const uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+  }
+
+ private:
+  /**
+   * @brief Format the fractional part of a number of microseconds given in nanoseconds with three digits
+   *
+   * @param ns Nanoseconds (less than 1000)
+   * @return Formatted fractional part
+   */
+  static std::string padded(const int64_t& ns)
+  {
+    const std::string digits = std::to_string(ns);
+    return std::string(3 - std::min(digits.size(), size_t(3)), '0') + digits;
+  }
+
+  ringBuffer<traceEvent> events_;  //!< Recorded events
+  clock::time_point origin_;       //!< Time point of the creation of the recorder
+  std::atomic<size_t> dropped_;    //!< Number of dropped events
+
+  static inline thread_local traceRecorder* current_ = nullptr;  //!< Trace recorder of the thread
+};
+
+/**
+ * @brief Scoped trace recorder of the calling thread. The previous trace recorder is restored when the scope ends.
+ *
+ */
+class traceScope
+{
+ public:
+  /**
+   * @brief Set the trace recorder of the calling thread for the lifetime of the scope
+   *
+   * @param recorder Trace recorder of the calling thread (null if none)
+   */
+  traceScope(traceRecorder* recorder) : previous_(traceRecorder::current()) { traceRecorder::setCurrent(recorder); }
+
+  /**
+   * @brief Restore the previous trace recorder of the calling thread
+   *
+   */
+  ~traceScope() { traceRecorder::setCurrent(previous_); }
+
+  traceScope(const traceScope&) = delete;
+  traceScope& operator=(const traceScope&) = delete;
+
+ private:
+  traceRecorder* previous_;  //!< Previous trace recorder of the calling thread
+};
+
+/**
+ * @brief Scoped trace event, recording the lifetime of the scope into the trace recorder of the calling thread, if any
+ *
+ */
+class traceSpan
+{
+ public:
+  /**
+   * @brief Begin the event
+   *
+   * @param name Name of the event (string literal)
+   */
+  traceSpan(const char* name) : recorder_(traceRecorder::current()), name_(name), begin_()
+  {
+    if (recorder_)
+    {
+      begin_ = traceRecorder::clock::now();
+    }
+  }
+
+  /**
+   * @brief End the event
+   *
+   */
+  ~traceSpan()
+  {
+    if (recorder_)
+    {
+      recorder_->record(name_, begin_, traceRecorder::clock::now());
+    }
+  }
+
+  traceSpan(const traceSpan&) = delete;
+  traceSpan& operator=(const traceSpan&) = delete;
+
+ private:
+  traceRecorder* recorder_;                 //!< Trace recorder of the thread that began the event
+  const char* name_;                        //!< Name of the event
+  traceRecorder::clock::time_point begin_;  //!< Begin of the event
+};
+
+/**
+ * @brief Time elapsed since the given time point in milliseconds, traced as an event ending now in the trace recorder
+ * of the calling thread, if any
+ *
+ * @param name Name of the event (string literal)
+ * @param start Start time point
+ * @return Elapsed time in milliseconds
+ */
+static inline double tracedMilliseconds(const char* name, const traceRecorder::clock::time_point& start)
+{
+  const auto end = traceRecorder::clock::now();
+  traceRecorder::trace(name, start, end);
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+}  // namespace utils
+
+#endif  // TRACE_RECORDER_HPP_
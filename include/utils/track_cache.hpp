@@ -0,0 +1,227 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TRACK_CACHE_HPP_
+#define TRACK_CACHE_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "sensors/sensor_data.hpp"
+#include "utils/csv_parser.hpp"
+
+namespace utils
+{
+/**
+ * @brief Header of the binary track cache. The cache is a single file holding, after the header, one record per frame
+ * processed by the tracker. Each record holds the timestamp (double), the number of features n (uint64), followed by
+ * the n ids (uint), and the n distorted, undistorted and normalized coordinates (2 floats each), followed by the number
+ * of bearings m (uint64, either 0 or n) and the m bearings (3 floats each).
+ *
+ */
+struct trackCacheHeader
+{
+  static constexpr char magic[8] = {'M', 'S', 'C', 'E', 'Q', 'F', 'T', 'C'};  //!< Magic identifying the file format
+  static constexpr uint32_t version = 2;                                        //!< Version of the file format
+
+  char magic_[8];      //!< Magic
+  uint32_t version_;   //!< Version
+  uint32_t reserved_;  //!< Reserved (padding)
+};
+
+/**
+ * @brief Writer of the binary track cache. Features are appended frame by frame as they are produced by the tracker.
+ * Records are buffered, and the file is flushed when the writer is destroyed, hence the cache can be read only
+ * afterwards.
+ *
+ */
+class trackCacheWriter
+{
+ public:
+  /**
+   * @brief Create the track cache file and write its header
+   *
+   * @param filename Name of the track cache file
+   */
+  trackCacheWriter(const std::string& filename) : file_(filename, std::ios::binary | std::ios::trunc)
+  {
+    if (!file_)
+    {
+      throw std::runtime_error("Error opening track cache file: \"" + filename + "\". Exit programm.");
+    }
+
+    trackCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic_, trackCacheHeader::magic, sizeof(header.magic_));
+    header.version_ = trackCacheHeader::version;
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+
+  /**
+   * @brief Append the features of a single frame
+   *
+   * @param timestamp Timestamp of the frame
+   * @param features Features detected/tracked in the frame
+   */
+  void write(const msceqf::fp& timestamp, const msceqf::Features& features)
+  {
+    const double t = timestamp;
+    const uint64_t n = features.ids_.size();
+    const uint64_t m = features.bearings_.size();
+
+    assert(features.distorted_uvs_.size() == n);
+    assert(features.uvs_.size() == n);
+    assert(features.normalized_uvs_.size() == n);
+    assert(m == 0 || m == n);
+
+    file_.write(reinterpret_cast<const char*>(&t), sizeof(t));
+    file_.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    file_.write(reinterpret_cast<const char*>(features.ids_.data()), n * sizeof(uint));
+    file_.write(reinterpret_cast<const char*>(features.distorted_uvs_.data()), n * sizeof(cv::Point2f));
+    file_.write(reinterpret_cast<const char*>(features.uvs_.data()), n * sizeof(cv::Point2f));
+    file_.write(reinterpret_cast<const char*>(features.normalized_uvs_.data()), n * sizeof(cv::Point2f));
+    file_.write(reinterpret_cast<const char*>(&m), sizeof(m));
+    file_.write(reinterpret_cast<const char*>(features.bearings_.data()), m * sizeof(cv::Point3f));
+
+    if (!file_)
+    {
+      throw std::runtime_error("Error writing track cache file. Exit programm.");
+    }
+  }
+
+ private:
+  std::ofstream file_;  //!< Track cache file
+};
+
+/**
+ * @brief Reader of the binary track cache. The cache is memory mapped, and the features are returned frame by frame as
+ * triangulated features measurements (without points), ready to be processed by the backend.
+ *
+ */
+class trackCacheReader
+{
+ public:
+  /**
+   * @brief Memory map and validate the given track cache
+   *
+   * @param filename Name of the track cache file
+   */
+  trackCacheReader(const std::string& filename) : file_(filename), offset_(sizeof(trackCacheHeader))
+  {
+    const std::string_view content = file_.view();
+
+    trackCacheHeader header;
+    if (content.size() < sizeof(trackCacheHeader))
+    {
+      throw std::runtime_error("Corrupted track cache: \"" + filename + "\". Exit programm.");
+    }
+    std::memcpy(&header, content.data(), sizeof(trackCacheHeader));
+
+    if (std::memcmp(header.magic_, trackCacheHeader::magic, sizeof(header.magic_)) != 0 ||
+        header.version_ != trackCacheHeader::version)
+    {
+      throw std::runtime_error("Unsupported track cache: \"" + filename + "\". Exit programm.");
+    }
+  }
+
+  /**
+   * @brief Check whether there are frames left to read
+   *
+   * @return true if there are frames left, false otherwise
+   */
+  bool hasNextFeatures() const { return offset_ < file_.view().size(); }
+
+  /**
+   * @brief Get the timestamp of the next frame, without consuming it
+   *
+   * @return Timestamp of the next frame
+   */
+  msceqf::fp nextTimestamp() const
+  {
+    double t;
+    read(offset_, &t, sizeof(t));
+    return t;
+  }
+
+  /**
+   * @brief Consume the next frame
+   *
+   * @return Triangulated features measurement (without points)
+   */
+  msceqf::TriangulatedFeatures nextFeatures()
+  {
+    if (!hasNextFeatures())
+    {
+      throw std::runtime_error("No features left");
+    }
+
+    double t;
+    uint64_t n;
+    read(offset_, &t, sizeof(t));
+    read(offset_ + sizeof(t), &n, sizeof(n));
+    size_t offset = offset_ + sizeof(t) + sizeof(n);
+
+    msceqf::TriangulatedFeatures features;
+    features.timestamp_ = t;
+    features.features_.ids_.resize(n);
+    features.features_.distorted_uvs_.resize(n);
+    features.features_.uvs_.resize(n);
+    features.features_.normalized_uvs_.resize(n);
+
+    read(offset, features.features_.ids_.data(), n * sizeof(uint));
+    offset += n * sizeof(uint);
+    read(offset, features.features_.distorted_uvs_.data(), n * sizeof(cv::Point2f));
+    offset += n * sizeof(cv::Point2f);
+    read(offset, features.features_.uvs_.data(), n * sizeof(cv::Point2f));
+    offset += n * sizeof(cv::Point2f);
+    read(offset, features.features_.normalized_uvs_.data(), n * sizeof(cv::Point2f));
+    offset += n * sizeof(cv::Point2f);
+
+    uint64_t m;
+    read(offset, &m, sizeof(m));
+    offset += sizeof(m);
+    if (m != 0 && m != n)
+    {
+      throw std::runtime_error("Corrupted track cache. Exit programm.");
+    }
+    features.features_.bearings_.resize(m);
+    read(offset, features.features_.bearings_.data(), m * sizeof(cv::Point3f));
+    offset_ = offset + m * sizeof(cv::Point3f);
+
+    return features;
+  }
+
+ private:
+  /**
+   * @brief Copy the given number of bytes of the mapped file, starting at the given offset, into the destination
+   *
+   * @param offset Offset
+   * @param dst Destination
+   * @param size Number of bytes
+   */
+  void read(const size_t& offset, void* dst, const size_t& size) const
+  {
+    if (offset + size > file_.view().size())
+    {
+      throw std::runtime_error("Corrupted track cache. Exit programm.");
+    }
+    std::memcpy(dst, file_.view().data() + offset, size);
+  }
+
+  mappedFile file_;  //!< Memory mapped track cache
+  size_t offset_;    //!< Offset of the next frame
+};
+}  // namespace utils
+
+#endif  // TRACK_CACHE_HPP_
@@ -0,0 +1,157 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TRAJECTORY_EVALUATION_HPP_
+#define TRAJECTORY_EVALUATION_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "types/fptypes.hpp"
+
+namespace utils
+{
+/**
+ * @brief Pose (orientation and position of the IMU frame in the global frame) associated with a time
+ *
+ */
+struct timedPose
+{
+  msceqf::fp timestamp_ = -1;                              //!< Timestamp of the pose
+  msceqf::Quaternion q_ = msceqf::Quaternion::Identity();  //!< Orientation of the IMU frame in the global frame
+  msceqf::Vector3 p_ = msceqf::Vector3::Zero();            //!< Position of the IMU frame in the global frame
+};
+
+/**
+ * @brief Errors of an estimated trajectory with respect to the groundtruth. Rotation errors are in degrees, translation
+ * errors in meters. Errors that can not be computed are NaN.
+ *
+ */
+struct trajectoryErrors
+{
+  msceqf::fp ate_position_ = std::numeric_limits<msceqf::fp>::quiet_NaN();     //!< Absolute position error (RMSE)
+  msceqf::fp ate_rotation_ = std::numeric_limits<msceqf::fp>::quiet_NaN();     //!< Absolute rotation error (RMSE)
+  msceqf::fp rpe_translation_ = std::numeric_limits<msceqf::fp>::quiet_NaN();  //!< Relative translation error (mean)
+  msceqf::fp rpe_rotation_ = std::numeric_limits<msceqf::fp>::quiet_NaN();     //!< Relative rotation error (mean)
+  size_t poses_ = 0;                                                            //!< Number of evaluated poses
+  size_t segments_ = 0;                                                         //!< Number of evaluated segments
+};
+
+/**
+ * @brief Evaluate an estimated trajectory against the associated groundtruth.
+ * The absolute trajectory error (ATE) is computed after aligning the estimated trajectory to the groundtruth with the
+ * position and yaw transformation minimizing the position error (the unobservable directions of visual-inertial
+ * odometry). The relative pose error (RPE) is computed over all the segments of the trajectory whose groundtruth
+ * travelled distance is (at least) the given segment length, and it does not depend on the alignment.
+ *
+ * @param estimate Estimated poses
+ * @param groundtruth Groundtruth poses, associated one to one with the estimated poses
+ * @param segment_length Travelled distance of the segments for the RPE
+ * @return Trajectory errors
+ */
+static inline trajectoryErrors evaluateTrajectory(const std::vector<timedPose>& estimate,
+                                                  const std::vector<timedPose>& groundtruth,
+                                                  const msceqf::fp& segment_length)
+{
+  assert(estimate.size() == groundtruth.size());
+
+  trajectoryErrors errors;
+  const size_t n = std::min(estimate.size(), groundtruth.size());
+  errors.poses_ = n;
+
+  if (n < 2)
+  {
+    return errors;
+  }
+
+  // Position and yaw alignment in closed form
+  msceqf::Vector3 mean_estimate = msceqf::Vector3::Zero();
+  msceqf::Vector3 mean_groundtruth = msceqf::Vector3::Zero();
+  for (size_t i = 0; i < n; ++i)
+  {
+    mean_estimate += estimate[i].p_;
+    mean_groundtruth += groundtruth[i].p_;
+  }
+  mean_estimate /= static_cast<msceqf::fp>(n);
+  mean_groundtruth /= static_cast<msceqf::fp>(n);
+
+  msceqf::fp sin_yaw = 0;
+  msceqf::fp cos_yaw = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    const msceqf::Vector3 e = estimate[i].p_ - mean_estimate;
+    const msceqf::Vector3 g = groundtruth[i].p_ - mean_groundtruth;
+    sin_yaw += e.x() * g.y() - e.y() * g.x();
+    cos_yaw += e.x() * g.x() + e.y() * g.y();
+  }
+
+  const msceqf::fp yaw = std::atan2(sin_yaw, cos_yaw);
+  const msceqf::Quaternion q_align(Eigen::AngleAxis<msceqf::fp>(yaw, msceqf::Vector3::UnitZ()));
+  const msceqf::Vector3 p_align = mean_groundtruth - q_align * mean_estimate;
+
+  msceqf::fp position_sse = 0;
+  msceqf::fp rotation_sse = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    const msceqf::Vector3 p = q_align * estimate[i].p_ + p_align;
+    const msceqf::Quaternion q = q_align * estimate[i].q_;
+    const msceqf::fp angle = Eigen::AngleAxis<msceqf::fp>(groundtruth[i].q_.inverse() * q).angle() * 180 / M_PI;
+    position_sse += (groundtruth[i].p_ - p).squaredNorm();
+    rotation_sse += angle * angle;
+  }
+  errors.ate_position_ = std::sqrt(position_sse / n);
+  errors.ate_rotation_ = std::sqrt(rotation_sse / n);
+
+  // Travelled distance along the groundtruth
+  std::vector<msceqf::fp> distances(n, 0);
+  for (size_t i = 1; i < n; ++i)
+  {
+    distances[i] = distances[i - 1] + (groundtruth[i].p_ - groundtruth[i - 1].p_).norm();
+  }
+
+  msceqf::fp translation_sum = 0;
+  msceqf::fp rotation_sum = 0;
+  size_t j = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    while (j < n && distances[j] - distances[i] < segment_length)
+    {
+      ++j;
+    }
+    if (j == n)
+    {
+      break;
+    }
+
+    const msceqf::Quaternion q_groundtruth = groundtruth[i].q_.inverse() * groundtruth[j].q_;
+    const msceqf::Vector3 p_groundtruth = groundtruth[i].q_.inverse() * (groundtruth[j].p_ - groundtruth[i].p_);
+    const msceqf::Quaternion q_estimate = estimate[i].q_.inverse() * estimate[j].q_;
+    const msceqf::Vector3 p_estimate = estimate[i].q_.inverse() * (estimate[j].p_ - estimate[i].p_);
+
+    translation_sum += (q_groundtruth.inverse() * (p_estimate - p_groundtruth)).norm();
+    rotation_sum += Eigen::AngleAxis<msceqf::fp>(q_groundtruth.inverse() * q_estimate).angle() * 180 / M_PI;
+    ++errors.segments_;
+  }
+
+  if (errors.segments_ > 0)
+  {
+    errors.rpe_translation_ = translation_sum / errors.segments_;
+    errors.rpe_rotation_ = rotation_sum / errors.segments_;
+  }
+
+  return errors;
+}
+}  // namespace utils
+
+#endif  // TRAJECTORY_EVALUATION_HPP_
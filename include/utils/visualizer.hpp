@@ -81,6 +81,11 @@ class Visualizer
       const auto& tracks = track_manager_.tracks();
       for (auto& id : active_ids)
       {
+        // Only tracks of the primary camera are drawn
+        if (tracks.at(id).cam_id_ != 0)
+        {
+          continue;
+        }
         const auto& color = colors_.at(id % colors_.size());
         for (size_t i = 0; i < tracks.at(id).size() - 1; ++i)
         {
@@ -17,6 +17,7 @@
 
 #include "msceqf/options/msceqf_options.hpp"
 #include "types/fptypes.hpp"
+#include "vision/features.hpp"
 
 namespace msceqf
 {
@@ -53,6 +54,15 @@ class PinholeCamera
    */
   virtual void undistortImage(const cv::Mat& image, cv::Mat& image_undistorted) = 0;
 
+  /**
+   * @brief Unproject given distorted points in OpenCV format (std::vector<cv::Point2f>) to bearings (unit vectors in
+   * the camera frame) according to the camera model
+   *
+   * @param uv_cv uv coordinates
+   * @param bearings Bearings of the given points
+   */
+  virtual void unproject(const std::vector<cv::Point2f>& uv_cv, FeaturesBearings& bearings) = 0;
+
   /**
    * @brief Normalize multiple features uv coordinates in Eigen format (std::vector<Eigen::Vector2f>)
    *
@@ -172,8 +182,21 @@ struct RadtanCamera final : public PinholeCamera
    * @param image_undistorted Undistorted image
    */
   void undistortImage(const cv::Mat& image, cv::Mat& image_undistorted) override;
+
+  /**
+   * @brief Unproject given distorted points in OpenCV format (std::vector<cv::Point2f>) to bearings. Bearings are the
+   * undistorted normalized coordinates lifted to the unit sphere
+   *
+   * @param uv_cv uv coordinates
+   * @param bearings Bearings of the given points
+   */
+  void unproject(const std::vector<cv::Point2f>& uv_cv, FeaturesBearings& bearings) override;
 };
 
+/**
+ * @brief This class represent a pinhole camera with equidistant (fisheye) distortion model
+ *
+ */
 struct EquidistantCamera final : public PinholeCamera
 {
   EquidistantCamera(const CameraOptions& opts, const Vector4& intrinsics);
@@ -193,6 +216,16 @@ struct EquidistantCamera final : public PinholeCamera
    * @param image_undistorted Undistorted image
    */
   void undistortImage(const cv::Mat& image, cv::Mat& image_undistorted) override;
+
+  /**
+   * @brief Unproject given distorted points in OpenCV format (std::vector<cv::Point2f>) to bearings. The incidence
+   * angle is recovered from the distorted radius, hence points observed at or beyond 90 degrees from the optical axis,
+   * which have no normalized coordinates, are unprojected as well
+   *
+   * @param uv_cv uv coordinates
+   * @param bearings Bearings of the given points
+   */
+  void unproject(const std::vector<cv::Point2f>& uv_cv, FeaturesBearings& bearings) override;
 };
 
 using PinholeCameraSharedPtr = std::shared_ptr<PinholeCamera>;
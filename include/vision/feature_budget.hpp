@@ -0,0 +1,144 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef FEATURE_BUDGET_HPP
+#define FEATURE_BUDGET_HPP
+
+#include <string>
+
+#include "msceqf/options/msceqf_options.hpp"
+#include "types/fptypes.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Latency of the tracker stages for a single frame, in milliseconds
+ *
+ */
+struct TrackerTimings
+{
+  /**
+   * @brief Get a string representation of the timings
+   *
+   * @return String
+   */
+  std::string toString() const;
+
+  fp preprocessing_ = 0;  //!< Color conversion and equalization
+  fp pyramids_ = 0;       //!< Optical flow pyramids construction
+  fp detection_ = 0;      //!< Feature detection
+  fp optical_flow_ = 0;   //!< KLT optical flow
+  fp ransac_ = 0;         //!< RANSAC outlier rejection
+  fp total_ = 0;          //!< Total frame processing time
+  bool tracked_ = false;  //!< Flag indicating whether features have been tracked (optical flow and RANSAC ran)
+};
+
+/**
+ * @brief Tracker parameters that are adapted at runtime by the feature budget controller
+ *
+ */
+struct FeatureBudget
+{
+  /**
+   * @brief Get a string representation of the budget
+   *
+   * @return String
+   */
+  std::string toString() const;
+
+  friend bool operator==(const FeatureBudget& lhs, const FeatureBudget& rhs)
+  {
+    return lhs.max_features_ == rhs.max_features_ && lhs.min_features_ == rhs.min_features_ &&
+           lhs.detector_pyramid_levels_ == rhs.detector_pyramid_levels_ &&
+           lhs.optical_flow_win_size_ == rhs.optical_flow_win_size_;
+  }
+
+  friend bool operator!=(const FeatureBudget& lhs, const FeatureBudget& rhs) { return !(lhs == rhs); }
+
+  uint max_features_ = 0;             //!< Maximum feature to track/detect
+  uint min_features_ = 0;             //!< Minimum feature to track/detect
+  uint detector_pyramid_levels_ = 0;  //!< Pyramids levels for feature detection (1-based)
+  uint optical_flow_win_size_ = 0;    //!< Window size for optical flow
+};
+
+/**
+ * @brief This class implements a controller that adapts the tracker workload to hold a target frame processing time.
+ * The controller filters the measured frame time with an exponential moving average. When the filtered frame time
+ * exceeds the target, the workload is reduced by lowering, in order, the maximum number of features, the number of
+ * detector pyramid levels and the optical flow window size. When the filtered frame time is below the target, the
+ * workload is restored in the opposite order. The configured tracker parameters are used as upper bounds.
+ *
+ */
+class FeatureBudgetController
+{
+ public:
+  /**
+   * @brief FeatureBudgetController constructor
+   *
+   * @param opts Tracker options
+   */
+  FeatureBudgetController(const TrackerOptions& opts);
+
+  /**
+   * @brief Feed the controller with the timings of the last processed frame, and adapt the budget if needed
+   *
+   * @param timings Tracker timings of the last processed frame
+   * @return true if the budget changed, false otherwise
+   */
+  bool update(const TrackerTimings& timings);
+
+  /**
+   * @brief Get the actual budget
+   *
+   * @return Feature budget
+   */
+  const FeatureBudget& budget() const;
+
+  /**
+   * @brief Get the filtered frame processing time
+   *
+   * @return Filtered frame processing time in milliseconds
+   */
+  const fp& frameTime() const;
+
+ private:
+  /**
+   * @brief Reduce the workload by a single step
+   *
+   * @return true if the workload has been reduced, false if all the parameters are at their lower bound
+   */
+  bool decrease();
+
+  /**
+   * @brief Increase the workload by a single step
+   *
+   * @return true if the workload has been increased, false if all the parameters are at their upper bound
+   */
+  bool increase();
+
+  FeatureBudgetOptions opts_;  //!< Feature budget options
+
+  FeatureBudget upper_;   //!< Upper bounds (configured tracker parameters)
+  FeatureBudget lower_;   //!< Lower bounds
+  FeatureBudget budget_;  //!< Actual budget
+
+  fp min_features_ratio_;  //!< Ratio between minimum and maximum number of features, kept while adapting
+  uint features_step_;     //!< Step used to adapt the maximum number of features
+
+  fp frame_time_;  //!< Filtered frame processing time in milliseconds
+  bool init_;      //!< Flag that indicates that the filtered frame time has been initialized
+
+  static constexpr uint win_step_ = 2;  //!< Step used to adapt the optical flow window size (keeps its parity)
+};
+
+}  // namespace msceqf
+
+#endif  // FEATURE_BUDGET_HPP
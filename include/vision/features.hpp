@@ -19,6 +19,7 @@
 namespace msceqf
 {
 using FeaturesCoordinates = std::vector<cv::Point2f>;  //!< The features coordinates
+using FeaturesBearings = std::vector<cv::Point3f>;     //!< The features bearings (unit vectors in the camera frame)
 
 /**
  * @brief (Cache friendly) Features struct. Define a set of features detected/tracked.
@@ -47,6 +48,7 @@ struct Features
     assert(distorted_uvs_.size() == uvs_.size());
     assert(distorted_uvs_.size() == normalized_uvs_.size());
     assert(distorted_uvs_.size() == ids_.size());
+    assert(bearings_.empty() || distorted_uvs_.size() == bearings_.size());
     return distorted_uvs_.size();
   }
 
@@ -66,6 +68,8 @@ struct Features
     size_t i = 0;
     size_t j = 0;
 
+    const bool bearings = !bearings_.empty();
+
     while (i < invalid.size())
     {
       if (!invalid[i])
@@ -74,6 +78,10 @@ struct Features
         uvs_[j] = uvs_[i];
         normalized_uvs_[j] = normalized_uvs_[i];
         ids_[j] = ids_[i];
+        if (bearings)
+        {
+          bearings_[j] = bearings_[i];
+        }
         ++j;
       }
       ++i;
@@ -83,12 +91,17 @@ struct Features
     uvs_.resize(j);
     normalized_uvs_.resize(j);
     ids_.resize(j);
+    if (bearings)
+    {
+      bearings_.resize(j);
+    }
   }
 
   FeaturesCoordinates distorted_uvs_;   //!< Distorted (u, v) coordinates of the features detected/tracked
   FeaturesCoordinates uvs_;             //!< Undistorted (u, v) coordinates of the features detected/tracked
   FeaturesCoordinates normalized_uvs_;  //!< Undistorted normalized (u, v) coordinates of features detected/tracked
   FeatureIds ids_;                      //!< Id of the features detected/tracked
+  FeaturesBearings bearings_;           //!< (Optional) Bearings of the features from the camera model unprojection
 };
 
 }  // namespace msceqf
@@ -12,7 +12,9 @@
 #ifndef TRACK_HPP
 #define TRACK_HPP
 
+#include <algorithm>
 #include <opencv2/opencv.hpp>
+#include <vector>
 
 #include "types/fptypes.hpp"
 #include "vision/features.hpp"
@@ -46,9 +48,82 @@ struct Track
   {
     assert(uvs_.size() == normalized_uvs_.size());
     assert(uvs_.size() == timestamps_.size());
+    assert(points_.empty() || uvs_.size() == points_.size());
+    assert(bearings_.empty() || uvs_.size() == bearings_.size());
     return uvs_.size();
   }
 
+  /**
+   * @brief Check if the track holds a 3D point for each of its coordinates
+   *
+   * @return true if points are available, false otherwise
+   */
+  inline bool hasPoints() const noexcept { return !points_.empty() && points_.size() == uvs_.size(); }
+
+  /**
+   * @brief Check if the track holds a bearing for each of its coordinates
+   *
+   * @return true if bearings are available, false otherwise
+   */
+  inline bool hasBearings() const noexcept { return !bearings_.empty() && bearings_.size() == uvs_.size(); }
+
+  /**
+   * @brief Get the measured bearing at the given index. This is the bearing from the camera model unprojection if
+   * available, the normalized coordinates lifted to the unit sphere otherwise
+   *
+   * @param idx Index of the coordinates
+   * @return Bearing (unit vector) in the camera frame
+   */
+  inline Vector3 bearing(const size_t& idx) const
+  {
+    if (hasBearings())
+    {
+      return Vector3(bearings_[idx].x, bearings_[idx].y, bearings_[idx].z).normalized();
+    }
+    return Vector3(normalized_uvs_[idx].x, normalized_uvs_[idx].y, 1.0).normalized();
+  }
+
+  /**
+   * @brief Preallocate the track for the given number of coordinates
+   *
+   * @param size Number of coordinates
+   * @param points Flag to indicate whether to preallocate also the 3D points
+   * @param bearings Flag to indicate whether to preallocate also the bearings
+   */
+  void reserve(const size_t& size, const bool& points = false, const bool& bearings = false)
+  {
+    uvs_.reserve(size);
+    normalized_uvs_.reserve(size);
+    timestamps_.reserve(size);
+    if (points)
+    {
+      points_.reserve(size);
+    }
+    if (bearings)
+    {
+      bearings_.reserve(size);
+    }
+  }
+
+  /**
+   * @brief Remove the oldest coordinates, normalized coordinates, timestamp, point and bearing (if any) of the track
+   *
+   */
+  void removeFront()
+  {
+    uvs_.erase(uvs_.begin());
+    normalized_uvs_.erase(normalized_uvs_.begin());
+    timestamps_.erase(timestamps_.begin());
+    if (!points_.empty())
+    {
+      points_.erase(points_.begin());
+    }
+    if (!bearings_.empty())
+    {
+      bearings_.erase(bearings_.begin());
+    }
+  }
+
   /**
    * @brief Remove invalid features coordinates, normalized feature coordinates and ids given a vector of boolean flags
    * indicating invalid features
@@ -64,6 +139,9 @@ struct Track
     size_t i = 0;
     size_t j = 0;
 
+    const bool points = hasPoints();
+    const bool bearings = hasBearings();
+
     while (i < uvs_.size())
     {
       if (!invalid[i])
@@ -71,6 +149,14 @@ struct Track
         uvs_[j] = uvs_[i];
         normalized_uvs_[j] = normalized_uvs_[i];
         timestamps_[j] = timestamps_[i];
+        if (points)
+        {
+          points_[j] = points_[i];
+        }
+        if (bearings)
+        {
+          bearings_[j] = bearings_[i];
+        }
         ++j;
       }
       ++i;
@@ -79,6 +165,14 @@ struct Track
     uvs_.resize(j);
     normalized_uvs_.resize(j);
     timestamps_.resize(j);
+    if (points)
+    {
+      points_.resize(j);
+    }
+    if (bearings)
+    {
+      bearings_.resize(j);
+    }
   }
 
   /**
@@ -96,21 +190,24 @@ struct Track
 
     size_t j = 0;
     size_t i = 0;
+    const bool points = hasPoints();
+    const bool bearings = hasBearings();
 
     while (i < uvs_.size())
     {
-      if (remove_equal && timestamps_[i] > timestamp)
-      {
-        uvs_[j] = uvs_[i];
-        normalized_uvs_[j] = normalized_uvs_[i];
-        timestamps_[j] = timestamps_[i];
-        ++j;
-      }
-      if (!remove_equal && timestamps_[i] >= timestamp)
+      if ((remove_equal && timestamps_[i] > timestamp) || (!remove_equal && timestamps_[i] >= timestamp))
       {
         uvs_[j] = uvs_[i];
         normalized_uvs_[j] = normalized_uvs_[i];
         timestamps_[j] = timestamps_[i];
+        if (points)
+        {
+          points_[j] = points_[i];
+        }
+        if (bearings)
+        {
+          bearings_[j] = bearings_[i];
+        }
         ++j;
       }
       ++i;
@@ -119,6 +216,44 @@ struct Track
     uvs_.resize(j);
     normalized_uvs_.resize(j);
     timestamps_.resize(j);
+    if (points)
+    {
+      points_.resize(j);
+    }
+    if (bearings)
+    {
+      bearings_.resize(j);
+    }
+  }
+
+  /**
+   * @brief Remove the coordinates and the timestamp at the given timestamp, if any
+   *
+   * @param timestamp Timestamp
+   */
+  void removeAt(const fp& timestamp)
+  {
+    assert(uvs_.size() == normalized_uvs_.size());
+    assert(uvs_.size() == timestamps_.size());
+
+    auto it = std::find(timestamps_.begin(), timestamps_.end(), timestamp);
+    if (it == timestamps_.end())
+    {
+      return;
+    }
+
+    const auto idx = std::distance(timestamps_.begin(), it);
+    uvs_.erase(uvs_.begin() + idx);
+    normalized_uvs_.erase(normalized_uvs_.begin() + idx);
+    timestamps_.erase(it);
+    if (!points_.empty())
+    {
+      points_.erase(points_.begin() + idx);
+    }
+    if (!bearings_.empty())
+    {
+      bearings_.erase(bearings_.begin() + idx);
+    }
   }
 
   /**
@@ -130,10 +265,120 @@ struct Track
   FeaturesCoordinates uvs_;             //!< (u, v) coordinates of the same feature at different time steps
   FeaturesCoordinates normalized_uvs_;  //!< Normalized (u, v) coordinates of the same feature at different time steps
   Times timestamps_;                    //!< Timestamps of the camera measurement containing the feature
+  std::vector<Vector3> points_;         //!< (Optional) 3D points of the feature in the camera frame at each time step
+  FeaturesBearings bearings_;           //!< (Optional) Bearings of the feature from the camera model at each time step
+  uint cam_id_ = 0;                     //!< Id of the camera observing the feature (0 for the primary camera)
 };
 
 using Tracks = std::unordered_map<uint, Track>;  //!< Tracks defined as a a vector of tracks mapped by ids
 
+/**
+ * @brief Running disparity statistics of a set of tracks. For each track length, the number of tracks, the sum of the
+ * displacements between the first and the last coordinates, and the sum of the time spanned by the tracks are kept.
+ * Statistics are maintained incrementally, by removing the contribution of a track before it is modified and adding it
+ * back afterwards, such that the disparity of the longest tracks is available without scanning all the tracks.
+ *
+ */
+struct DisparityStatistics
+{
+  /**
+   * @brief Add the contribution of the given track
+   *
+   * @param track Track
+   */
+  void add(const Track& track)
+  {
+    if (track.empty())
+    {
+      return;
+    }
+
+    const size_t length = track.size();
+    if (length >= counts_.size())
+    {
+      counts_.resize(length + 1, 0);
+      disparity_sums_.resize(length + 1, 0);
+      span_sums_.resize(length + 1, 0);
+    }
+
+    ++counts_[length];
+    disparity_sums_[length] += cv::norm(track.uvs_.back() - track.uvs_.front());
+    span_sums_[length] += track.timestamps_.back() - track.timestamps_.front();
+    longest_ = std::max(longest_, length);
+  }
+
+  /**
+   * @brief Remove the contribution of the given track. The track has to be unchanged since it was added
+   *
+   * @param track Track
+   */
+  void remove(const Track& track)
+  {
+    if (track.empty())
+    {
+      return;
+    }
+
+    const size_t length = track.size();
+    assert(length < counts_.size() && counts_[length] > 0);
+
+    // Sums are reset once a length class is empty, such that round-off errors do not accumulate
+    if (--counts_[length] == 0)
+    {
+      disparity_sums_[length] = 0;
+      span_sums_[length] = 0;
+    }
+    else
+    {
+      disparity_sums_[length] -= cv::norm(track.uvs_.back() - track.uvs_.front());
+      span_sums_[length] -= track.timestamps_.back() - track.timestamps_.front();
+    }
+
+    while (longest_ > 0 && counts_[longest_] == 0)
+    {
+      --longest_;
+    }
+  }
+
+  /**
+   * @brief Clear the statistics
+   *
+   */
+  void clear()
+  {
+    counts_.clear();
+    disparity_sums_.clear();
+    span_sums_.clear();
+    longest_ = 0;
+  }
+
+  /**
+   * @brief Get the length of the longest tracks
+   *
+   * @return Length of the longest tracks, 0 if there are no tracks
+   */
+  inline size_t longest() const noexcept { return longest_; }
+
+  /**
+   * @brief Get the average displacement between the first and the last coordinates of the longest tracks
+   *
+   * @return Average disparity of the longest tracks
+   */
+  inline fp longestDisparity() const { return longest_ > 0 ? disparity_sums_[longest_] / counts_[longest_] : 0; }
+
+  /**
+   * @brief Get the average time spanned by the longest tracks
+   *
+   * @return Average time spanned by the longest tracks
+   */
+  inline fp longestSpan() const { return longest_ > 0 ? span_sums_[longest_] / counts_[longest_] : 0; }
+
+  std::vector<size_t> counts_;      //!< Number of tracks per track length
+  std::vector<fp> disparity_sums_;  //!< Sum of the displacement between first and last coordinates per track length
+  std::vector<fp> span_sums_;       //!< Sum of the time spanned by the tracks per track length
+  size_t longest_ = 0;              //!< Length of the longest tracks
+};
+
 }  // namespace msceqf
 
 #endif  // TRACK_HPP
\ No newline at end of file
@@ -12,11 +12,15 @@
 #ifndef TRACK_MANAGER_HPP
 #define TRACK_MANAGER_HPP
 
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <unordered_set>
+#include <vector>
 
 #include "types/fptypes.hpp"
+#include "msceqf/stats/latency_stats.hpp"
 #include "vision/tracker.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace msceqf
 {
@@ -32,8 +36,15 @@ class TrackManager
    *
    * @param opts Tracker options
    * @param intrinsics Camera intrinsics as R4 vector (fx, fy, cx, cy)
+   * @param secondary_intrinsics Intrinsics of the secondary cameras
+   * @param executor Thread pool used to track the secondary cameras in parallel (sequential tracking if null)
+   * @param stats Latency statistics the tracker stages are recorded into (none if null)
    */
-  TrackManager(const TrackManagerOptions& opts, const Vector4& intrinsics);
+  TrackManager(const TrackManagerOptions& opts,
+               const Vector4& intrinsics,
+               const std::vector<In>& secondary_intrinsics = std::vector<In>(),
+               const std::shared_ptr<utils::threadPool>& executor = nullptr,
+               const std::shared_ptr<LatencyStats>& stats = nullptr);
 
   /**
    * @brief Process a single camera measurement. Forward camera measurement to tracker, and update tracks
@@ -43,7 +54,41 @@ class TrackManager
   void processCamera(Camera& cam);
 
   /**
-   * @brief Process a single features measurement. update tracks
+   * @brief Process synchronized camera measurements from the camera rig, the first measurement being the one of the
+   * primary camera. Secondary cameras are tracked in parallel on the executor (if any), and their tracks are labeled
+   * with the camera id.
+   *
+   * @param cams Camera measurements
+   */
+  void processCameras(std::vector<Camera>& cams);
+
+  /**
+   * @brief Get the number of cameras (primary and secondary)
+   *
+   * @return Number of cameras
+   */
+  inline size_t numCameras() const { return secondary_trackers_.size() + 1; }
+
+  /**
+   * @brief Get the id of the track of a given feature observed by a given camera. Feature ids are assigned
+   * independently by the tracker of each camera, hence they are interleaved across cameras to keep track ids unique
+   * (track id % numCameras() is the id of the camera).
+   *
+   * @param feature_id Feature id assigned by the tracker of the camera
+   * @param cam_id Id of the camera
+   * @return Track id
+   */
+  inline uint trackId(const uint& feature_id, const uint& cam_id) const
+  {
+    return feature_id * static_cast<uint>(numCameras()) + cam_id;
+  }
+
+  /**
+   * @brief Process a single features measurement (batch of features given as structure-of-arrays), and update tracks.
+   * Buckets for the whole batch and storage for new tracks are reserved upfront, such that the insertion of the
+   * features does not trigger rehashing or reallocations. If 3D points are provided for all the features, they are
+   * stored in the tracks along with the coordinates. Features are given for the primary camera, and their ids are
+   * mapped to track ids as the ones of the primary camera tracker.
    *
    * @param features Features measurement
    */
@@ -104,11 +149,49 @@ class TrackManager
    */
   void removeTracksTail(const fp& timestamp, const bool& remove_equal = true);
 
+  /**
+   * @brief Remove the tail of the tracks with the given ids. This method remove from each of these tracks all the
+   * coordinates as well as the timestamps that are older (or equal) to the given timestamp.
+   *
+   * @param ids Ids of the tracks
+   * @param timestamp Timestamp
+   * @param remove_equal Flag to indicate whether to include in the removal also the coordinates and timestamps at the
+   * given timestamp
+   */
+  void removeTracksTail(const std::unordered_set<uint>& ids, const fp& timestamp, const bool& remove_equal = true);
+
+  /**
+   * @brief Remove from each track the coordinates as well as the timestamp at the given timestamp. Tracks left empty
+   * are removed.
+   *
+   * @param timestamp Timestamp
+   */
+  void removeTracksAt(const fp& timestamp);
+
   /**
    * @brief Clear all the tracks
    *
    */
-  inline void clear() { tracks_.clear(); }
+  inline void clear()
+  {
+    tracks_.clear();
+    disparity_statistics_.clear();
+  }
+
+  /**
+   * @brief Get the running disparity statistics of the tracks. Statistics are updated as tracks are extended and
+   * trimmed.
+   *
+   * @return Disparity statistics
+   */
+  const DisparityStatistics& disparityStatistics() const;
+
+  /**
+   * @brief Get the features detected/tracked by the tracker of the primary camera in the last processed frame
+   *
+   * @return Current features of the primary camera
+   */
+  const Tracker::TimedFeatures& currentFeatures() const;
 
   /**
    * @brief Get the camera pointer
@@ -117,15 +200,44 @@ class TrackManager
    */
   const PinholeCameraUniquePtr& cam() const;
 
+  /**
+   * @brief Get the latency of the tracker stages measured on the last processed frame
+   *
+   * @return Tracker timings
+   */
+  const TrackerTimings& trackerTimings() const;
+
+  /**
+   * @brief Get the actual feature budget of the tracker
+   *
+   * @return Feature budget
+   */
+  const FeatureBudget& featureBudget() const;
+
  private:
   /**
-   * @brief Updeate tracks with current features from tracker
+   * @brief Updeate tracks with current features from tracker. Feature ids of the given tracker are mapped to unique
+   * track ids across cameras.
    *
+   * @param tracker Feature tracker
+   * @param cam_id Id of the camera the tracker is associated to
    */
-  void updateTracks();
+  void updateTracks(const Tracker& tracker, const uint& cam_id);
+
+  /**
+   * @brief Record the latency of the stages of the given tracker, measured on the last processed frame
+   *
+   * @param tracker Feature tracker
+   */
+  void recordTimings(const Tracker& tracker) const;
+
+  Tracker tracker_;                                           //!< Feature tracker (primary camera)
+  std::vector<std::unique_ptr<Tracker>> secondary_trackers_;  //!< Feature trackers (secondary cameras)
+  Tracks tracks_;                                             //!< Tracks
+  DisparityStatistics disparity_statistics_;                  //!< Running disparity statistics of the tracks
 
-  Tracker tracker_;  //!< Feature tracker
-  Tracks tracks_;    //!< Tracks
+  std::shared_ptr<utils::threadPool> executor_;  //!< Thread pool for the secondary cameras (shared, may be null)
+  std::shared_ptr<LatencyStats> stats_;          //!< Latency statistics (none if null)
 
   size_t max_track_length_;  //!< Maximum length of a single track
 };
@@ -17,6 +17,7 @@
 #include "sensors/sensor_data.hpp"
 #include "types/fptypes.hpp"
 #include "vision/camera.hpp"
+#include "vision/feature_budget.hpp"
 #include "vision/features.hpp"
 #include "vision/track.hpp"
 
@@ -45,6 +46,9 @@ class Tracker
    * @brief This method process the input camera measurement.
    * If first pre-process the camera image, and then it tracks features.
    *
+   * @note The input image is never written. If equalization is enabled, the equalized image is stored in a buffer
+   * owned by the tracker and the camera image is set to reference it, hence borrowed buffers can be safely processed.
+   *
    * @param cam Camera measurement
    */
   void processCamera(Camera& cam);
@@ -63,6 +67,20 @@ class Tracker
    */
   const PinholeCameraUniquePtr& cam() const;
 
+  /**
+   * @brief Get the latency of the tracker stages measured on the last processed frame
+   *
+   * @return Tracker timings
+   */
+  const TrackerTimings& timings() const;
+
+  /**
+   * @brief Get the actual feature budget (adapted at runtime if the adaptive feature budget is enabled)
+   *
+   * @return Feature budget
+   */
+  const FeatureBudget& budget() const;
+
  private:
   /**
    * @brief Detect/Tracks feature in the given camera measurement.
@@ -75,6 +93,12 @@ class Tracker
    */
   void track(Camera& cam);
 
+  /**
+   * @brief Apply the feature budget given by the budget controller to the tracker parameters
+   *
+   */
+  void applyBudget();
+
   /**
    * @brief Detect features based on the selected feature detector.
    * This method detects feature in a image through its pyramids. Each pyramid is split in a grid, and features are
@@ -132,11 +156,13 @@ class Tracker
 
   PinholeCameraUniquePtr cam_;       //!< Pointer to the pinhole camera object
   cv::Ptr<cv::Feature2D> detector_;  //!< The feature detector
+  cv::Ptr<cv::CLAHE> clahe_;         //!< The CLAHE equalizer
 
   std::map<uint, std::atomic<uint>> max_kpts_per_cell_;  //!< Maximum number of keypoints for each cell of the grid
   uint id_;                                              //!< Feature id counter
 
   cv::Mat feature_mask_;  //!< Maks for existing features
+  cv::Mat image_;         //!< Pre-processed image buffer (reused across frames)
 
   std::vector<cv::Mat> previous_pyramids_;  //!< Pyramids for Optical Flow and feature extraction from previous image
   TimedFeatures previous_features_;         //!< Features detected in previous image associated to their timestamp
@@ -144,7 +170,11 @@ class Tracker
   std::vector<cv::Mat> current_pyramids_;  //!< Pyramids for Optical Flow and feature extraction from current image
   TimedFeatures current_features_;         //!< Features detected in previous image associated to their timestamp
 
-  cv::Size win_;  //!< The Optical Flow window size
+  cv::Size win_;          //!< The Optical Flow window size
+  cv::Size pyramid_win_;  //!< The window size used to build the pyramids (largest Optical Flow window size)
+
+  FeatureBudgetController budget_controller_;  //!< The adaptive feature budget controller
+  TrackerTimings timings_;                     //!< Latency of the tracker stages for the last processed frame
 
   static constexpr std::array<uint, 4> ratio_ = {10, 6, 3, 1};  //!< Ratio of features among pyramid levels
 };
@@ -47,9 +47,9 @@ void StaticInitializer::insertImu(const Imu& imu)
   }
 }
 
-bool StaticInitializer::detectMotion(const Tracks& tracks)
+bool StaticInitializer::detectMotion(const DisparityStatistics& stats)
 {
-  return detectAccelerationSpike() && checker_.disparityCheck(tracks);
+  return detectAccelerationSpike() && checker_.disparityCheck(stats);
 }
 
 bool StaticInitializer::initializeOrigin()
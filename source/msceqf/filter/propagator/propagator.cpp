@@ -192,6 +192,41 @@ bool Propagator::propagate(MSCEqFState& X, const SystemState& xi0, fp& timestamp
   return true;
 }
 
+bool Propagator::imuVariance(const fp& t0, const fp& t1, fp& acc_var, fp& ang_var)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto first = std::lower_bound(imu_buffer_.begin(), imu_buffer_.end(), t0);
+  auto last = std::upper_bound(imu_buffer_.begin(), imu_buffer_.end(), t1);
+
+  // Welford's online algorithm
+  fp n = 0;
+  Vector3 acc_mean = Vector3::Zero();
+  Vector3 ang_mean = Vector3::Zero();
+  Vector3 acc_m2 = Vector3::Zero();
+  Vector3 ang_m2 = Vector3::Zero();
+  for (auto it = first; it != last; ++it)
+  {
+    ++n;
+    const Vector3 acc_diff = it->acc_ - acc_mean;
+    const Vector3 ang_diff = it->ang_ - ang_mean;
+    acc_mean += acc_diff / n;
+    ang_mean += ang_diff / n;
+    acc_m2 += acc_diff.cwiseProduct(it->acc_ - acc_mean);
+    ang_m2 += ang_diff.cwiseProduct(it->ang_ - ang_mean);
+  }
+
+  if (n < 2)
+  {
+    return false;
+  }
+
+  acc_var = acc_m2.sum() / (n - 1);
+  ang_var = ang_m2.sum() / (n - 1);
+
+  return true;
+}
+
 void Propagator::propagateMean(MSCEqFState& X, const SystemState& xi0, const Imu& u, const fp& dt)
 {
   // Compute the Lift lambda
@@ -208,6 +243,20 @@ void Propagator::propagateMean(MSCEqFState& X, const SystemState& xi0, const Imu
   {
     X.state_.at(MSCEqFStateElementName::L)->updateRight(dt * lambda.at(SystemStateElementName::K));
   }
+
+  for (uint cam_id = 1; cam_id <= X.opts().secondary_cameras_extrinsics_.size(); ++cam_id)
+  {
+    X.state_.at(MSCEqFState::MSCEqFCameraKey{MSCEqFStateElementName::E, cam_id})
+        ->updateRight(dt * lambda.at(SystemState::SystemCameraKey{SystemStateElementName::S, cam_id}));
+
+    if (X.opts().enable_camera_intrinsics_calibration_)
+    {
+      X.state_.at(MSCEqFState::MSCEqFCameraKey{MSCEqFStateElementName::L, cam_id})
+          ->updateRight(dt * lambda.at(SystemState::SystemCameraKey{SystemStateElementName::K, cam_id}));
+    }
+  }
+  // Persistent features are static in the world frame, and phi maps them through the origin only, hence their SOT3
+  // elements are constant and their lift is not integrated
   // for (const auto& id : feat_ids)
   // {
   //   X.state_.at(id)->updateRight(dt * lambda.at(id));
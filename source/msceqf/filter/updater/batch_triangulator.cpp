@@ -0,0 +1,247 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#include "msceqf/filter/updater/batch_triangulator.hpp"
+#include "msceqf/filter/updater/updater_helper.hpp"
+#include "utils/logger.hpp"
+
+namespace msceqf
+{
+BatchTriangulator::BatchTriangulator(const UpdaterOptions& opts)
+    : opts_(opts), clones_(), clones_inv_(), observations_(), offsets_(1, 0), A_fs_(), A_fs_init_()
+{
+}
+
+void BatchTriangulator::setClones(const MSCEqFState& X)
+{
+  const size_t num_cams = 1 + X.opts().secondary_cameras_extrinsics_.size();
+
+  clones_.assign(num_cams, std::map<fp, SE3>());
+  clones_inv_.assign(num_cams, std::map<fp, SE3>());
+
+  for (const auto& timestamp : X.clonesTimestamps())
+  {
+    for (uint cam_id = 0; cam_id < num_cams; ++cam_id)
+    {
+      const SE3 E = X.clone(timestamp, cam_id);
+      clones_[cam_id].emplace(timestamp, E);
+      clones_inv_[cam_id].emplace(timestamp, E.inv());
+    }
+  }
+}
+
+const SE3& BatchTriangulator::clone(const fp& timestamp, const uint& cam_id) const
+{
+  return clones_.at(cam_id).at(timestamp);
+}
+
+void BatchTriangulator::clear()
+{
+  for (auto& field : observations_)
+  {
+    field.clear();
+  }
+  offsets_.assign(1, 0);
+  A_fs_.clear();
+  A_fs_init_.clear();
+}
+
+size_t BatchTriangulator::addFeature(const Track& track, const SE3& A_E, const Vector3& A_f)
+{
+  const auto& clones_inv = clones_inv_.at(track.cam_id_);
+
+  for (size_t i = 0; i < track.size(); ++i)
+  {
+    // Pose of the anchor with respect to the observing clone
+    const SE3 Ci_A = clones_inv.at(track.timestamps_[i]) * A_E;
+    const Matrix3& R = Ci_A.R();
+    const Vector3& t = Ci_A.x();
+
+    const Matrix<2, 3> B = UpdaterHelper::tangentBasis(track.bearing(i));
+
+    for (int r = 0; r < 3; ++r)
+    {
+      observations_[B00 + r].emplace_back(B(0, r));
+      observations_[B10 + r].emplace_back(B(1, r));
+      for (int c = 0; c < 3; ++c)
+      {
+        observations_[R00 + 3 * r + c].emplace_back(R(r, c));
+      }
+      observations_[T0 + r].emplace_back(t(r));
+    }
+  }
+
+  offsets_.emplace_back(offsets_.back() + track.size());
+  A_fs_.emplace_back(A_f);
+  A_fs_init_.emplace_back(A_f);
+
+  return A_fs_.size() - 1;
+}
+
+void BatchTriangulator::refine()
+{
+  const size_t num_features = A_fs_.size();
+  const Eigen::Index num_obs = static_cast<Eigen::Index>(offsets_.back());
+
+  if (num_features == 0)
+  {
+    return;
+  }
+
+  auto field = [&](const Field& f) { return Map<const ArrayX>(observations_[f].data(), num_obs); };
+
+  const auto b00 = field(B00);
+  const auto b01 = field(B01);
+  const auto b02 = field(B02);
+  const auto b10 = field(B10);
+  const auto b11 = field(B11);
+  const auto b12 = field(B12);
+  const auto r00 = field(R00);
+  const auto r01 = field(R01);
+  const auto r02 = field(R02);
+  const auto r10 = field(R10);
+  const auto r11 = field(R11);
+  const auto r12 = field(R12);
+  const auto r20 = field(R20);
+  const auto r21 = field(R21);
+  const auto r22 = field(R22);
+  const auto t0 = field(T0);
+  const auto t1 = field(T1);
+  const auto t2 = field(T2);
+
+  // Anchored inverse depth parameters (alpha, beta, rho) of each feature, expanded for each observation
+  std::vector<Vector3> params(num_features);
+  ArrayX alpha(num_obs), beta(num_obs), rho(num_obs);
+  for (size_t f = 0; f < num_features; ++f)
+  {
+    params[f] << A_fs_[f](0) / A_fs_[f](2), A_fs_[f](1) / A_fs_[f](2), 1.0 / A_fs_[f](2);
+    const Eigen::Index n = offsets_[f + 1] - offsets_[f];
+    alpha.segment(offsets_[f], n).setConstant(params[f](0));
+    beta.segment(offsets_[f], n).setConstant(params[f](1));
+    rho.segment(offsets_[f], n).setConstant(params[f](2));
+  }
+
+  std::vector<bool> active(num_features, true);
+  std::vector<fp> initial_cost(num_features, 0);
+  std::vector<fp> cost(num_features, 0);
+  size_t num_active = num_features;
+
+  ArrayX hx(num_obs), hy(num_obs), hz(num_obs), h_inv(num_obs), px(num_obs), py(num_obs), ex(num_obs), ey(num_obs);
+  ArrayX mx0(num_obs), mx1(num_obs), mx2(num_obs), my0(num_obs), my1(num_obs), my2(num_obs);
+  ArrayX jx0(num_obs), jx1(num_obs), jx2(num_obs), jy0(num_obs), jy1(num_obs), jy2(num_obs);
+
+  for (uint iterations = 0; iterations < opts_.max_iterations_ && num_active > 0; ++iterations)
+  {
+    // Feature in clone frame scaled by the anchor inverse depth h = R * [alpha, beta, 1]^T + rho * t
+    hx = r00 * alpha + r01 * beta + r02 + rho * t0;
+    hy = r10 * alpha + r11 * beta + r12 + rho * t1;
+    hz = r20 * alpha + r21 * beta + r22 + rho * t2;
+    h_inv = (hx.square() + hy.square() + hz.square()).rsqrt();
+
+    // Predicted bearing pi(h) in the tangent space at the measured bearing b, p = B * pi(h). Since B * b = 0 the
+    // residual is e = B * (b - pi(h)) = -p
+    px = h_inv * (b00 * hx + b01 * hy + b02 * hz);
+    py = h_inv * (b10 * hx + b11 * hy + b12 * hz);
+    ex = -px;
+    ey = -py;
+
+    // Differential of p with respect to h, M = B * dpi(h) = (B - p * pi(h)^T) / |h|
+    mx0 = h_inv * (b00 - px * hx * h_inv);
+    mx1 = h_inv * (b01 - px * hy * h_inv);
+    mx2 = h_inv * (b02 - px * hz * h_inv);
+    my0 = h_inv * (b10 - py * hx * h_inv);
+    my1 = h_inv * (b11 - py * hy * h_inv);
+    my2 = h_inv * (b12 - py * hz * h_inv);
+
+    // Jacobian of p with respect to (alpha, beta, rho), M * [R.col(0) R.col(1) t]
+    jx0 = mx0 * r00 + mx1 * r10 + mx2 * r20;
+    jx1 = mx0 * r01 + mx1 * r11 + mx2 * r21;
+    jx2 = mx0 * t0 + mx1 * t1 + mx2 * t2;
+    jy0 = my0 * r00 + my1 * r10 + my2 * r20;
+    jy1 = my0 * r01 + my1 * r11 + my2 * r21;
+    jy2 = my0 * t0 + my1 * t1 + my2 * t2;
+
+    for (size_t f = 0; f < num_features; ++f)
+    {
+      if (!active[f])
+      {
+        continue;
+      }
+
+      const Eigen::Index o = offsets_[f];
+      const Eigen::Index n = offsets_[f + 1] - offsets_[f];
+
+      Matrix3 H;
+      H(0, 0) = (jx0.segment(o, n).square() + jy0.segment(o, n).square()).sum();
+      H(0, 1) = (jx0.segment(o, n) * jx1.segment(o, n) + jy0.segment(o, n) * jy1.segment(o, n)).sum();
+      H(0, 2) = (jx0.segment(o, n) * jx2.segment(o, n) + jy0.segment(o, n) * jy2.segment(o, n)).sum();
+      H(1, 1) = (jx1.segment(o, n).square() + jy1.segment(o, n).square()).sum();
+      H(1, 2) = (jx1.segment(o, n) * jx2.segment(o, n) + jy1.segment(o, n) * jy2.segment(o, n)).sum();
+      H(2, 2) = (jx2.segment(o, n).square() + jy2.segment(o, n).square()).sum();
+      H(1, 0) = H(0, 1);
+      H(2, 0) = H(0, 2);
+      H(2, 1) = H(1, 2);
+
+      Vector3 g;
+      g(0) = (jx0.segment(o, n) * ex.segment(o, n) + jy0.segment(o, n) * ey.segment(o, n)).sum();
+      g(1) = (jx1.segment(o, n) * ex.segment(o, n) + jy1.segment(o, n) * ey.segment(o, n)).sum();
+      g(2) = (jx2.segment(o, n) * ex.segment(o, n) + jy2.segment(o, n) * ey.segment(o, n)).sum();
+
+      cost[f] = (ex.segment(o, n).square() + ey.segment(o, n).square()).sum();
+      if (iterations == 0)
+      {
+        initial_cost[f] = cost[f];
+      }
+
+      const Vector3 delta = H.ldlt().solve(g);
+      params[f] += delta;
+
+      alpha.segment(o, n).setConstant(params[f](0));
+      beta.segment(o, n).setConstant(params[f](1));
+      rho.segment(o, n).setConstant(params[f](2));
+
+      if (delta.norm() < opts_.tollerance_)
+      {
+        utils::Logger::debug(
+            [&]() { return "Feature refinement converged in " + std::to_string(iterations) + " iterations"; });
+        active[f] = false;
+        --num_active;
+      }
+    }
+  }
+
+  for (size_t f = 0; f < num_features; ++f)
+  {
+    A_fs_[f] << params[f](0) / params[f](2), params[f](1) / params[f](2), 1.0 / params[f](2);
+
+    // Return given initial value if no improvement
+    if (active[f])
+    {
+      utils::Logger::debug("Feature refinement not converged, reached max iterations");
+      if (cost[f] > initial_cost[f])
+      {
+        A_fs_[f] = A_fs_init_[f];
+        continue;
+      }
+    }
+
+    // Return given initial value if invalid
+    if (A_fs_[f](2) < opts_.min_depth_ || A_fs_[f](2) > opts_.max_depth_ || std::isnan(A_fs_[f].norm()))
+    {
+      utils::Logger::debug("Feature refinement converged to invalid value");
+      A_fs_[f] = A_fs_init_[f];
+    }
+  }
+}
+
+const Vector3& BatchTriangulator::feature(const size_t& idx) const { return A_fs_.at(idx); }
+
+}  // namespace msceqf
@@ -16,19 +16,31 @@
 #include "msceqf/filter/updater/updater.hpp"
 #include "msceqf/symmetry/symmetry.hpp"
 #include "utils/logger.hpp"
+#include "utils/tools.hpp"
 
 namespace msceqf
 {
-Updater::Updater(const UpdaterOptions& opts, const SystemState& xi0)
-    : opts_(opts), xi0_(xi0), ph_(nullptr), chi2_table_(), update_ids_(), total_size_(0)
+Updater::Updater(const UpdaterOptions& opts, const SystemState& xi0, const std::shared_ptr<LatencyStats>& stats)
+    : opts_(opts)
+    , xi0_(xi0)
+    , ph_(nullptr)
+    , chi2_table_()
+    , triangulation_cache_()
+    , batch_triangulator_(opts)
+    , update_ids_()
+    , total_size_(0)
+    , ms_per_row_(0)
+    , stats_(stats)
 {
   switch (opts_.projection_method_)
   {
     case ProjectionMethod::UNIT_SPHERE:
-      ph_ = createProjectionHelper<ProjectionHelperS2>(opts_.msc_features_representation_);
+      ph_ = createProjectionHelper<ProjectionHelperS2>(opts_.msc_features_representation_,
+                                                       xi0_.opts().enable_camera_intrinsics_calibration_);
       break;
     case ProjectionMethod::UNIT_PLANE:
-      ph_ = createProjectionHelper<ProjectionHelperZ1>(opts_.msc_features_representation_);
+      ph_ = createProjectionHelper<ProjectionHelperZ1>(opts_.msc_features_representation_,
+                                                       xi0_.opts().enable_camera_intrinsics_calibration_);
       break;
     default:
       break;
@@ -49,8 +61,19 @@ void Updater::mscUpdate(MSCEqFState& X, const Tracks& tracks, std::unordered_set
     return;
   }
 
+  const auto start = std::chrono::steady_clock::now();
+
+  pruneTriangulationCache(tracks);
+
+  // Precompute the clones and their inverses once for all the tracks
+  batch_triangulator_.setClones(X);
+  batch_triangulator_.clear();
+
+  selectTracks(tracks, ids);
+
   // Precompute the total number of rows of the C matrix and the residual delta with a "safe" margin
   size_t rows = 0;
+  size_t max_track_rows = 0;
   size_t long_tracks = 0;
   for (const auto& id : ids)
   {
@@ -59,6 +82,7 @@ void Updater::mscUpdate(MSCEqFState& X, const Tracks& tracks, std::unordered_set
       continue;
     }
     rows += tracks.at(id).size();
+    max_track_rows = std::max(max_track_rows, tracks.at(id).size() * ph_->block_rows());
     ++long_tracks;
   }
   rows = rows * ph_->block_rows() - ph_->dim_loss() * (long_tracks - 1);
@@ -69,17 +93,20 @@ void Updater::mscUpdate(MSCEqFState& X, const Tracks& tracks, std::unordered_set
   // Fill the map of the indices of the columns of the C matrix for the variable involved in it, with insertion order.
   // This is needed for block operations. On doing so, we precompute the total number of columns of the C matrix.
   size_t cols = 0;
-  if (X.opts().enable_camera_intrinsics_calibration_)
-  {
-    cols_map_.insert(MSCEqFStateElementName::L, cols);
-    cols += X.dof(MSCEqFStateElementName::L);
-  }
+  insertCalibrationCols(X, cols);
   for (const auto& [timestamp, clone] : X.clones_)
   {
     cols_map_.insert(timestamp, cols);
     cols += clone->getDof();
   }
 
+  // With streaming accumulation the blocks of the tracks are folded into a square root information factor (cols x
+  // cols) whenever the C matrix is full, hence its size is bounded regardless of the number of tracks
+  if (opts_.streaming_update_)
+  {
+    rows = std::min(rows, cols + std::max(cols, max_track_rows));
+  }
+
   // Preallocate C matrix and residual delta
   MatrixX C = MatrixX::Zero(rows, cols);
   VectorX delta = VectorX::Zero(rows);
@@ -88,66 +115,116 @@ void Updater::mscUpdate(MSCEqFState& X, const Tracks& tracks, std::unordered_set
   update_ids_.clear();
   total_size_ = 0;
 
-  // For each track triangulate the feature, compute C and delta blocks, and performe chi2 rejection test
+  const MatrixX P = X.subCov(cols_map_.keys());
+
+  // For each track perform the initial triangulation of the feature in anchor frame (frame of first observation of the
+  // feature), and collect the succesfully triangulated features for the batch refinement. Features given with their
+  // 3D points are not triangulated, the point at the anchor being the feature in anchor frame
+  utils::stopwatch triangulation_watch(LatencyStats::name(LatencyStage::UPDATER_TRIANGULATION));
+  triangulation_watch.start();
+
+  std::vector<std::pair<uint, Vector3>> triangulated;
+  std::vector<std::pair<size_t, size_t>> refined;
   for (const auto& id : ids)
   {
     const auto& track = tracks.at(id);
 
     if (track.size() < opts_.min_track_lenght_)
     {
-      utils::Logger::debug("Track with id: " + std::to_string(id) + " do not contain enough views for triangulation");
+      utils::Logger::debug(
+          [&]() { return "Track with id: " + std::to_string(id) + " do not contain enough views for triangulation"; });
       continue;
     }
-    const auto& track_size = track.size();
 
-    // Triangulate feature in anchor frame (frame of first observation of the feature)
-    const auto& A_E = X.clone(track.timestamps_.front());
+    if (opts_.use_features_points_ && track.hasPoints())
+    {
+      const Vector3& A_f = track.points_.front();
+      if (A_f(2) < opts_.min_depth_ || A_f(2) > opts_.max_depth_ || std::isnan(A_f.norm()))
+      {
+        utils::Logger::debug(
+            [&]() { return "Given point for track id: " + std::to_string(id) + " is not within the depth bounds"; });
+        continue;
+      }
+      triangulated.emplace_back(id, A_f);
+      continue;
+    }
+
+    const SE3& A_E = batch_triangulator_.clone(track.timestamps_.front(), track.cam_id_);
     Vector3 A_f = Vector3::Zero();
 
-    if (!linearTriangulation(X, track, A_E, A_f))
+    if (!initialTriangulation(X, track, id, A_E, A_f))
     {
-      utils::Logger::debug("Linear triangulation failed for track id: " + std::to_string(id));
       continue;
     }
 
-    if (opts_.refine_traingulation_)
+    refined.emplace_back(triangulated.size(), batch_triangulator_.addFeature(track, A_E, A_f));
+    triangulated.emplace_back(id, A_f);
+  }
+
+  if (opts_.refine_traingulation_)
+  {
+    utils::Logger::debug(
+        [&]() { return "Nonlinear triangulation of " + std::to_string(batch_triangulator_.size()) + " features..."; });
+    batch_triangulator_.refine();
+    for (const auto& [idx, batch_idx] : refined)
     {
-      utils::Logger::debug(
-          "Linear triangulation succeeded. Nonlinear triangulation for track id: " + std::to_string(id) + "...");
-      nonlinearTriangulation(X, track, A_E, A_f);
+      triangulated[idx].second = batch_triangulator_.feature(batch_idx);
     }
+  }
 
-    // For each feature measurement in track compute the Jacobian and residual block
-    // (C matrix block, Cf matrix block and delta block)
-    MatrixX Cf = MatrixX::Zero(ph_->block_rows() * track_size, ph_->dim_loss());
-    for (size_t i = 0; i < track_size; ++i)
-    {
-      Vector2 uv(track.uvs_[i].x, track.uvs_[i].y);
-      Vector2 uvn(track.normalized_uvs_[i].x, track.normalized_uvs_[i].y);
-      FeatHelper feat(A_f, uv, uvn, track.timestamps_.front(), track.timestamps_[i]);
+  triangulation_watch.stop();
+  LatencyStats::record(stats_, LatencyStage::UPDATER_TRIANGULATION, triangulation_watch);
 
-      const auto& row_idx = total_size_ + (ph_->block_rows() * i);
-      C.middleRows(row_idx, ph_->block_rows()).setZero();
-      delta.middleRows(row_idx, ph_->block_rows()).setZero();
+  // For each triangulated feature compute C and delta blocks, and performe chi2 rejection test
+  utils::stopwatch jacobians_watch(LatencyStats::name(LatencyStage::UPDATER_JACOBIANS));
+  utils::stopwatch gating_watch(LatencyStats::name(LatencyStage::UPDATER_GATING));
+  utils::stopwatch compression_watch(LatencyStats::name(LatencyStage::UPDATER_COMPRESSION));
+  size_t rows_processed = 0;
+  for (const auto& [id, A_f] : triangulated)
+  {
+    const auto& track = tracks.at(id);
+    const auto& track_size = track.size();
+    rows_processed += ph_->block_rows() * track_size;
+
+    const SE3& A_E = batch_triangulator_.clone(track.timestamps_.front(), track.cam_id_);
+
+    // Features given with their 3D points are not triangulated, hence they have no warm start
+    if (opts_.refine_traingulation_ && !(opts_.use_features_points_ && track.hasPoints()))
+    {
+      setWarmStart(id, A_E, A_f);
+    }
 
-      ph_->residualJacobianBlock(X, xi0_, feat, C.middleRows(row_idx, ph_->block_rows()),
-                                 delta.middleRows(row_idx, ph_->block_rows()),
-                                 Cf.middleRows(ph_->block_rows() * i, ph_->block_rows()), cols_map_);
+    if (opts_.streaming_update_ && total_size_ + (ph_->block_rows() * track_size) > static_cast<size_t>(C.rows()))
+    {
+      compression_watch.start();
+      UpdaterHelper::updateQRAccumulation(C, delta, total_size_);
+      compression_watch.stop();
     }
 
+    // For all the feature measurements in track compute the Jacobian and residual blocks
+    // (C matrix block, Cf matrix block and delta block)
+    jacobians_watch.start();
+    MatrixX Cf = MatrixX::Zero(ph_->block_rows() * track_size, ph_->dim_loss());
+    ph_->residualJacobianBlock(X, xi0_, track, A_f, C, delta, Cf, total_size_, cols_map_);
+
     UpdaterHelper::nullspaceProjection(Cf, C.middleRows(total_size_, ph_->block_rows() * track_size),
                                        delta.middleRows(total_size_, ph_->block_rows() * track_size));
+    jacobians_watch.stop();
 
     const auto& C_block = C.middleRows(total_size_, (ph_->block_rows() * track_size) - ph_->dim_loss());
     const auto& delta_block = delta.middleRows(total_size_, (ph_->block_rows() * track_size) - ph_->dim_loss());
 
-    MatrixX S = C_block * X.subCov(cols_map_.keys()) * C_block.transpose();
+    gating_watch.start();
+    MatrixX S = C_block * P * C_block.transpose();
     S.diagonal() += VectorX::Ones(S.rows()) * opts_.pixel_std_ * opts_.pixel_std_;
     fp chi2 = delta_block.dot(S.llt().solve(delta_block));
+    const bool chi2_passed =
+        UpdaterHelper::chi2Test(chi2, (ph_->block_rows() * track_size) - ph_->dim_loss(), chi2_table_);
+    gating_watch.stop();
 
-    if (!UpdaterHelper::chi2Test(chi2, (ph_->block_rows() * track_size) - ph_->dim_loss(), chi2_table_))
+    if (!chi2_passed)
     {
-      utils::Logger::debug("Chi2 test failed for track id: " + std::to_string(id));
+      utils::Logger::debug([&]() { return "Chi2 test failed for track id: " + std::to_string(id); });
       continue;
     }
 
@@ -158,6 +235,9 @@ void Updater::mscUpdate(MSCEqFState& X, const Tracks& tracks, std::unordered_set
     update_ids_.emplace_back(id);
   }
 
+  LatencyStats::record(stats_, LatencyStage::UPDATER_JACOBIANS, jacobians_watch);
+  LatencyStats::record(stats_, LatencyStage::UPDATER_GATING, gating_watch);
+
   if (update_ids_.empty())
   {
     ids.clear();
@@ -187,170 +267,558 @@ void Updater::mscUpdate(MSCEqFState& X, const Tracks& tracks, std::unordered_set
   // Update compression
   if (C.rows() > C.cols())
   {
+    compression_watch.start();
     UpdaterHelper::updateQRCompression(C, delta);
+    compression_watch.stop();
   }
+  LatencyStats::record(stats_, LatencyStage::UPDATER_COMPRESSION, compression_watch);
 
   // Define measurement noise covariance
   MatrixX R = MatrixX::Identity(C.rows(), C.rows()) * opts_.pixel_std_ * opts_.pixel_std_;
 
   // MSCEqF Update
-  UpdateMSCEqF(X, C, delta, R);
+  {
+    auto timer = LatencyStats::time(stats_, LatencyStage::UPDATER_KALMAN_UPDATE);
+    UpdateMSCEqF(X, C, delta, R);
+  }
+
+  // Update the measured time per row of the update
+  const fp ms_per_row = utils::elapsedMilliseconds(start, std::chrono::steady_clock::now()) / rows_processed;
+  ms_per_row_ = ms_per_row_ > 0 ? 0.9 * ms_per_row_ + 0.1 * ms_per_row : ms_per_row;
 }
 
-bool Updater::linearTriangulation(const MSCEqFState& X, const Track& track, const SE3& A_E, Vector3& A_f) const
+void Updater::selectTracks(const Tracks& tracks, std::unordered_set<uint>& ids) const
 {
-  Matrix3 A = Matrix3::Zero();
-  Vector3 b = Vector3::Zero();
+  // Rows budget
+  size_t max_rows = opts_.max_update_rows_ > 0 ? opts_.max_update_rows_ : std::numeric_limits<size_t>::max();
+  if (opts_.update_time_budget_ > 0 && ms_per_row_ > 0)
+  {
+    max_rows = std::min(max_rows, static_cast<size_t>(opts_.update_time_budget_ / ms_per_row_));
+  }
 
-  Matrix3 Ai = Matrix3::Zero();
-  Vector3 A_bf = Vector3::Zero();
+  auto track_rows = [&](const Track& track) { return ph_->block_rows() * track.size() - ph_->dim_loss(); };
 
-  std::vector<Vector3> bearings;
+  size_t rows = 0;
+  for (const auto& id : ids)
+  {
+    if (tracks.at(id).size() >= opts_.min_track_lenght_)
+    {
+      rows += track_rows(tracks.at(id));
+    }
+  }
 
-  for (size_t i = 0; i < track.size(); ++i)
+  if (rows <= max_rows)
   {
-    SE3 E = A_E.inv() * X.clone(track.timestamps_[i]);
+    return;
+  }
 
-    A_bf(0) = track.normalized_uvs_[i].x;
-    A_bf(1) = track.normalized_uvs_[i].y;
-    A_bf(2) = 1.0;
+  // Parallax above the cap (in normalized coordinates) does not increase the score, to avoid outliers dominating
+  const fp& max_parallax = opts_.selection_max_parallax_;
+  const size_t grid_size = std::max(opts_.selection_grid_size_, 1u);
 
-    A_bf = E.R() * A_bf;
-    Ai = -SO3::wedge(A_bf) * SO3::wedge(A_bf);
+  struct Candidate
+  {
+    uint id_;
+    fp score_;
+    Vector2 uvn_;
+  };
+
+  std::vector<Candidate> candidates;
+  Vector2 uvn_min = Vector2::Constant(std::numeric_limits<fp>::max());
+  Vector2 uvn_max = Vector2::Constant(std::numeric_limits<fp>::lowest());
+  for (const auto& id : ids)
+  {
+    const auto& track = tracks.at(id);
+    if (track.size() < opts_.min_track_lenght_)
+    {
+      continue;
+    }
 
-    A += Ai;
-    b += Ai * E.x();
+    // Rotation-compensated parallax between the first and the last observation
+    const Matrix3 R = batch_triangulator_.clone(track.timestamps_.back(), track.cam_id_).R().transpose() *
+                      batch_triangulator_.clone(track.timestamps_.front(), track.cam_id_).R();
+    const Vector3 bf = R * Vector3(track.normalized_uvs_.front().x, track.normalized_uvs_.front().y, 1.0);
+    const Vector2 uvn(track.normalized_uvs_.back().x, track.normalized_uvs_.back().y);
+    const fp parallax = bf(2) > 0 ? (bf.segment<2>(0) / bf(2) - uvn).norm() : max_parallax;
 
-    bearings.push_back(A_bf.normalized());
+    candidates.push_back({id, track.size() * std::min(parallax, max_parallax), uvn});
+    uvn_min = uvn_min.cwiseMin(uvn);
+    uvn_max = uvn_max.cwiseMax(uvn);
   }
 
-  A_f = A.colPivHouseholderQr().solve(b);
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.score_ > b.score_; });
+
+  // Greedy selection, first the best track of each grid cell then the remaining tracks by score
+  const Vector2 cell = ((uvn_max - uvn_min) / grid_size).cwiseMax(Vector2::Constant(1e-6));
+  std::vector<bool> occupied(grid_size * grid_size, false);
+  std::vector<bool> selected(candidates.size(), false);
+  std::unordered_set<uint> selected_ids;
+  rows = 0;
 
-  fp min_cos = 1;
-  for (size_t i = 0; i < bearings.size(); ++i)
+  for (const bool& coverage : {true, false})
   {
-    for (size_t j = i + 1; j < bearings.size(); ++j)
+    for (size_t i = 0; i < candidates.size(); ++i)
     {
-      fp cos = bearings[i].dot(bearings[j]);
-      if (cos < min_cos)
+      if (selected[i])
+      {
+        continue;
+      }
+
+      const Vector2 cell_idx = (candidates[i].uvn_ - uvn_min).cwiseQuotient(cell).array().floor().matrix();
+      const size_t cell_id = std::min(static_cast<size_t>(cell_idx(1)), grid_size - 1) * grid_size +
+                             std::min(static_cast<size_t>(cell_idx(0)), grid_size - 1);
+      if (coverage && occupied[cell_id])
+      {
+        continue;
+      }
+
+      const size_t candidate_rows = track_rows(tracks.at(candidates[i].id_));
+      if (rows + candidate_rows > max_rows && !selected_ids.empty())
       {
-        min_cos = cos;
+        continue;
       }
+
+      occupied[cell_id] = true;
+      selected[i] = true;
+      selected_ids.insert(candidates[i].id_);
+      rows += candidate_rows;
     }
   }
-  fp max_angle = std::acos(min_cos) * 180 / M_PI;
 
-  // OpenCV triangulation
-  // cv::Mat uvn_first_cv = (cv::Mat_<fp>(2, 1) << track.normalized_uvs_.front().x, track.normalized_uvs_.front().y);
-  // cv::Mat uvn_last_cv = (cv::Mat_<fp>(2, 1) << track.normalized_uvs_.back().x, track.normalized_uvs_.back().y);
+  utils::Logger::debug([&]() {
+    return "Selected " + std::to_string(selected_ids.size()) + " tracks out of " + std::to_string(candidates.size()) +
+           " within a budget of " + std::to_string(max_rows) + " rows";
+  });
 
-  // Matrix<3, 4> P_first_eigen = Matrix<3, 4>::Zero();
-  // P_first_eigen.block(0, 0, 3, 3) = Matrix3::Identity();
+  ids = std::move(selected_ids);
+}
 
-  // Matrix<3, 4> P_last_eigen = (X.clone(track.timestamps_.back()).inv() * A_E).asMatrix().block(0, 0, 3,
-  // 4);
+void Updater::persistentFeaturesUpdate(MSCEqFState& X,
+                                       const Tracks& tracks,
+                                       const std::vector<uint>& ids,
+                                       const fp& timestamp)
+{
+  if (ids.empty())
+  {
+    return;
+  }
 
-  // cv::Mat P_first_cv, P_last_cv;
-  // cv::eigen2cv(P_first_eigen, P_first_cv);
-  // cv::eigen2cv(P_last_eigen, P_last_cv);
+  const size_t rows = ph_->block_rows() * ids.size();
 
-  // cv::Mat A_f_cv;
-  // cv::triangulatePoints(P_first_cv, P_last_cv, uvn_first_cv, uvn_last_cv, A_f_cv);
-  // Vector3 A_f_eigen = Vector3(A_f_cv.at<fp>(0, 0) / A_f_cv.at<fp>(3, 0), A_f_cv.at<fp>(1, 0) / A_f_cv.at<fp>(3, 0),
-  //                             A_f_cv.at<fp>(2, 0) / A_f_cv.at<fp>(3, 0));
+  // Fill the map of the indices of the columns of the C matrix. Only the clone at the given timestamp and the
+  // persistent features are involved in the update
+  cols_map_.clear();
 
-  if (A_f(2) < opts_.min_depth_ || A_f(2) > opts_.max_depth_ || std::isnan(A_f.norm()) || max_angle < opts_.min_angle_)
+  size_t cols = 0;
+  insertCalibrationCols(X, cols);
+  cols_map_.insert(timestamp, cols);
+  cols += X.dof(timestamp);
+  for (const auto& id : ids)
+  {
+    cols_map_.insert(MSCEqFState::MSCEqFStateKey(id), cols);
+    cols += X.dof(MSCEqFState::MSCEqFStateKey(id));
+  }
+
+  // Preallocate C matrix and residual delta
+  MatrixX C = MatrixX::Zero(rows, cols);
+  VectorX delta = VectorX::Zero(rows);
+  MatrixX Cp = MatrixX::Zero(ph_->block_rows(), 3);
+
+  const MatrixX P = X.subCov(cols_map_.keys());
+  const SE3 PS_inv = (xi0_.P() * xi0_.S()).inv();
+
+  update_ids_.clear();
+  total_size_ = 0;
+
+  for (const auto& id : ids)
+  {
+    const auto& track = tracks.at(id);
+    const MSCEqFState::MSCEqFStateKey key(id);
+
+    // Persistent feature in origin frame G0_f = Q^-1 * G0_f0
+    const SOT3& Q = X.Q(id);
+    const Vector3 G0_f0 = PS_inv * xi0_.f(id);
+    const Vector3 G0_f = Q.inv() * G0_f0;
+
+    Vector2 uv(track.uvs_.back().x, track.uvs_.back().y);
+    Vector2 uvn(track.normalized_uvs_.back().x, track.normalized_uvs_.back().y);
+    Vector3 bearing = track.bearing(track.size() - 1);
+    PointFeatHelper feat(G0_f, uv, uvn, bearing, timestamp, track.cam_id_);
+
+    C.middleRows(total_size_, ph_->block_rows()).setZero();
+    delta.middleRows(total_size_, ph_->block_rows()).setZero();
+
+    ph_->pointResidualJacobianBlock(X, xi0_, feat, C, delta, Cp, total_size_, 0, cols_map_);
+
+    C.block(total_size_, cols_map_.at(key), ph_->block_rows(), X.dof(key)).noalias() =
+        Cp * UpdaterHelper::persistentFeatureJacobian(Q, G0_f0);
+
+    const auto& C_block = C.middleRows(total_size_, ph_->block_rows());
+    const auto& delta_block = delta.middleRows(total_size_, ph_->block_rows());
+
+    MatrixX S = C_block * P * C_block.transpose();
+    S.diagonal() += VectorX::Ones(S.rows()) * opts_.pixel_std_ * opts_.pixel_std_;
+    fp chi2 = delta_block.dot(S.llt().solve(delta_block));
+
+    if (!UpdaterHelper::chi2Test(chi2, ph_->block_rows(), chi2_table_))
+    {
+      utils::Logger::debug([&]() { return "Chi2 test failed for persistent feature id: " + std::to_string(id); });
+      continue;
+    }
+
+    total_size_ += ph_->block_rows();
+    update_ids_.emplace_back(id);
+  }
+
+  if (update_ids_.empty())
+  {
+    utils::Logger::warn("No valid persistent features to update with. Skipping update step");
+    return;
+  }
+
+  // Resize residual delta and C matrix based on total_size_
+  delta.conservativeResize(total_size_);
+  C.conservativeResize(total_size_, C.cols());
+
+  // Update compression
+  if (C.rows() > C.cols())
+  {
+    UpdaterHelper::updateQRCompression(C, delta);
+  }
+
+  // Define measurement noise covariance
+  MatrixX R = MatrixX::Identity(C.rows(), C.rows()) * opts_.pixel_std_ * opts_.pixel_std_;
+
+  // MSCEqF Update
+  UpdateMSCEqF(X, C, delta, R);
+
+  utils::Logger::info(
+      [&]() { return "Successful update with " + std::to_string(update_ids_.size()) + " persistent features"; });
+}
+
+bool Updater::persistentFeatureInitialization(MSCEqFState& X, const Track& track, const uint& id, Vector3& G0_f)
+{
+  if (track.size() < opts_.min_track_lenght_ || X.hasPersistentFeature(id))
   {
     return false;
   }
 
+  const auto& track_size = track.size();
+
+  // Triangulate feature in origin frame
+  if (!triangulate(X, track, id, G0_f))
+  {
+    return false;
+  }
+
+  // Fill the map of the indices of the columns of the C matrix
+  cols_map_.clear();
+
+  size_t cols = 0;
+  insertCalibrationCols(X, cols);
+  for (const auto& [timestamp, clone] : X.clones_)
+  {
+    cols_map_.insert(timestamp, cols);
+    cols += clone->getDof();
+  }
+
+  const size_t rows = ph_->block_rows() * track_size;
+
+  MatrixX C = MatrixX::Zero(rows, cols);
+  VectorX delta = VectorX::Zero(rows);
+  MatrixX Cp = MatrixX::Zero(rows, 3);
+
+  for (size_t i = 0; i < track_size; ++i)
+  {
+    Vector2 uv(track.uvs_[i].x, track.uvs_[i].y);
+    Vector2 uvn(track.normalized_uvs_[i].x, track.normalized_uvs_[i].y);
+    Vector3 bearing = track.bearing(i);
+    PointFeatHelper feat(G0_f, uv, uvn, bearing, track.timestamps_[i], track.cam_id_);
+
+    const auto& row_idx = ph_->block_rows() * i;
+    ph_->pointResidualJacobianBlock(X, xi0_, feat, C, delta, Cp, row_idx, row_idx, cols_map_);
+  }
+
+  // Split the measurements with QR decomposition of the feature Jacobian Cp = [Q1 Q2] [R1; 0]
+  Eigen::HouseholderQR<MatrixX> qr(Cp);
+  const MatrixX Qr = qr.householderQ();
+  const Matrix3 R1 = qr.matrixQR().topLeftCorner<3, 3>().triangularView<Eigen::Upper>();
+  const MatrixX H = Qr.transpose() * C;
+  const VectorX r = Qr.transpose() * delta;
+
+  // Chi2 test on the part of the measurements that does not involve the feature
+  const MatrixX P = X.subCov(cols_map_.keys());
+  const auto H2 = H.bottomRows(rows - 3);
+  const auto r2 = r.bottomRows(rows - 3);
+  MatrixX S = H2 * P * H2.transpose();
+  S.diagonal() += VectorX::Ones(S.rows()) * opts_.pixel_std_ * opts_.pixel_std_;
+  fp chi2 = r2.dot(S.llt().solve(r2));
+
+  if (!UpdaterHelper::chi2Test(chi2, rows - 3, chi2_table_))
+  {
+    utils::Logger::debug(
+        [&]() { return "Chi2 test failed for persistent feature initialization of track id: " + std::to_string(id); });
+    return false;
+  }
+
+  // Feature covariance and cross covariance with the state from r1 = H1 * x + R1 * f + n1
+  const auto H1 = H.topRows(3);
+  const Vector3 r1 = r.topRows(3);
+  const Matrix3 R1_inv = R1.inverse();
+  Matrix3 P_ff = H1 * P * H1.transpose();
+  P_ff.diagonal() += Vector3::Ones() * opts_.pixel_std_ * opts_.pixel_std_;
+  P_ff = R1_inv * P_ff * R1_inv.transpose();
+  const MatrixX P_fx = -R1_inv * H1 * X.subCovCols(cols_map_.keys()).transpose();
+
+  // Map the feature perturbation to the algebra of SOT3 via the right pseudo inverse of M = [wedge(G0_f) -G0_f].
+  // The gauge direction (rotation about the bearing of the feature) is not observable and is given a small variance
+  Matrix<3, 4> M = Matrix<3, 4>::Zero();
+  M.block<3, 3>(0, 0) = SO3::wedge(G0_f);
+  M.block<3, 1>(0, 3) = -G0_f;
+  const Matrix<4, 3> M_pinv = M.transpose() / G0_f.squaredNorm();
+  const Vector4 n = (Vector4() << G0_f.normalized(), 0.0).finished();
+
+  Matrix4 P_qq = M_pinv * P_ff * M_pinv.transpose() + 1.0e-2 * n * n.transpose();
+  const MatrixX P_qx = M_pinv * P_fx;
+
+  const MSCEqFState::MSCEqFStateKey key(id);
+  X.initializeStateElement(key, P_qq);
+
+  const uint& idx = X.index(key);
+  X.cov_.block(idx, 0, X.dof(key), P_qx.cols()) = P_qx;
+  X.cov_.block(0, idx, P_qx.cols(), X.dof(key)) = P_qx.transpose();
+
+  X.state_.at(key)->updateLeft(M_pinv * R1_inv * r1);
+
+  utils::Logger::debug([&]() { return "Initialized persistent feature with id: " + std::to_string(id); });
+
   return true;
 }
 
-void Updater::nonlinearTriangulation(const MSCEqFState& X, const Track& track, const SE3& A_E, Vector3& A_f) const
+void Updater::addObservations(const MSCEqFState& X, const Tracks& tracks, const fp& timestamp)
 {
-  Vector3 A_f_init = A_f;
-  Vector3 A_f_invdepth(A_f(0) / A_f(2), A_f(1) / A_f(2), 1 / A_f(2));
+  if (!opts_.refine_traingulation_)
+  {
+    return;
+  }
 
-  MatrixX J = MatrixX::Zero(2 * track.size(), 3);
-  VectorX res = VectorX::Zero(2 * track.size());
+  for (const auto& [id, track] : tracks)
+  {
+    // Only tracks observed at the given timestamp, and that need to be triangulated, are accumulated
+    if (track.timestamps_.back() != timestamp || (opts_.use_features_points_ && track.hasPoints()))
+    {
+      continue;
+    }
+    accumulateObservations(X, track, triangulation_cache_[id]);
+  }
+}
 
-  fp initial_residual_norm;
-  fp actual_res_norm;
+bool Updater::triangulate(const MSCEqFState& X, const Track& track, const uint& id, Vector3& G0_f)
+{
+  batch_triangulator_.setClones(X);
+  const SE3& A_E = batch_triangulator_.clone(track.timestamps_.front(), track.cam_id_);
+  Vector3 A_f = Vector3::Zero();
 
-  bool converged = false;
+  if (!initialTriangulation(X, track, id, A_E, A_f))
+  {
+    return false;
+  }
 
-  for (uint iterations = 0; iterations < opts_.max_iterations_; ++iterations)
+  if (opts_.refine_traingulation_)
   {
-    nonlinearTriangulationResidualJacobian(X, track, A_E, A_f, res, J);
-    Vector3 delta = J.colPivHouseholderQr().solve(res);
+    utils::Logger::debug([&]() {
+      return "Linear triangulation succeeded. Nonlinear triangulation for track id: " + std::to_string(id) + "...";
+    });
 
-    actual_res_norm = res.norm();
+    batch_triangulator_.clear();
+    const size_t batch_idx = batch_triangulator_.addFeature(track, A_E, A_f);
+    batch_triangulator_.refine();
+    A_f = batch_triangulator_.feature(batch_idx);
+
+    setWarmStart(id, A_E, A_f);
+  }
 
-    if (iterations == 0)
+  G0_f = A_E * A_f;
+
+  return true;
+}
+
+fp Updater::parallax(const MSCEqFState& X, const Tracks& tracks, const fp& timestamp_a, const fp& timestamp_b) const
+{
+  fp parallax_sum = 0;
+  size_t count = 0;
+
+  for (const auto& [id, track] : tracks)
+  {
+    const auto it_a = std::find(track.timestamps_.begin(), track.timestamps_.end(), timestamp_a);
+    const auto it_b = std::find(track.timestamps_.begin(), track.timestamps_.end(), timestamp_b);
+    if (it_a == track.timestamps_.end() || it_b == track.timestamps_.end())
     {
-      initial_residual_norm = actual_res_norm;
+      continue;
     }
 
-    A_f_invdepth += delta;
-
-    A_f(0) = A_f_invdepth(0) / A_f_invdepth(2);
-    A_f(1) = A_f_invdepth(1) / A_f_invdepth(2);
-    A_f(2) = 1.0 / A_f_invdepth(2);
+    const auto& uvn_a = track.normalized_uvs_[std::distance(track.timestamps_.begin(), it_a)];
+    const auto& uvn_b = track.normalized_uvs_[std::distance(track.timestamps_.begin(), it_b)];
 
-    if (delta.norm() < opts_.tollerance_)
+    // Rotate the bearing observed at a in the frame of b, compensating the rotation between the two clones
+    const Matrix3 R = X.clone(timestamp_b, track.cam_id_).R().transpose() * X.clone(timestamp_a, track.cam_id_).R();
+    const Vector3 bf = R * Vector3(uvn_a.x, uvn_a.y, 1.0);
+    if (bf(2) <= 0)
     {
-      utils::Logger::debug("Feature refinement converged in " + std::to_string(iterations) + " iterations");
-      converged = true;
-      break;
+      continue;
     }
+
+    const fp fx = track.cam_id_ == 0 ? X.opts_.initial_camera_intrinsics_.k()(0) :
+                                        X.opts_.secondary_cameras_intrinsics_.at(track.cam_id_ - 1).k()(0);
+
+    parallax_sum += fx * (bf.segment<2>(0) / bf(2) - Vector2(uvn_b.x, uvn_b.y)).norm();
+    ++count;
   }
 
-  // Return given initial value if no improvement
-  if (!converged)
+  return count > 0 ? parallax_sum / count : -1;
+}
+
+bool Updater::initialTriangulation(
+    const MSCEqFState& X, const Track& track, const uint& id, const SE3& A_E, Vector3& A_f)
+{
+  auto& entry = triangulation_cache_[id];
+
+  // Without refinement the linear triangulation is the final estimate, hence it is relinearized at the actual clones
+  if (!opts_.refine_traingulation_)
   {
-    utils::Logger::debug("Feature refinement not converged, reached max iterations");
-    if (actual_res_norm > initial_residual_norm)
+    entry.reset();
+  }
+  accumulateObservations(X, track, entry);
+
+  if (!linearTriangulation(entry, A_f))
+  {
+    utils::Logger::debug([&]() { return "Linear triangulation failed for track id: " + std::to_string(id); });
+    return false;
+  }
+
+  // Warm start from the last refined feature if it is still within the depth bounds in the anchor frame
+  if (opts_.refine_traingulation_ && entry.has_warm_start_)
+  {
+    Vector3 A_f_warm = A_E.inv() * entry.G0_f_;
+    if (A_f_warm(2) > opts_.min_depth_ && A_f_warm(2) < opts_.max_depth_)
     {
-      A_f = A_f_init;
-      return;
+      A_f = A_f_warm;
     }
   }
 
-  // Return given initial value if invalid
-  if (A_f(2) < opts_.min_depth_ || A_f(2) > opts_.max_depth_ || std::isnan(A_f.norm()))
+  return true;
+}
+
+void Updater::setWarmStart(const uint& id, const SE3& A_E, const Vector3& A_f)
+{
+  auto& entry = triangulation_cache_.at(id);
+  entry.G0_f_ = A_E * A_f;
+  entry.has_warm_start_ = true;
+}
+
+void Updater::pruneTriangulationCache(const Tracks& tracks)
+{
+  for (auto it = triangulation_cache_.begin(); it != triangulation_cache_.end();)
   {
-    utils::Logger::debug("Feature refinement converged to invalid value");
-    A_f = A_f_init;
-    return;
+    if (tracks.count(it->first) == 0)
+    {
+      it = triangulation_cache_.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
   }
 }
 
-void Updater::nonlinearTriangulationResidualJacobian(
-    const MSCEqFState& X, const Track& track, const SE3& A_E, const Vector3& A_f, VectorX& res, MatrixX& J) const
+void Updater::accumulateObservations(const MSCEqFState& X, const Track& track, TriangulationCacheEntry& entry) const
 {
-  J.setZero();
-  res.setZero();
+  if (!entry.isValid(track))
+  {
+    entry.reset();
+  }
 
-  Matrix3 J_rep = Matrix3::Identity();
-  J_rep.block<3, 1>(0, 2) = -A_f;
-  J_rep = A_f(2) * J_rep;
+  const SE3 A_E_inv = X.clone(track.timestamps_.front(), track.cam_id_).inv();
 
-  Vector3 Gf0 = A_E * A_f;
+  Matrix3 Ai = Matrix3::Zero();
+  Vector3 A_bf = Vector3::Zero();
 
-  for (size_t i = 0; i < track.size(); ++i)
+  // Accumulate only the observations that are not part of the normal equations yet
+  for (size_t i = entry.num_observations_; i < track.size(); ++i)
   {
-    const auto& clone_E = X.clone(track.timestamps_[i]);
+    SE3 E = A_E_inv * X.clone(track.timestamps_[i], track.cam_id_);
 
-    Vector3 Ci_f = clone_E.inv() * Gf0;
-    Vector3 Ci_f_invdepth(Ci_f(0) / Ci_f(2), Ci_f(1) / Ci_f(2), 1 / Ci_f(2));
+    // Bearing of the observation in the anchor frame, Ai = I - A_bf * A_bf^T projects on its orthogonal complement
+    A_bf = E.R() * track.bearing(i);
+    Ai = -SO3::wedge(A_bf) * SO3::wedge(A_bf);
 
-    Vector2 uvn(track.normalized_uvs_[i].x, track.normalized_uvs_[i].y);
-    res.block(2 * i, 0, 2, 1) = uvn - Ci_f_invdepth.block(0, 0, 2, 1);
+    entry.A_ += Ai;
+    entry.b_ += Ai * E.x();
 
-    J.block(2 * i, 0, 2, 2) = Matrix2::Identity();
-    J.block(2 * i, 2, 2, 1) = -Ci_f_invdepth.block<2, 1>(0, 0);
-    J.block(2 * i, 0, 2, 3) = Ci_f_invdepth(2) * J.block(2 * i, 0, 2, 3) * clone_E.R().transpose() * A_E.R() * J_rep;
+    for (const auto& bearing : entry.bearings_)
+    {
+      entry.min_cos_ = std::min(entry.min_cos_, bearing.dot(A_bf));
+    }
+    entry.bearings_.push_back(A_bf);
+  }
+
+  entry.num_observations_ = track.size();
+  entry.anchor_timestamp_ = track.timestamps_.front();
+  entry.last_timestamp_ = track.timestamps_.back();
+}
+
+bool Updater::linearTriangulation(const TriangulationCacheEntry& entry, Vector3& A_f) const
+{
+  A_f = entry.A_.colPivHouseholderQr().solve(entry.b_);
+
+  fp max_angle = std::acos(entry.min_cos_) * 180 / M_PI;
+
+  // OpenCV triangulation
+  // cv::Mat uvn_first_cv = (cv::Mat_<fp>(2, 1) << track.normalized_uvs_.front().x, track.normalized_uvs_.front().y);
+  // cv::Mat uvn_last_cv = (cv::Mat_<fp>(2, 1) << track.normalized_uvs_.back().x, track.normalized_uvs_.back().y);
+
+  // Matrix<3, 4> P_first_eigen = Matrix<3, 4>::Zero();
+  // P_first_eigen.block(0, 0, 3, 3) = Matrix3::Identity();
+
+  // Matrix<3, 4> P_last_eigen = (X.clone(track.timestamps_.back()).inv() * A_E).asMatrix().block(0, 0, 3,
+  // 4);
+
+  // cv::Mat P_first_cv, P_last_cv;
+  // cv::eigen2cv(P_first_eigen, P_first_cv);
+  // cv::eigen2cv(P_last_eigen, P_last_cv);
+
+  // cv::Mat A_f_cv;
+  // cv::triangulatePoints(P_first_cv, P_last_cv, uvn_first_cv, uvn_last_cv, A_f_cv);
+  // Vector3 A_f_eigen = Vector3(A_f_cv.at<fp>(0, 0) / A_f_cv.at<fp>(3, 0), A_f_cv.at<fp>(1, 0) / A_f_cv.at<fp>(3, 0),
+  //                             A_f_cv.at<fp>(2, 0) / A_f_cv.at<fp>(3, 0));
+
+  if (A_f(2) < opts_.min_depth_ || A_f(2) > opts_.max_depth_ || std::isnan(A_f.norm()) || max_angle < opts_.min_angle_)
+  {
+    return false;
+  }
+
+  return true;
+}
+
+void Updater::insertCalibrationCols(const MSCEqFState& X, size_t& cols)
+{
+  if (X.opts().enable_camera_intrinsics_calibration_)
+  {
+    cols_map_.insert(MSCEqFStateElementName::L, cols);
+    cols += X.dof(MSCEqFStateElementName::L);
+  }
+  for (uint cam_id = 1; cam_id <= X.opts().secondary_cameras_extrinsics_.size(); ++cam_id)
+  {
+    const MSCEqFState::MSCEqFCameraKey E_key{MSCEqFStateElementName::E, cam_id};
+    cols_map_.insert(MSCEqFState::MSCEqFStateKey(E_key), cols);
+    cols += X.dof(MSCEqFState::MSCEqFStateKey(E_key));
+    if (X.opts().enable_camera_intrinsics_calibration_)
+    {
+      const MSCEqFState::MSCEqFCameraKey L_key{MSCEqFStateElementName::L, cam_id};
+      cols_map_.insert(MSCEqFState::MSCEqFStateKey(L_key), cols);
+      cols += X.dof(MSCEqFState::MSCEqFStateKey(L_key));
+    }
   }
 }
 
@@ -366,8 +834,9 @@ void Updater::UpdateMSCEqF(MSCEqFState& X, const MatrixX& C, const VectorX& delt
   MatrixX K = G * invS.selfadjointView<Eigen::Upper>();
   VectorX inn = K * delta;
 
+  // Clones and persistent features are interleaved, hence the newest clone is not necessarily the last element
   assert((inn.segment(X.index(MSCEqFStateElementName::E), X.dof(MSCEqFStateElementName::E)) -
-          inn.segment(inn.rows() - X.dof(MSCEqFStateElementName::E), X.dof(MSCEqFStateElementName::E)))
+          inn.segment(X.clones_.crbegin()->second->getIndex(), X.dof(MSCEqFStateElementName::E)))
              .norm() < 1e-12);
 
   // Update state
@@ -386,6 +855,14 @@ void Updater::UpdateMSCEqF(MSCEqFState& X, const MatrixX& C, const VectorX& delt
   {
     clone->updateLeft(inn.segment(clone->getIndex(), clone->getDof()));
   }
+  for (auto& [key, element] : X.state_)
+  {
+    // Persistent features and calibration of the secondary cameras
+    if (!std::holds_alternative<MSCEqFStateElementName>(key))
+    {
+      element->updateLeft(inn.segment(element->getIndex(), element->getDof()));
+    }
+  }
 
   X.cov_.triangularView<Eigen::Upper>() -= K * G.transpose();
   X.cov_ = X.cov_.selfadjointView<Eigen::Upper>();
@@ -13,119 +13,303 @@
 
 namespace msceqf
 {
-ProjectionHelper::ProjectionHelper(const FeatureRepresentation& feature_representation)
-    : feature_representation_(feature_representation)
+ProjectionHelper::ProjectionHelper(const size_t& block_rows, const size_t& dim_loss)
+    : block_rows_(block_rows), dim_loss_(dim_loss)
 {
-  switch (feature_representation_)
+}
+
+CameraIntrinsicsHelper ProjectionHelper::cameraIntrinsics(const MSCEqFState& X,
+                                                          const SystemState& xi0,
+                                                          const uint& cam_id,
+                                                          const ColsMap& cols_map)
+{
+  CameraIntrinsicsHelper intrinsics;
+  intrinsics.K_ = Matrix3::Identity();
+  intrinsics.L_ = Matrix3::Identity();
+  intrinsics.K_inv_ = Matrix3::Identity();
+  intrinsics.L_inv_ = Matrix3::Identity();
+  intrinsics.KL_ = Matrix2::Identity();
+  intrinsics.f_ = 1.0;
+  intrinsics.calibrated_ = false;
+  intrinsics.col_ = 0;
+
+  if (!X.opts().enable_camera_intrinsics_calibration_)
   {
-    case FeatureRepresentation::ANCHORED_EUCLIDEAN:
-      dim_loss_ = 3;
-      break;
-    case FeatureRepresentation::ANCHORED_INVERSE_DEPTH:
-      dim_loss_ = 3;
-      break;
-    case FeatureRepresentation::ANCHORED_POLAR:
-      dim_loss_ = 4;
-      break;
+    return intrinsics;
   }
-}
 
-Vector3 ProjectionHelperS2::pi(const Vector3& f) { return f / f.norm(); }
+  intrinsics.K_ = xi0.K(cam_id).asMatrix();
+  intrinsics.L_ = X.L(cam_id).asMatrix();
+  intrinsics.L_inv_ = intrinsics.L_.inverse();
+  intrinsics.calibrated_ = true;
+  intrinsics.col_ = cols_map.at(MSCEqFState::cameraKey(MSCEqFStateElementName::L, cam_id));
 
-Vector3 ProjectionHelperZ1::pi(const Vector3& f) { return (Vector3() << f(0) / f(2), f(1) / f(2), 1.0).finished(); }
+  const Matrix3 KL = intrinsics.K_ * intrinsics.L_;
+  intrinsics.K_inv_ = intrinsics.K_.inverse();
+  intrinsics.KL_ = KL.block<2, 2>(0, 0);
+  intrinsics.f_ = std::max(KL(0, 0), KL(1, 1));
 
-MatrixX ProjectionHelperS2::dpi(const Vector3& f)
-{
-  return (Matrix3::Identity() - ((f * f.transpose()) / (f.transpose() * f))) / f.norm();
+  return intrinsics;
 }
 
-MatrixX ProjectionHelperZ1::dpi(const Vector3& f)
+template <typename Helper>
+void ProjectionHelper::computeResidualJacobianBlock(const MSCEqFState& X,
+                                                    const SystemState& xi0,
+                                                    const Track& track,
+                                                    const Vector3& A_f,
+                                                    MatrixX& C,
+                                                    VectorX& delta,
+                                                    MatrixX& Cf,
+                                                    const size_t& row_idx,
+                                                    const ColsMap& cols_map)
 {
-  return (Matrix<2, 3>() << 1.0 / f(2), 0.0, -f(0) / (f(2) * f(2)), 0.0, 1.0 / f(2), -f(1) / (f(2) * f(2))).finished();
-}
+  constexpr int rows = Helper::rows_;
+  constexpr int cf_cols = Helper::cf_cols_;
 
-void ProjectionHelperS2::residualJacobianBlock([[maybe_unused]] const MSCEqFState& X,
-                                               [[maybe_unused]] const SystemState& xi0,
-                                               [[maybe_unused]] const FeatHelper& feat,
-                                               [[maybe_unused]] MatrixXBlockRowRef C_block_row,
-                                               [[maybe_unused]] VectorXBlockRowRef delta_block_row,
-                                               [[maybe_unused]] MatrixXBlockRowRef Cf_block_row,
-                                               [[maybe_unused]] const ColsMap& cols_map)
-{
-  throw std::runtime_error("Update with S2 projection not implemented yet");
+  const size_t track_size = track.size();
+  const fp& anchor_timestamp = track.timestamps_.front();
+
+  // Clones of secondary cameras are composed with the extrinsics of the camera rig (clone * C0_S_Ci * E_i)
+  const SE3 anchor_E = X.clone(anchor_timestamp, track.cam_id_);
+  const Eigen::Index anchor_col = cols_map.at(anchor_timestamp);
+
+  // A perturbation of E_i of a secondary camera is a perturbation of its clones through the adjoint of clone * C0_S_Ci
+  const bool secondary = track.cam_id_ > 0;
+  SE3 rig;
+  Eigen::Index Ei_col = 0;
+  Matrix6 anchor_Ad = Matrix6::Identity();
+  if (secondary)
+  {
+    rig = X.opts().secondary_cameras_extrinsics_.at(track.cam_id_ - 1);
+    Ei_col = cols_map.at(MSCEqFState::cameraKey(MSCEqFStateElementName::E, track.cam_id_));
+    anchor_Ad = (X.clone(anchor_timestamp) * rig).Adjoint();
+  }
+
+  // Quantities that are constant along the track are computed once
+  const Vector3 G0_f = anchor_E * A_f;
+  const Matrix3 G0_f_wedge = SO3::wedge(G0_f);
+  const Matrix<3, cf_cols> RJ = anchor_E.R() * UpdaterHelper::featureJacobian<Helper::representation_>(A_f);
+  const CameraIntrinsicsHelper intrinsics = cameraIntrinsics(X, xi0, track.cam_id_, cols_map);
+
+  C.middleRows(row_idx, rows * track_size).setZero();
+
+  for (size_t i = 0; i < track_size; ++i)
+  {
+    const Eigen::Index row = static_cast<Eigen::Index>(row_idx + rows * i);
+    const Vector2 uv(track.uvs_[i].x, track.uvs_[i].y);
+    const Vector2 uvn(track.normalized_uvs_[i].x, track.normalized_uvs_[i].y);
+    const Vector3 bearing = track.bearing(i);
+
+    const Matrix<rows, 3> DRt = Helper::measurementBlock(intrinsics, X.clone(track.timestamps_[i], track.cam_id_),
+                                                         G0_f, uv, uvn, bearing, C, delta, row);
+
+    // C block of the clone is D * R^T * [wedge(G0_f) -I], the anchor block is its opposite
+    if (track.timestamps_[i] != anchor_timestamp)
+    {
+      const Eigen::Index clone_col = cols_map.at(track.timestamps_[i]);
+      C.block<rows, 3>(row, clone_col).noalias() = DRt * G0_f_wedge;
+      C.block<rows, 3>(row, clone_col + 3) = -DRt;
+      C.block<rows, 6>(row, anchor_col) = -C.block<rows, 6>(row, clone_col);
+
+      if (secondary)
+      {
+        C.block<rows, 6>(row, Ei_col).noalias() =
+            C.block<rows, 6>(row, clone_col) * ((X.clone(track.timestamps_[i]) * rig).Adjoint() - anchor_Ad);
+      }
+    }
+
+    Cf.block<rows, cf_cols>(rows * i, 0).noalias() = DRt * RJ;
+  }
 }
 
-void ProjectionHelperZ1::residualJacobianBlock(const MSCEqFState& X,
-                                               const SystemState& xi0,
-                                               const FeatHelper& feat,
-                                               MatrixXBlockRowRef C_block_row,
-                                               VectorXBlockRowRef delta_block_row,
-                                               MatrixXBlockRowRef Cf_block_row,
-                                               const ColsMap& cols_map)
+template <typename Helper>
+void ProjectionHelper::computePointResidualJacobianBlock(const MSCEqFState& X,
+                                                         const SystemState& xi0,
+                                                         const PointFeatHelper& feat,
+                                                         MatrixX& C,
+                                                         VectorX& delta,
+                                                         MatrixX& Cp,
+                                                         const size_t& row_idx,
+                                                         const size_t& cp_row_idx,
+                                                         const ColsMap& cols_map)
 {
-  const auto& anchor_E = X.clone(feat.anchor_timestamp_);
-  const auto& clone_E = X.clone(feat.clone_timestamp_);
+  constexpr int rows = Helper::rows_;
 
-  // feature in origin frame and camera frame
-  Vector3 G0_f = anchor_E * feat.A_f_;
-  Vector3 C_f = clone_E.inv() * G0_f;
+  const CameraIntrinsicsHelper intrinsics = cameraIntrinsics(X, xi0, feat.cam_id_, cols_map);
+  const Eigen::Index row = static_cast<Eigen::Index>(row_idx);
 
-  // precompute D = K0 * L * dpi(C_f) if intrinsics are calibrated, D = dpi(C_f) otherwise
-  Matrix<2, 3> D = X.opts().enable_camera_intrinsics_calibration_ ?
-                       (xi0.K() * X.L()).asMatrix().block<2, 2>(0, 0) * dpi(C_f) :
-                       dpi(C_f);
+  const Matrix<rows, 3> DRt = Helper::measurementBlock(intrinsics, X.clone(feat.clone_timestamp_, feat.cam_id_),
+                                                       feat.G0_f_, feat.uv_, feat.uvn_, feat.bearing_, C, delta, row);
 
-  // Precompute P = L * pi(C_f) if intrinsics are calibrated, P = pi(C_f) otherwise
-  Vector3 P = X.opts().enable_camera_intrinsics_calibration_ ? X.L().asMatrix() * pi(C_f) : pi(C_f);
+  // The feature is not anchored to any clone, hence only the clone of the measurement is involved
+  const Eigen::Index clone_col = cols_map.at(feat.clone_timestamp_);
+  C.block<rows, 3>(row, clone_col).noalias() = DRt * SO3::wedge(feat.G0_f_);
+  C.block<rows, 3>(row, clone_col + 3) = -DRt;
 
-  // Precompute A = [wedge(G0_f) -I]
-  Matrix<3, 6> A = Matrix<3, 6>::Zero();
-  A.block<3, 3>(0, 0) = SO3::wedge(G0_f);
-  A.block<3, 3>(0, 3) = -Matrix3::Identity();
-
-  if (X.opts().enable_camera_intrinsics_calibration_)
+  if (feat.cam_id_ > 0)
   {
-    C_block_row.block(0, cols_map.at(MSCEqFStateElementName::L), block_rows_, X.dof(MSCEqFStateElementName::L))
-        .noalias() = xi0.K().asMatrix().block<2, 2>(0, 0) * UpdaterHelper::Xi(P);
+    const SE3 rig = X.opts().secondary_cameras_extrinsics_.at(feat.cam_id_ - 1);
+    const Eigen::Index Ei_col = cols_map.at(MSCEqFState::cameraKey(MSCEqFStateElementName::E, feat.cam_id_));
+    C.block<rows, 6>(row, Ei_col).noalias() =
+        C.block<rows, 6>(row, clone_col) * (X.clone(feat.clone_timestamp_) * rig).Adjoint();
   }
 
-  if (feat.clone_timestamp_ != feat.anchor_timestamp_)
+  Cp.block<rows, 3>(cp_row_idx, 0) = DRt;
+}
+
+template <FeatureRepresentation representation, bool intrinsics_calibration>
+inline Matrix<2, 3> ProjectionHelperS2<representation, intrinsics_calibration>::measurementBlock(
+    const CameraIntrinsicsHelper& intrinsics,
+    const SE3& clone_E,
+    const Vector3& G0_f,
+    const Vector2& uv,
+    [[maybe_unused]] const Vector2& uvn,
+    const Vector3& bearing,
+    MatrixX& C,
+    VectorX& delta,
+    const Eigen::Index& row_idx)
+{
+  // feature in camera frame
+  const Matrix3 Rt = clone_E.R().transpose();
+  const Vector3 C_f = Rt * (G0_f - clone_E.x());
+
+  if constexpr (intrinsics_calibration)
   {
-    C_block_row.block(0, cols_map.at(feat.clone_timestamp_), block_rows_, X.dof(feat.clone_timestamp_)).noalias() =
-        D * clone_E.R().transpose() * A;
-    C_block_row.block(0, cols_map.at(feat.anchor_timestamp_), block_rows_, X.dof(feat.anchor_timestamp_)) =
-        -C_block_row.block(0, cols_map.at(feat.clone_timestamp_), block_rows_, X.dof(feat.clone_timestamp_));
-  }
+    // Angular residuals are scaled by the focal length such that they are expressed in pixels
+    if (intrinsics.calibrated_)
+    {
+      // Measured bearing b = pi(m), with m = L^-1 * n and n = K^-1 * [uv 1]^T. The measured bearing depends on L,
+      // hence the intrinsics block is B * dpi(m) * L^-1 * [Xi(n); 0]
+      const Vector3 n = intrinsics.K_inv_ * uv.homogeneous();
+      const Vector3 m = intrinsics.L_inv_ * n;
+      const Vector3 b = pi(m);
+      const Matrix<rows_, 3> B = intrinsics.f_ * UpdaterHelper::tangentBasis(b);
 
-  switch (feature_representation_)
+      C.block<rows_, 4>(row_idx, intrinsics.col_).noalias() =
+          B * dpi(m) * intrinsics.L_inv_.leftCols<2>() * UpdaterHelper::Xi(n);
+      delta.segment<rows_>(row_idx).noalias() = B * (b - pi(C_f));
+      return B * dpi(C_f) * Rt;
+    }
+
+    const Matrix<rows_, 3> B = intrinsics.f_ * UpdaterHelper::tangentBasis(bearing);
+    delta.segment<rows_>(row_idx).noalias() = B * (bearing - pi(C_f));
+    return B * dpi(C_f) * Rt;
+  }
+  else
   {
-    case FeatureRepresentation::ANCHORED_EUCLIDEAN:
-      Cf_block_row = D * clone_E.R().transpose() * anchor_E.R();
-      break;
-    case FeatureRepresentation::ANCHORED_INVERSE_DEPTH:
-      Cf_block_row = D * clone_E.R().transpose() * anchor_E.R() * UpdaterHelper::inverseDepthJacobian(feat.A_f_);
-      break;
-    case FeatureRepresentation::ANCHORED_POLAR:
-      Vector3 A_f0 = (Vector3() << 0.0, 0.0, 1.0).finished();
-      Vector3 thetak =
-          std::acos((A_f0.normalized().transpose() * feat.A_f_.normalized())) * A_f0.cross(feat.A_f_).normalized();
-      Matrix<3, 4> J = Matrix<3, 4>::Zero();
-      J.block<3, 3>(0, 0) = SO3::wedge(feat.A_f_) * SO3::leftJacobian(thetak);
-      J.block<3, 1>(0, 3) = -feat.A_f_;
-      Cf_block_row = D * clone_E.R().transpose() * anchor_E.R() * J;
-      break;
+    const Matrix<rows_, 3> B = UpdaterHelper::tangentBasis(bearing);
+    delta.segment<rows_>(row_idx).noalias() = B * (bearing - pi(C_f));
+    return B * dpi(C_f) * Rt;
   }
+}
 
-  if (X.opts().enable_camera_intrinsics_calibration_)
+template <FeatureRepresentation representation, bool intrinsics_calibration>
+void ProjectionHelperS2<representation, intrinsics_calibration>::residualJacobianBlock(const MSCEqFState& X,
+                                                                                       const SystemState& xi0,
+                                                                                       const Track& track,
+                                                                                       const Vector3& A_f,
+                                                                                       MatrixX& C,
+                                                                                       VectorX& delta,
+                                                                                       MatrixX& Cf,
+                                                                                       const size_t& row_idx,
+                                                                                       const ColsMap& cols_map) const
+{
+  computeResidualJacobianBlock<ProjectionHelperS2>(X, xi0, track, A_f, C, delta, Cf, row_idx, cols_map);
+}
+
+template <FeatureRepresentation representation, bool intrinsics_calibration>
+void ProjectionHelperS2<representation, intrinsics_calibration>::pointResidualJacobianBlock(
+    const MSCEqFState& X,
+    const SystemState& xi0,
+    const PointFeatHelper& feat,
+    MatrixX& C,
+    VectorX& delta,
+    MatrixX& Cp,
+    const size_t& row_idx,
+    const size_t& cp_row_idx,
+    const ColsMap& cols_map) const
+{
+  computePointResidualJacobianBlock<ProjectionHelperS2>(X, xi0, feat, C, delta, Cp, row_idx, cp_row_idx, cols_map);
+}
+
+template <FeatureRepresentation representation, bool intrinsics_calibration>
+inline Matrix<2, 3> ProjectionHelperZ1<representation, intrinsics_calibration>::measurementBlock(
+    const CameraIntrinsicsHelper& intrinsics,
+    const SE3& clone_E,
+    const Vector3& G0_f,
+    const Vector2& uv,
+    const Vector2& uvn,
+    [[maybe_unused]] const Vector3& bearing,
+    MatrixX& C,
+    VectorX& delta,
+    const Eigen::Index& row_idx)
+{
+  // feature in camera frame
+  const Matrix3 Rt = clone_E.R().transpose();
+  const Vector3 C_f = Rt * (G0_f - clone_E.x());
+
+  // P = L * pi(C_f) if intrinsics are calibrated, P = pi(C_f) otherwise
+  Vector3 P = pi(C_f);
+
+  if constexpr (intrinsics_calibration)
   {
-    delta_block_row = feat.uv_ - (xi0.K().asMatrix() * P).segment<2>(0);
+    if (intrinsics.calibrated_)
+    {
+      P = intrinsics.L_ * P;
+      C.block<rows_, 4>(row_idx, intrinsics.col_).noalias() = intrinsics.K_.block<2, 2>(0, 0) * UpdaterHelper::Xi(P);
+    }
+    delta.segment<rows_>(row_idx) = uv - (intrinsics.K_ * P).head<2>();
+    return intrinsics.KL_ * dpi(C_f) * Rt;
   }
   else
   {
-    delta_block_row = feat.uvn_ - P.segment<2>(0);
+    delta.segment<rows_>(row_idx) = uvn - P.head<2>();
+    return dpi(C_f) * Rt;
   }
 }
 
+template <FeatureRepresentation representation, bool intrinsics_calibration>
+void ProjectionHelperZ1<representation, intrinsics_calibration>::residualJacobianBlock(const MSCEqFState& X,
+                                                                                       const SystemState& xi0,
+                                                                                       const Track& track,
+                                                                                       const Vector3& A_f,
+                                                                                       MatrixX& C,
+                                                                                       VectorX& delta,
+                                                                                       MatrixX& Cf,
+                                                                                       const size_t& row_idx,
+                                                                                       const ColsMap& cols_map) const
+{
+  computeResidualJacobianBlock<ProjectionHelperZ1>(X, xi0, track, A_f, C, delta, Cf, row_idx, cols_map);
+}
+
+template <FeatureRepresentation representation, bool intrinsics_calibration>
+void ProjectionHelperZ1<representation, intrinsics_calibration>::pointResidualJacobianBlock(
+    const MSCEqFState& X,
+    const SystemState& xi0,
+    const PointFeatHelper& feat,
+    MatrixX& C,
+    VectorX& delta,
+    MatrixX& Cp,
+    const size_t& row_idx,
+    const size_t& cp_row_idx,
+    const ColsMap& cols_map) const
+{
+  computePointResidualJacobianBlock<ProjectionHelperZ1>(X, xi0, feat, C, delta, Cp, row_idx, cp_row_idx, cols_map);
+}
+
+template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_EUCLIDEAN, true>;
+template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_EUCLIDEAN, false>;
+template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, true>;
+template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, false>;
+template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_POLAR, true>;
+template class ProjectionHelperS2<FeatureRepresentation::ANCHORED_POLAR, false>;
+template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_EUCLIDEAN, true>;
+template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_EUCLIDEAN, false>;
+template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, true>;
+template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_INVERSE_DEPTH, false>;
+template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_POLAR, true>;
+template class ProjectionHelperZ1<FeatureRepresentation::ANCHORED_POLAR, false>;
+
 Matrix<2, 4> UpdaterHelper::Xi(const Vector3& f)
 {
   Matrix<2, 4> Xi = Matrix<2, 4>::Zero();
@@ -136,6 +320,15 @@ Matrix<2, 4> UpdaterHelper::Xi(const Vector3& f)
   return Xi;
 }
 
+Matrix<2, 3> UpdaterHelper::tangentBasis(const Vector3& b)
+{
+  Matrix<2, 3> B;
+  const Vector3 a = std::abs(b(0)) < 0.9 ? Vector3::UnitX() : Vector3::UnitY();
+  B.row(0) = b.cross(a).normalized().transpose();
+  B.row(1) = b.cross(Vector3(B.row(0).transpose())).transpose();
+  return B;
+}
+
 Matrix3 UpdaterHelper::inverseDepthJacobian(const Vector3& A_f)
 {
   Matrix3 Cid = Matrix3::Identity();
@@ -144,6 +337,24 @@ Matrix3 UpdaterHelper::inverseDepthJacobian(const Vector3& A_f)
   return Cid;
 }
 
+Matrix<3, 4> UpdaterHelper::persistentFeatureJacobian(const SOT3& Q, const Vector3& G0_f0)
+{
+  // Linear action of Q^-1 on R3
+  const SOT3 Q_inv = Q.inv();
+  Matrix3 Q_inv_action = Matrix3::Zero();
+  for (int i = 0; i < 3; ++i)
+  {
+    Q_inv_action.col(i) = Q_inv * Vector3(Vector3::Unit(i));
+  }
+
+  // Differential of exp(-eps) * G0_f0 is [wedge(G0_f0) -G0_f0]
+  Matrix<3, 4> J = Matrix<3, 4>::Zero();
+  J.block<3, 3>(0, 0) = SO3::wedge(G0_f0);
+  J.block<3, 1>(0, 3) = -G0_f0;
+
+  return Q_inv_action * J;
+}
+
 void UpdaterHelper::nullspaceProjection(Ref<MatrixX> Cf, MatrixXBlockRowRef Ct, VectorXBlockRowRef delta)
 {
   Eigen::HouseholderQR<Ref<MatrixX>> QR(Cf);
@@ -171,6 +382,22 @@ void UpdaterHelper::updateQRCompression(MatrixX& C, VectorX& delta)
   delta = Q.transpose() * delta;
 }
 
+void UpdaterHelper::updateQRAccumulation(MatrixX& C, VectorX& delta, size_t& rows)
+{
+  const size_t cols = C.cols();
+
+  if (rows <= cols)
+  {
+    return;
+  }
+
+  Eigen::HouseholderQR<MatrixX> QR(C.topRows(rows));
+  delta.head(rows).applyOnTheLeft(QR.householderQ().adjoint());
+
+  C.topRows(cols) = QR.matrixQR().topRows(cols).triangularView<Eigen::Upper>();
+  rows = cols;
+}
+
 bool UpdaterHelper::chi2Test(const fp& chi2, const size_t& dof, const std::map<uint, fp>& chi2_table)
 {
   fp chi2_threshold;
@@ -16,7 +16,7 @@
 namespace msceqf
 {
 ZeroVelocityUpdater::ZeroVelocityUpdater(const ZeroVelocityUpdaterOptions& opts, const Checker& checker)
-    : opts_(opts), checker_(checker), motion_(false)
+    : opts_(opts), checker_(checker), motion_(false), standstill_time_(0)
 {
 }
 
@@ -24,7 +24,7 @@ void ZeroVelocityUpdater::setMotion() { motion_ = true; }
 
 void ZeroVelocityUpdater::setMeasurement(const SE23& y) { y_ = y; }
 
-bool ZeroVelocityUpdater::isActive(const Tracks& tracks)
+bool ZeroVelocityUpdater::isActive(const DisparityStatistics& stats)
 {
   if (opts_.zero_velocity_update_ == ZeroVelocityUpdate::DISABLE)
   {
@@ -36,28 +36,52 @@ bool ZeroVelocityUpdater::isActive(const Tracks& tracks)
     return false;
   }
 
-  motion_ = checker_.disparityCheck(tracks);
+  motion_ = checker_.disparityCheck(stats);
 
   return !motion_;
 }
 
+bool ZeroVelocityUpdater::isStandstill(const fp& acc_var, const fp& ang_var, const fp& dt)
+{
+  if (opts_.zero_velocity_update_ == ZeroVelocityUpdate::DISABLE || !opts_.imu_standstill_detection_)
+  {
+    return false;
+  }
+
+  if (opts_.zero_velocity_update_ == ZeroVelocityUpdate::BEGINNING && motion_)
+  {
+    return false;
+  }
+
+  if (acc_var < opts_.imu_standstill_acc_threshold_ && ang_var < opts_.imu_standstill_ang_threshold_)
+  {
+    standstill_time_ += dt;
+  }
+  else
+  {
+    standstill_time_ = 0;
+  }
+
+  return standstill_time_ >= opts_.imu_standstill_window_;
+}
+
 bool ZeroVelocityUpdater::zvUpdate(MSCEqFState& X, const SystemState& xi0) const
 {
-  Vector9 delta = SE23::log(xi0.T().inv() * y_ * X.D().inv());
+  const Vector9 delta = SE23::log(xi0.T().inv() * y_ * X.D().inv());
 
-  Matrix9 Sigma = X.subCov({MSCEqFStateElementName::Dd}).block(0, 0, 9, 9);
+  // The measurement involves the D element only, hence the innovation covariance and the gain are computed with fixed
+  // size blocks of the covariance directly
+  const Eigen::Index D_idx = X.index(MSCEqFStateElementName::Dd);
+  const Matrix9 Sigma = X.cov_.block<9, 9>(D_idx, D_idx);
 
   Matrix9 R = Matrix9::Identity() * 0.05 * 0.05;
-  R.block(0, 0, 3, 3) = Sigma.block(0, 0, 3, 3);
-  R.block(6, 6, 3, 3) = Sigma.block(6, 6, 3, 3);
+  R.block<3, 3>(0, 0) = Sigma.block<3, 3>(0, 0);
+  R.block<3, 3>(6, 6) = Sigma.block<3, 3>(6, 6);
 
-  MatrixX G = X.subCovCols({MSCEqFStateElementName::Dd}).leftCols(9);
-  MatrixX S(R.rows(), R.cols());
-  S.triangularView<Eigen::Upper>() = Sigma + R;
-  MatrixX invS = MatrixX::Identity(R.rows(), R.cols());
-  S.selfadjointView<Eigen::Upper>().ldlt().solveInPlace(invS);
-  MatrixX K = G * invS.selfadjointView<Eigen::Upper>();
-  VectorX inn = K * delta;
+  const Matrix<Eigen::Dynamic, 9> G = X.cov_.middleCols<9>(D_idx);
+  const Matrix9 S = Sigma + R;
+  const Matrix<Eigen::Dynamic, 9> K = S.ldlt().solve(G.transpose()).transpose();
+  const VectorX inn = K * delta;
 
   // Update state
   X.state_.at(MSCEqFStateElementName::Dd)
@@ -75,14 +99,21 @@ bool ZeroVelocityUpdater::zvUpdate(MSCEqFState& X, const SystemState& xi0) const
   {
     clone->updateLeft(inn.segment(clone->getIndex(), clone->getDof()));
   }
+  for (auto& [key, element] : X.state_)
+  {
+    // Persistent features and calibration of the secondary cameras
+    if (!std::holds_alternative<MSCEqFStateElementName>(key))
+    {
+      element->updateLeft(inn.segment(element->getIndex(), element->getDof()));
+    }
+  }
 
   X.cov_.triangularView<Eigen::Upper>() -= K * G.transpose();
   X.cov_ = X.cov_.selfadjointView<Eigen::Upper>();
 
   if (opts_.curvature_correction_)
   {
-    MatrixX expGamma = Symmetry::curvatureCorrection(X, inn);
-    X.cov_ = expGamma * X.cov_ * expGamma.transpose();
+    Symmetry::applyCurvatureCorrection(X, inn);
   }
 
   return true;
@@ -13,28 +13,67 @@
 
 namespace msceqf
 {
-MSCEqF::MSCEqF(const std::string& params_filepath)
+MSCEqF::MSCEqF(const std::string& params_filepath, const std::shared_ptr<utils::threadPool>& executor)
     : parser_(params_filepath)
     , opts_(parser_.parseOptions())
+    , executor_(executor ? executor
+                         : std::make_shared<utils::threadPool>(
+                               opts_.state_options_.secondary_cameras_intrinsics_.size() + 2))
+    , stats_(std::make_shared<LatencyStats>())
+    , trace_(opts_.trace_filepath_.empty() ? nullptr : std::make_unique<utils::traceRecorder>(opts_.trace_buffer_size_))
     , xi0_(opts_.state_options_)
     , X_(opts_.state_options_, xi0_)
     , xi_(opts_.state_options_)
-    , track_manager_(opts_.track_manager_options_, opts_.state_options_.initial_camera_intrinsics_.k())
+    , track_manager_(opts_.track_manager_options_,
+                     opts_.state_options_.initial_camera_intrinsics_.k(),
+                     opts_.state_options_.secondary_cameras_intrinsics_,
+                     executor_,
+                     stats_)
     , checker_(opts_.checker_options_)
     , initializer_(opts_.init_options_, checker_)
     , propagator_(opts_.propagator_options_)
-    , updater_(opts_.updater_options_, xi0_)
+    , updater_(opts_.updater_options_, xi0_, stats_)
     , zvupdater_(opts_.zvupdater_options_, checker_)
     , visualizer_(track_manager_)
+    , track_cache_writer_(nullptr)
     , ids_to_update_()
+    , promoted_ids_()
     , timestamp_(-1)
     , is_filter_initialized_(false)
     , zvu_performed_(false)
 {
+  // The number of OpenCV threads is a process-wide setting, hence it is applied only by instances owning their executor
+  if (!executor)
+  {
+    utils::loggerScope scope(opts_.logger_level_);
+    cv::setNumThreads(opts_.track_manager_options_.tracker_options_.opencv_threads_);
+    utils::Logger::info("OpenCV number of threads set to: " + std::to_string(cv::getNumThreads()));
+  }
+}
+
+MSCEqF::~MSCEqF()
+{
+  try
+  {
+    if (!opts_.latency_stats_filepath_.empty())
+    {
+      stats_->write(opts_.latency_stats_filepath_);
+    }
+    if (trace_)
+    {
+      trace_->write(opts_.trace_filepath_);
+    }
+  }
+  catch (const std::exception& e)
+  {
+    utils::Logger::err(e.what());
+  }
 }
 
 void MSCEqF::processImuMeasurement(const Imu& imu)
 {
+  utils::loggerScope scope(opts_.logger_level_);
+
   assert(imu.timestamp_ >= 0);
 
   if (!is_filter_initialized_)
@@ -55,22 +94,19 @@ void MSCEqF::processImuMeasurement(const Imu& imu)
 
 void MSCEqF::processCameraMeasurement(Camera& cam)
 {
+  utils::loggerScope scope(opts_.logger_level_);
+  utils::traceScope trace_scope(trace_.get());
+  auto timer = LatencyStats::time(stats_, LatencyStage::CAMERA_MEASUREMENT);
+
   assert(cam.timestamp_ >= 0);
   assert(cam.image_.size() == cv::Size(opts_.track_manager_options_.tracker_options_.cam_options_.resolution_(0),
                                        opts_.track_manager_options_.tracker_options_.cam_options_.resolution_(1)));
 
-  cam.timestamp_ += opts_.track_manager_options_.tracker_options_.cam_options_.timeshift_cam_imu_;
-
-  if (opts_.track_manager_options_.tracker_options_.cam_options_.mask_type_ == MaskType::STATIC)
-  {
-    cam.mask_ = opts_.track_manager_options_.tracker_options_.cam_options_.static_mask_;
-  }
-
-  assert(cam.image_.size() == cam.mask_.size());
+  preprocessCamera(cam, opts_.track_manager_options_.tracker_options_);
 
   if (!is_filter_initialized_)
   {
-    initialize(cam);
+    initialize(cam.timestamp_, [&]() { trackCamera(cam); });
     return;
   }
 
@@ -80,90 +116,76 @@ void MSCEqF::processCameraMeasurement(Camera& cam)
     return;
   }
 
-  auto future_propagation = std::async([&]() { return propagator_.propagate(X_, xi0_, timestamp_, cam.timestamp_); });
-  auto future_image_processing = std::async([&]() { track_manager_.processCamera(cam); });
+  filterStep(cam.timestamp_, [&]() { trackCamera(cam); });
+}
 
-  if (!future_propagation.get())
-  {
-    utils::Logger::err("Propagation failure");
-    return;
-  }
+void MSCEqF::trackCamera(Camera& cam)
+{
+  track_manager_.processCamera(cam);
 
-  if (opts_.zvupdater_options_.zero_velocity_update_ != ZeroVelocityUpdate::DISABLE)
-  {
-    future_image_processing.wait();
-    if (zvupdater_.isActive(track_manager_.tracks()))
-    {
-      if (!zvu_performed_)
-      {
-        zvupdater_.setMeasurement(SE23(SO3(), {-xi_.T().v(), Vector3::Zero()}).multiplyRight(xi_.T()));
-      }
-      zvu_performed_ = zvupdater_.zvUpdate(X_, xi0_);
-      utils::Logger::info("Successful zero velocity update");
-      return;
-    }
-    if (zvu_performed_)
-    {
-      zvu_performed_ = false;
-      track_manager_.removeTracksTail(cam.timestamp_, false);
-    }
-    X_.stochasticCloning(cam.timestamp_);
-  }
-  else
+  if (track_cache_writer_)
   {
-    auto future_cloning = std::async([&]() { X_.stochasticCloning(cam.timestamp_); });
-
-    future_image_processing.wait();
-    future_cloning.wait();
+    // Features are recorded with the timestamp of the measurement, the camera-imu time shift is applied on replay
+    const auto& [timestamp, features] = track_manager_.currentFeatures();
+    const fp& timeshift = opts_.track_manager_options_.tracker_options_.cam_options_.timeshift_cam_imu_;
+    track_cache_writer_->write(timestamp - timeshift, features);
   }
+}
 
-  track_manager_.lostTracksIds(cam.timestamp_, ids_to_update_);
+void MSCEqF::processCamerasMeasurement(std::vector<Camera>& cams)
+{
+  utils::loggerScope scope(opts_.logger_level_);
+  utils::traceScope trace_scope(trace_.get());
+  auto timer = LatencyStats::time(stats_, LatencyStage::CAMERA_MEASUREMENT);
 
-  bool marginalize = false;
-  fp marginalize_timestamp = -1;
-  if (X_.clonesSize() == opts_.state_options_.num_clones_)
+  if (cams.size() != track_manager_.numCameras())
   {
-    marginalize_timestamp = X_.cloneTimestampToMarginalize();
-    track_manager_.activeTracksIds(marginalize_timestamp, ids_to_update_);
-    marginalize = true;
+    utils::Logger::err("Received " + std::to_string(cams.size()) + " camera measurements, expected " +
+                       std::to_string(track_manager_.numCameras()) + ". Discarding measurements");
+    return;
   }
 
-  updater_.mscUpdate(X_, track_manager_.tracks(), ids_to_update_);
-  if (!ids_to_update_.empty())
-  {
-    utils::Logger::info("Successful update with " + std::to_string(ids_to_update_.size()) + " tracks");
-  }
-  else
+  assert(cams.front().timestamp_ >= 0);
+
+  preprocessCamera(cams.front(), opts_.track_manager_options_.tracker_options_);
+  for (size_t i = 1; i < cams.size(); ++i)
   {
-    utils::Logger::warn("Failed update.");
+    preprocessCamera(cams[i], opts_.track_manager_options_.secondary_trackers_options_[i - 1]);
+
+    // Secondary cameras share the clone of the primary camera
+    cams[i].timestamp_ = cams.front().timestamp_;
   }
 
-  xi_ = Symmetry::phi(X_, xi0_);
+  const fp& timestamp = cams.front().timestamp_;
 
-  if (X_.opts().enable_camera_intrinsics_calibration_ && X_.covBlock(MSCEqFStateElementName::L).trace() < 1.0e-4)
+  if (!is_filter_initialized_)
   {
-    track_manager_.cam()->setIntrinsics(xi_.k());
+    initialize(timestamp, [&]() { track_manager_.processCameras(cams); });
+    return;
   }
 
-  track_manager_.removeTracksId(ids_to_update_);
-  ids_to_update_.clear();
-
-  if (marginalize)
+  if (timestamp < timestamp_)
   {
-    X_.marginalizeCloneAt(marginalize_timestamp);
-    track_manager_.removeTracksTail(marginalize_timestamp);
+    utils::Logger::warn("Received Camera measurements older than actual state estimate. Discarding measurements");
+    return;
   }
+
+  filterStep(timestamp, [&]() { track_manager_.processCameras(cams); });
 }
 
 void MSCEqF::processFeaturesMeasurement(TriangulatedFeatures& features)
 {
+  utils::loggerScope scope(opts_.logger_level_);
+  utils::traceScope trace_scope(trace_.get());
+  auto timer = LatencyStats::time(stats_, LatencyStage::CAMERA_MEASUREMENT);
+
   assert(features.timestamp_ >= 0);
 
   features.timestamp_ += opts_.track_manager_options_.tracker_options_.cam_options_.timeshift_cam_imu_;
 
   if (!is_filter_initialized_)
   {
-    initialize(features);
+    initialize(features.timestamp_, [&]() { track_manager_.processFeatures(features); });
     return;
   }
 
@@ -173,9 +195,53 @@ void MSCEqF::processFeaturesMeasurement(TriangulatedFeatures& features)
     return;
   }
 
-  auto future_propagation =
-      std::async([&]() { return propagator_.propagate(X_, xi0_, timestamp_, features.timestamp_); });
-  auto future_feature_processing = std::async([&]() { track_manager_.processFeatures(features); });
+  filterStep(features.timestamp_, [&]() { track_manager_.processFeatures(features); });
+}
+
+void MSCEqF::preprocessCamera(Camera& cam, const TrackerOptions& opts) const
+{
+  cam.timestamp_ += opts.cam_options_.timeshift_cam_imu_;
+
+  if (opts.cam_options_.mask_type_ == MaskType::STATIC)
+  {
+    cam.mask_ = opts.cam_options_.static_mask_;
+  }
+
+  assert(cam.image_.size() == cam.mask_.size());
+}
+
+void MSCEqF::filterStep(const fp& timestamp, const std::function<void()>& frontend)
+{
+  // While at standstill, detected from the buffered IMU readings only, the frontend is skipped entirely. The IMU
+  // readings have to be checked before propagation, that removes them from the buffer
+  fp acc_var = 0;
+  fp ang_var = 0;
+  if (opts_.zvupdater_options_.imu_standstill_detection_ &&
+      propagator_.imuVariance(timestamp_, timestamp, acc_var, ang_var) &&
+      zvupdater_.isStandstill(acc_var, ang_var, timestamp - timestamp_))
+  {
+    utils::traceSpan span("standstill");
+    const bool propagated = [&]() {
+      auto timer = LatencyStats::time(stats_, LatencyStage::PROPAGATION);
+      return propagator_.propagate(X_, xi0_, timestamp_, timestamp);
+    }();
+    if (!propagated)
+    {
+      utils::Logger::err("Propagation failure");
+      return;
+    }
+    zeroVelocityStep();
+    return;
+  }
+
+  auto future_propagation = executor_->async([&]() {
+    auto timer = LatencyStats::time(stats_, LatencyStage::PROPAGATION);
+    return propagator_.propagate(X_, xi0_, timestamp_, timestamp);
+  });
+  auto future_frontend = executor_->async([&]() {
+    auto timer = LatencyStats::time(stats_, LatencyStage::TRACKING);
+    frontend();
+  });
 
   if (!future_propagation.get())
   {
@@ -185,51 +251,79 @@ void MSCEqF::processFeaturesMeasurement(TriangulatedFeatures& features)
 
   if (opts_.zvupdater_options_.zero_velocity_update_ != ZeroVelocityUpdate::DISABLE)
   {
-    future_feature_processing.wait();
-    if (zvupdater_.isActive(track_manager_.tracks()))
+    future_frontend.wait();
+    if (zvupdater_.isActive(track_manager_.disparityStatistics()))
     {
-      if (!zvu_performed_)
-      {
-        zvupdater_.setMeasurement(SE23(SO3(), {-xi_.T().v(), Vector3::Zero()}).multiplyRight(xi_.T()));
-      }
-      zvu_performed_ = zvupdater_.zvUpdate(X_, xi0_);
-      utils::Logger::info("Successful zero velocity update");
+      zeroVelocityStep();
       return;
     }
     if (zvu_performed_)
     {
       zvu_performed_ = false;
-      track_manager_.removeTracksTail(features.timestamp_, false);
+      track_manager_.removeTracksTail(timestamp, false);
     }
-    X_.stochasticCloning(features.timestamp_);
+    auto timer = LatencyStats::time(stats_, LatencyStage::CLONING);
+    X_.stochasticCloning(timestamp);
   }
   else
   {
-    auto future_cloning = std::async([&]() { X_.stochasticCloning(features.timestamp_); });
+    auto future_cloning = executor_->async([&]() {
+      auto timer = LatencyStats::time(stats_, LatencyStage::CLONING);
+      X_.stochasticCloning(timestamp);
+    });
 
-    future_feature_processing.wait();
+    future_frontend.wait();
     future_cloning.wait();
   }
 
-  track_manager_.lostTracksIds(features.timestamp_, ids_to_update_);
+  // The newest observations are accumulated for the triangulation as soon as their clone is available
+  updater_.addObservations(X_, track_manager_.tracks(), timestamp);
+
+  track_manager_.lostTracksIds(timestamp, ids_to_update_);
 
   bool marginalize = false;
+  bool marginalize_oldest = false;
   fp marginalize_timestamp = -1;
   if (X_.clonesSize() == opts_.state_options_.num_clones_)
   {
-    marginalize_timestamp = X_.cloneTimestampToMarginalize();
-    track_manager_.activeTracksIds(marginalize_timestamp, ids_to_update_);
+    // The parallax between the last keyframe and the newest clone is computed only if needed by the policy
+    fp parallax = -1;
+    if (opts_.state_options_.marginalization_policy_ == MarginalizationPolicy::PARALLAX && X_.clonesSize() > 2)
+    {
+      const auto timestamps = X_.clonesTimestamps();
+      parallax = updater_.parallax(X_, track_manager_.tracks(), timestamps.rbegin()[2], timestamps.back());
+    }
+
+    marginalize_timestamp = X_.cloneTimestampToMarginalize(parallax);
+    marginalize_oldest = marginalize_timestamp == X_.oldestCloneTimestamp();
     marginalize = true;
-  }
 
-  updater_.mscUpdate(X_, track_manager_.tracks(), ids_to_update_);
-  if (!ids_to_update_.empty())
-  {
-    utils::Logger::info("Successful update with " + std::to_string(ids_to_update_.size()) + " tracks");
+    // Tracks active in the oldest clone are used before losing their oldest observation, while observations in
+    // non-keyframe clones are redundant and simply dropped
+    if (marginalize_oldest)
+    {
+      track_manager_.activeTracksIds(marginalize_timestamp, ids_to_update_);
+    }
   }
-  else
+
   {
-    utils::Logger::warn("Failed update.");
+    auto timer = LatencyStats::time(stats_, LatencyStage::UPDATE);
+
+    if (opts_.state_options_.num_persistent_features_ > 0)
+    {
+      persistentFeaturesStep(timestamp);
+    }
+
+    updater_.mscUpdate(X_, track_manager_.tracks(), ids_to_update_);
+    if (!ids_to_update_.empty())
+    {
+      utils::Logger::info(
+          [&]() { return "Successful update with " + std::to_string(ids_to_update_.size()) + " tracks"; });
+    }
+    else
+    {
+      utils::Logger::warn("Failed update.");
+    }
   }
 
   xi_ = Symmetry::phi(X_, xi0_);
@@ -239,46 +333,117 @@ void MSCEqF::processFeaturesMeasurement(TriangulatedFeatures& features)
     track_manager_.cam()->setIntrinsics(xi_.k());
   }
 
+  // Tracks of persistent features are kept, only their latest observation is needed for the next update
+  if (!promoted_ids_.empty() || X_.persistentFeaturesSize() > 0)
+  {
+    for (const auto& id : promoted_ids_)
+    {
+      ids_to_update_.erase(id);
+    }
+    promoted_ids_.clear();
+
+    const auto persistent_ids = X_.persistentFeaturesIds();
+    track_manager_.removeTracksTail(std::unordered_set<uint>(persistent_ids.begin(), persistent_ids.end()), timestamp,
+                                    false);
+  }
+
   track_manager_.removeTracksId(ids_to_update_);
   ids_to_update_.clear();
 
   if (marginalize)
   {
+    auto timer = LatencyStats::time(stats_, LatencyStage::MARGINALIZATION);
     X_.marginalizeCloneAt(marginalize_timestamp);
-    track_manager_.removeTracksTail(marginalize_timestamp);
+    if (marginalize_oldest)
+    {
+      track_manager_.removeTracksTail(marginalize_timestamp);
+    }
+    else
+    {
+      track_manager_.removeTracksAt(marginalize_timestamp);
+    }
   }
 }
 
-void MSCEqF::initialize(Camera& cam)
+void MSCEqF::zeroVelocityStep()
 {
-  if (opts_.init_options_.init_with_given_state_)
+  if (!zvu_performed_)
+  {
+    zvupdater_.setMeasurement(SE23(SO3(), {-xi_.T().v(), Vector3::Zero()}).multiplyRight(xi_.T()));
+  }
+  zvu_performed_ = zvupdater_.zvUpdate(X_, xi0_);
+  utils::Logger::info("Successful zero velocity update");
+}
+
+void MSCEqF::persistentFeaturesStep(const fp& timestamp)
+{
+  std::unordered_set<uint> active_ids;
+  track_manager_.activeTracksIds(timestamp, active_ids);
+
+  // Split persistent features in tracked and lost, persistent features are never used in the MSC update
+  std::vector<uint> tracked_ids;
+  std::unordered_set<uint> lost_ids;
+  for (const auto& id : X_.persistentFeaturesIds())
+  {
+    ids_to_update_.erase(id);
+    if (active_ids.count(id))
+    {
+      tracked_ids.emplace_back(id);
+    }
+    else
+    {
+      lost_ids.insert(id);
+    }
+  }
+
+  for (const auto& id : lost_ids)
+  {
+    X_.marginalizeFeature(id);
+    xi0_.removeFeature(id);
+  }
+  track_manager_.removeTracksId(lost_ids);
+
+  updater_.persistentFeaturesUpdate(X_, track_manager_.tracks(), tracked_ids, timestamp);
+
+  if (X_.persistentFeaturesSize() >= opts_.state_options_.num_persistent_features_)
   {
-    setGivenOrigin(opts_.init_options_.initial_extended_pose_, opts_.init_options_.initial_bias_,
-                   opts_.init_options_.initial_timestamp_);
     return;
   }
 
-  track_manager_.processCamera(cam);
-  if (opts_.zvupdater_options_.zero_velocity_update_ != ZeroVelocityUpdate::DISABLE)
+  // Candidates are the longest active tracks
+  std::vector<uint> candidates;
+  for (const auto& id : active_ids)
   {
-    if (initializer_.initializeOrigin())
+    if (!X_.hasPersistentFeature(id) &&
+        track_manager_.tracks().at(id).size() >= opts_.updater_options_.persistent_feature_min_track_length_)
     {
-      setGivenOrigin(initializer_.T0(), initializer_.b0(), cam.timestamp_);
+      candidates.emplace_back(id);
     }
   }
-  else
+  std::sort(candidates.begin(), candidates.end(), [&](const uint& a, const uint& b) {
+    return track_manager_.tracks().at(a).size() > track_manager_.tracks().at(b).size();
+  });
+
+  for (const auto& id : candidates)
   {
-    if (initializer_.detectMotion(track_manager_.tracks()))
+    if (X_.persistentFeaturesSize() >= opts_.state_options_.num_persistent_features_)
     {
-      utils::Logger::info("Static initialization succeeded");
-      track_manager_.clear();
-      setGivenOrigin(initializer_.T0(), initializer_.b0(), cam.timestamp_);
+      break;
+    }
+
+    Vector3 G0_f;
+    if (updater_.persistentFeatureInitialization(X_, track_manager_.tracks().at(id), id, G0_f))
+    {
+      xi0_.insertFeature(id, xi0_.P() * xi0_.S() * G0_f);
+
+      // The measurements not used for the initialization are used in the MSC update
+      ids_to_update_.insert(id);
+      promoted_ids_.insert(id);
     }
   }
-  return;
 }
 
-void MSCEqF::initialize(TriangulatedFeatures& features)
+void MSCEqF::initialize(const fp& timestamp, const std::function<void()>& frontend)
 {
   if (opts_.init_options_.init_with_given_state_)
   {
@@ -287,21 +452,21 @@ void MSCEqF::initialize(TriangulatedFeatures& features)
     return;
   }
 
-  track_manager_.processFeatures(features);
+  frontend();
   if (opts_.zvupdater_options_.zero_velocity_update_ != ZeroVelocityUpdate::DISABLE)
   {
     if (initializer_.initializeOrigin())
     {
-      setGivenOrigin(initializer_.T0(), initializer_.b0(), features.timestamp_);
+      setGivenOrigin(initializer_.T0(), initializer_.b0(), timestamp);
     }
   }
   else
   {
-    if (initializer_.detectMotion(track_manager_.tracks()))
+    if (initializer_.detectMotion(track_manager_.disparityStatistics()))
     {
       utils::Logger::info("Static initialization succeeded");
       track_manager_.clear();
-      setGivenOrigin(initializer_.T0(), initializer_.b0(), features.timestamp_);
+      setGivenOrigin(initializer_.T0(), initializer_.b0(), timestamp);
     }
   }
   return;
@@ -309,6 +474,8 @@ void MSCEqF::initialize(TriangulatedFeatures& features)
 
 void MSCEqF::setGivenOrigin(const SE23& T0, const Vector6& b0, const fp& timestamp)
 {
+  utils::loggerScope scope(opts_.logger_level_);
+
   xi0_ = SystemState(opts_.state_options_, T0, b0);
   X_ = MSCEqFState(opts_.state_options_, xi0_);
   xi_ = Symmetry::phi(X_, xi0_);
@@ -318,8 +485,15 @@ void MSCEqF::setGivenOrigin(const SE23& T0, const Vector6& b0, const fp& timesta
   logInit();
 }
 
+void MSCEqF::recordTracks(const std::string& filename)
+{
+  track_cache_writer_ = std::make_unique<utils::trackCacheWriter>(filename);
+}
+
 const MSCEqFOptions& MSCEqF::options() const { return opts_; }
 
+const LatencyStats& MSCEqF::latencyStats() const { return *stats_; }
+
 const StateOptions& MSCEqF::stateOptions() const { return opts_.state_options_; }
 
 const SystemState& MSCEqF::stateOrigin() const { return xi0_; }
@@ -18,14 +18,16 @@ namespace msceqf
 {
 OptionParser::OptionParser(const std::string& filepath) : node_(YAML::LoadFile(filepath)), filepath_(filepath) {}
 
+OptionParser::OptionParser(const YAML::Node& node, const std::string& filepath) : node_(node), filepath_(filepath) {}
+
 MSCEqFOptions OptionParser::parseOptions()
 {
   MSCEqFOptions opts;
 
-  // Set the logger level
+  // Parse the logger level (scoped to the MSCEqF instance)
   int level;
   readDefault(level, 0, "logger_level");
-  utils::Logger::setLevel(static_cast<utils::LoggerLevel>(level));
+  opts.logger_level_ = static_cast<utils::LoggerLevel>(level);
 
   ///
   /// Parse state options
@@ -43,6 +45,12 @@ MSCEqFOptions OptionParser::parseOptions()
   readDefault(opts.state_options_.num_clones_, 10, "num_clones");
   readDefault(opts.state_options_.num_persistent_features_, 0, "num_persistent_features");
 
+  // Parse clone marginalization policy
+  parseMarginalizationPolicy(opts.state_options_.marginalization_policy_);
+  readDefault(opts.state_options_.keyframe_translation_threshold_, 0.05, "keyframe_translation_threshold");
+  readDefault(opts.state_options_.keyframe_rotation_threshold_, 5.0, "keyframe_rotation_threshold_deg");
+  readDefault(opts.state_options_.keyframe_parallax_threshold_, 10.0, "keyframe_parallax_threshold_px");
+
   ///
   /// Parse tracker parameters
   ///
@@ -92,6 +100,23 @@ MSCEqFOptions OptionParser::parseOptions()
       break;
   }
 
+  // Parse adaptive feature budget parameters (upper bounds are the parameters given above). They are always parsed,
+  // since the feature budget controller is constructed even if disabled
+  readDefault(opts.track_manager_options_.tracker_options_.budget_opts_.enable_, false, "adaptive_feature_budget");
+  readDefault(opts.track_manager_options_.tracker_options_.budget_opts_.target_frame_time_, 20.0,
+              "budget_target_frame_time_ms");
+  readDefault(opts.track_manager_options_.tracker_options_.budget_opts_.tolerance_, 0.1, "budget_tolerance");
+  readDefault(opts.track_manager_options_.tracker_options_.budget_opts_.smoothing_, 0.2, "budget_smoothing");
+  readDefault(opts.track_manager_options_.tracker_options_.budget_opts_.min_max_features_, 20,
+              "budget_min_max_features");
+  readDefault(opts.track_manager_options_.tracker_options_.budget_opts_.min_detector_pyramid_levels_, 1,
+              "budget_min_detector_pyramid_levels");
+  readDefault(opts.track_manager_options_.tracker_options_.budget_opts_.min_optical_flow_win_size_, 11,
+              "budget_min_optical_flow_win_size");
+
+  // Parse secondary cameras (they share the tracker parameters parsed so far)
+  parseSecondaryCameras(opts);
+
   ///
   /// Parse track manager parameters
   ///
@@ -149,6 +174,14 @@ MSCEqFOptions OptionParser::parseOptions()
   readDefault(opts.updater_options_.curvature_correction_, false, "curvature_correction");
   readDefault(opts.zvupdater_options_.curvature_correction_, false, "curvature_correction");
   parsePixStd(opts.updater_options_.pixel_std_, opts.state_options_);
+  readDefault(opts.updater_options_.persistent_feature_min_track_length_, opts.state_options_.num_clones_,
+              "persistent_feature_min_track_length");
+  readDefault(opts.updater_options_.streaming_update_, false, "streaming_update");
+  readDefault(opts.updater_options_.max_update_rows_, 0, "max_update_rows");
+  readDefault(opts.updater_options_.update_time_budget_, 0.0, "update_time_budget_ms");
+  readDefault(opts.updater_options_.selection_max_parallax_, 0.1, "track_selection_max_parallax");
+  readDefault(opts.updater_options_.selection_grid_size_, 8, "track_selection_grid_size");
+  readDefault(opts.updater_options_.use_features_points_, false, "use_features_points");
 
   ///
   /// Parse zero velocity updater options
@@ -160,6 +193,32 @@ MSCEqFOptions OptionParser::parseOptions()
     opts.checker_options_.disparity_window_ = 0.0;
     utils::Logger::warn("Parameter: [checker_disparity_window] set to : 0.0 for zero velocity update");
   }
+  readDefault(opts.zvupdater_options_.imu_standstill_detection_, false, "imu_standstill_detection");
+  readDefault(opts.zvupdater_options_.imu_standstill_window_, 1.0, "imu_standstill_window");
+  readDefault(opts.zvupdater_options_.imu_standstill_acc_threshold_, 0.05, "imu_standstill_acc_threshold");
+  readDefault(opts.zvupdater_options_.imu_standstill_ang_threshold_, 1e-3, "imu_standstill_ang_threshold");
+
+  ///
+  /// Parse scheduler options
+  ///
+
+  readDefault(opts.scheduler_options_.drop_frames_, true, "scheduler_drop_frames");
+  readDefault(opts.scheduler_options_.frame_deadline_, 50.0, "scheduler_frame_deadline_ms");
+  readDefault(opts.scheduler_options_.max_queue_size_, 10, "scheduler_max_queue_size");
+  opts.scheduler_options_.max_queue_size_ = std::max(opts.scheduler_options_.max_queue_size_, size_t(1));
+
+  ///
+  /// Parse latency statistics options
+  ///
+
+  readDefault(opts.latency_stats_filepath_, std::string(), "latency_stats_file");
+
+  ///
+  /// Parse tracing options
+  ///
+
+  readDefault(opts.trace_filepath_, std::string(), "trace_file");
+  readDefault(opts.trace_buffer_size_, 262144, "trace_buffer_size");
 
   // Parse non state options
   // readDefault(opts.persistent_feature_init_delay_, 1.0, "persistent_feature_init_delay");
@@ -275,6 +334,54 @@ void OptionParser::parseCameraParameters(SE3& extrinsics,
   }
 }
 
+void OptionParser::parseSecondaryCameras(MSCEqFOptions& opts)
+{
+  if (!node_["secondary_cameras"])
+  {
+    return;
+  }
+
+  if (!node_["secondary_cameras"].IsSequence())
+  {
+    throw std::runtime_error(
+        "Wrong secondary cameras. Please provide secondary cameras (secondary_cameras) as a list in the configuration "
+        "file.");
+  }
+
+  for (const auto& node : node_["secondary_cameras"])
+  {
+    OptionParser parser(node, filepath_);
+
+    TrackerOptions tracker_options = opts.track_manager_options_.tracker_options_;
+    SE3 extrinsics;
+    In intrinsics;
+
+    parser.parseCameraParameters(extrinsics, intrinsics, tracker_options.distortion_model_,
+                                 tracker_options.cam_options_.distortion_coefficients_,
+                                 tracker_options.cam_options_.resolution_,
+                                 tracker_options.cam_options_.timeshift_cam_imu_,
+                                 tracker_options.cam_options_.static_mask_, tracker_options.cam_options_.mask_type_);
+
+    if (tracker_options.cam_options_.timeshift_cam_imu_ !=
+        opts.track_manager_options_.tracker_options_.cam_options_.timeshift_cam_imu_)
+    {
+      utils::Logger::warn("Secondary cameras are assumed synchronized with the primary camera. Using primary camera "
+                          "time shift");
+      tracker_options.cam_options_.timeshift_cam_imu_ =
+          opts.track_manager_options_.tracker_options_.cam_options_.timeshift_cam_imu_;
+    }
+
+    // Extrinsics of the secondary camera with respect to the primary camera C0_S_Ci = (IC0_S)^-1 * ICi_S
+    opts.state_options_.secondary_cameras_extrinsics_.emplace_back(
+        opts.state_options_.initial_camera_extrinsics_.inv() * extrinsics);
+    opts.state_options_.secondary_cameras_intrinsics_.emplace_back(intrinsics);
+    opts.track_manager_options_.secondary_trackers_options_.emplace_back(tracker_options);
+  }
+
+  utils::Logger::info("Parsed " + std::to_string(opts.track_manager_options_.secondary_trackers_options_.size()) +
+                      " secondary cameras");
+}
+
 void OptionParser::parseGivenOrigin(SE23& T0, Vector6& b0, fp& t0)
 {
   Matrix5 T = Matrix5::Identity();
@@ -376,6 +483,30 @@ void OptionParser::parseProjectionMethod(ProjectionMethod& proj)
   }
 }
 
+void OptionParser::parseMarginalizationPolicy(MarginalizationPolicy& policy)
+{
+  std::string policy_str;
+  readDefault(policy_str, "oldest", "clone_marginalization_policy");
+
+  if (policy_str.compare("oldest") == 0)
+  {
+    policy = MarginalizationPolicy::OLDEST;
+  }
+  else if (policy_str.compare("motion") == 0)
+  {
+    policy = MarginalizationPolicy::MOTION;
+  }
+  else if (policy_str.compare("parallax") == 0)
+  {
+    policy = MarginalizationPolicy::PARALLAX;
+  }
+  else
+  {
+    throw std::runtime_error(
+        "Wrong or unsupported clone marginalization policy. Please use oldest, motion or parallax.");
+  }
+}
+
 void OptionParser::parseDetectorType(FeatureDetector& detector)
 {
   std::string detectortype;
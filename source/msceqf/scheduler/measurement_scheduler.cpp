@@ -0,0 +1,159 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#include "msceqf/scheduler/measurement_scheduler.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "utils/logger.hpp"
+#include "utils/tools.hpp"
+
+namespace msceqf
+{
+std::string SchedulerStats::toString() const
+{
+  std::ostringstream os;
+  os << "received: " << received_ << ", processed: " << processed_ << ", dropped: " << dropped_
+     << ", expired: " << expired_ << ", late: " << late_ << ", max lateness: " << max_lateness_
+     << " ms, mean latency: " << mean_latency_ << " ms, mean processing: " << mean_processing_ << " ms";
+  return os.str();
+}
+
+MeasurementScheduler::MeasurementScheduler(MSCEqF& sys)
+    : sys_(sys), opts_(sys.options().scheduler_options_), frames_(), stats_(), mutex_()
+{
+}
+
+void MeasurementScheduler::push(const Imu& imu) { sys_.processMeasurement(imu); }
+
+void MeasurementScheduler::push(const Camera& cam)
+{
+  Frame frame;
+  frame.cam_ = cam;
+  frame.arrival_ = clock::now();
+  enqueue(std::move(frame));
+}
+
+void MeasurementScheduler::push(CameraView&& cam)
+{
+  Frame frame;
+  frame.cam_ = cam.camera();
+  frame.view_ = std::move(cam);
+  frame.arrival_ = clock::now();
+  enqueue(std::move(frame));
+}
+
+void MeasurementScheduler::enqueue(Frame&& frame)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  ++stats_.received_;
+
+  auto it = std::upper_bound(frames_.begin(), frames_.end(), frame,
+                             [](const Frame& lhs, const Frame& rhs) { return lhs.cam_ < rhs.cam_; });
+  frames_.insert(it, std::move(frame));
+
+  if (frames_.size() > opts_.max_queue_size_)
+  {
+    frames_.pop_front();
+    ++stats_.dropped_;
+    utils::Logger::debug("Scheduler queue full, dropping oldest frame");
+  }
+}
+
+size_t MeasurementScheduler::process(const fp& timestamp, const ProcessedCallback& callback)
+{
+  size_t processed = 0;
+
+  while (true)
+  {
+    Frame frame;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      // Frames ready to be processed are the ones older than the given timestamp
+      auto ready_end = std::lower_bound(frames_.begin(), frames_.end(), timestamp,
+                                        [](const Frame& frame, const fp& t) { return frame.cam_.timestamp_ < t; });
+      size_t ready = std::distance(frames_.begin(), ready_end);
+
+      if (ready == 0)
+      {
+        break;
+      }
+
+      // Behind, keep only the newest ready frame, propagation is merged across the dropped ones
+      if (opts_.drop_frames_ && ready > 1)
+      {
+        frames_.erase(frames_.begin(), frames_.begin() + (ready - 1));
+        stats_.dropped_ += ready - 1;
+        utils::Logger::debug([&]() { return "Scheduler behind, dropped " + std::to_string(ready - 1) + " frames"; });
+      }
+
+      // Expired, the frame missed its deadline while a newer frame is waiting, drop it not to delay the newer one
+      if (opts_.drop_frames_ && frames_.size() > 1 &&
+          utils::elapsedMilliseconds(frames_.front().arrival_, clock::now()) > opts_.frame_deadline_)
+      {
+        frames_.pop_front();
+        ++stats_.dropped_;
+        ++stats_.expired_;
+        utils::Logger::debug("Scheduler dropped a frame past its deadline");
+        continue;
+      }
+
+      frame = std::move(frames_.front());
+      frames_.pop_front();
+    }
+
+    const auto start = clock::now();
+    sys_.processMeasurement(frame.cam_);
+    const auto end = clock::now();
+
+    if (callback)
+    {
+      callback(frame.cam_);
+    }
+
+    ++processed;
+
+    const fp processing = utils::elapsedMilliseconds(start, end);
+    const fp latency = utils::elapsedMilliseconds(frame.arrival_, end);
+    const fp lateness = latency - opts_.frame_deadline_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.processed_;
+    stats_.mean_latency_ += (latency - stats_.mean_latency_) / stats_.processed_;
+    stats_.mean_processing_ += (processing - stats_.mean_processing_) / stats_.processed_;
+    if (lateness > 0)
+    {
+      ++stats_.late_;
+      stats_.max_lateness_ = std::max(stats_.max_lateness_, lateness);
+      utils::Logger::debug([&]() { return "Frame processed " + std::to_string(lateness) + " ms past its deadline"; });
+    }
+  }
+
+  return processed;
+}
+
+size_t MeasurementScheduler::queued() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_.size();
+}
+
+SchedulerStats MeasurementScheduler::stats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace msceqf
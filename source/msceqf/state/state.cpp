@@ -11,6 +11,9 @@
 
 #include "msceqf/state/state.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include "utils/logger.hpp"
 #include "utils/tools.hpp"
 
@@ -33,6 +36,16 @@ MSCEqFState::MSCEqFState(const StateOptions& opts, const SystemState& xi0) : opt
     initializeStateElement(MSCEqFStateElementName::L, opts_.L_init_cov_);
   }
 
+  // Initialize the calibration of the secondary cameras, with respect to the primary camera, and their covariance
+  for (uint cam_id = 1; cam_id <= opts_.secondary_cameras_extrinsics_.size(); ++cam_id)
+  {
+    initializeStateElement(MSCEqFCameraKey{MSCEqFStateElementName::E, cam_id}, opts_.E_init_cov_);
+    if (opts_.enable_camera_intrinsics_calibration_)
+    {
+      initializeStateElement(MSCEqFCameraKey{MSCEqFStateElementName::L, cam_id}, opts_.L_init_cov_);
+    }
+  }
+
   const uint& D_idx = state_.at(MSCEqFStateElementName::Dd)->getIndex();
   const uint& delta_idx = D_idx + 9;
   const uint& E_idx = state_.at(MSCEqFStateElementName::E)->getIndex();
@@ -134,6 +147,24 @@ const In& MSCEqFState::L() const
   return std::static_pointer_cast<MSCEqFInState>(state_.at(MSCEqFStateElementName::L))->L_;
 }
 
+const SE3& MSCEqFState::E(const uint& cam_id) const
+{
+  if (cam_id == 0)
+  {
+    return E();
+  }
+  return std::static_pointer_cast<MSCEqFSE3State>(state_.at(MSCEqFCameraKey{MSCEqFStateElementName::E, cam_id}))->E_;
+}
+
+const In& MSCEqFState::L(const uint& cam_id) const
+{
+  if (cam_id == 0)
+  {
+    return L();
+  }
+  return std::static_pointer_cast<MSCEqFInState>(state_.at(MSCEqFCameraKey{MSCEqFStateElementName::L, cam_id}))->L_;
+}
+
 const SOT3& MSCEqFState::Q(const uint& feat_id) const
 {
   return std::static_pointer_cast<MSCEqFSOT3State>(state_.at(feat_id))->Q_;
@@ -144,6 +175,36 @@ const SE3& MSCEqFState::clone(const fp& timestamp) const
   return std::static_pointer_cast<MSCEqFSE3State>(clones_.at(timestamp))->E_;
 }
 
+SE3 MSCEqFState::clone(const fp& timestamp, const uint& cam_id) const
+{
+  if (cam_id == 0)
+  {
+    return clone(timestamp);
+  }
+  return clone(timestamp) * opts_.secondary_cameras_extrinsics_.at(cam_id - 1) * E(cam_id);
+}
+
+bool MSCEqFState::hasPersistentFeature(const uint& feat_id) const { return state_.count(feat_id) > 0; }
+
+std::vector<uint> MSCEqFState::persistentFeaturesIds() const
+{
+  std::vector<uint> ids;
+  for (const auto& [key, element] : state_)
+  {
+    if (std::holds_alternative<uint>(key))
+    {
+      ids.emplace_back(std::get<uint>(key));
+    }
+  }
+  return ids;
+}
+
+size_t MSCEqFState::persistentFeaturesSize() const
+{
+  return std::count_if(state_.cbegin(), state_.cend(),
+                       [](const auto& key_element) { return std::holds_alternative<uint>(key_element.first); });
+}
+
 const uint& MSCEqFState::index(const MSCEqFKey& key) const { return getPtr(key)->getIndex(); }
 
 const uint& MSCEqFState::dof(const MSCEqFKey& key) const { return getPtr(key)->getDof(); }
@@ -227,14 +288,24 @@ const MatrixX MSCEqFState::subCovCols(const std::vector<MSCEqFKey>& keys) const
 
 void MSCEqFState::preallocate()
 {
-  size_t num_elements = 2 + opts_.num_persistent_features_;
+  const size_t num_cameras = 1 + opts_.secondary_cameras_extrinsics_.size();
+  size_t num_elements = 1 + num_cameras + opts_.num_persistent_features_;
   if (opts_.enable_camera_intrinsics_calibration_)
   {
-    ++num_elements;
+    num_elements += num_cameras;
   }
   state_.reserve(num_elements);
 }
 
+MSCEqFStateElementName MSCEqFState::elementName(const MSCEqFStateKey& key)
+{
+  if (std::holds_alternative<MSCEqFCameraKey>(key))
+  {
+    return std::get<MSCEqFCameraKey>(key).name_;
+  }
+  return std::get<MSCEqFStateElementName>(key);
+}
+
 void MSCEqFState::initializeStateElement(const MSCEqFStateKey& key, const MatrixX& cov_block)
 {
   assert(key.valueless_by_exception() == false);
@@ -243,9 +314,9 @@ void MSCEqFState::initializeStateElement(const MSCEqFStateKey& key, const Matrix
   uint idx = cov_.rows();
 
   bool success = false;
-  if (std::holds_alternative<MSCEqFStateElementName>(key))
+  if (!std::holds_alternative<uint>(key))
   {
-    switch (std::get<MSCEqFStateElementName>(key))
+    switch (elementName(key))
     {
       case MSCEqFStateElementName::Dd:
         success = insertStateElement(key, std::move(createMSCEqFStateElement<MSCEqFSDBState>(idx)));
@@ -281,7 +352,7 @@ void MSCEqFState::initializeStateElement(const MSCEqFStateKey& key, const Matrix
   }
   else
   {
-    utils::Logger::debug("Failed to initialize new state element with key: " + toString(key));
+    utils::Logger::debug([&]() { return "Failed to initialize new state element with key: " + toString(key); });
   }
 }
 
@@ -296,7 +367,7 @@ void MSCEqFState::stochasticCloning(const fp& timestamp)
 
   if (insertCloneElement(timestamp, std::move(clone)))
   {
-    utils::Logger::debug("Created MSCEqF Clone element at time: " + std::to_string(timestamp));
+    utils::Logger::debug([&]() { return "Created MSCEqF Clone element at time: " + std::to_string(timestamp); });
 
     const uint& idx = ptr->getIndex();
     const uint& size_increment = ptr->getDof();
@@ -317,16 +388,37 @@ void MSCEqFState::stochasticCloning(const fp& timestamp)
   }
   else
   {
-    utils::Logger::debug("Failed to create MSCEqF Clone element at time: " + std::to_string(timestamp));
+    utils::Logger::debug(
+        [&]() { return "Failed to create MSCEqF Clone element at time: " + std::to_string(timestamp); });
   }
 }
 
 void MSCEqFState::marginalizeCloneAt(const fp& timestamp)
 {
   const auto& clone_to_remove = clones_.at(timestamp);
-  const uint& idx = clone_to_remove->getIndex();
-  const uint& size = clone_to_remove->getDof();
+  const uint idx = clone_to_remove->getIndex();
+  const uint size = clone_to_remove->getDof();
 
+  clones_.erase(timestamp);
+  removeCovarianceBlock(idx, size);
+
+  utils::Logger::debug([&]() { return "Marginalized MSCEqF Clone element at time: " + std::to_string(timestamp); });
+}
+
+void MSCEqFState::marginalizeFeature(const uint& feat_id)
+{
+  const auto& feat_to_remove = state_.at(feat_id);
+  const uint idx = feat_to_remove->getIndex();
+  const uint size = feat_to_remove->getDof();
+
+  state_.erase(feat_id);
+  removeCovarianceBlock(idx, size);
+
+  utils::Logger::debug([&]() { return "Marginalized MSCEqF State element [" + toString(feat_id) + "]"; });
+}
+
+void MSCEqFState::removeCovarianceBlock(const uint& idx, const uint& size)
+{
   const Eigen::Index rows = cov_.rows();
   const Eigen::Index cols = cov_.cols();
 
@@ -334,24 +426,83 @@ void MSCEqFState::marginalizeCloneAt(const fp& timestamp)
   cov_.block(0, idx, rows, cols - idx - size) = cov_.block(0, idx + size, rows, cols - idx - size).eval();
   cov_.conservativeResize(rows - size, cols - size);
 
+  // Clones and persistent features are interleaved in the covariance, shift all the elements following the block
+  for (auto& [key, element] : state_)
+  {
+    if (element->getIndex() > idx)
+    {
+      element->updateIndex(element->getIndex() - size);
+    }
+  }
   for (auto& [timestamp, clone] : clones_)
   {
-    clone->updateIndex(clone->getIndex() - size);
+    if (clone->getIndex() > idx)
+    {
+      clone->updateIndex(clone->getIndex() - size);
+    }
   }
+}
 
-  clones_.erase(timestamp);
-
-  utils::Logger::debug("Marginalized MSCEqF Clone element at time: " + std::to_string(timestamp));
+std::vector<fp> MSCEqFState::clonesTimestamps() const
+{
+  std::vector<fp> timestamps;
+  timestamps.reserve(clones_.size());
+  for (const auto& [timestamp, clone] : clones_)
+  {
+    timestamps.emplace_back(timestamp);
+  }
+  return timestamps;
 }
 
-const fp& MSCEqFState::cloneTimestampToMarginalize() const { return clones_.cbegin()->first; }
+const fp& MSCEqFState::oldestCloneTimestamp() const { return clones_.cbegin()->first; }
+
+const fp& MSCEqFState::cloneTimestampToMarginalize(const fp& parallax) const
+{
+  if (opts_.marginalization_policy_ == MarginalizationPolicy::OLDEST || clones_.size() < 3)
+  {
+    return oldestCloneTimestamp();
+  }
+
+  const auto newest = std::prev(clones_.cend());
+  const auto candidate = std::prev(newest);
+  const auto keyframe = std::prev(candidate);
+
+  bool is_keyframe = true;
+  switch (opts_.marginalization_policy_)
+  {
+    case MarginalizationPolicy::MOTION:
+    {
+      SE3 E = clone(keyframe->first).inv() * clone(newest->first);
+      fp translation = E.x().norm();
+      fp rotation = Eigen::AngleAxis<fp>(E.R()).angle() * 180 / M_PI;
+      is_keyframe =
+          translation > opts_.keyframe_translation_threshold_ || rotation > opts_.keyframe_rotation_threshold_;
+      break;
+    }
+    case MarginalizationPolicy::PARALLAX:
+    {
+      is_keyframe = parallax < 0 || parallax > opts_.keyframe_parallax_threshold_;
+      break;
+    }
+    default:
+      break;
+  }
+
+  if (!is_keyframe)
+  {
+    utils::Logger::debug([&]() { return "Clone at time: " + std::to_string(candidate->first) + " is not a keyframe"; });
+    return candidate->first;
+  }
+
+  return oldestCloneTimestamp();
+}
 
 bool MSCEqFState::insertStateElement(const MSCEqFStateKey& key, MSCEqFStateElementUniquePtr ptr)
 {
   assert(ptr != nullptr);
   if (state_.try_emplace(key, std::move(ptr)).second)
   {
-    utils::Logger::info("Created MSCEqF State element [" + toString(key) + "]");
+    utils::Logger::info([&]() { return "Created MSCEqF State element [" + toString(key) + "]"; });
     return true;
   }
   return false;
@@ -372,15 +523,7 @@ const MSCEqFStateElementSharedPtr& MSCEqFState::getPtr(const MSCEqFKey& key) con
   assert(key.valueless_by_exception() == false);
   if (std::holds_alternative<MSCEqFStateKey>(key))
   {
-    const auto& state_key = std::get<MSCEqFStateKey>(key);
-    if (std::holds_alternative<MSCEqFStateElementName>(state_key))
-    {
-      return state_.at(std::get<MSCEqFStateElementName>(state_key));
-    }
-    else
-    {
-      return state_.at(std::get<uint>(state_key));
-    }
+    return state_.at(std::get<MSCEqFStateKey>(key));
   }
   else
   {
@@ -388,6 +531,15 @@ const MSCEqFStateElementSharedPtr& MSCEqFState::getPtr(const MSCEqFKey& key) con
   }
 }
 
+MSCEqFState::MSCEqFStateKey MSCEqFState::cameraKey(const MSCEqFStateElementName& name, const uint& cam_id)
+{
+  if (cam_id == 0)
+  {
+    return name;
+  }
+  return MSCEqFCameraKey{name, cam_id};
+}
+
 std::string MSCEqFState::toString(const MSCEqFStateKey& key)
 {
   std::string name;
@@ -406,6 +558,11 @@ std::string MSCEqFState::toString(const MSCEqFStateKey& key)
         break;
     }
   }
+  else if (std::holds_alternative<MSCEqFCameraKey>(key))
+  {
+    const auto& camera_key = std::get<MSCEqFCameraKey>(key);
+    name = toString(camera_key.name_) + " of camera " + std::to_string(camera_key.cam_id_);
+  }
   else
   {
     name = "Scaled Orthogonal Transforms (SOT3) associated with feature id: " + std::to_string(std::get<uint>(key));
@@ -421,9 +578,9 @@ const MSCEqFState MSCEqFState::Random() const
   {
     assert(key.valueless_by_exception() == false);
 
-    if (std::holds_alternative<MSCEqFStateElementName>(key))
+    if (!std::holds_alternative<uint>(key))
     {
-      switch (std::get<MSCEqFStateElementName>(key))
+      switch (elementName(key))
       {
         case MSCEqFStateElementName::Dd:
           std::static_pointer_cast<MSCEqFSDBState>(ptr)->Dd_ =
@@ -454,9 +611,9 @@ const MSCEqFState MSCEqFState::operator*(const MSCEqFState& other) const
   {
     assert(key.valueless_by_exception() == false);
 
-    if (std::holds_alternative<MSCEqFStateElementName>(key))
+    if (!std::holds_alternative<uint>(key))
     {
-      switch (std::get<MSCEqFStateElementName>(key))
+      switch (elementName(key))
       {
         case MSCEqFStateElementName::Dd:
           std::static_pointer_cast<MSCEqFSDBState>(result.state_.at(key))
@@ -481,4 +638,10 @@ const MSCEqFState MSCEqFState::operator*(const MSCEqFState& other) const
   return result;
 }
 
+void MSCEqFState::updateLeft(const MSCEqFKey& key, const VectorX& delta)
+{
+  assert(delta.size() == getPtr(key)->getDof());
+  getPtr(key)->updateLeft(delta);
+}
+
 }  // namespace msceqf
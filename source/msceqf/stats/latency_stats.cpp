@@ -0,0 +1,147 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#include "msceqf/stats/latency_stats.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "utils/logger.hpp"
+
+namespace msceqf
+{
+const char* LatencyStats::name(const LatencyStage& stage)
+{
+  switch (stage)
+  {
+    case LatencyStage::CAMERA_MEASUREMENT:
+      return "camera_measurement";
+    case LatencyStage::PROPAGATION:
+      return "propagation";
+    case LatencyStage::TRACKING:
+      return "tracking";
+    case LatencyStage::CLONING:
+      return "cloning";
+    case LatencyStage::UPDATE:
+      return "update";
+    case LatencyStage::MARGINALIZATION:
+      return "marginalization";
+    case LatencyStage::TRACKER_PREPROCESSING:
+      return "tracker_preprocessing";
+    case LatencyStage::TRACKER_PYRAMIDS:
+      return "tracker_pyramids";
+    case LatencyStage::TRACKER_DETECTION:
+      return "tracker_detection";
+    case LatencyStage::TRACKER_OPTICAL_FLOW:
+      return "tracker_optical_flow";
+    case LatencyStage::TRACKER_RANSAC:
+      return "tracker_ransac";
+    case LatencyStage::UPDATER_TRIANGULATION:
+      return "updater_triangulation";
+    case LatencyStage::UPDATER_JACOBIANS:
+      return "updater_jacobians";
+    case LatencyStage::UPDATER_GATING:
+      return "updater_gating";
+    case LatencyStage::UPDATER_COMPRESSION:
+      return "updater_compression";
+    case LatencyStage::UPDATER_KALMAN_UPDATE:
+      return "updater_kalman_update";
+    default:
+      return "unknown";
+  }
+}
+
+const utils::latencyHistogram& LatencyStats::histogram(const LatencyStage& stage) const
+{
+#ifdef LATENCY_STATS
+  return histograms_[static_cast<size_t>(stage)];
+#else
+  static_cast<void>(stage);
+  static const utils::latencyHistogram empty;
+  return empty;
+#endif
+}
+
+LatencySummary LatencyStats::summary(const LatencyStage& stage) const
+{
+  const auto& h = histogram(stage);
+
+  LatencySummary summary;
+  summary.count_ = h.count();
+  summary.mean_ = h.mean() * 1e-6;
+  summary.min_ = h.min() * 1e-6;
+  summary.p50_ = h.percentile(50) * 1e-6;
+  summary.p90_ = h.percentile(90) * 1e-6;
+  summary.p99_ = h.percentile(99) * 1e-6;
+  summary.max_ = h.max() * 1e-6;
+  return summary;
+}
+
+void LatencyStats::reset()
+{
+#ifdef LATENCY_STATS
+  for (auto& h : histograms_)
+  {
+    h.reset();
+  }
+#endif
+}
+
+std::string LatencyStats::toCsv() const
+{
+  std::ostringstream os;
+  os << "stage,count,mean_ms,min_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+  for (size_t i = 0; enabled && i < static_cast<size_t>(LatencyStage::SIZE); ++i)
+  {
+    const auto stage = static_cast<LatencyStage>(i);
+    const auto s = summary(stage);
+    os << name(stage) << ',' << s.count_ << ',' << s.mean_ << ',' << s.min_ << ',' << s.p50_ << ',' << s.p90_ << ','
+       << s.p99_ << ',' << s.max_ << '\n';
+  }
+  return os.str();
+}
+
+std::string LatencyStats::toJson() const
+{
+  std::ostringstream os;
+  os << "{\n  \"enabled\": " << (enabled ? "true" : "false") << ",\n  \"stages\": [";
+  for (size_t i = 0; enabled && i < static_cast<size_t>(LatencyStage::SIZE); ++i)
+  {
+    const auto stage = static_cast<LatencyStage>(i);
+    const auto s = summary(stage);
+    os << (i == 0 ? "\n" : ",\n") << "    {\"stage\": \"" << name(stage) << "\", \"count\": " << s.count_
+       << ", \"mean_ms\": " << s.mean_ << ", \"min_ms\": " << s.min_ << ", \"p50_ms\": " << s.p50_
+       << ", \"p90_ms\": " << s.p90_ << ", \"p99_ms\": " << s.p99_ << ", \"max_ms\": " << s.max_ << "}";
+  }
+  os << "\n  ]\n}\n";
+  return os.str();
+}
+
+void LatencyStats::write(const std::string& filename) const
+{
+  if constexpr (!enabled)
+  {
+    utils::Logger::warn("Latency statistics not written to \"" + filename +
+                        "\", they are compiled out (ENABLE_LATENCY_STATS CMake option)");
+    return;
+  }
+
+  std::ofstream file(filename);
+  if (!file)
+  {
+    throw std::runtime_error("Error opening latency stats file: \"" + filename + "\". Exit programm.");
+  }
+
+  const bool json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+  file << (json ? toJson() : toCsv());
+}
+}  // namespace msceqf
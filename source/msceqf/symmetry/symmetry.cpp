@@ -55,6 +55,19 @@ const SystemState Symmetry::phi(const MSCEqFState& X, const SystemState& xi)
           break;
       }
     }
+    else if (std::holds_alternative<SystemState::SystemCameraKey>(key))
+    {
+      // The calibration of the secondary cameras is relative to the primary camera, hence only the right action applies
+      const auto& camera_key = std::get<SystemState::SystemCameraKey>(key);
+      if (camera_key.name_ == SystemStateElementName::S)
+      {
+        std::static_pointer_cast<CameraExtrinsicState>(ptr)->S_.multiplyRight(X.E(camera_key.cam_id_));
+      }
+      else
+      {
+        std::static_pointer_cast<CameraIntrinsicState>(ptr)->K_.multiplyRight(X.L(camera_key.cam_id_));
+      }
+    }
     else
     {
       std::static_pointer_cast<FeatureState>(ptr)->f_ =
@@ -107,6 +120,18 @@ const SystemState::SystemStateAlgebraMap Symmetry::lift(const SystemState& xi, c
           break;
       }
     }
+    else if (std::holds_alternative<SystemState::SystemCameraKey>(key))
+    {
+      // The calibration of the secondary cameras with respect to the primary camera is constant
+      if (std::get<SystemState::SystemCameraKey>(key).name_ == SystemStateElementName::S)
+      {
+        lambda[key] = Vector6::Zero();
+      }
+      else
+      {
+        lambda[key] = Vector4::Zero();
+      }
+    }
     else
     {
       // Feature expressed in camera frame and its squared depth
@@ -148,6 +173,18 @@ const MatrixX Symmetry::curvatureCorrection(const MSCEqFState& X, const VectorX&
         In::adjoint(inn.segment(X.index(MSCEqFStateElementName::L), X.dof(MSCEqFStateElementName::L)));
   }
 
+  for (uint cam_id = 1; cam_id <= X.opts().secondary_cameras_extrinsics_.size(); ++cam_id)
+  {
+    const uint& E_idx = X.index(MSCEqFState::MSCEqFCameraKey{MSCEqFStateElementName::E, cam_id});
+    Gamma.block(E_idx, E_idx, 6, 6) = SE3::adjoint(inn.segment(E_idx, 6));
+
+    if (X.opts().enable_camera_intrinsics_calibration_)
+    {
+      const uint& L_idx = X.index(MSCEqFState::MSCEqFCameraKey{MSCEqFStateElementName::L, cam_id});
+      Gamma.block(L_idx, L_idx, 4, 4) = In::adjoint(inn.segment(L_idx, 4));
+    }
+  }
+
   for (auto& [timestamp, clone] : X.clones_)
   {
     Gamma.block(clone->getIndex(), clone->getIndex(), 6, 6) =
@@ -160,4 +197,49 @@ const MatrixX Symmetry::curvatureCorrection(const MSCEqFState& X, const VectorX&
   // return MatrixX::Identity(Gamma.rows(), Gamma.rows()) + Gamma;
 }
 
+template <int n>
+void Symmetry::applyCurvatureCorrectionBlock(MSCEqFState& X, const Eigen::Index& idx, const Matrix<n, n>& Gamma)
+{
+  const Matrix<n, n> expGamma = Matrix<n, n>(-0.5 * Gamma).exp();
+  X.cov_.middleRows<n>(idx) = expGamma * X.cov_.middleRows<n>(idx);
+  X.cov_.middleCols<n>(idx) = X.cov_.middleCols<n>(idx) * expGamma.transpose();
+}
+
+void Symmetry::applyCurvatureCorrection(MSCEqFState& X, const VectorX& inn)
+{
+  const Eigen::Index D_idx = X.index(MSCEqFStateElementName::Dd);
+
+  Matrix15 Gamma_D = Matrix15::Zero();
+  Gamma_D.block<9, 9>(0, 0) = SE23::adjoint(inn.segment<9>(D_idx));
+  Gamma_D.block<6, 6>(9, 0) = SE3::adjoint(inn.segment<6>(D_idx + 9));
+  Gamma_D.block<6, 6>(9, 9) = SE3::adjoint(inn.segment<6>(D_idx));
+  applyCurvatureCorrectionBlock<15>(X, D_idx, Gamma_D);
+
+  const Eigen::Index E_idx = X.index(MSCEqFStateElementName::E);
+  applyCurvatureCorrectionBlock<6>(X, E_idx, SE3::adjoint(inn.segment<6>(E_idx)));
+
+  if (X.opts().enable_camera_intrinsics_calibration_)
+  {
+    const Eigen::Index L_idx = X.index(MSCEqFStateElementName::L);
+    applyCurvatureCorrectionBlock<4>(X, L_idx, In::adjoint(inn.segment<4>(L_idx)));
+  }
+
+  for (uint cam_id = 1; cam_id <= X.opts().secondary_cameras_extrinsics_.size(); ++cam_id)
+  {
+    const Eigen::Index Ei_idx = X.index(MSCEqFState::MSCEqFCameraKey{MSCEqFStateElementName::E, cam_id});
+    applyCurvatureCorrectionBlock<6>(X, Ei_idx, SE3::adjoint(inn.segment<6>(Ei_idx)));
+
+    if (X.opts().enable_camera_intrinsics_calibration_)
+    {
+      const Eigen::Index Li_idx = X.index(MSCEqFState::MSCEqFCameraKey{MSCEqFStateElementName::L, cam_id});
+      applyCurvatureCorrectionBlock<4>(X, Li_idx, In::adjoint(inn.segment<4>(Li_idx)));
+    }
+  }
+
+  for (auto& [timestamp, clone] : X.clones_)
+  {
+    applyCurvatureCorrectionBlock<6>(X, clone->getIndex(), SE3::adjoint(inn.segment<6>(clone->getIndex())));
+  }
+}
+
 }  // namespace msceqf
\ No newline at end of file
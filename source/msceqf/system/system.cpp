@@ -32,6 +32,7 @@ SystemState::SystemState(const StateOptions& opts, const SE23& T0, const Vector6
         SystemStateElementName::K,
         createSystemStateElement<CameraIntrinsicState>(std::make_tuple(opts_.initial_camera_intrinsics_))));
   }
+  insertSecondaryCamerasElements();
 }
 
 SystemState::SystemState(const SystemState& other) : opts_(other.opts_), state_()
@@ -68,14 +69,33 @@ SystemState::~SystemState() { state_.clear(); }
 
 void SystemState::preallocate()
 {
-  size_t num_elements = 2 + opts_.num_persistent_features_;
+  const size_t num_cameras = 1 + opts_.secondary_cameras_extrinsics_.size();
+  size_t num_elements = 2 + num_cameras + opts_.num_persistent_features_;
   if (opts_.enable_camera_intrinsics_calibration_)
   {
-    ++num_elements;
+    num_elements += num_cameras;
   }
   state_.reserve(num_elements);
 }
 
+void SystemState::insertSecondaryCamerasElements()
+{
+  for (uint cam_id = 1; cam_id <= opts_.secondary_cameras_extrinsics_.size(); ++cam_id)
+  {
+    insertSystemStateElement(std::make_pair(
+        SystemCameraKey{SystemStateElementName::S, cam_id},
+        createSystemStateElement<CameraExtrinsicState>(
+            std::make_tuple(opts_.secondary_cameras_extrinsics_.at(cam_id - 1)))));
+    if (opts_.enable_camera_intrinsics_calibration_)
+    {
+      insertSystemStateElement(std::make_pair(
+          SystemCameraKey{SystemStateElementName::K, cam_id},
+          createSystemStateElement<CameraIntrinsicState>(
+              std::make_tuple(opts_.secondary_cameras_intrinsics_.at(cam_id - 1)))));
+    }
+  }
+}
+
 void SystemState::insertSystemStateElement(std::pair<SystemStateKey, SystemStateElementUniquePtr>&& key_ptr)
 {
   assert(key_ptr.first.valueless_by_exception() == false);
@@ -83,7 +103,7 @@ void SystemState::insertSystemStateElement(std::pair<SystemStateKey, SystemState
 
   state_.insert_or_assign(key_ptr.first, std::move(key_ptr.second));
 
-  utils::Logger::info("Created System State element [" + toString(key_ptr.first) + "]");
+  utils::Logger::info([&]() { return "Created System State element [" + toString(key_ptr.first) + "]"; });
 }
 
 void SystemState::insertSystemStateElement(
@@ -138,11 +158,51 @@ const Vector4 SystemState::k() const
   }
 }
 
+const SE3& SystemState::S(const uint& cam_id) const
+{
+  if (cam_id == 0)
+  {
+    return S();
+  }
+  return std::static_pointer_cast<CameraExtrinsicState>(state_.at(SystemCameraKey{SystemStateElementName::S, cam_id}))
+      ->S_;
+}
+
+const In& SystemState::K(const uint& cam_id) const
+{
+  if (cam_id == 0)
+  {
+    return K();
+  }
+  if (opts_.enable_camera_intrinsics_calibration_)
+  {
+    return std::static_pointer_cast<CameraIntrinsicState>(state_.at(SystemCameraKey{SystemStateElementName::K, cam_id}))
+        ->K_;
+  }
+  else
+  {
+    return opts_.secondary_cameras_intrinsics_.at(cam_id - 1);
+  }
+}
+
 const Vector3& SystemState::f(const uint& feat_id) const
 {
   return std::static_pointer_cast<FeatureState>(state_.at(feat_id))->f_;
 }
 
+void SystemState::insertFeature(const uint& feat_id, const Vector3& f)
+{
+  insertSystemStateElement(std::make_pair(feat_id, createSystemStateElement<FeatureState>(std::make_tuple(f))));
+}
+
+void SystemState::removeFeature(const uint& feat_id)
+{
+  if (state_.erase(feat_id))
+  {
+    utils::Logger::info([&]() { return "Removed System State element [" + toString(feat_id) + "]"; });
+  }
+}
+
 const Vector3 SystemState::ge3() const { return opts_.gravity_ * Vector3(0, 0, -1); }
 
 std::string SystemState::toString(const SystemStateKey& key)
@@ -166,6 +226,11 @@ std::string SystemState::toString(const SystemStateKey& key)
         break;
     }
   }
+  else if (std::holds_alternative<SystemCameraKey>(key))
+  {
+    const auto& camera_key = std::get<SystemCameraKey>(key);
+    name = toString(camera_key.name_) + " of camera " + std::to_string(camera_key.cam_id_);
+  }
   else
   {
     name = "Persistent feature (f) with id: " + std::to_string(std::get<uint>(key));
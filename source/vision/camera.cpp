@@ -11,6 +11,7 @@
 
 #include "vision/camera.hpp"
 
+#include <cmath>
 #include <opencv2/core/eigen.hpp>
 
 namespace msceqf
@@ -136,6 +137,19 @@ void RadtanCamera::undistort(std::vector<cv::Point2f>& uv_cv, const bool& normal
   }
 }
 
+void RadtanCamera::unproject(const std::vector<cv::Point2f>& uv_cv, FeaturesBearings& bearings)
+{
+  std::vector<cv::Point2f> uvn_cv(uv_cv);
+  undistort(uvn_cv, true);
+
+  bearings.resize(uvn_cv.size());
+  for (size_t i = 0; i < uvn_cv.size(); ++i)
+  {
+    const fp norm = std::sqrt(uvn_cv[i].x * uvn_cv[i].x + uvn_cv[i].y * uvn_cv[i].y + 1.0);
+    bearings[i] = cv::Point3f(uvn_cv[i].x / norm, uvn_cv[i].y / norm, 1.0 / norm);
+  }
+}
+
 void RadtanCamera::undistortImage(const cv::Mat& image, cv::Mat& image_undistorted)
 {
   cv::Vec<fp, 4> dist_cv;
@@ -180,6 +194,46 @@ void EquidistantCamera::undistort(std::vector<cv::Point2f>& uv_cv, const bool& n
   }
 }
 
+void EquidistantCamera::unproject(const std::vector<cv::Point2f>& uv_cv, FeaturesBearings& bearings)
+{
+  const fp k1 = distortion_coefficients_(0);
+  const fp k2 = distortion_coefficients_(1);
+  const fp k3 = distortion_coefficients_(2);
+  const fp k4 = distortion_coefficients_(3);
+
+  bearings.resize(uv_cv.size());
+  for (size_t i = 0; i < uv_cv.size(); ++i)
+  {
+    const fp x = (uv_cv[i].x - intrinsics_(2)) / intrinsics_(0);
+    const fp y = (uv_cv[i].y - intrinsics_(3)) / intrinsics_(1);
+    const fp theta_d = std::sqrt(x * x + y * y);
+
+    if (theta_d < 1e-8)
+    {
+      bearings[i] = cv::Point3f(x, y, 1.0);
+      continue;
+    }
+
+    // Solve theta_d = theta * (1 + k1 * theta^2 + k2 * theta^4 + k3 * theta^6 + k4 * theta^8) with Newton iterations
+    fp theta = theta_d;
+    for (int iter = 0; iter < 10; ++iter)
+    {
+      const fp theta2 = theta * theta;
+      const fp f = theta * (1 + theta2 * (k1 + theta2 * (k2 + theta2 * (k3 + theta2 * k4)))) - theta_d;
+      const fp df = 1 + theta2 * (3 * k1 + theta2 * (5 * k2 + theta2 * (7 * k3 + theta2 * 9 * k4)));
+      const fp step = f / df;
+      theta -= step;
+      if (std::abs(step) < 1e-10)
+      {
+        break;
+      }
+    }
+
+    const fp s = std::sin(theta) / theta_d;
+    bearings[i] = cv::Point3f(s * x, s * y, std::cos(theta));
+  }
+}
+
 void EquidistantCamera::undistortImage(const cv::Mat& image, cv::Mat& image_undistorted)
 {
   cv::Vec<fp, 4> dist_cv;
@@ -0,0 +1,151 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#include "vision/feature_budget.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace msceqf
+{
+std::string TrackerTimings::toString() const
+{
+  std::ostringstream os;
+  os << "preprocessing: " << preprocessing_ << " ms, pyramids: " << pyramids_ << " ms, detection: " << detection_
+     << " ms, optical flow: " << optical_flow_ << " ms, ransac: " << ransac_ << " ms, total: " << total_ << " ms";
+  return os.str();
+}
+
+std::string FeatureBudget::toString() const
+{
+  std::ostringstream os;
+  os << "max features: " << max_features_ << ", min features: " << min_features_
+     << ", detector pyramid levels: " << detector_pyramid_levels_
+     << ", optical flow window size: " << optical_flow_win_size_;
+  return os.str();
+}
+
+FeatureBudgetController::FeatureBudgetController(const TrackerOptions& opts)
+    : opts_(opts.budget_opts_)
+    , upper_()
+    , lower_()
+    , budget_()
+    , min_features_ratio_(1.0)
+    , features_step_(1)
+    , frame_time_(0)
+    , init_(false)
+{
+  upper_.max_features_ = opts.max_features_;
+  upper_.min_features_ = opts.min_features_;
+  upper_.detector_pyramid_levels_ = opts.detector_pyramid_levels_;
+  upper_.optical_flow_win_size_ = opts.optical_flow_win_size_;
+
+  lower_.max_features_ = std::clamp(opts_.min_max_features_, uint(1), upper_.max_features_);
+  lower_.detector_pyramid_levels_ =
+      std::clamp(opts_.min_detector_pyramid_levels_, uint(1), upper_.detector_pyramid_levels_);
+  lower_.optical_flow_win_size_ = std::clamp(opts_.min_optical_flow_win_size_, uint(3), upper_.optical_flow_win_size_);
+
+  min_features_ratio_ = upper_.max_features_ > 0 ? static_cast<fp>(upper_.min_features_) / upper_.max_features_ : 1.0;
+  lower_.min_features_ = static_cast<uint>(std::round(min_features_ratio_ * lower_.max_features_));
+
+  features_step_ = std::max(uint(1), upper_.max_features_ / 10);
+
+  opts_.smoothing_ = std::clamp(opts_.smoothing_, fp(1e-3), fp(1.0));
+  opts_.tolerance_ = std::max(opts_.tolerance_, fp(0.0));
+
+  budget_ = upper_;
+}
+
+bool FeatureBudgetController::update(const TrackerTimings& timings)
+{
+  if (!opts_.enable_ || opts_.target_frame_time_ <= 0)
+  {
+    return false;
+  }
+
+  if (!init_)
+  {
+    frame_time_ = timings.total_;
+    init_ = true;
+  }
+  else
+  {
+    frame_time_ = opts_.smoothing_ * timings.total_ + (1.0 - opts_.smoothing_) * frame_time_;
+  }
+
+  if (frame_time_ > (1.0 + opts_.tolerance_) * opts_.target_frame_time_)
+  {
+    return decrease();
+  }
+
+  if (frame_time_ < (1.0 - opts_.tolerance_) * opts_.target_frame_time_)
+  {
+    return increase();
+  }
+
+  return false;
+}
+
+bool FeatureBudgetController::decrease()
+{
+  if (budget_.max_features_ > lower_.max_features_)
+  {
+    budget_.max_features_ =
+        std::max(lower_.max_features_, budget_.max_features_ - std::min(features_step_, budget_.max_features_));
+    budget_.min_features_ = static_cast<uint>(std::round(min_features_ratio_ * budget_.max_features_));
+    return true;
+  }
+
+  if (budget_.detector_pyramid_levels_ > lower_.detector_pyramid_levels_)
+  {
+    --budget_.detector_pyramid_levels_;
+    return true;
+  }
+
+  if (budget_.optical_flow_win_size_ >= lower_.optical_flow_win_size_ + win_step_)
+  {
+    budget_.optical_flow_win_size_ -= win_step_;
+    return true;
+  }
+
+  return false;
+}
+
+bool FeatureBudgetController::increase()
+{
+  if (budget_.optical_flow_win_size_ + win_step_ <= upper_.optical_flow_win_size_)
+  {
+    budget_.optical_flow_win_size_ += win_step_;
+    return true;
+  }
+
+  if (budget_.detector_pyramid_levels_ < upper_.detector_pyramid_levels_)
+  {
+    ++budget_.detector_pyramid_levels_;
+    return true;
+  }
+
+  if (budget_.max_features_ < upper_.max_features_)
+  {
+    budget_.max_features_ = std::min(upper_.max_features_, budget_.max_features_ + features_step_);
+    budget_.min_features_ = static_cast<uint>(std::round(min_features_ratio_ * budget_.max_features_));
+    return true;
+  }
+
+  return false;
+}
+
+const FeatureBudget& FeatureBudgetController::budget() const { return budget_; }
+
+const fp& FeatureBudgetController::frameTime() const { return frame_time_; }
+
+}  // namespace msceqf
@@ -15,52 +15,152 @@
 
 namespace msceqf
 {
-TrackManager::TrackManager(const TrackManagerOptions& opts, const Vector4& intrinsics)
-    : tracker_(opts.tracker_options_, intrinsics), tracks_(), max_track_length_(opts.max_track_length_)
+TrackManager::TrackManager(const TrackManagerOptions& opts,
+                           const Vector4& intrinsics,
+                           const std::vector<In>& secondary_intrinsics,
+                           const std::shared_ptr<utils::threadPool>& executor,
+                           const std::shared_ptr<LatencyStats>& stats)
+    : tracker_(opts.tracker_options_, intrinsics)
+    , secondary_trackers_()
+    , tracks_()
+    , disparity_statistics_()
+    , executor_(executor)
+    , stats_(stats)
+    , max_track_length_(opts.max_track_length_)
 {
+  if (opts.secondary_trackers_options_.size() != secondary_intrinsics.size())
+  {
+    throw std::runtime_error("Secondary cameras options and intrinsics mismatch");
+  }
+
+  for (size_t i = 0; i < secondary_intrinsics.size(); ++i)
+  {
+    secondary_trackers_.emplace_back(
+        std::make_unique<Tracker>(opts.secondary_trackers_options_[i], secondary_intrinsics[i].k()));
+  }
 }
 
 void TrackManager::processCamera(Camera& cam)
 {
   tracker_.processCamera(cam);
-  updateTracks();
+  recordTimings(tracker_);
+  updateTracks(tracker_, 0);
+}
+
+void TrackManager::processCameras(std::vector<Camera>& cams)
+{
+  if (cams.size() != numCameras())
+  {
+    throw std::runtime_error("Expected " + std::to_string(numCameras()) + " camera measurements, received " +
+                             std::to_string(cams.size()));
+  }
+
+  // Secondary cameras are tracked on the executor (if any) while the primary camera is tracked in the calling thread
+  std::vector<utils::pooledTask<void>> tasks;
+  if (executor_)
+  {
+    tasks.reserve(secondary_trackers_.size());
+    for (size_t i = 0; i < secondary_trackers_.size(); ++i)
+    {
+      tasks.emplace_back(executor_->async([&, i]() { secondary_trackers_[i]->processCamera(cams[i + 1]); }));
+    }
+  }
+
+  tracker_.processCamera(cams.front());
+
+  for (size_t i = 0; i < secondary_trackers_.size(); ++i)
+  {
+    if (executor_)
+    {
+      tasks[i].get();
+    }
+    else
+    {
+      secondary_trackers_[i]->processCamera(cams[i + 1]);
+    }
+  }
+
+  recordTimings(tracker_);
+  updateTracks(tracker_, 0);
+  for (size_t i = 0; i < secondary_trackers_.size(); ++i)
+  {
+    recordTimings(*secondary_trackers_[i]);
+    updateTracks(*secondary_trackers_[i], i + 1);
+  }
 }
 
 void TrackManager::processFeatures(const TriangulatedFeatures& features)
 {
-  if (features.features_.empty())
+  const auto& batch = features.features_;
+
+  if (batch.empty())
   {
     utils::Logger::warn("Impossible to update tracks. No features has been given");
     return;
   }
 
+  assert(batch.uvs_.size() == batch.ids_.size());
+  assert(batch.normalized_uvs_.size() == batch.ids_.size());
+
+  const bool points = features.points_.size() == batch.ids_.size();
+  if (!points && !features.points_.empty())
+  {
+    utils::Logger::warn("Number of points and features mismatch. Points are ignored");
+  }
+  const bool bearings = batch.bearings_.size() == batch.ids_.size();
+
+  // Reserve buckets for the whole batch, such that new tracks do not trigger rehashing
+  tracks_.reserve(tracks_.size() + batch.ids_.size());
+
   // for each feature/id either initialize a new track or update the existing track associated to the id
-  assert(features.features_.size() == features.points_.size());
-  for (size_t i = 0; i < features.features_.size(); ++i)
+  for (size_t i = 0; i < batch.ids_.size(); ++i)
   {
-    auto& uv = features.features_.uvs_[i];
-    auto& uvn = features.features_.normalized_uvs_[i];
-    auto& id = features.features_.ids_[i];
+    auto [it, inserted] = tracks_.try_emplace(trackId(batch.ids_[i], 0));
+    auto& track_ref = it->second;
+    track_ref.cam_id_ = 0;
+    disparity_statistics_.remove(track_ref);
 
-    // Initialize new element into tracks or extend existing track
-    auto& track_ref = tracks_.try_emplace(id, Track()).first->second;
-    track_ref.uvs_.emplace_back(uv);
-    track_ref.normalized_uvs_.emplace_back(uvn);
-    track_ref.timestamps_.emplace_back(features.timestamp_);
+    // Preallocate new tracks to their maximum length (Keep memory bounded and avoid reallocations)
+    if (inserted)
+    {
+      track_ref.reserve(max_track_length_ + 1, points, bearings);
+    }
+
+    // Points and bearings are kept only if they are given for every coordinate of the track
+    if (!points || track_ref.points_.size() != track_ref.size())
+    {
+      track_ref.points_.clear();
+    }
+    if (!bearings || track_ref.bearings_.size() != track_ref.size())
+    {
+      track_ref.bearings_.clear();
+    }
 
     // Remove tracks that are too long (Keep memory bounded)
-    if (track_ref.size() > max_track_length_)
+    if (track_ref.size() == max_track_length_)
     {
-      // utils::Logger::warn("Max track (id: " + std::to_string(id) + ") length reached, removing track tail");
-      track_ref.uvs_.erase(track_ref.uvs_.begin());
-      track_ref.normalized_uvs_.erase(track_ref.normalized_uvs_.begin());
-      track_ref.timestamps_.erase(track_ref.timestamps_.begin());
+      track_ref.removeFront();
+    }
+
+    track_ref.uvs_.emplace_back(batch.uvs_[i]);
+    track_ref.normalized_uvs_.emplace_back(batch.normalized_uvs_[i]);
+    track_ref.timestamps_.emplace_back(features.timestamp_);
+    if (points && track_ref.points_.size() + 1 == track_ref.uvs_.size())
+    {
+      track_ref.points_.emplace_back(features.points_[i]);
+    }
+    if (bearings && track_ref.bearings_.size() + 1 == track_ref.uvs_.size())
+    {
+      track_ref.bearings_.emplace_back(batch.bearings_[i]);
     }
+    disparity_statistics_.add(track_ref);
   }
 }
 
 const Tracks& TrackManager::tracks() const { return tracks_; }
 
+const DisparityStatistics& TrackManager::disparityStatistics() const { return disparity_statistics_; }
+
 void TrackManager::tracksIds(const fp& timestamp,
                              std::unordered_set<uint>& active_ids,
                              std::unordered_set<uint>& lost_ids) const
@@ -111,6 +211,7 @@ void TrackManager::removeTracksId(const std::unordered_set<uint>& ids)
   {
     if (ids.count(it->first))
     {
+      disparity_statistics_.remove(it->second);
       it = tracks_.erase(it);
     }
     else
@@ -124,6 +225,7 @@ void TrackManager::removeTracksTail(const fp& timestamp, const bool& remove_equa
 {
   for (auto it = tracks_.begin(); it != tracks_.end();)
   {
+    disparity_statistics_.remove(it->second);
     if (remove_equal && it->second.size() == 1 && it->second.timestamps_.front() == timestamp)
     {
       it = tracks_.erase(it);
@@ -131,14 +233,71 @@ void TrackManager::removeTracksTail(const fp& timestamp, const bool& remove_equa
     else
     {
       it->second.removeTail(timestamp, remove_equal);
+      disparity_statistics_.add(it->second);
       ++it;
     }
   }
 }
 
-void TrackManager::updateTracks()
+void TrackManager::removeTracksTail(const std::unordered_set<uint>& ids, const fp& timestamp, const bool& remove_equal)
 {
-  auto& current_features = tracker_.currentFeatures();
+  for (const auto& id : ids)
+  {
+    auto it = tracks_.find(id);
+    if (it == tracks_.end())
+    {
+      continue;
+    }
+
+    disparity_statistics_.remove(it->second);
+    if (remove_equal && it->second.size() == 1 && it->second.timestamps_.front() == timestamp)
+    {
+      tracks_.erase(it);
+    }
+    else
+    {
+      it->second.removeTail(timestamp, remove_equal);
+      disparity_statistics_.add(it->second);
+    }
+  }
+}
+
+void TrackManager::removeTracksAt(const fp& timestamp)
+{
+  for (auto it = tracks_.begin(); it != tracks_.end();)
+  {
+    disparity_statistics_.remove(it->second);
+    it->second.removeAt(timestamp);
+    if (it->second.empty())
+    {
+      it = tracks_.erase(it);
+    }
+    else
+    {
+      disparity_statistics_.add(it->second);
+      ++it;
+    }
+  }
+}
+
+void TrackManager::recordTimings(const Tracker& tracker) const
+{
+  const auto& timings = tracker.timings();
+  LatencyStats::record(stats_, LatencyStage::TRACKER_PREPROCESSING, timings.preprocessing_);
+  LatencyStats::record(stats_, LatencyStage::TRACKER_PYRAMIDS, timings.pyramids_);
+  LatencyStats::record(stats_, LatencyStage::TRACKER_DETECTION, timings.detection_);
+
+  // Optical flow and RANSAC do not run on frames where features are only detected (e.g. the first frame)
+  if (timings.tracked_)
+  {
+    LatencyStats::record(stats_, LatencyStage::TRACKER_OPTICAL_FLOW, timings.optical_flow_);
+    LatencyStats::record(stats_, LatencyStage::TRACKER_RANSAC, timings.ransac_);
+  }
+}
+
+void TrackManager::updateTracks(const Tracker& tracker, const uint& cam_id)
+{
+  auto& current_features = tracker.currentFeatures();
 
   if (current_features.second.empty())
   {
@@ -146,30 +305,49 @@ void TrackManager::updateTracks()
     return;
   }
 
+  const bool bearings = !current_features.second.bearings_.empty();
+
   // for each feature/id either initialize a new track or update the existing track associated to the id
   for (size_t i = 0; i < current_features.second.size(); ++i)
   {
     auto& uv = current_features.second.uvs_[i];
     auto& uvn = current_features.second.normalized_uvs_[i];
-    auto& id = current_features.second.ids_[i];
+    const uint id = trackId(current_features.second.ids_[i], cam_id);
 
     // Initialize new element into tracks or extend existing track
     auto& track_ref = tracks_.try_emplace(id, Track()).first->second;
+    disparity_statistics_.remove(track_ref);
     track_ref.uvs_.emplace_back(uv);
     track_ref.normalized_uvs_.emplace_back(uvn);
     track_ref.timestamps_.emplace_back(current_features.first);
+    track_ref.cam_id_ = cam_id;
+
+    // Bearings are kept only if available for all the coordinates of the track
+    if (bearings && track_ref.bearings_.size() + 1 == track_ref.uvs_.size())
+    {
+      track_ref.bearings_.emplace_back(current_features.second.bearings_[i]);
+    }
+    else
+    {
+      track_ref.bearings_.clear();
+    }
 
     // Remove tracks that are too long (Keep memory bounded)
     if (track_ref.size() > max_track_length_)
     {
       // utils::Logger::warn("Max track (id: " + std::to_string(id) + ") length reached, removing track tail");
-      track_ref.uvs_.erase(track_ref.uvs_.begin());
-      track_ref.normalized_uvs_.erase(track_ref.normalized_uvs_.begin());
-      track_ref.timestamps_.erase(track_ref.timestamps_.begin());
+      track_ref.removeFront();
     }
+    disparity_statistics_.add(track_ref);
   }
 }
 
+const Tracker::TimedFeatures& TrackManager::currentFeatures() const { return tracker_.currentFeatures(); }
+
 const PinholeCameraUniquePtr& TrackManager::cam() const { return tracker_.cam(); }
 
+const TrackerTimings& TrackManager::trackerTimings() const { return tracker_.timings(); }
+
+const FeatureBudget& TrackManager::featureBudget() const { return tracker_.budget(); }
+
 }  // namespace msceqf
@@ -13,6 +13,7 @@
 
 #include "utils/logger.hpp"
 #include "utils/tools.hpp"
+#include "utils/trace_recorder.hpp"
 
 namespace msceqf
 {
@@ -20,22 +21,24 @@ Tracker::Tracker(const TrackerOptions& opts, const Vector4& intrinsics)
     : opts_(opts)
     , cam_()
     , detector_()
+    , clahe_()
     , max_kpts_per_cell_()
     , id_(0)
     , feature_mask_(opts_.cam_options_.static_mask_)
+    , image_()
     , previous_pyramids_()
     , previous_features_()
     , current_pyramids_()
     , current_features_()
     , win_(cv::Size(opts_.optical_flow_win_size_, opts_.optical_flow_win_size_))
+    , pyramid_win_(win_)
+    , budget_controller_(opts_)
+    , timings_()
 {
   assert(feature_mask_.size() == cv::Size(opts_.cam_options_.resolution_(0), opts_.cam_options_.resolution_(1)));
   assert(opts_.optical_flow_pyramid_levels_ > 0);
   assert(opts_.detector_pyramid_levels_ > 0);
 
-  cv::setNumThreads(opts_.opencv_threads_);
-  utils::Logger::info("Set OpenCV threads to: " + std::to_string(cv::getNumThreads()));
-
   // Deep copy allocate new memory
   feature_mask_ = feature_mask_.clone();
 
@@ -90,6 +93,14 @@ Tracker::Tracker(const TrackerOptions& opts, const Vector4& intrinsics)
       break;
   }
 
+  if (opts_.equalizer_ == EqualizationMethod::CLAHE)
+  {
+    clahe_ = cv::createCLAHE();
+  }
+
+  // Bounds of the adaptive feature budget are the (limited) tracker options
+  budget_controller_ = FeatureBudgetController(opts_);
+
   assert(cam_ != nullptr);
   assert(!detector_.empty());
 }
@@ -98,9 +109,13 @@ void Tracker::processCamera(Camera& cam)
 {
   assert(!cam.image_.empty());
 
+  const auto start = std::chrono::steady_clock::now();
+
+  // Pre-processing writes into the tracker owned buffer, the input image is never modified
   if (cam.image_.channels() > 1)
   {
-    cv::cvtColor(cam.image_, cam.image_, cv::COLOR_BGR2GRAY);
+    cv::cvtColor(cam.image_, image_, cv::COLOR_BGR2GRAY);
+    cam.image_ = image_;
   }
 
   switch (opts_.equalizer_)
@@ -108,42 +123,72 @@ void Tracker::processCamera(Camera& cam)
     case EqualizationMethod::NONE:
       break;
     case EqualizationMethod::HISTOGRAM:
-      cv::equalizeHist(cam.image_, cam.image_);
+      cv::equalizeHist(cam.image_, image_);
+      cam.image_ = image_;
       break;
     case EqualizationMethod::CLAHE:
-      cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE();
-      clahe->apply(cam.image_, cam.image_);
+      clahe_->apply(cam.image_, image_);
+      cam.image_ = image_;
       break;
   }
 
+  timings_.preprocessing_ = utils::tracedMilliseconds("tracker_preprocessing", start);
+
   track(cam);
+
+  timings_.total_ = utils::elapsedMilliseconds(start, std::chrono::steady_clock::now());
+
+  if (opts_.budget_opts_.enable_ && budget_controller_.update(timings_))
+  {
+    applyBudget();
+  }
 }
 
 void Tracker::track(Camera& cam)
 {
+  using clock = std::chrono::steady_clock;
+
   // Assign timestamp
   current_features_.first = cam.timestamp_;
 
   // Update opts_.optical_flow_pyramid_levels_ with the actual number of pyramid levels
   // (opts_.optical_flow_pyramid_levels_ - 1) is given since maxLevel is 0-based in buildOpticalFlowPyramid
+  // Pyramids are always built with the largest window, so that the optical flow window can be adapted at runtime
+  auto t = clock::now();
+  const int max_level = opts_.optical_flow_pyramid_levels_ - 1;
   opts_.optical_flow_pyramid_levels_ =
-      cv::buildOpticalFlowPyramid(cam.image_, current_pyramids_, win_, opts_.optical_flow_pyramid_levels_ - 1) + 1;
+      cv::buildOpticalFlowPyramid(cam.image_, current_pyramids_, pyramid_win_, max_level) + 1;
+  timings_.pyramids_ = utils::tracedMilliseconds("tracker_pyramids", t);
 
   // Copy data (do not allocate new memory)
   cam.mask_.copyTo(feature_mask_);
 
   if (previous_features_.second.empty())
   {
+    t = clock::now();
     detect(current_pyramids_, feature_mask_, current_features_.second);
+    timings_.detection_ = utils::tracedMilliseconds("tracker_detection", t);
+    timings_.optical_flow_ = 0;
+    timings_.ransac_ = 0;
+    timings_.tracked_ = false;
   }
   else
   {
     std::vector<uchar> klt_mask;
     std::vector<uchar> ransac_mask;
 
+    t = clock::now();
     detect(previous_pyramids_, feature_mask_, previous_features_.second);
+    timings_.detection_ = utils::tracedMilliseconds("tracker_detection", t);
+
+    t = clock::now();
     matchKLT(klt_mask);
+    timings_.optical_flow_ = utils::tracedMilliseconds("tracker_optical_flow", t);
+
+    t = clock::now();
     ransac(ransac_mask);
+    timings_.ransac_ = utils::tracedMilliseconds("tracker_ransac", t);
+    timings_.tracked_ = true;
 
     // Check if there are invalid features
     assert(klt_mask.size() == ransac_mask.size());
@@ -151,7 +196,9 @@ void Tracker::track(Camera& cam)
     bool found_invalid = false;
     for (size_t i = 0; i < invalid.size(); i++)
     {
-      auto& uv = current_features_.second.uvs_[i];
+      // Bounds are checked on the distorted coordinates, the undistorted coordinates of wide angle features can be
+      // outside the image
+      auto& uv = current_features_.second.distorted_uvs_[i];
       found_invalid |= (invalid[i] = !klt_mask[i] || !ransac_mask[i] || uv.x < 0 || uv.y < 0 ||
                                      uv.x > current_pyramids_[0].cols || uv.y > current_pyramids_[0].rows);
     }
@@ -170,6 +217,27 @@ void Tracker::track(Camera& cam)
   previous_features_ = current_features_;
 }
 
+void Tracker::applyBudget()
+{
+  const auto& budget = budget_controller_.budget();
+
+  opts_.max_features_ = budget.max_features_;
+  opts_.min_features_ = budget.min_features_;
+  opts_.detector_pyramid_levels_ = budget.detector_pyramid_levels_;
+  opts_.optical_flow_win_size_ = budget.optical_flow_win_size_;
+  win_ = cv::Size(opts_.optical_flow_win_size_, opts_.optical_flow_win_size_);
+
+  if (opts_.detector_ == FeatureDetector::GFTT)
+  {
+    detector_.dynamicCast<cv::GFTTDetector>()->setMaxFeatures(opts_.max_features_);
+  }
+
+  utils::Logger::info([&]() {
+    return "Feature budget adapted (frame time: " + std::to_string(budget_controller_.frameTime()) + " ms) to " +
+           budget.toString();
+  });
+}
+
 void Tracker::detect(std::vector<cv::Mat>& pyramids, cv::Mat& mask, Features& features)
 {
   // Return if we have enough features
@@ -225,7 +293,12 @@ void Tracker::detect(std::vector<cv::Mat>& pyramids, cv::Mat& mask, Features& fe
 
     // Parallel feature extraction for each cell of the grid.
     // Re-computation of max_kpts_per_cell_ based on how many feature have been extracted in previous cells.
+    // OpenCV worker threads trace the range of cells they process into the trace recorder of the calling thread
+    utils::traceRecorder* recorder = utils::traceRecorder::current();
     cv::parallel_for_(cv::Range(0, opts_.grid_x_size_ * opts_.grid_y_size_), [&](const cv::Range& range) {
+      utils::traceScope trace_scope(recorder);
+      utils::traceSpan span("tracker_detection_cells");
+
       for (int cell_idx = range.start; cell_idx < range.end; ++cell_idx)
       {
         cell_kpts[cell_idx].clear();
@@ -290,6 +363,10 @@ void Tracker::detect(std::vector<cv::Mat>& pyramids, cv::Mat& mask, Features& fe
   FeaturesCoordinates normalized_detected_flat(undistorted_detected_flat);
   cam_->normalize(normalized_detected_flat);
 
+  // Unproject
+  FeaturesBearings detected_bearings;
+  cam_->unproject(detected_flat, detected_bearings);
+
   // Return if no keypoints has been found
   if (detected_flat.empty())
   {
@@ -304,6 +381,13 @@ void Tracker::detect(std::vector<cv::Mat>& pyramids, cv::Mat& mask, Features& fe
   features.uvs_.reserve(total_size);
   features.normalized_uvs_.reserve(total_size);
 
+  // Bearings are kept only if available for all the existing features
+  const bool bearings = features.bearings_.size() == features.distorted_uvs_.size();
+  if (bearings)
+  {
+    features.bearings_.reserve(total_size);
+  }
+
   // Append newly detected features to existing
   features.distorted_uvs_.insert(features.distorted_uvs_.end(), std::make_move_iterator(detected_flat.begin()),
                                  std::make_move_iterator(detected_flat.end()));
@@ -312,6 +396,11 @@ void Tracker::detect(std::vector<cv::Mat>& pyramids, cv::Mat& mask, Features& fe
   features.normalized_uvs_.insert(features.normalized_uvs_.end(),
                                   std::make_move_iterator(normalized_detected_flat.begin()),
                                   std::make_move_iterator(normalized_detected_flat.end()));
+  if (bearings)
+  {
+    features.bearings_.insert(features.bearings_.end(), std::make_move_iterator(detected_bearings.begin()),
+                              std::make_move_iterator(detected_bearings.end()));
+  }
 
   // Assign id to newly detected features
   features.ids_.reserve(total_size);
@@ -373,11 +462,12 @@ void Tracker::matchKLT(std::vector<uchar>& mask)
                            current_features_.second.distorted_uvs_, mask, error, win_,
                            opts_.optical_flow_pyramid_levels_ - 1, criteria, cv::OPTFLOW_USE_INITIAL_FLOW);
 
-  // Undistort and Normalize tracked features
+  // Undistort, Normalize and Unproject tracked features
   current_features_.second.uvs_ = current_features_.second.distorted_uvs_;
   cam_->undistort(current_features_.second.uvs_);
   current_features_.second.normalized_uvs_ = current_features_.second.uvs_;
   cam_->normalize(current_features_.second.normalized_uvs_);
+  cam_->unproject(current_features_.second.distorted_uvs_, current_features_.second.bearings_);
 }
 
 void Tracker::ransac(std::vector<uchar>& mask)
@@ -399,4 +489,8 @@ const Tracker::TimedFeatures& Tracker::currentFeatures() const { return current_
 
 const PinholeCameraUniquePtr& Tracker::cam() const { return cam_; }
 
+const TrackerTimings& Tracker::timings() const { return timings_; }
+
+const FeatureBudget& Tracker::budget() const { return budget_controller_.budget(); }
+
 }  // namespace msceqf
\ No newline at end of file
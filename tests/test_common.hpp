@@ -19,6 +19,7 @@
 
 #include <Eigen/Dense>
 
+#include "msceqf/options/msceqf_option_parser.hpp"
 #include "msceqf/state/state.hpp"
 
 namespace msceqf
@@ -28,6 +29,17 @@ const std::string parameters_path = "../../tests/config/parameters.yaml";
 constexpr fp EPS = 1e-6;
 constexpr int N_TESTS = 100;
 
+/**
+ * @brief Parse the MSCEqF options from the test parameters file
+ *
+ * @return MSCEqF options
+ */
+MSCEqFOptions parseTestOptions()
+{
+  OptionParser parser(parameters_path);
+  return parser.parseOptions();
+}
+
 template <typename Derived, typename OtherDerived>
 void MatrixEquality(const Eigen::MatrixBase<Derived>& A, const Eigen::MatrixBase<OtherDerived>& B, fp tol = EPS)
 {
@@ -59,6 +71,13 @@ void SystemStateEquality(const msceqf::SystemState& xi1,
     MatrixEquality(xi1.K().asMatrix(), xi2.K().asMatrix(), tol);
   }
 
+  assert(xi1.opts().secondary_cameras_extrinsics_.size() == xi2.opts().secondary_cameras_extrinsics_.size());
+  for (uint cam_id = 1; cam_id <= xi1.opts().secondary_cameras_extrinsics_.size(); ++cam_id)
+  {
+    MatrixEquality(xi1.S(cam_id).asMatrix(), xi2.S(cam_id).asMatrix(), tol);
+    MatrixEquality(xi1.K(cam_id).asMatrix(), xi2.K(cam_id).asMatrix(), tol);
+  }
+
   for (const auto& id : feat_ids)
   {
     MatrixEquality(xi1.f(id), xi2.f(id), tol);
@@ -84,6 +103,20 @@ void MSCEqFStateEquality(const msceqf::MSCEqFState& X1,
     MatrixEquality(X1.covBlock(msceqf::MSCEqFStateElementName::L), X2.covBlock(msceqf::MSCEqFStateElementName::L), tol);
   }
 
+  assert(X1.opts().secondary_cameras_extrinsics_.size() == X2.opts().secondary_cameras_extrinsics_.size());
+  for (uint cam_id = 1; cam_id <= X1.opts().secondary_cameras_extrinsics_.size(); ++cam_id)
+  {
+    const auto E_key = msceqf::MSCEqFState::cameraKey(msceqf::MSCEqFStateElementName::E, cam_id);
+    MatrixEquality(X1.E(cam_id).asMatrix(), X2.E(cam_id).asMatrix(), tol);
+    MatrixEquality(X1.covBlock(E_key), X2.covBlock(E_key), tol);
+    if (X1.opts().enable_camera_intrinsics_calibration_)
+    {
+      const auto L_key = msceqf::MSCEqFState::cameraKey(msceqf::MSCEqFStateElementName::L, cam_id);
+      MatrixEquality(X1.L(cam_id).asMatrix(), X2.L(cam_id).asMatrix(), tol);
+      MatrixEquality(X1.covBlock(L_key), X2.covBlock(L_key), tol);
+    }
+  }
+
   for (const auto& id : feat_ids)
   {
     MatrixEquality(X1.Q(id).asMatrix(), X2.Q(id).asMatrix(), tol);
@@ -0,0 +1,273 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_DATA_PARSER_HPP
+#define TEST_DATA_PARSER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <sstream>
+
+#include "utils/data_parser.hpp"
+#include "utils/sequence_cache.hpp"
+
+namespace msceqf
+{
+const std::string trajectory_path = "../../tests/data/noisefree_trajectory.csv";
+
+const std::vector<std::string> trajectory_imu_header = {"t", "w_x", "w_y", "w_z", "a_x", "a_y", "a_z"};
+
+/**
+ * @brief Parse a single line with the legacy line parser (stringstream tokenization and regex based validation)
+ *
+ * @param line Line
+ * @param delimiter Delimiter
+ * @param regex Regex every field has to match
+ * @param data Parsed fields
+ */
+template <typename T>
+void parseLegacyLine(const std::string& line, const char& delimiter, const std::regex& regex, std::vector<T>& data)
+{
+  std::stringstream ss(line);
+  std::string s;
+
+  while (std::getline(ss, s, delimiter))
+  {
+    if (s == "#")
+    {
+      continue;
+    }
+    if (!s.empty() && s.back() == '\r')
+    {
+      s.pop_back();
+    }
+    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+    if (!std::regex_match(s, regex))
+    {
+      throw std::runtime_error("Regex match fail. Exit programm.");
+    }
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      data.emplace_back(s == "nan" ? std::numeric_limits<fp>::quiet_NaN() : std::stod(s));
+    }
+    else
+    {
+      data.emplace_back(s);
+    }
+  }
+}
+
+/**
+ * @brief Parse a whole file of numbers with the legacy line parser, used as reference for the fast parser
+ *
+ * @param filename Name of the file
+ * @param delimiter Delimiter
+ * @return Parsed columns
+ */
+utils::csvColumns parseLegacyCsv(const std::string& filename, const char& delimiter)
+{
+  const std::regex any("^.*$");
+  const std::regex number("^[+-]?((\\d*\\.\\d+)|(\\d+\\.\\d*)|(\\d+))([eE][+-]?\\d+)?|^nan$");
+
+  std::ifstream file(filename);
+  std::string line;
+  utils::csvColumns csv;
+
+  if (!std::getline(file, line))
+  {
+    throw std::runtime_error("Corrupted file. Exit programm.");
+  }
+  parseLegacyLine(line, delimiter, any, csv.header_);
+  csv.columns_.resize(csv.header_.size());
+
+  while (std::getline(file, line))
+  {
+    std::vector<fp> tmp;
+    parseLegacyLine(line, delimiter, number, tmp);
+    if (tmp.size() != csv.columns_.size())
+    {
+      throw std::runtime_error("Number of fields and header titles mismatch. Exit programm.");
+    }
+    for (size_t col = 0; col < tmp.size(); ++col)
+    {
+      csv.columns_[col].emplace_back(tmp[col]);
+    }
+    ++csv.rows_;
+  }
+
+  return csv;
+}
+
+TEST(DataParserTest, ParseThroughputBenchmark)
+{
+  const fp megabytes = static_cast<fp>(std::filesystem::file_size(trajectory_path)) / (1024 * 1024);
+
+  utils::dataParser legacy_parser(trajectory_path, "", "", "", trajectory_imu_header, {}, {});
+  utils::dataParser parser(trajectory_path, "", "", "", trajectory_imu_header, {}, {});
+
+  auto start = std::chrono::steady_clock::now();
+  utils::csvColumns csv = parseLegacyCsv(trajectory_path, ',');
+  legacy_parser.parseAndCheckImu(csv);
+  auto end = std::chrono::steady_clock::now();
+  const fp legacy_ms = std::chrono::duration<fp, std::milli>(end - start).count();
+
+  start = std::chrono::steady_clock::now();
+  parser.parseAndCheck();
+  end = std::chrono::steady_clock::now();
+  const fp ms = std::chrono::duration<fp, std::milli>(end - start).count();
+
+  RecordProperty("legacy_parser_mb_per_s", std::to_string(1e3 * megabytes / legacy_ms));
+  RecordProperty("parser_mb_per_s", std::to_string(1e3 * megabytes / ms));
+  EXPECT_LT(ms, legacy_ms);
+
+  // Both parsers have to produce the same data
+  const auto& legacy_imu = legacy_parser.getImuData();
+  const auto& imu = parser.getImuData();
+  ASSERT_EQ(legacy_imu.size(), imu.size());
+  for (size_t i = 0; i < imu.size(); ++i)
+  {
+    EXPECT_EQ(legacy_imu[i].timestamp_, imu[i].timestamp_);
+    EXPECT_TRUE(legacy_imu[i].ang_ == imu[i].ang_);
+    EXPECT_TRUE(legacy_imu[i].acc_ == imu[i].acc_);
+  }
+}
+
+TEST(DataParserTest, StringFieldsTest)
+{
+  const std::string filename = (std::filesystem::temp_directory_path() / "msceqf_test_images.csv").string();
+  {
+    std::ofstream file(filename);
+    file << "#timestamp [ns],filename\r\n1403636579763555584,Image_0.png\r\n\n1403636579813555456,Image_1.png\n";
+  }
+
+  const utils::csvFields csv = utils::parseCsvFields(filename, ',');
+  std::filesystem::remove(filename);
+
+  ASSERT_EQ(csv.rows_, 2u);
+  ASSERT_EQ(csv.header_.size(), 2u);
+  EXPECT_EQ(csv.header_[0], "#timestamp [ns]");
+  EXPECT_EQ(csv.header_[1], "filename");
+  EXPECT_EQ(csv.columns_[0][1], "1403636579813555456");
+  EXPECT_EQ(csv.columns_[1][0], "Image_0.png");
+  EXPECT_EQ(csv.columns_[1][1], "Image_1.png");
+}
+
+TEST(DataParserTest, SequenceCacheRoundTripTest)
+{
+  const std::filesystem::path folder = std::filesystem::temp_directory_path() / "msceqf_test_sequence";
+  std::filesystem::create_directories(folder);
+
+  const std::string imu_filename = (folder / "imu.csv").string();
+  const std::string gt_filename = (folder / "gt.csv").string();
+  const std::string image_filename = (folder / "images.csv").string();
+  const std::string cache_filename = (folder / "sequence.cache").string();
+
+  const size_t num_imu = 10;
+  const size_t num_images = 3;
+  {
+    std::ofstream imu(imu_filename);
+    std::ofstream gt(gt_filename);
+    std::ofstream images(image_filename);
+    imu << "t,w_x,w_y,w_z,a_x,a_y,a_z\n";
+    gt << "t,q_x,q_y,q_z,q_w,p_x,p_y,p_z,v_x,v_y,v_z,bw_x,bw_y,bw_z,ba_x,ba_y,ba_z\n";
+    images << "#timestamp [ns],filename\n";
+    for (size_t k = 0; k < num_imu; ++k)
+    {
+      imu << 0.01 * k << "," << utils::random<fp>(-1, 1) << ",0.2,0.3,0.4,0.5," << 9.81 + k << "\n";
+      gt << 0.01 * k << ",0,0,0,1," << k << ",2,3,4,5,6,7,8,9,10,11,12\n";
+    }
+    for (size_t k = 0; k < num_images; ++k)
+    {
+      cv::Mat image(6, 8, CV_8UC1);
+      cv::randu(image, 0, 255);
+      cv::imwrite((folder / ("image_" + std::to_string(k) + ".png")).string(), image);
+      images << 0.01 + 0.03 * k << ",image_" << k << ".png\n";
+    }
+  }
+
+  utils::dataParser parser(imu_filename, gt_filename, image_filename, folder.string() + "/", trajectory_imu_header,
+                           {"t", "q_x", "q_y", "q_z", "q_w", "p_x", "p_y", "p_z", "v_x", "v_y", "v_z", "bw_x", "bw_y",
+                            "bw_z", "ba_x", "ba_y", "ba_z"},
+                           {"#timestamp [ns]", "filename"});
+  parser.parseAndCheck();
+  utils::writeSequenceCache(parser, cache_filename);
+
+  {
+    utils::sequenceCache cache(cache_filename);
+    ASSERT_EQ(cache.numImu(), num_imu);
+    ASSERT_EQ(cache.numGroundtruth(), num_imu);
+    ASSERT_EQ(cache.numImages(), num_images);
+
+    for (size_t k = 0; k < num_imu; ++k)
+    {
+      const Imu& expected = parser.getImuData()[k];
+      const Imu imu = cache.imu(k);
+      EXPECT_EQ(imu.timestamp_, expected.timestamp_);
+      EXPECT_TRUE(imu.ang_ == expected.ang_);
+      EXPECT_TRUE(imu.acc_ == expected.acc_);
+
+      const Groundtruth& expected_gt = parser.getGroundtruthData()[k];
+      const Groundtruth gt = cache.groundtruth(k);
+      EXPECT_EQ(gt.timestamp_, expected_gt.timestamp_);
+      EXPECT_TRUE(gt.q_.coeffs() == expected_gt.q_.coeffs());
+      EXPECT_TRUE(gt.p_ == expected_gt.p_);
+      EXPECT_TRUE(gt.v_ == expected_gt.v_);
+      EXPECT_TRUE(gt.bw_ == expected_gt.bw_);
+      EXPECT_TRUE(gt.ba_ == expected_gt.ba_);
+    }
+
+    for (size_t k = 0; k < num_images; ++k)
+    {
+      const auto& [timestamp, path] = parser.getImageIndex()[k];
+      const Camera cam = cache.image(k);
+      EXPECT_EQ(cam.timestamp_, timestamp);
+      EXPECT_EQ(cv::norm(cam.image_, cv::imread(path, cv::IMREAD_GRAYSCALE), cv::NORM_INF), 0);
+    }
+  }
+
+  // A cache written with a different size of a double is rejected
+  {
+    std::fstream file(cache_filename, std::ios::binary | std::ios::in | std::ios::out);
+    const uint32_t double_size = 4;
+    file.seekp(offsetof(utils::sequenceCacheHeader, double_size_));
+    file.write(reinterpret_cast<const char*>(&double_size), sizeof(double_size));
+  }
+  EXPECT_THROW(utils::sequenceCache cache(cache_filename), std::runtime_error);
+
+  // A truncated cache is rejected
+  utils::writeSequenceCache(parser, cache_filename);
+  std::filesystem::resize_file(cache_filename, std::filesystem::file_size(cache_filename) - 1);
+  EXPECT_THROW(utils::sequenceCache cache(cache_filename), std::runtime_error);
+
+  std::filesystem::remove_all(folder);
+}
+
+TEST(DataParserTest, NumberValidationTest)
+{
+  EXPECT_EQ(utils::parseNumber("1.5"), 1.5);
+  EXPECT_EQ(utils::parseNumber("+2"), 2);
+  EXPECT_EQ(utils::parseNumber("-3e2"), -300);
+  EXPECT_EQ(utils::parseNumber(".5"), 0.5);
+  EXPECT_EQ(utils::parseNumber("5.\r"), 5);
+  EXPECT_TRUE(std::isnan(utils::parseNumber("NaN")));
+
+  for (const auto& field : {"", "inf", "1.2.3", "+-1", "1e", "abc", "1 "})
+  {
+    EXPECT_THROW(utils::parseNumber(field), std::runtime_error);
+  }
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_DATA_PARSER_HPP
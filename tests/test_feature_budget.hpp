@@ -0,0 +1,177 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_FEATURE_BUDGET_HPP
+#define TEST_FEATURE_BUDGET_HPP
+
+#include "vision/feature_budget.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Get tracker options for the feature budget tests (target frame time of 20 ms, no smoothing)
+ *
+ * @return Tracker options
+ */
+TrackerOptions featureBudgetTestOptions()
+{
+  TrackerOptions opts = parseTestOptions().track_manager_options_.tracker_options_;
+  opts.max_features_ = 200;
+  opts.min_features_ = 50;
+  opts.detector_pyramid_levels_ = 3;
+  opts.optical_flow_win_size_ = 21;
+  opts.budget_opts_.enable_ = true;
+  opts.budget_opts_.target_frame_time_ = 20;
+  opts.budget_opts_.tolerance_ = 0.1;
+  opts.budget_opts_.smoothing_ = 1.0;
+  opts.budget_opts_.min_max_features_ = 20;
+  opts.budget_opts_.min_detector_pyramid_levels_ = 1;
+  opts.budget_opts_.min_optical_flow_win_size_ = 11;
+  return opts;
+}
+
+/**
+ * @brief Feed the given controller with a frame of the given processing time
+ *
+ * @param controller Feature budget controller
+ * @param ms Frame processing time in milliseconds
+ * @return true if the budget changed, false otherwise
+ */
+bool feedFrame(FeatureBudgetController& controller, const fp& ms)
+{
+  TrackerTimings timings;
+  timings.total_ = ms;
+  return controller.update(timings);
+}
+
+TEST(FeatureBudgetTest, DefaultOptionsTest)
+{
+  // Budget parameters are parsed with their defaults even if the controller is disabled
+  const TrackerOptions opts = parseTestOptions().track_manager_options_.tracker_options_;
+  EXPECT_GT(opts.budget_opts_.target_frame_time_, 0);
+  EXPECT_GT(opts.budget_opts_.smoothing_, 0);
+  EXPECT_GE(opts.budget_opts_.tolerance_, 0);
+  EXPECT_GE(opts.budget_opts_.min_max_features_, 1u);
+  EXPECT_GE(opts.budget_opts_.min_detector_pyramid_levels_, 1u);
+
+  // A disabled controller never adapts the budget
+  TrackerOptions disabled = featureBudgetTestOptions();
+  disabled.budget_opts_.enable_ = false;
+  FeatureBudgetController controller(disabled);
+  const FeatureBudget budget = controller.budget();
+  for (const fp& ms : {100.0, 1.0})
+  {
+    EXPECT_FALSE(feedFrame(controller, ms));
+    EXPECT_EQ(controller.budget(), budget);
+  }
+}
+
+TEST(FeatureBudgetTest, ToleranceBandTest)
+{
+  const TrackerOptions opts = featureBudgetTestOptions();
+  FeatureBudgetController controller(opts);
+  const FeatureBudget budget = controller.budget();
+
+  // Frame times within the tolerance band around the target do not adapt the budget
+  for (const fp& ms : {20.0, 21.9, 18.1})
+  {
+    EXPECT_FALSE(feedFrame(controller, ms));
+    EXPECT_EQ(controller.budget(), budget);
+  }
+
+  // Just outside the band the budget is reduced
+  EXPECT_TRUE(feedFrame(controller, 22.1));
+  EXPECT_LT(controller.budget().max_features_, budget.max_features_);
+
+  // The frame time is filtered with an exponential moving average
+  TrackerOptions smoothed = featureBudgetTestOptions();
+  smoothed.budget_opts_.smoothing_ = 0.5;
+  FeatureBudgetController smoothed_controller(smoothed);
+  feedFrame(smoothed_controller, 10);
+  feedFrame(smoothed_controller, 30);
+  EXPECT_DOUBLE_EQ(smoothed_controller.frameTime(), 20);
+}
+
+TEST(FeatureBudgetTest, SlowAndFastFramesTest)
+{
+  const TrackerOptions opts = featureBudgetTestOptions();
+  FeatureBudgetController controller(opts);
+  const FeatureBudget upper = controller.budget();
+  EXPECT_EQ(upper.max_features_, opts.max_features_);
+  EXPECT_EQ(upper.min_features_, opts.min_features_);
+  EXPECT_EQ(upper.detector_pyramid_levels_, opts.detector_pyramid_levels_);
+  EXPECT_EQ(upper.optical_flow_win_size_, opts.optical_flow_win_size_);
+
+  // Slow frames reduce, in order, the number of features, the detector pyramid levels and the optical flow window
+  FeatureBudget previous = controller.budget();
+  size_t steps = 0;
+  while (feedFrame(controller, 40))
+  {
+    const FeatureBudget& budget = controller.budget();
+    if (budget.max_features_ < previous.max_features_)
+    {
+      EXPECT_EQ(budget.detector_pyramid_levels_, upper.detector_pyramid_levels_);
+      EXPECT_EQ(budget.optical_flow_win_size_, upper.optical_flow_win_size_);
+      EXPECT_EQ(budget.min_features_ * upper.max_features_, budget.max_features_ * upper.min_features_);
+    }
+    else if (budget.detector_pyramid_levels_ < previous.detector_pyramid_levels_)
+    {
+      EXPECT_EQ(budget.max_features_, opts.budget_opts_.min_max_features_);
+      EXPECT_EQ(budget.optical_flow_win_size_, upper.optical_flow_win_size_);
+    }
+    else
+    {
+      EXPECT_EQ(budget.detector_pyramid_levels_, opts.budget_opts_.min_detector_pyramid_levels_);
+      EXPECT_EQ(budget.optical_flow_win_size_ + 2, previous.optical_flow_win_size_);
+    }
+    previous = budget;
+    ASSERT_LT(++steps, 100u);
+  }
+
+  // The budget stops at the lower bounds
+  const FeatureBudget lower = controller.budget();
+  EXPECT_EQ(lower.max_features_, opts.budget_opts_.min_max_features_);
+  EXPECT_EQ(lower.min_features_, 5u);
+  EXPECT_EQ(lower.detector_pyramid_levels_, opts.budget_opts_.min_detector_pyramid_levels_);
+  EXPECT_EQ(lower.optical_flow_win_size_, opts.budget_opts_.min_optical_flow_win_size_);
+  EXPECT_EQ(steps, 9u + 2u + 5u);
+
+  // Fast frames restore the workload in the opposite order, up to the configured parameters
+  previous = controller.budget();
+  steps = 0;
+  while (feedFrame(controller, 5))
+  {
+    const FeatureBudget& budget = controller.budget();
+    if (budget.optical_flow_win_size_ > previous.optical_flow_win_size_)
+    {
+      EXPECT_EQ(budget.max_features_, lower.max_features_);
+      EXPECT_EQ(budget.detector_pyramid_levels_, lower.detector_pyramid_levels_);
+    }
+    else if (budget.detector_pyramid_levels_ > previous.detector_pyramid_levels_)
+    {
+      EXPECT_EQ(budget.optical_flow_win_size_, upper.optical_flow_win_size_);
+      EXPECT_EQ(budget.max_features_, lower.max_features_);
+    }
+    else
+    {
+      EXPECT_GT(budget.max_features_, previous.max_features_);
+      EXPECT_EQ(budget.detector_pyramid_levels_, upper.detector_pyramid_levels_);
+    }
+    previous = budget;
+    ASSERT_LT(++steps, 100u);
+  }
+  EXPECT_EQ(controller.budget(), upper);
+  EXPECT_EQ(steps, 9u + 2u + 5u);
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_FEATURE_BUDGET_HPP
@@ -0,0 +1,162 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_LATENCY_HISTOGRAM_HPP
+#define TEST_LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "msceqf/stats/latency_stats.hpp"
+#include "utils/latency_histogram.hpp"
+
+namespace msceqf
+{
+TEST(LatencyHistogramTest, PercentileAccuracyTest)
+{
+  std::mt19937_64 generator(42);
+
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    // Latencies spanning from microseconds to tens of milliseconds
+    std::lognormal_distribution<double> distribution(13, 1 + 0.01 * i);
+    std::vector<uint64_t> latencies;
+    utils::latencyHistogram histogram;
+    for (int k = 0; k < 1000; ++k)
+    {
+      latencies.emplace_back(static_cast<uint64_t>(distribution(generator)));
+      histogram.record(latencies.back());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    EXPECT_EQ(histogram.count(), latencies.size());
+    EXPECT_EQ(histogram.min(), latencies.front());
+    EXPECT_EQ(histogram.max(), latencies.back());
+
+    // Percentiles are within the relative resolution of the buckets
+    for (const double& percentile : {1.0, 50.0, 90.0, 99.0})
+    {
+      const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * latencies.size()));
+      const double expected = static_cast<double>(latencies[rank - 1]);
+      const double tolerance = expected / utils::latencyHistogram::sub_buckets;
+      EXPECT_NEAR(static_cast<double>(histogram.percentile(percentile)), expected, tolerance);
+    }
+
+    histogram.reset();
+    EXPECT_EQ(histogram.count(), 0u);
+    EXPECT_EQ(histogram.percentile(50), 0u);
+  }
+}
+
+TEST(LatencyHistogramTest, StatsSerializationTest)
+{
+  const size_t num_stages = static_cast<size_t>(LatencyStage::SIZE);
+  const size_t num_rows = LatencyStats::enabled ? num_stages : 0;
+
+  auto stats = std::make_shared<LatencyStats>();
+  for (size_t i = 0; i < num_stages; ++i)
+  {
+    for (size_t k = 0; k <= i; ++k)
+    {
+      LatencyStats::record(stats, static_cast<LatencyStage>(i), 0.1 * (k + 1));
+    }
+  }
+
+  // One row per stage (if stats are compiled in), in the order of the stages, with the number of recorded latencies
+  std::istringstream csv(stats->toCsv());
+  std::string line;
+  ASSERT_TRUE(std::getline(csv, line));
+  EXPECT_EQ(line, "stage,count,mean_ms,min_ms,p50_ms,p90_ms,p99_ms,max_ms");
+  size_t rows = 0;
+  while (std::getline(csv, line))
+  {
+    ASSERT_LT(rows, num_stages);
+    const auto stage = static_cast<LatencyStage>(rows);
+    EXPECT_EQ(line.substr(0, line.find(',')), LatencyStats::name(stage));
+    EXPECT_EQ(line.substr(line.find(',') + 1, line.find(',', line.find(',') + 1) - line.find(',') - 1),
+              std::to_string(rows + 1));
+    EXPECT_EQ(stats->summary(stage).count_, rows + 1);
+    ++rows;
+  }
+  EXPECT_EQ(rows, num_rows);
+
+  const std::string json = stats->toJson();
+  EXPECT_NE(json.find(std::string("\"enabled\": ") + (LatencyStats::enabled ? "true" : "false")), std::string::npos);
+  size_t objects = 0;
+  for (size_t pos = json.find("{\"stage\": "); pos != std::string::npos; pos = json.find("{\"stage\": ", pos + 1))
+  {
+    ASSERT_LT(objects, num_stages);
+    const auto stage = static_cast<LatencyStage>(objects);
+    const std::string expected = std::string("{\"stage\": \"") + LatencyStats::name(stage) +
+                                 "\", \"count\": " + std::to_string(objects + 1) + ",";
+    EXPECT_EQ(json.compare(pos, expected.size(), expected), 0);
+    ++objects;
+  }
+  EXPECT_EQ(objects, num_rows);
+
+  stats->reset();
+  EXPECT_EQ(stats->summary(LatencyStage::UPDATE).count_, 0u);
+}
+
+TEST(LatencyHistogramTest, TraceTest)
+{
+  const std::string filename = (std::filesystem::temp_directory_path() / "msceqf_test_trace.json").string();
+
+  // Events are recorded only by the threads having the recorder set, the fifth event is dropped (capacity of four)
+  utils::traceRecorder recorder(4);
+  utils::stopwatch untraced_watch("untraced");
+  untraced_watch.start();
+  untraced_watch.stop();
+  {
+    utils::traceScope scope(&recorder);
+    {
+      utils::traceSpan span("span");
+    }
+    utils::stopwatch watch("watch");
+    for (size_t i = 0; i < 2; ++i)
+    {
+      watch.start();
+      watch.stop();
+    }
+    {
+      auto timer = LatencyStats::time(nullptr, LatencyStage::UPDATE);
+    }
+    utils::traceSpan dropped("dropped");
+  }
+  EXPECT_EQ(utils::traceRecorder::current(), nullptr);
+  EXPECT_EQ(recorder.dropped(), 1u);
+  recorder.write(filename);
+
+  std::ifstream file(filename);
+  const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  std::filesystem::remove(filename);
+
+  EXPECT_EQ(json.rfind("{\"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": 1},", 0), 0u);
+  EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+
+  std::vector<std::string> names;
+  for (size_t pos = json.find("{\"name\": \""); pos != std::string::npos; pos = json.find("{\"name\": \"", pos + 1))
+  {
+    const size_t begin = pos + 10;
+    names.emplace_back(json.substr(begin, json.find('"', begin) - begin));
+    EXPECT_NE(json.find("\"ph\": \"X\"", pos), std::string::npos);
+  }
+  EXPECT_EQ(names, std::vector<std::string>({"span", "watch", "watch", "update"}));
+  EXPECT_EQ(std::count(json.begin(), json.end(), '{'), std::count(json.begin(), json.end(), '}'));
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,136 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_LOGGER_HPP
+#define TEST_LOGGER_HPP
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/logger.hpp"
+#include "utils/ring_buffer.hpp"
+
+namespace msceqf
+{
+TEST(LoggerTest, RingBufferMultipleProducersTest)
+{
+  const size_t num_producers = 4;
+  const size_t num_elements = 20000;
+
+  utils::ringBuffer<size_t> buffer(64);
+
+  // Producers retry on a full ring buffer, such that every element is eventually pushed
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < num_producers; ++p)
+  {
+    producers.emplace_back([&buffer, p]() {
+      for (size_t i = 0; i < num_elements; ++i)
+      {
+        while (!buffer.push(p * num_elements + i))
+        {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<size_t> received(num_producers * num_elements, 0);
+  std::vector<size_t> next(num_producers, 0);
+  size_t element;
+  size_t popped = 0;
+  while (popped < received.size())
+  {
+    if (!buffer.pop(element))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    ++received[element];
+    ++popped;
+
+    // Elements of the same producer are popped in the order they have been pushed
+    const size_t p = element / num_elements;
+    EXPECT_EQ(element, p * num_elements + next[p]++);
+  }
+  EXPECT_FALSE(buffer.pop(element));
+
+  for (auto& producer : producers)
+  {
+    producer.join();
+  }
+
+  // No element has been lost nor duplicated
+  EXPECT_EQ(popped, received.size());
+  for (const auto& count : received)
+  {
+    ASSERT_EQ(count, 1u);
+  }
+}
+
+TEST(LoggerTest, RingBufferFullTest)
+{
+  utils::ringBuffer<std::string> buffer(5);
+  ASSERT_EQ(buffer.capacity(), 8u);
+
+  for (size_t i = 0; i < buffer.capacity(); ++i)
+  {
+    EXPECT_TRUE(buffer.push(std::to_string(i)));
+  }
+  EXPECT_FALSE(buffer.push("rejected"));
+
+  // Popping frees a slot, elements are popped in order, and the rejected element is not in the ring buffer
+  std::string element;
+  ASSERT_TRUE(buffer.pop(element));
+  EXPECT_EQ(element, "0");
+  EXPECT_TRUE(buffer.push("accepted"));
+  EXPECT_FALSE(buffer.push("rejected"));
+
+  for (size_t i = 1; i < buffer.capacity(); ++i)
+  {
+    ASSERT_TRUE(buffer.pop(element));
+    EXPECT_EQ(element, std::to_string(i));
+  }
+  ASSERT_TRUE(buffer.pop(element));
+  EXPECT_EQ(element, "accepted");
+  EXPECT_FALSE(buffer.pop(element));
+}
+
+TEST(LoggerTest, DisabledLevelTest)
+{
+  utils::loggerScope scope(utils::LoggerLevel::WARN);
+
+  size_t evaluated = 0;
+  const auto message = [&evaluated]() {
+    ++evaluated;
+    return std::string("message");
+  };
+
+  utils::Logger::debug(message);
+  utils::Logger::info(message);
+  EXPECT_EQ(evaluated, 0u);
+
+  {
+    utils::loggerScope inactive(utils::LoggerLevel::INACTIVE);
+    utils::Logger::warn(message);
+    utils::Logger::err(message);
+    EXPECT_EQ(evaluated, 0u);
+  }
+
+  // Enabled levels evaluate the message exactly once
+  utils::Logger::warn(message);
+  EXPECT_EQ(evaluated, 1u);
+  utils::Logger::flush();
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_LOGGER_HPP
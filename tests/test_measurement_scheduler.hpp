@@ -0,0 +1,136 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_MEASUREMENT_SCHEDULER_HPP
+#define TEST_MEASUREMENT_SCHEDULER_HPP
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "msceqf/scheduler/measurement_scheduler.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Generate a blank camera measurement with the resolution of the test parameters
+ *
+ * @param timestamp Timestamp of the measurement
+ * @return Camera measurement
+ */
+Camera blankFrame(const fp& timestamp)
+{
+  Camera cam;
+  cam.image_ = cv::Mat::zeros(480, 640, CV_8UC1);
+  cam.mask_ = 255 * cv::Mat::ones(480, 640, CV_8UC1);
+  cam.timestamp_ = timestamp;
+  return cam;
+}
+
+/**
+ * @brief Check that every received frame has been either processed, dropped, or is still queued
+ *
+ * @param scheduler Measurement scheduler
+ */
+void schedulerStatsConsistency(const MeasurementScheduler& scheduler)
+{
+  const SchedulerStats stats = scheduler.stats();
+  EXPECT_EQ(stats.received_, stats.processed_ + stats.dropped_ + scheduler.queued());
+  EXPECT_LE(stats.expired_, stats.dropped_);
+  EXPECT_LE(stats.late_, stats.processed_);
+}
+
+TEST(MeasurementSchedulerTest, NewestFrameWinsTest)
+{
+  MSCEqF sys(parameters_path);
+  MeasurementScheduler scheduler(sys);
+  ASSERT_TRUE(sys.options().scheduler_options_.drop_frames_);
+
+  for (size_t k = 1; k <= 5; ++k)
+  {
+    scheduler.push(blankFrame(0.1 * k));
+  }
+
+  // Frames newer than the given timestamp are not ready
+  std::vector<fp> processed;
+  EXPECT_EQ(scheduler.process(0.05, [&](const Camera& cam) { processed.push_back(cam.timestamp_); }), 0u);
+  EXPECT_EQ(scheduler.queued(), 5u);
+
+  // All the frames are ready, only the newest one is processed
+  EXPECT_EQ(scheduler.process(0.55, [&](const Camera& cam) { processed.push_back(cam.timestamp_); }), 1u);
+  ASSERT_EQ(processed.size(), 1u);
+  EXPECT_EQ(processed.front(), 0.5);
+  EXPECT_EQ(scheduler.queued(), 0u);
+
+  const SchedulerStats stats = scheduler.stats();
+  EXPECT_EQ(stats.received_, 5u);
+  EXPECT_EQ(stats.processed_, 1u);
+  EXPECT_EQ(stats.dropped_, 4u);
+  schedulerStatsConsistency(scheduler);
+}
+
+TEST(MeasurementSchedulerTest, BoundedQueueTest)
+{
+  MSCEqF sys(parameters_path);
+  MeasurementScheduler scheduler(sys);
+  const size_t max_queue_size = sys.options().scheduler_options_.max_queue_size_;
+
+  // Frames are pushed out of order, the queue keeps the newest ones
+  const size_t num_frames = max_queue_size + 5;
+  for (size_t k = num_frames; k > 0; --k)
+  {
+    scheduler.push(blankFrame(0.1 * k));
+    schedulerStatsConsistency(scheduler);
+  }
+  EXPECT_EQ(scheduler.queued(), max_queue_size);
+  EXPECT_EQ(scheduler.stats().dropped_, 5u);
+
+  std::vector<fp> processed;
+  scheduler.process(0.1 * num_frames + 0.05, [&](const Camera& cam) { processed.push_back(cam.timestamp_); });
+  ASSERT_EQ(processed.size(), 1u);
+  EXPECT_EQ(processed.front(), 0.1 * num_frames);
+  EXPECT_EQ(scheduler.stats().dropped_, num_frames - 1);
+  schedulerStatsConsistency(scheduler);
+}
+
+TEST(MeasurementSchedulerTest, DeadlineTest)
+{
+  MSCEqF sys(parameters_path);
+  MeasurementScheduler scheduler(sys);
+  const fp deadline = sys.options().scheduler_options_.frame_deadline_;
+
+  scheduler.push(blankFrame(0.1));
+  scheduler.push(blankFrame(0.2));
+  std::this_thread::sleep_for(std::chrono::duration<fp, std::milli>(2 * deadline));
+
+  // The first frame expired while a newer frame is queued, hence it is dropped
+  std::vector<fp> processed;
+  EXPECT_EQ(scheduler.process(0.15, [&](const Camera& cam) { processed.push_back(cam.timestamp_); }), 0u);
+  EXPECT_EQ(scheduler.stats().expired_, 1u);
+  EXPECT_EQ(scheduler.queued(), 1u);
+
+  // The newest frame expired as well, but it is processed anyway, and counted as late
+  EXPECT_EQ(scheduler.process(0.25, [&](const Camera& cam) { processed.push_back(cam.timestamp_); }), 1u);
+  ASSERT_EQ(processed.size(), 1u);
+  EXPECT_EQ(processed.front(), 0.2);
+
+  const SchedulerStats stats = scheduler.stats();
+  EXPECT_EQ(stats.expired_, 1u);
+  EXPECT_EQ(stats.dropped_, 1u);
+  EXPECT_EQ(stats.processed_, 1u);
+  EXPECT_EQ(stats.late_, 1u);
+  EXPECT_GT(stats.max_lateness_, 0);
+  schedulerStatsConsistency(scheduler);
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_MEASUREMENT_SCHEDULER_HPP
@@ -0,0 +1,506 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_PROJECTION_HPP
+#define TEST_PROJECTION_HPP
+
+#include <chrono>
+#include <limits>
+#include <map>
+
+#include "msceqf/filter/updater/updater_helper.hpp"
+#include "msceqf/options/msceqf_option_parser.hpp"
+#include "vision/camera.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Add clones at random poses to the given state, and fill the map of indices for the C matrix accordingly
+ *
+ * @param X MSCEqF state
+ * @param num_clones Number of clones
+ * @param cols_map Map of indices for the C matrix and the residual delta
+ */
+void randomClones(MSCEqFState& X, const size_t& num_clones, ColsMap& cols_map)
+{
+  cols_map.clear();
+  size_t cols = 0;
+  for (size_t k = 0; k < num_clones; ++k)
+  {
+    const fp timestamp = 0.1 * k;
+    X = X.Random();
+    X.stochasticCloning(timestamp);
+    cols_map.insert(timestamp, cols);
+    cols += X.dof(timestamp);
+  }
+}
+
+/**
+ * @brief Generate a track of a random feature in front of all the clones of the given state, observed by the given
+ * camera
+ *
+ * @param X MSCEqF state
+ * @param track Track of the feature (normalized coordinates)
+ * @param A_f Feature in anchor frame
+ * @param cam_id Id of the camera observing the feature
+ * @param noise Magnitude of the noise added to the normalized coordinates
+ */
+void randomTrack(const MSCEqFState& X, Track& track, Vector3& A_f, const uint& cam_id = 0, const fp& noise = 1e-3)
+{
+  const std::vector<fp> timestamps = X.clonesTimestamps();
+
+  Vector3 G0_f;
+  bool valid = false;
+  while (!valid)
+  {
+    G0_f = 10 * Vector3::Random();
+    valid = std::all_of(timestamps.begin(), timestamps.end(),
+                        [&](const fp& timestamp) { return (X.clone(timestamp, cam_id).inv() * G0_f)(2) > 0.5; });
+  }
+
+  track = Track();
+  track.cam_id_ = cam_id;
+  for (const auto& timestamp : timestamps)
+  {
+    const Vector3 C_f = X.clone(timestamp, cam_id).inv() * G0_f;
+    const Vector2 uvn = C_f.head<2>() / C_f(2) + noise * Vector2::Random();
+    track.uvs_.emplace_back(uvn(0), uvn(1));
+    track.normalized_uvs_.emplace_back(uvn(0), uvn(1));
+    track.timestamps_.emplace_back(timestamp);
+  }
+
+  A_f = X.clone(timestamps.front(), cam_id).inv() * G0_f;
+}
+
+/**
+ * @brief Generate a noise-free track with bearings of a random feature in front of the anchor (first clone), and
+ * observed at or beyond 90 degrees from the optical axis by at least one of the other clones of the given state
+ *
+ * @param X MSCEqF state
+ * @param track Track of the feature (bearings)
+ * @param A_f Feature in anchor frame
+ */
+void wideAngleTrack(const MSCEqFState& X, Track& track, Vector3& A_f)
+{
+  const std::vector<fp> timestamps = X.clonesTimestamps();
+
+  Vector3 G0_f;
+  bool valid = false;
+  while (!valid)
+  {
+    G0_f = 10 * Vector3::Random();
+    const fp anchor_depth = (X.clone(timestamps.front()).inv() * G0_f)(2);
+    valid = anchor_depth > 0.5 && anchor_depth < 20 &&
+            std::all_of(timestamps.begin(), timestamps.end(),
+                        [&](const fp& timestamp) { return (X.clone(timestamp).inv() * G0_f).norm() > 0.5; }) &&
+            std::any_of(timestamps.begin(), timestamps.end(),
+                        [&](const fp& timestamp) { return (X.clone(timestamp).inv() * G0_f)(2) <= 0; });
+  }
+
+  track = Track();
+  for (const auto& timestamp : timestamps)
+  {
+    const Vector3 C_f = X.clone(timestamp).inv() * G0_f;
+    const Vector3 b = C_f.normalized();
+
+    // Normalized coordinates are not defined at or beyond 90 degrees
+    const Vector2 uvn = C_f(2) > 0 ? Vector2(C_f.head<2>() / C_f(2)) : Vector2::Zero();
+    track.uvs_.emplace_back(uvn(0), uvn(1));
+    track.normalized_uvs_.emplace_back(uvn(0), uvn(1));
+    track.bearings_.emplace_back(b(0), b(1), b(2));
+    track.timestamps_.emplace_back(timestamp);
+  }
+
+  A_f = X.clone(timestamps.front()).inv() * G0_f;
+}
+
+TEST(ProjectionTest, FeatureJacobianTest)
+{
+  for (const bool& calibration : {false, true})
+  {
+    // Options
+    MSCEqFOptions opts = parseTestOptions();
+
+    // Set specific options for this test independently by given parameters
+    opts.state_options_.enable_camera_intrinsics_calibration_ = calibration;
+    opts.state_options_.num_persistent_features_ = 0;
+
+    SystemState xi0(opts.state_options_);
+
+    const std::vector<ProjectionHelperSharedPtr> helpers = {
+        createProjectionHelper<ProjectionHelperZ1>(FeatureRepresentation::ANCHORED_EUCLIDEAN, calibration),
+        createProjectionHelper<ProjectionHelperS2>(FeatureRepresentation::ANCHORED_EUCLIDEAN, calibration)};
+
+    for (int i = 0; i < N_TESTS; ++i)
+    {
+      MSCEqFState X(opts.state_options_, xi0);
+      ColsMap clones_cols_map;
+      randomClones(X, 5, clones_cols_map);
+
+      // Columns of the C matrix, intrinsics first if calibrated
+      ColsMap cols_map;
+      size_t cols = 0;
+      if (calibration)
+      {
+        cols_map.insert(MSCEqFStateElementName::L, cols);
+        cols += X.dof(MSCEqFStateElementName::L);
+      }
+      for (const auto& timestamp : X.clonesTimestamps())
+      {
+        cols_map.insert(timestamp, cols);
+        cols += X.dof(timestamp);
+      }
+
+      // Noise-free track, the S2 tangent basis depends on the measured bearing and its differential vanishes only with
+      // zero residual. With intrinsics calibration the measured pixel coordinates are K * L * [uvn 1]^T
+      Track track;
+      Vector3 A_f;
+      randomTrack(X, track, A_f, 0, 0);
+      if (calibration)
+      {
+        const Matrix3 KL = xi0.K().asMatrix() * X.L().asMatrix();
+        for (size_t k = 0; k < track.size(); ++k)
+        {
+          const Vector3 uv = KL * Vector3(track.normalized_uvs_[k].x, track.normalized_uvs_[k].y, 1.0);
+          track.uvs_[k] = cv::Point2f(uv(0), uv(1));
+        }
+      }
+
+      for (const auto& ph : helpers)
+      {
+        const size_t rows = ph->block_rows() * track.size();
+        MatrixX C = MatrixX::Zero(rows, cols);
+        VectorX delta = VectorX::Zero(rows);
+        MatrixX Cf = MatrixX::Zero(rows, ph->dim_loss());
+        ph->residualJacobianBlock(X, xi0, track, A_f, C, delta, Cf, 0, cols_map);
+
+        auto residual = [&](const MSCEqFState& X_h, const Vector3& A_f_h) {
+          MatrixX C_h = MatrixX::Zero(rows, cols);
+          VectorX delta_h = VectorX::Zero(rows);
+          MatrixX Cf_h = MatrixX::Zero(rows, ph->dim_loss());
+          ph->residualJacobianBlock(X_h, xi0, track, A_f_h, C_h, delta_h, Cf_h, 0, cols_map);
+          return delta_h;
+        };
+
+        // The residual decreases along Cf, delta(A_f + e) - delta(A_f) = -Cf * e
+        const fp h = 1e-6;
+        MatrixX Cf_numerical = MatrixX::Zero(rows, ph->dim_loss());
+        for (int j = 0; j < 3; ++j)
+        {
+          Cf_numerical.col(j) = -(residual(X, A_f + h * Vector3::Unit(j)) - delta) / h;
+        }
+        MatrixEquality(Cf, Cf_numerical, 1e-4);
+
+        // The residual decreases along the clone blocks, delta(exp(e) * E) - delta(E) = -C * e, with the feature fixed
+        // in the anchor frame
+        MatrixX C_numerical = MatrixX::Zero(rows, cols);
+        for (const auto& timestamp : X.clonesTimestamps())
+        {
+          for (int j = 0; j < 6; ++j)
+          {
+            MSCEqFState X_h(X);
+            X_h.updateLeft(timestamp, h * Vector6::Unit(j));
+            C_numerical.col(cols_map.at(timestamp) + j) = -(residual(X_h, A_f) - delta) / h;
+          }
+        }
+
+        // The residual decreases along the intrinsics block, delta(exp(e) * L) - delta(L) = -C * e
+        if (calibration)
+        {
+          for (int j = 0; j < 4; ++j)
+          {
+            MSCEqFState X_h(X);
+            X_h.updateLeft(MSCEqFStateElementName::L, h * Vector4::Unit(j));
+            C_numerical.col(cols_map.at(MSCEqFStateElementName::L) + j) = -(residual(X_h, A_f) - delta) / h;
+          }
+        }
+
+        MatrixEquality(C, C_numerical, 1e-4);
+      }
+    }
+  }
+}
+
+TEST(ProjectionTest, SecondaryCameraJacobianTest)
+{
+  // Options
+  MSCEqFOptions opts = parseTestOptions();
+
+  // Set specific options for this test independently by given parameters
+  opts.state_options_.num_persistent_features_ = 0;
+  opts.state_options_.secondary_cameras_intrinsics_ = {In(1.0, 1.0, 0.0, 0.0)};
+
+  const MSCEqFState::MSCEqFStateKey E_key = MSCEqFState::cameraKey(MSCEqFStateElementName::E, 1);
+  const MSCEqFState::MSCEqFStateKey L_key = MSCEqFState::cameraKey(MSCEqFStateElementName::L, 1);
+
+  for (const bool& calibration : {false, true})
+  {
+    opts.state_options_.enable_camera_intrinsics_calibration_ = calibration;
+
+    const std::vector<ProjectionHelperSharedPtr> helpers = {
+        createProjectionHelper<ProjectionHelperZ1>(FeatureRepresentation::ANCHORED_EUCLIDEAN, calibration),
+        createProjectionHelper<ProjectionHelperS2>(FeatureRepresentation::ANCHORED_EUCLIDEAN, calibration)};
+
+    for (int i = 0; i < N_TESTS; ++i)
+    {
+      // Non-identity extrinsics of the secondary camera of the rig
+      opts.state_options_.secondary_cameras_extrinsics_ = {SE3::exp(Vector6::Random())};
+
+      SystemState xi0(opts.state_options_);
+      MSCEqFState X(opts.state_options_, xi0);
+      ColsMap cols_map;
+      randomClones(X, 5, cols_map);
+
+      // Columns of the calibration of the secondary camera follow the clones
+      size_t cols = 6 * X.clonesSize();
+      cols_map.insert(E_key, cols);
+      cols += X.dof(E_key);
+      if (calibration)
+      {
+        cols_map.insert(L_key, cols);
+        cols += X.dof(L_key);
+      }
+
+      // Noise-free track of the secondary camera, the feature is expressed in the frame of the secondary camera anchor.
+      // With intrinsics calibration the measured pixel coordinates are K1 * L1 * [uvn 1]^T
+      Track track;
+      Vector3 A_f;
+      randomTrack(X, track, A_f, 1, 0);
+      if (calibration)
+      {
+        const Matrix3 KL = xi0.K(1).asMatrix() * X.L(1).asMatrix();
+        for (size_t k = 0; k < track.size(); ++k)
+        {
+          const Vector3 uv = KL * Vector3(track.normalized_uvs_[k].x, track.normalized_uvs_[k].y, 1.0);
+          track.uvs_[k] = cv::Point2f(uv(0), uv(1));
+        }
+      }
+
+      // Observation of the feature as a point in the origin frame at the newest clone
+      const fp& timestamp = track.timestamps_.back();
+      const Vector3 G0_f = X.clone(track.timestamps_.front(), 1) * A_f;
+      const Vector2 uv(track.uvs_.back().x, track.uvs_.back().y);
+      const Vector2 uvn(track.normalized_uvs_.back().x, track.normalized_uvs_.back().y);
+      const Vector3 bearing = track.bearing(track.size() - 1);
+      const uint cam_id = 1;
+      const PointFeatHelper feat(G0_f, uv, uvn, bearing, timestamp, cam_id);
+
+      for (const auto& ph : helpers)
+      {
+        const size_t rows = ph->block_rows() * track.size();
+        MatrixX C = MatrixX::Zero(rows, cols);
+        VectorX delta = VectorX::Zero(rows);
+        MatrixX Cf = MatrixX::Zero(rows, ph->dim_loss());
+        ph->residualJacobianBlock(X, xi0, track, A_f, C, delta, Cf, 0, cols_map);
+
+        const size_t point_rows = ph->block_rows();
+        MatrixX C_point = MatrixX::Zero(point_rows, cols);
+        VectorX delta_point = VectorX::Zero(point_rows);
+        MatrixX Cp = MatrixX::Zero(point_rows, 3);
+        ph->pointResidualJacobianBlock(X, xi0, feat, C_point, delta_point, Cp, 0, 0, cols_map);
+
+        // Observations are predicted through the extrinsics and intrinsics of the observing camera
+        MatrixEquality(delta, VectorX::Zero(rows), 1e-6);
+        MatrixEquality(delta_point, VectorX::Zero(point_rows), 1e-6);
+
+        auto residual = [&](const MSCEqFState& X_h) {
+          MatrixX C_h = MatrixX::Zero(rows, cols);
+          VectorX delta_h = VectorX::Zero(rows);
+          MatrixX Cf_h = MatrixX::Zero(rows, ph->dim_loss());
+          ph->residualJacobianBlock(X_h, xi0, track, A_f, C_h, delta_h, Cf_h, 0, cols_map);
+          return delta_h;
+        };
+
+        auto point_residual = [&](const MSCEqFState& X_h) {
+          MatrixX C_h = MatrixX::Zero(point_rows, cols);
+          VectorX delta_h = VectorX::Zero(point_rows);
+          MatrixX Cp_h = MatrixX::Zero(point_rows, 3);
+          ph->pointResidualJacobianBlock(X_h, xi0, feat, C_h, delta_h, Cp_h, 0, 0, cols_map);
+          return delta_h;
+        };
+
+        // The residual decreases along the clone blocks and the calibration blocks of the secondary camera,
+        // delta(exp(e) * E) - delta(E) = -C * e, with the feature fixed in the anchor frame or in the origin frame
+        const fp h = 1e-6;
+        MatrixX C_numerical = MatrixX::Zero(rows, cols);
+        MatrixX C_point_numerical = MatrixX::Zero(point_rows, cols);
+        std::vector<MSCEqFState::MSCEqFKey> keys;
+        for (const auto& clone_timestamp : X.clonesTimestamps())
+        {
+          keys.emplace_back(clone_timestamp);
+        }
+        keys.emplace_back(E_key);
+        if (calibration)
+        {
+          keys.emplace_back(L_key);
+        }
+        for (const auto& key : keys)
+        {
+          for (uint j = 0; j < X.dof(key); ++j)
+          {
+            MSCEqFState X_h(X);
+            X_h.updateLeft(key, h * VectorX::Unit(X.dof(key), j));
+            C_numerical.col(cols_map.at(key) + j) = -(residual(X_h) - delta) / h;
+            C_point_numerical.col(cols_map.at(key) + j) = -(point_residual(X_h) - delta_point) / h;
+          }
+        }
+
+        MatrixEquality(C, C_numerical, 1e-4);
+        MatrixEquality(C_point, C_point_numerical, 1e-4);
+      }
+    }
+  }
+}
+
+TEST(ProjectionTest, EquidistantUnprojectionTest)
+{
+  CameraOptions cam_opts;
+  cam_opts.distortion_coefficients_ = (VectorX(4) << 0.01, -0.005, 0.001, -0.0005).finished();
+  cam_opts.resolution_ = Vector2(640, 480);
+  const Vector4 intrinsics(300, 300, 320, 240);
+  PinholeCameraUniquePtr cam = createCamera<EquidistantCamera>(cam_opts, intrinsics);
+
+  const VectorX& k = cam_opts.distortion_coefficients_;
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    // Bearings with incidence angle up to 110 degrees
+    const fp theta = utils::random<fp>(0, 110 * M_PI / 180);
+    const fp phi = utils::random<fp>(-M_PI, M_PI);
+    const Vector3 b(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+
+    // Equidistant projection
+    const fp theta2 = theta * theta;
+    const fp theta_d = theta * (1 + theta2 * (k(0) + theta2 * (k(1) + theta2 * (k(2) + theta2 * k(3)))));
+    const std::vector<cv::Point2f> uv = {
+        cv::Point2f(intrinsics(0) * theta_d * std::cos(phi) + intrinsics(2),
+                    intrinsics(1) * theta_d * std::sin(phi) + intrinsics(3))};
+
+    FeaturesBearings bearings;
+    cam->unproject(uv, bearings);
+    ASSERT_EQ(bearings.size(), 1u);
+    MatrixEquality(Vector3(bearings[0].x, bearings[0].y, bearings[0].z), b, 1e-5);
+  }
+}
+
+TEST(ProjectionTest, WideAngleProjectionTest)
+{
+  // Options
+  MSCEqFOptions opts = parseTestOptions();
+
+  // Set specific options for this test independently by given parameters
+  opts.state_options_.enable_camera_intrinsics_calibration_ = false;
+  opts.state_options_.num_persistent_features_ = 0;
+
+  SystemState xi0(opts.state_options_);
+
+  const ProjectionHelperSharedPtr ph =
+      createProjectionHelper<ProjectionHelperS2>(FeatureRepresentation::ANCHORED_EUCLIDEAN, false);
+
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    MSCEqFState X(opts.state_options_, xi0);
+    ColsMap cols_map;
+    randomClones(X, 5, cols_map);
+
+    Track track;
+    Vector3 A_f;
+    wideAngleTrack(X, track, A_f);
+
+    const size_t rows = ph->block_rows() * track.size();
+    MatrixX C = MatrixX::Zero(rows, 6 * X.clonesSize());
+    VectorX delta = VectorX::Zero(rows);
+    MatrixX Cf = MatrixX::Zero(rows, ph->dim_loss());
+    ph->residualJacobianBlock(X, xi0, track, A_f, C, delta, Cf, 0, cols_map);
+
+    // Observations beyond 90 degrees are predicted from the bearings
+    MatrixEquality(delta, VectorX::Zero(rows), 1e-6);
+
+    const fp h = 1e-6;
+    MatrixX Cf_numerical = MatrixX::Zero(rows, ph->dim_loss());
+    for (int j = 0; j < 3; ++j)
+    {
+      MatrixX C_h = MatrixX::Zero(rows, 6 * X.clonesSize());
+      VectorX delta_h = VectorX::Zero(rows);
+      MatrixX Cf_h = MatrixX::Zero(rows, ph->dim_loss());
+      ph->residualJacobianBlock(X, xi0, track, A_f + h * Vector3::Unit(j), C_h, delta_h, Cf_h, 0, cols_map);
+      Cf_numerical.col(j) = -(delta_h - delta) / h;
+    }
+
+    MatrixEquality(Cf, Cf_numerical, 1e-4);
+  }
+}
+
+TEST(ProjectionTest, ProjectionBenchmark)
+{
+  // Options
+  MSCEqFOptions opts = parseTestOptions();
+
+  // Set specific options for this test independently by given parameters
+  opts.state_options_.enable_camera_intrinsics_calibration_ = false;
+  opts.state_options_.num_persistent_features_ = 0;
+
+  SystemState xi0(opts.state_options_);
+  MSCEqFState X(opts.state_options_, xi0);
+  ColsMap cols_map;
+  randomClones(X, 10, cols_map);
+
+  constexpr size_t num_tracks = 200;
+  std::vector<Track> tracks(num_tracks);
+  std::vector<Vector3> features(num_tracks);
+  for (size_t k = 0; k < num_tracks; ++k)
+  {
+    randomTrack(X, tracks[k], features[k]);
+  }
+
+  const std::vector<std::pair<std::string, ProjectionHelperSharedPtr>> helpers = {
+      {"Z1", createProjectionHelper<ProjectionHelperZ1>(FeatureRepresentation::ANCHORED_INVERSE_DEPTH, false)},
+      {"S2", createProjectionHelper<ProjectionHelperS2>(FeatureRepresentation::ANCHORED_INVERSE_DEPTH, false)}};
+
+  // Best time per observation over repeated runs, to be robust to scheduling noise
+  std::map<std::string, fp> ns_per_observation;
+  for (const auto& [name, ph] : helpers)
+  {
+    const size_t rows = ph->block_rows() * X.clonesSize();
+    MatrixX C = MatrixX::Zero(rows, 6 * X.clonesSize());
+    VectorX delta = VectorX::Zero(rows);
+    MatrixX Cf = MatrixX::Zero(rows, ph->dim_loss());
+
+    fp best = std::numeric_limits<fp>::max();
+    for (int run = 0; run < 5; ++run)
+    {
+      size_t observations = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < N_TESTS; ++i)
+      {
+        for (size_t k = 0; k < num_tracks; ++k)
+        {
+          ph->residualJacobianBlock(X, xi0, tracks[k], features[k], C, delta, Cf, 0, cols_map);
+          observations += tracks[k].size();
+        }
+      }
+      auto end = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<fp, std::nano>(end - start).count() / observations);
+    }
+    ns_per_observation[name] = best;
+    RecordProperty(name + "_ns_per_observation", std::to_string(best));
+
+    EXPECT_TRUE(delta.allFinite());
+    EXPECT_TRUE(C.allFinite());
+  }
+
+  // The S2 kernel stays within the budget of the Z1 kernel, up to the normalization and the tangent basis
+  constexpr fp max_ratio = 2.0;
+  EXPECT_LT(ns_per_observation.at("S2"), max_ratio * ns_per_observation.at("Z1"));
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_PROJECTION_HPP
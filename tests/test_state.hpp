@@ -16,6 +16,7 @@
 
 #include "msceqf/state/state.hpp"
 #include "msceqf/symmetry/symmetry.hpp"
+#include "msceqf/filter/propagator/propagator.hpp"
 #include "msceqf/options/msceqf_option_parser.hpp"
 
 namespace msceqf
@@ -343,6 +344,255 @@ TEST(MSCEqFStateTest, MSCEqFStateConstructionTest)
   }
 }
 
+
+TEST(MSCEqFStateTest, MarginalizationPolicyTest)
+{
+  MSCEqFOptions opts = parseTestOptions();
+  opts.state_options_.keyframe_translation_threshold_ = 0.05;
+  opts.state_options_.keyframe_rotation_threshold_ = 5.0;
+  opts.state_options_.keyframe_parallax_threshold_ = 10.0;
+
+  SystemState xi0(
+      opts.state_options_,
+      std::make_pair(SystemStateElementName::T, createSystemStateElement<ExtendedPoseState>(std::make_tuple())),
+      std::make_pair(SystemStateElementName::b, createSystemStateElement<BiasState>(std::make_tuple())));
+
+  // Clones of a static hover, with the given motion before the newest clone
+  const std::vector<fp> timestamps = {0.0, 0.1, 0.2, 0.3, 0.4};
+  auto hover = [&](const Vector6& motion) {
+    MSCEqFState X(opts.state_options_, xi0);
+    for (size_t k = 0; k < timestamps.size() - 1; ++k)
+    {
+      X.stochasticCloning(timestamps[k]);
+    }
+    X.updateLeft(MSCEqFStateElementName::E, motion);
+    X.stochasticCloning(timestamps.back());
+    return X;
+  };
+
+  const fp translation = opts.state_options_.keyframe_translation_threshold_;
+  const fp rotation = opts.state_options_.keyframe_rotation_threshold_ * M_PI / 180;
+  const std::vector<Vector6> small_motions = {Vector6::Zero(),
+                                              (Vector6() << 0, 0, 0, 0.5 * translation, 0, 0).finished(),
+                                              (Vector6() << 0, 0.5 * rotation, 0, 0, 0, 0).finished()};
+  const std::vector<Vector6> large_motions = {(Vector6() << 0, 0, 0, 0, 2 * translation, 0).finished(),
+                                              (Vector6() << 0, 0, 2 * rotation, 0, 0, 0).finished()};
+
+  const fp small_parallax = 0.5 * opts.state_options_.keyframe_parallax_threshold_;
+  const fp large_parallax = 2.0 * opts.state_options_.keyframe_parallax_threshold_;
+
+  const fp& oldest = timestamps.front();
+  const fp& second_newest = timestamps.rbegin()[1];
+
+  for (const auto& policy :
+       {MarginalizationPolicy::OLDEST, MarginalizationPolicy::MOTION, MarginalizationPolicy::PARALLAX})
+  {
+    opts.state_options_.marginalization_policy_ = policy;
+
+    // With less than three clones there is no keyframe to compare with, and the oldest clone is marginalized
+    MSCEqFState X(opts.state_options_, xi0);
+    X.stochasticCloning(timestamps[0]);
+    X.stochasticCloning(timestamps[1]);
+    EXPECT_EQ(X.cloneTimestampToMarginalize(small_parallax), oldest);
+
+    for (const auto& motion : small_motions)
+    {
+      X = hover(motion);
+      switch (policy)
+      {
+        case MarginalizationPolicy::OLDEST:
+          // The oldest clone is always marginalized
+          EXPECT_EQ(X.cloneTimestampToMarginalize(small_parallax), oldest);
+          EXPECT_EQ(X.cloneTimestampToMarginalize(), oldest);
+          break;
+        case MarginalizationPolicy::MOTION:
+          // Without enough motion the second newest clone is not a keyframe, regardless of the parallax
+          EXPECT_EQ(X.cloneTimestampToMarginalize(small_parallax), second_newest);
+          EXPECT_EQ(X.cloneTimestampToMarginalize(large_parallax), second_newest);
+          break;
+        case MarginalizationPolicy::PARALLAX:
+          // The second newest clone is a keyframe with enough parallax, or if the parallax is not available
+          EXPECT_EQ(X.cloneTimestampToMarginalize(small_parallax), second_newest);
+          EXPECT_EQ(X.cloneTimestampToMarginalize(large_parallax), oldest);
+          EXPECT_EQ(X.cloneTimestampToMarginalize(), oldest);
+          break;
+      }
+    }
+
+    for (const auto& motion : large_motions)
+    {
+      X = hover(motion);
+      switch (policy)
+      {
+        case MarginalizationPolicy::OLDEST:
+        case MarginalizationPolicy::MOTION:
+          // With enough motion the second newest clone is a keyframe
+          EXPECT_EQ(X.cloneTimestampToMarginalize(small_parallax), oldest);
+          break;
+        case MarginalizationPolicy::PARALLAX:
+          // The motion is not considered, only the parallax
+          EXPECT_EQ(X.cloneTimestampToMarginalize(small_parallax), second_newest);
+          EXPECT_EQ(X.cloneTimestampToMarginalize(large_parallax), oldest);
+          break;
+      }
+    }
+  }
+}
+
+TEST(MSCEqFStateTest, MarginalizeIntermediateCloneTest)
+{
+  MSCEqFOptions opts = parseTestOptions();
+
+  SystemState xi0(
+      opts.state_options_,
+      std::make_pair(SystemStateElementName::T, createSystemStateElement<ExtendedPoseState>(std::make_tuple())),
+      std::make_pair(SystemStateElementName::b, createSystemStateElement<BiasState>(std::make_tuple())));
+
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    MSCEqFState X(opts.state_options_, xi0);
+    Propagator propagator(opts.propagator_options_);
+
+    // Propagate with random IMU readings between clones, such that each clone has its own covariance
+    fp timestamp = 0;
+    for (int k = 0; k <= 60; ++k)
+    {
+      Imu imu;
+      imu.ang_ = Vector3::Random();
+      imu.acc_ = 10 * Vector3::Random();
+      imu.timestamp_ = 0.01 * k;
+      propagator.insertImu(X, xi0, imu, timestamp);
+    }
+    for (int k = 1; k <= 5; ++k)
+    {
+      ASSERT_TRUE(propagator.propagate(X, xi0, timestamp, 0.1 * k));
+      X.stochasticCloning(timestamp);
+    }
+
+    const std::vector<fp> timestamps = X.clonesTimestamps();
+    const fp removed = timestamps[2];
+    const uint removed_idx = X.index(removed);
+    const uint removed_dof = X.dof(removed);
+    const Eigen::Index rows = X.cov().rows();
+
+    std::vector<MSCEqFState::MSCEqFKey> keys = {MSCEqFStateElementName::Dd, MSCEqFStateElementName::E};
+    if (opts.state_options_.enable_camera_intrinsics_calibration_)
+    {
+      keys.emplace_back(MSCEqFStateElementName::L);
+    }
+    std::vector<uint> indices;
+    for (const auto& t : timestamps)
+    {
+      if (t != removed)
+      {
+        keys.emplace_back(t);
+        indices.emplace_back(X.index(t));
+      }
+    }
+    const MatrixX P = X.subCov(keys);
+
+    X.marginalizeCloneAt(removed);
+
+    // The clone and its covariance block are removed, all the remaining (cross-)covariances are unchanged
+    ASSERT_EQ(X.clonesSize(), timestamps.size() - 1);
+    ASSERT_EQ(X.cov().rows(), rows - removed_dof);
+    ASSERT_EQ(X.cov().cols(), rows - removed_dof);
+    MatrixEquality(X.subCov(keys), P);
+    MatrixEquality(X.cov(), MatrixX(X.cov().transpose()));
+
+    // Indices of the clones following the removed one are shifted, the others are unchanged
+    size_t k = 0;
+    for (const auto& t : X.clonesTimestamps())
+    {
+      EXPECT_NE(t, removed);
+      EXPECT_EQ(X.index(t), indices[k] > removed_idx ? indices[k] - removed_dof : indices[k]);
+      EXPECT_LE(X.index(t) + X.dof(t), X.cov().rows());
+      ++k;
+    }
+
+    // A new clone is appended after the remaining elements
+    X.stochasticCloning(0.6);
+    EXPECT_EQ(X.index(0.6), rows - removed_dof);
+    MatrixEquality(X.covBlock(0.6), X.covBlock(MSCEqFStateElementName::E));
+  }
+}
+
+TEST(MSCEqFStateTest, SecondaryCamerasTest)
+{
+  MSCEqFOptions opts = parseTestOptions();
+
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    opts.state_options_.enable_camera_intrinsics_calibration_ = static_cast<bool>(utils::random<int>(0, 1));
+    opts.state_options_.secondary_cameras_extrinsics_ = {SE3::exp(Vector6::Random()), SE3::exp(Vector6::Random())};
+    opts.state_options_.secondary_cameras_intrinsics_ = {In(Vector4(100 * Vector4::Random().cwiseAbs())),
+                                                         In(Vector4(100 * Vector4::Random().cwiseAbs()))};
+    const bool calibration = opts.state_options_.enable_camera_intrinsics_calibration_;
+
+    SystemState xi0(opts.state_options_);
+    MSCEqFState X(opts.state_options_, xi0);
+    Propagator propagator(opts.propagator_options_);
+
+    // The calibration of the secondary cameras starts at the identity, uncorrelated with the other elements
+    const size_t core_size = calibration ? 25 : 21;
+    const size_t calibration_size = calibration ? 10 : 6;
+    ASSERT_EQ(X.cov().rows(), core_size + 2 * calibration_size);
+    for (uint cam_id = 1; cam_id <= 2; ++cam_id)
+    {
+      const auto E_key = MSCEqFState::cameraKey(MSCEqFStateElementName::E, cam_id);
+      const SE3& S0 = opts.state_options_.secondary_cameras_extrinsics_[cam_id - 1];
+      const In& K0 = opts.state_options_.secondary_cameras_intrinsics_[cam_id - 1];
+      MatrixEquality(xi0.S(cam_id).asMatrix(), S0.asMatrix());
+      MatrixEquality(xi0.K(cam_id).asMatrix(), K0.asMatrix());
+      MatrixEquality(X.E(cam_id).asMatrix(), Matrix4::Identity());
+      MatrixEquality(X.covBlock(E_key), opts.state_options_.E_init_cov_);
+      EXPECT_EQ(X.index(E_key), core_size + (cam_id - 1) * calibration_size);
+      if (calibration)
+      {
+        const auto L_key = MSCEqFState::cameraKey(MSCEqFStateElementName::L, cam_id);
+        MatrixEquality(X.L(cam_id).asMatrix(), Matrix3::Identity());
+        MatrixEquality(X.covBlock(L_key), opts.state_options_.L_init_cov_);
+        EXPECT_EQ(X.index(L_key), X.index(E_key) + 6);
+      }
+    }
+    MatrixEquality(X.cov().topRightCorner(core_size, 2 * calibration_size),
+                   MatrixX::Zero(core_size, 2 * calibration_size));
+
+    // Propagation with random IMU readings does not change the calibration of the secondary cameras
+    const MSCEqFState X_random = X.Random();
+    X = X_random;
+    fp timestamp = 0;
+    for (int k = 0; k <= 20; ++k)
+    {
+      Imu imu;
+      imu.ang_ = Vector3::Random();
+      imu.acc_ = 10 * Vector3::Random();
+      imu.timestamp_ = 0.01 * k;
+      propagator.insertImu(X, xi0, imu, timestamp);
+    }
+    ASSERT_TRUE(propagator.propagate(X, xi0, timestamp, 0.2));
+    for (uint cam_id = 1; cam_id <= 2; ++cam_id)
+    {
+      MatrixEquality(X.E(cam_id).asMatrix(), X_random.E(cam_id).asMatrix());
+      if (calibration)
+      {
+        MatrixEquality(X.L(cam_id).asMatrix(), X_random.L(cam_id).asMatrix());
+      }
+    }
+
+    // Clones of the secondary cameras are composed with the extrinsics of the camera rig and their E element, that is
+    // with the estimated extrinsics of the secondary cameras with respect to the primary camera
+    X.stochasticCloning(timestamp);
+    const SystemState xi = Symmetry::phi(X, xi0);
+    for (uint cam_id = 1; cam_id <= 2; ++cam_id)
+    {
+      MatrixEquality(X.clone(timestamp, cam_id).asMatrix(),
+                     (X.clone(timestamp) * xi0.S(cam_id) * X.E(cam_id)).asMatrix());
+      MatrixEquality(X.clone(timestamp, cam_id).asMatrix(), (X.clone(timestamp) * xi.S(cam_id)).asMatrix());
+    }
+  }
+}
+
 }  // namespace msceqf
 
 #endif  // TEST_STATE_HPP
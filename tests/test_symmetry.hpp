@@ -42,6 +42,10 @@ TEST(SymmetryTest, phi_without_persistent_features)
     Vector4 intrinsics = Vector4::Random().cwiseAbs();
     opts.state_options_.initial_camera_intrinsics_ = In(intrinsics);
 
+    // Secondary camera
+    opts.state_options_.secondary_cameras_extrinsics_ = {SE3::exp(Vector6::Random())};
+    opts.state_options_.secondary_cameras_intrinsics_ = {In(Vector4(Vector4::Random().cwiseAbs()))};
+
     // xi0 (implicit extrinsics and intrinsics in construction)
     SystemState xi0(
         opts.state_options_,
@@ -59,6 +63,14 @@ TEST(SymmetryTest, phi_without_persistent_features)
     SystemState xi1 = Symmetry::phi(X2, Symmetry::phi(X1, xi));
     SystemState xi2 = Symmetry::phi(X1 * X2, xi);
     SystemStateEquality(xi1, xi2);
+
+    // The calibration of the secondary camera relative to the primary camera is acted on by its own elements only
+    SystemState xi3 = Symmetry::phi(X1, xi0);
+    MatrixEquality(xi3.S(1).asMatrix(), (xi0.S(1) * X1.E(1)).asMatrix());
+    if (opts.state_options_.enable_camera_intrinsics_calibration_)
+    {
+      MatrixEquality(xi3.K(1).asMatrix(), (xi0.K(1) * X1.L(1)).asMatrix());
+    }
   }
 }
 
@@ -171,6 +183,37 @@ TEST(SymmetryTest, lift)
   }
 }
 
+TEST(SymmetryTest, curvature_correction)
+{
+  // Options
+  MSCEqFOptions opts = parseTestOptions();
+
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    // Set specific options for this test independently by given parameters
+    opts.state_options_.enable_camera_intrinsics_calibration_ = static_cast<bool>(utils::random<int>(0, 1));
+    opts.state_options_.num_persistent_features_ = 0;
+    opts.state_options_.secondary_cameras_extrinsics_ = {SE3::exp(Vector6::Random())};
+    opts.state_options_.secondary_cameras_intrinsics_ = {In(1.0, 1.0, 0.0, 0.0)};
+
+    SystemState xi0(opts.state_options_);
+    MSCEqFState X(opts.state_options_, xi0);
+    for (size_t k = 0; k < 5; ++k)
+    {
+      X.stochasticCloning(0.1 * k);
+    }
+
+    const VectorX inn = 0.1 * VectorX::Random(X.cov().rows());
+
+    // The block-wise correction matches the correction with the full Gamma matrix
+    const MatrixX expGamma = Symmetry::curvatureCorrection(X, inn);
+    const MatrixX cov = expGamma * X.cov() * expGamma.transpose();
+    Symmetry::applyCurvatureCorrection(X, inn);
+
+    MatrixEquality(X.cov(), cov);
+  }
+}
+
 }  // namespace msceqf
 
 #endif  // TEST_SYMMETRY_HPP
\ No newline at end of file
@@ -0,0 +1,350 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_TRACK_MANAGER_HPP
+#define TEST_TRACK_MANAGER_HPP
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "utils/track_cache.hpp"
+#include "vision/track_manager.hpp"
+#include "msceqf/options/msceqf_option_parser.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Generate a batch of features. Each feature is observed for the given number of consecutive frames, after
+ * which it is replaced by a new one
+ *
+ * @param frame Frame index
+ * @param num_features Number of features per batch
+ * @param lifetime Number of frames a feature is observed for
+ * @param points Flag to indicate whether to generate 3D points
+ * @return Features measurement
+ */
+TriangulatedFeatures featuresBatch(const size_t& frame,
+                                   const size_t& num_features,
+                                   const size_t& lifetime,
+                                   const bool& points)
+{
+  TriangulatedFeatures features;
+  features.timestamp_ = 0.05 * frame;
+  features.features_.ids_.reserve(num_features);
+  features.features_.uvs_.reserve(num_features);
+  features.features_.normalized_uvs_.reserve(num_features);
+
+  for (size_t j = 0; j < num_features; ++j)
+  {
+    // Features are renewed in a staggered way
+    const uint id = static_cast<uint>(((frame + j) / lifetime) * num_features + j);
+    const Vector3 f = Vector3::Random() + 5 * Vector3::UnitZ();
+    features.features_.ids_.emplace_back(id);
+    features.features_.uvs_.emplace_back(500 * f(0) / f(2) + 320, 500 * f(1) / f(2) + 240);
+    features.features_.normalized_uvs_.emplace_back(f(0) / f(2), f(1) / f(2));
+    if (points)
+    {
+      features.points_.emplace_back(f);
+    }
+  }
+
+  return features;
+}
+
+TEST(TrackManagerTest, FeaturesIngestionTest)
+{
+  // Options
+  MSCEqFOptions opts = parseTestOptions();
+
+  TrackManager track_manager(opts.track_manager_options_, opts.state_options_.initial_camera_intrinsics_.k());
+
+  constexpr size_t num_frames = 50;
+  constexpr size_t num_features = 100;
+  constexpr size_t lifetime = 10;
+
+  for (size_t frame = 0; frame < num_frames; ++frame)
+  {
+    // Points are not given for a few frames, tracks spanning these frames have to drop their points
+    track_manager.processFeatures(featuresBatch(frame, num_features, lifetime, frame != 5 && frame != 25));
+
+    for (const auto& [id, track] : track_manager.tracks())
+    {
+      EXPECT_TRUE(track.size() <= opts.track_manager_options_.max_track_length_);
+      EXPECT_TRUE(track.points_.empty() || track.hasPoints());
+    }
+  }
+
+  // Tracks alive at the last frame have not been observed in a frame without points, hence they hold all their points
+  std::unordered_set<uint> active_ids;
+  track_manager.activeTracksIds(0.05 * (num_frames - 1), active_ids);
+  for (const auto& id : active_ids)
+  {
+    const auto& track = track_manager.tracks().at(id);
+    EXPECT_TRUE(track.hasPoints());
+    for (size_t i = 0; i < track.size(); ++i)
+    {
+      EXPECT_NEAR(track.points_[i](0) / track.points_[i](2), track.normalized_uvs_[i].x, 1e-6);
+      EXPECT_NEAR(track.points_[i](1) / track.points_[i](2), track.normalized_uvs_[i].y, 1e-6);
+    }
+  }
+}
+
+TEST(TrackManagerTest, FeaturesIngestionBenchmark)
+{
+  // Options
+  MSCEqFOptions opts = parseTestOptions();
+
+  TrackManager track_manager(opts.track_manager_options_, opts.state_options_.initial_camera_intrinsics_.k());
+
+  constexpr size_t num_frames = 500;
+  constexpr size_t num_features = 1000;
+  constexpr size_t lifetime = 20;
+
+  std::vector<TriangulatedFeatures> batches;
+  batches.reserve(num_frames);
+  for (size_t frame = 0; frame < num_frames; ++frame)
+  {
+    batches.emplace_back(featuresBatch(frame, num_features, lifetime, true));
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t frame = 0; frame < num_frames; ++frame)
+  {
+    track_manager.processFeatures(batches[frame]);
+
+    // Bound the number of tracks as the filter would do, removing the lost tracks
+    std::unordered_set<uint> lost_ids;
+    track_manager.lostTracksIds(batches[frame].timestamp_, lost_ids);
+    track_manager.removeTracksId(lost_ids);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  // Ingestion (including lost tracks removal) has to stay well within the frame budget, 10us per feature amounts to
+  // 10ms for a frame of 1000 features
+  const fp ns = std::chrono::duration<fp, std::nano>(end - start).count() / (num_frames * num_features);
+  RecordProperty("ns_per_feature", std::to_string(ns));
+  EXPECT_LT(ns, 1e4);
+
+  EXPECT_EQ(track_manager.tracks().size(), num_features);
+}
+
+/**
+ * @brief Check the running disparity statistics of the track manager against the statistics computed over all the
+ * tracks
+ *
+ * @param track_manager Track manager
+ */
+void disparityStatisticsEquality(const TrackManager& track_manager)
+{
+  size_t longest = 0;
+  for (const auto& [id, track] : track_manager.tracks())
+  {
+    longest = std::max(longest, track.size());
+  }
+
+  fp disparity = 0;
+  fp span = 0;
+  size_t cnt = 0;
+  for (const auto& [id, track] : track_manager.tracks())
+  {
+    if (track.size() == longest)
+    {
+      disparity += cv::norm(track.uvs_.back() - track.uvs_.front());
+      span += track.timestamps_.back() - track.timestamps_.front();
+      ++cnt;
+    }
+  }
+
+  const DisparityStatistics& stats = track_manager.disparityStatistics();
+  EXPECT_EQ(stats.longest(), longest);
+  if (cnt > 0)
+  {
+    EXPECT_NEAR(stats.longestDisparity(), disparity / cnt, 1e-6);
+    EXPECT_NEAR(stats.longestSpan(), span / cnt, 1e-6);
+  }
+}
+
+TEST(TrackManagerTest, DisparityStatisticsTest)
+{
+  // Options
+  MSCEqFOptions opts = parseTestOptions();
+
+  TrackManager track_manager(opts.track_manager_options_, opts.state_options_.initial_camera_intrinsics_.k());
+
+  constexpr size_t num_frames = 100;
+  constexpr size_t num_features = 100;
+  constexpr size_t lifetime = 15;
+
+  for (size_t frame = 0; frame < num_frames; ++frame)
+  {
+    const fp timestamp = 0.05 * frame;
+    track_manager.processFeatures(featuresBatch(frame, num_features, lifetime, false));
+    disparityStatisticsEquality(track_manager);
+
+    std::unordered_set<uint> lost_ids;
+    track_manager.lostTracksIds(timestamp, lost_ids);
+    track_manager.removeTracksId(lost_ids);
+    disparityStatisticsEquality(track_manager);
+
+    // Trim the tracks as the marginalization of clones would do
+    if (frame % 7 == 0 && frame > 0)
+    {
+      track_manager.removeTracksAt(timestamp - 0.05);
+      disparityStatisticsEquality(track_manager);
+    }
+    if (frame % 11 == 0 && frame > 5)
+    {
+      track_manager.removeTracksTail(timestamp - 0.25);
+      disparityStatisticsEquality(track_manager);
+    }
+  }
+
+  track_manager.clear();
+  disparityStatisticsEquality(track_manager);
+}
+
+/**
+ * @brief Generate a textured camera measurement (blurred noise) with the resolution of the test parameters, shifted by
+ * the given number of pixels
+ *
+ * @param texture Texture of the camera measurement (larger than the resolution by the maximum shift)
+ * @param shift Shift in pixels
+ * @param timestamp Timestamp of the measurement
+ * @return Camera measurement
+ */
+Camera texturedFrame(const cv::Mat& texture, const int& shift, const fp& timestamp)
+{
+  Camera cam;
+  texture(cv::Rect(shift, shift, 640, 480)).copyTo(cam.image_);
+  cam.mask_ = 255 * cv::Mat::ones(480, 640, CV_8UC1);
+  cam.timestamp_ = timestamp;
+  return cam;
+}
+
+TEST(TrackManagerTest, MultiCameraTracksTest)
+{
+  // Options
+  MSCEqFOptions opts = parseTestOptions();
+
+  // The secondary camera replicates the primary camera
+  opts.track_manager_options_.secondary_trackers_options_ = {opts.track_manager_options_.tracker_options_};
+  const std::vector<In> secondary_intrinsics = {opts.state_options_.initial_camera_intrinsics_};
+
+  TrackManager track_manager(opts.track_manager_options_, opts.state_options_.initial_camera_intrinsics_.k(),
+                             secondary_intrinsics, std::make_shared<utils::threadPool>(1));
+  ASSERT_EQ(track_manager.numCameras(), 2u);
+
+  // Each camera observes a different texture
+  std::vector<cv::Mat> textures(2);
+  for (auto& texture : textures)
+  {
+    texture = cv::Mat(500, 660, CV_8UC1);
+    cv::randu(texture, 0, 255);
+    cv::GaussianBlur(texture, texture, cv::Size(5, 5), 1.5);
+  }
+
+  constexpr size_t num_frames = 3;
+  for (size_t frame = 0; frame < num_frames; ++frame)
+  {
+    const fp timestamp = 0.05 * frame;
+    const int shift = 2 * static_cast<int>(frame);
+    std::vector<Camera> cams = {texturedFrame(textures[0], shift, timestamp),
+                                texturedFrame(textures[1], shift, timestamp)};
+    track_manager.processCameras(cams);
+  }
+
+  // Track ids are unique across cameras, and they map back to the camera observing the feature
+  std::vector<size_t> tracks_per_camera(track_manager.numCameras(), 0);
+  for (const auto& [id, track] : track_manager.tracks())
+  {
+    EXPECT_EQ(track.cam_id_, id % track_manager.numCameras());
+    EXPECT_EQ(track_manager.trackId(id / track_manager.numCameras(), track.cam_id_), id);
+    ++tracks_per_camera[track.cam_id_];
+  }
+  EXPECT_GT(tracks_per_camera[0], 0u);
+  EXPECT_GT(tracks_per_camera[1], 0u);
+
+  // Features of the primary camera tracker are the tracks of the primary camera
+  std::unordered_set<uint> active_ids;
+  track_manager.activeTracksIds(0.05 * (num_frames - 1), active_ids);
+  const auto& [timestamp, features] = track_manager.currentFeatures();
+  for (const auto& feature_id : features.ids_)
+  {
+    const uint id = track_manager.trackId(feature_id, 0);
+    ASSERT_TRUE(active_ids.count(id));
+    EXPECT_EQ(track_manager.tracks().at(id).cam_id_, 0u);
+  }
+
+  // Features measurements are mapped as the ones of the primary camera
+  track_manager.clear();
+  track_manager.processFeatures(featuresBatch(0, 10, 10, false));
+  for (const auto& [id, track] : track_manager.tracks())
+  {
+    EXPECT_EQ(id % track_manager.numCameras(), 0u);
+    EXPECT_EQ(track.cam_id_, 0u);
+  }
+}
+
+TEST(TrackManagerTest, TrackCacheRoundTripTest)
+{
+  const std::string filename = (std::filesystem::temp_directory_path() / "msceqf_test_tracks.cache").string();
+
+  // Frames with bearings, without bearings, and without features
+  std::vector<TriangulatedFeatures> frames;
+  for (size_t frame = 0; frame < 3; ++frame)
+  {
+    TriangulatedFeatures features = featuresBatch(frame, frame == 2 ? 0 : 50, 10, false);
+    for (size_t j = 0; j < features.features_.ids_.size(); ++j)
+    {
+      const cv::Point2f& uvn = features.features_.normalized_uvs_[j];
+      features.features_.distorted_uvs_.emplace_back(features.features_.uvs_[j] + cv::Point2f(0.5f, -0.5f));
+      if (frame == 0)
+      {
+        const Vector3 bearing = Vector3(uvn.x, uvn.y, 1).normalized();
+        features.features_.bearings_.emplace_back(bearing.x(), bearing.y(), bearing.z());
+      }
+    }
+    frames.emplace_back(features);
+  }
+
+  {
+    utils::trackCacheWriter writer(filename);
+    for (const auto& features : frames)
+    {
+      writer.write(features.timestamp_, features.features_);
+    }
+  }
+
+  utils::trackCacheReader reader(filename);
+  for (const auto& expected : frames)
+  {
+    ASSERT_TRUE(reader.hasNextFeatures());
+    EXPECT_EQ(reader.nextTimestamp(), expected.timestamp_);
+
+    const TriangulatedFeatures features = reader.nextFeatures();
+    EXPECT_EQ(features.timestamp_, expected.timestamp_);
+    EXPECT_EQ(features.features_.ids_, expected.features_.ids_);
+    EXPECT_EQ(features.features_.distorted_uvs_, expected.features_.distorted_uvs_);
+    EXPECT_EQ(features.features_.uvs_, expected.features_.uvs_);
+    EXPECT_EQ(features.features_.normalized_uvs_, expected.features_.normalized_uvs_);
+    EXPECT_EQ(features.features_.bearings_, expected.features_.bearings_);
+    EXPECT_TRUE(features.points_.empty());
+  }
+  EXPECT_FALSE(reader.hasNextFeatures());
+  EXPECT_THROW(reader.nextFeatures(), std::runtime_error);
+
+  std::filesystem::remove(filename);
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_TRACK_MANAGER_HPP
@@ -0,0 +1,64 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_TRAJECTORY_EVALUATION_HPP
+#define TEST_TRAJECTORY_EVALUATION_HPP
+
+#include "utils/trajectory_evaluation.hpp"
+
+namespace msceqf
+{
+TEST(TrajectoryEvaluationTest, AlignmentInvarianceTest)
+{
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    // Helix trajectory
+    std::vector<utils::timedPose> groundtruth;
+    for (int k = 0; k < 2000; ++k)
+    {
+      const fp t = 0.01 * k;
+      utils::timedPose pose;
+      pose.timestamp_ = t;
+      pose.q_ = Quaternion(Eigen::AngleAxis<fp>(t, Vector3::UnitZ()) *
+                           Eigen::AngleAxis<fp>(0.1 * std::sin(t), Vector3::UnitX()));
+      pose.p_ = Vector3(5 * std::cos(t), 5 * std::sin(t), 0.3 * t);
+      groundtruth.emplace_back(pose);
+    }
+
+    // The estimate differs from the groundtruth by a position and yaw transformation only
+    const Quaternion q(Eigen::AngleAxis<fp>(M_PI * Vector2::Random()(0), Vector3::UnitZ()));
+    const Vector3 p = 10 * Vector3::Random();
+    std::vector<utils::timedPose> estimate;
+    std::vector<utils::timedPose> noisy_estimate;
+    for (const auto& pose : groundtruth)
+    {
+      estimate.push_back({pose.timestamp_, q * pose.q_, q * pose.p_ + p});
+      noisy_estimate.push_back({pose.timestamp_, q * pose.q_, q * pose.p_ + p + 0.1 * Vector3::Random()});
+    }
+
+    const utils::trajectoryErrors errors = utils::evaluateTrajectory(estimate, groundtruth, 10);
+    EXPECT_EQ(errors.poses_, groundtruth.size());
+    EXPECT_GT(errors.segments_, 0);
+    EXPECT_NEAR(errors.ate_position_, 0, 1e-6);
+    EXPECT_NEAR(errors.ate_rotation_, 0, 1e-6);
+    EXPECT_NEAR(errors.rpe_translation_, 0, 1e-6);
+    EXPECT_NEAR(errors.rpe_rotation_, 0, 1e-6);
+
+    const utils::trajectoryErrors noisy_errors = utils::evaluateTrajectory(noisy_estimate, groundtruth, 10);
+    EXPECT_GT(noisy_errors.ate_position_, 0.01);
+    EXPECT_LT(noisy_errors.ate_position_, 0.2);
+    EXPECT_GT(noisy_errors.rpe_translation_, 0.01);
+  }
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_TRAJECTORY_EVALUATION_HPP
@@ -0,0 +1,517 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_UPDATER_HPP
+#define TEST_UPDATER_HPP
+
+#include "msceqf/filter/updater/updater.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Check that the given covariance is symmetric and positive semi-definite
+ *
+ * @param cov Covariance matrix
+ */
+void CovarianceValidity(const MatrixX& cov)
+{
+  MatrixEquality(cov, cov.transpose(), 1e-9);
+  const VectorX eigenvalues = Eigen::SelfAdjointEigenSolver<MatrixX>(cov).eigenvalues();
+  EXPECT_GT(eigenvalues.minCoeff(), -1e-9 * std::max(fp(1.0), eigenvalues.maxCoeff()));
+}
+
+/**
+ * @brief Get the estimate of a persistent feature in origin frame G0_f = Q^-1 * (P * S)^-1 * f
+ *
+ * @param X MSCEqF state
+ * @param xi0 System state origin
+ * @param id Id of the persistent feature
+ * @return Persistent feature in origin frame
+ */
+Vector3 persistentFeatureEstimate(const MSCEqFState& X, const SystemState& xi0, const uint& id)
+{
+  return X.Q(id).inv() * ((xi0.P() * xi0.S()).inv() * xi0.f(id));
+}
+
+/**
+ * @brief Get options for updater tests, camera intrinsics calibration is disabled and the pixel standard deviation is
+ * expressed on the unit plane
+ *
+ * @param pixel_std Standard deviation of the normalized coordinates
+ * @return MSCEqF options
+ */
+MSCEqFOptions updaterTestOptions(const fp& pixel_std)
+{
+  MSCEqFOptions opts = parseTestOptions();
+  opts.state_options_.enable_camera_intrinsics_calibration_ = false;
+  opts.state_options_.num_persistent_features_ = 1;
+  opts.updater_options_.pixel_std_ = pixel_std;
+  return opts;
+}
+
+TEST(UpdaterTest, PersistentFeatureInitializationTest)
+{
+  const fp noise = 2e-3;
+  MSCEqFOptions opts = updaterTestOptions(noise);
+
+  int initialized = 0;
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    SystemState xi0(opts.state_options_);
+    MSCEqFState X(opts.state_options_, xi0);
+    ColsMap cols_map;
+    randomClones(X, opts.updater_options_.min_track_lenght_ + 1, cols_map);
+
+    Track track;
+    Vector3 A_f;
+    randomTrack(X, track, A_f, 0, noise);
+
+    Updater updater(opts.updater_options_, xi0);
+    const uint id = 42;
+    Vector3 G0_f;
+    if (!updater.persistentFeatureInitialization(X, track, id, G0_f))
+    {
+      // Initialization can be rejected by the chi2 test
+      continue;
+    }
+    ++initialized;
+
+    // The feature and its cross covariance with the clones keep the covariance symmetric positive semi-definite
+    EXPECT_TRUE(X.hasPersistentFeature(id));
+    CovarianceValidity(X.cov());
+    CovarianceValidity(X.covBlock(MSCEqFState::MSCEqFStateKey(id)));
+
+    // A feature cannot be initialized twice
+    Vector3 G0_f_twice;
+    EXPECT_FALSE(updater.persistentFeatureInitialization(X, track, id, G0_f_twice));
+  }
+  EXPECT_GT(initialized, N_TESTS / 2);
+}
+
+TEST(UpdaterTest, PersistentFeatureConvergenceTest)
+{
+  const fp noise = 2e-3;
+  MSCEqFOptions opts = updaterTestOptions(noise);
+
+  SystemState xi0(opts.state_options_);
+  MSCEqFState X(opts.state_options_, xi0);
+  ColsMap cols_map;
+  randomClones(X, opts.updater_options_.min_track_lenght_ + 1, cols_map);
+
+  // Feature initialized from a noisy track
+  const uint id = 42;
+  Tracks tracks;
+  Vector3 A_f;
+  randomTrack(X, tracks[id], A_f, 0, noise);
+  const Vector3 G0_f_true = X.clone(tracks.at(id).timestamps_.front()) * A_f;
+
+  Updater updater(opts.updater_options_, xi0);
+  Vector3 G0_f;
+  ASSERT_TRUE(updater.persistentFeatureInitialization(X, tracks.at(id), id, G0_f));
+  xi0.insertFeature(id, xi0.P() * xi0.S() * G0_f);
+
+  const fp initial_error = (persistentFeatureEstimate(X, xi0, id) - G0_f_true).norm();
+
+  // The camera moves around the feature, which is observed without noise
+  fp timestamp = X.clonesTimestamps().back();
+  for (int k = 0; k < 20; ++k)
+  {
+    Vector3 C_f = Vector3::Zero();
+    while (C_f(2) < 0.5)
+    {
+      MSCEqFState X_moved(X);
+      X_moved.updateLeft(MSCEqFStateElementName::E, 0.05 * Vector6::Random());
+      C_f = X_moved.E().inv() * G0_f_true;
+      if (C_f(2) >= 0.5)
+      {
+        X = X_moved;
+      }
+    }
+
+    timestamp += 0.1;
+    X.stochasticCloning(timestamp);
+
+    auto& track = tracks.at(id);
+    const Vector2 uvn = C_f.head<2>() / C_f(2);
+    track.uvs_.emplace_back(uvn(0), uvn(1));
+    track.normalized_uvs_.emplace_back(uvn(0), uvn(1));
+    track.timestamps_.emplace_back(timestamp);
+
+    updater.persistentFeaturesUpdate(X, tracks, {id}, timestamp);
+    CovarianceValidity(X.cov());
+  }
+
+  // The estimate moves towards the true feature, and it reprojects onto the last observation
+  const Vector3 G0_f_estimate = persistentFeatureEstimate(X, xi0, id);
+  EXPECT_LE((G0_f_estimate - G0_f_true).norm(), initial_error + EPS);
+
+  const Vector3 C_f_estimate = X.clone(timestamp).inv() * G0_f_estimate;
+  const Vector3 C_f_true = X.clone(timestamp).inv() * G0_f_true;
+  MatrixEquality(C_f_estimate.head<2>() / C_f_estimate(2), C_f_true.head<2>() / C_f_true(2), noise);
+}
+
+TEST(UpdaterTest, WideAngleTriangulationTest)
+{
+  for (const bool& refine : {true, false})
+  {
+    MSCEqFOptions opts = updaterTestOptions(1e-3);
+    opts.updater_options_.refine_traingulation_ = refine;
+    opts.updater_options_.min_angle_ = 0;
+
+    for (int i = 0; i < N_TESTS; ++i)
+    {
+      SystemState xi0(opts.state_options_);
+      MSCEqFState X(opts.state_options_, xi0);
+      ColsMap cols_map;
+      randomClones(X, opts.updater_options_.min_track_lenght_ + 1, cols_map);
+
+      // Noise-free bearings, some of which at or beyond 90 degrees, triangulate the feature
+      Track track;
+      Vector3 A_f;
+      wideAngleTrack(X, track, A_f);
+      const Vector3 G0_f_true = X.clone(track.timestamps_.front()) * A_f;
+
+      Updater updater(opts.updater_options_, xi0);
+      Vector3 G0_f;
+      ASSERT_TRUE(updater.triangulate(X, track, 0, G0_f));
+      MatrixEquality(G0_f, G0_f_true, 1e-4);
+    }
+  }
+}
+
+TEST(UpdaterTest, TriangulationCacheTest)
+{
+  const fp noise = 1e-3;
+
+  for (const bool& refine : {true, false})
+  {
+    MSCEqFOptions opts = updaterTestOptions(noise);
+    opts.updater_options_.refine_traingulation_ = refine;
+    opts.updater_options_.min_angle_ = 0;
+
+    SystemState xi0(opts.state_options_);
+    MSCEqFState X(opts.state_options_, xi0);
+    ColsMap cols_map;
+    randomClones(X, 3, cols_map);
+
+    // Features in front of the initial clones
+    constexpr size_t num_features = 10;
+    Tracks tracks;
+    std::vector<Vector3> features(num_features);
+    for (uint id = 0; id < num_features; ++id)
+    {
+      Vector3 A_f;
+      randomTrack(X, tracks[id], A_f, 0, noise);
+      features[id] = X.clone(tracks.at(id).timestamps_.front()) * A_f;
+    }
+
+    Updater cached(opts.updater_options_, xi0);
+    fp timestamp = X.clonesTimestamps().back();
+
+    for (int k = 0; k < 15; ++k)
+    {
+      // New clone, each feature in front of it is observed
+      X.updateLeft(MSCEqFStateElementName::E, 0.05 * Vector6::Random());
+      timestamp += 0.1;
+      X.stochasticCloning(timestamp);
+      for (auto& [id, track] : tracks)
+      {
+        const Vector3 C_f = X.clone(timestamp).inv() * features[id];
+        if (C_f(2) > 0.5)
+        {
+          const Vector2 uvn = C_f.head<2>() / C_f(2) + noise * Vector2::Random();
+          track.uvs_.emplace_back(uvn(0), uvn(1));
+          track.normalized_uvs_.emplace_back(uvn(0), uvn(1));
+          track.timestamps_.emplace_back(timestamp);
+        }
+      }
+      cached.addObservations(X, tracks, timestamp);
+
+      // Corrections of the clones as an update would do
+      if (k % 3 == 2)
+      {
+        for (const auto& clone_timestamp : X.clonesTimestamps())
+        {
+          X.updateLeft(clone_timestamp, 1e-3 * Vector6::Random());
+        }
+      }
+
+      // Marginalization of the oldest clone or of an intermediate clone, and trim of the tracks accordingly
+      if (k % 4 == 3)
+      {
+        const std::vector<fp> timestamps = X.clonesTimestamps();
+        const bool oldest = k % 8 == 3;
+        const fp marginalize_timestamp = oldest ? timestamps.front() : timestamps[timestamps.size() / 2];
+        X.marginalizeCloneAt(marginalize_timestamp);
+        for (auto it = tracks.begin(); it != tracks.end();)
+        {
+          if (oldest)
+          {
+            it->second.removeTail(marginalize_timestamp);
+          }
+          else
+          {
+            it->second.removeAt(marginalize_timestamp);
+          }
+          it = it->second.empty() ? tracks.erase(it) : std::next(it);
+        }
+      }
+
+      // Cached triangulation agrees with the triangulation from scratch
+      for (const auto& [id, track] : tracks)
+      {
+        if (track.size() < opts.updater_options_.min_track_lenght_)
+        {
+          continue;
+        }
+
+        Updater scratch(opts.updater_options_, xi0);
+        Vector3 G0_f_cached;
+        Vector3 G0_f_scratch;
+        const bool cached_valid = cached.triangulate(X, track, id, G0_f_cached);
+        const bool scratch_valid = scratch.triangulate(X, track, id, G0_f_scratch);
+
+        if (refine)
+        {
+          // The cached normal equations are linearized at past clones, the refinement converges to the same feature
+          if (cached_valid && scratch_valid)
+          {
+            MatrixEquality(G0_f_cached, G0_f_scratch, 1e-6);
+          }
+        }
+        else
+        {
+          EXPECT_EQ(cached_valid, scratch_valid);
+          if (cached_valid && scratch_valid)
+          {
+            MatrixEquality(G0_f_cached, G0_f_scratch, 1e-9);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(UpdaterTest, GivenPointsUpdateTest)
+{
+  const fp noise = 1e-3;
+  MSCEqFOptions opts = updaterTestOptions(noise);
+  opts.state_options_.num_persistent_features_ = 0;
+  opts.updater_options_.use_features_points_ = true;
+  opts.updater_options_.refine_traingulation_ = true;
+
+  SystemState xi0(opts.state_options_);
+  MSCEqFState X(opts.state_options_, xi0);
+  ColsMap cols_map;
+  randomClones(X, opts.updater_options_.min_track_lenght_ + 2, cols_map);
+
+  // Tracks given with their 3D points (feature in the frame of each observation) mixed with triangulated tracks
+  constexpr uint num_tracks = 20;
+  Tracks tracks;
+  std::unordered_set<uint> ids;
+  std::unordered_set<uint> given_ids;
+  for (uint id = 0; id < num_tracks; ++id)
+  {
+    Track& track = tracks[id];
+    Vector3 A_f;
+    randomTrack(X, track, A_f, 0, noise);
+    if (id % 2 == 0)
+    {
+      const Vector3 G0_f = X.clone(track.timestamps_.front()) * A_f;
+      for (const auto& timestamp : track.timestamps_)
+      {
+        track.points_.emplace_back(X.clone(timestamp).inv() * G0_f);
+      }
+      ASSERT_TRUE(track.hasPoints());
+      given_ids.insert(id);
+    }
+    ids.insert(id);
+  }
+
+  // Features with given points are neither accumulated nor warm started
+  Updater updater(opts.updater_options_, xi0);
+  updater.addObservations(X, tracks, X.clonesTimestamps().back());
+  ASSERT_NO_THROW(updater.mscUpdate(X, tracks, ids));
+
+  EXPECT_FALSE(ids.empty());
+  EXPECT_TRUE(std::any_of(ids.begin(), ids.end(), [&](const uint& id) { return given_ids.count(id) > 0; }));
+  CovarianceValidity(X.cov());
+}
+
+TEST(UpdaterTest, StreamingUpdateTest)
+{
+  const fp noise = 1e-3;
+  MSCEqFOptions opts = updaterTestOptions(noise);
+  opts.state_options_.num_persistent_features_ = 0;
+  opts.updater_options_.max_update_rows_ = 0;
+  opts.updater_options_.update_time_budget_ = 0;
+
+  SystemState xi0(opts.state_options_);
+  MSCEqFState X(opts.state_options_, xi0);
+  ColsMap cols_map;
+  randomClones(X, opts.updater_options_.min_track_lenght_ + 2, cols_map);
+
+  // Enough tracks for the streaming accumulation to fold the C matrix several times
+  constexpr uint num_tracks = 40;
+  Tracks tracks;
+  std::unordered_set<uint> ids;
+  for (uint id = 0; id < num_tracks; ++id)
+  {
+    Vector3 A_f;
+    randomTrack(X, tracks[id], A_f, 0, noise);
+    ids.insert(id);
+  }
+
+  MSCEqFState X_dense(X);
+  MSCEqFState X_streaming(X);
+  std::unordered_set<uint> ids_dense(ids);
+  std::unordered_set<uint> ids_streaming(ids);
+
+  opts.updater_options_.streaming_update_ = false;
+  Updater dense(opts.updater_options_, xi0);
+  dense.mscUpdate(X_dense, tracks, ids_dense);
+
+  opts.updater_options_.streaming_update_ = true;
+  Updater streaming(opts.updater_options_, xi0);
+  streaming.mscUpdate(X_streaming, tracks, ids_streaming);
+
+  // The same tracks are used, and the updated state and covariance agree
+  ASSERT_FALSE(ids_dense.empty());
+  EXPECT_EQ(ids_dense, ids_streaming);
+  MSCEqFStateEquality(X_dense, X_streaming, {}, 1e-6);
+  for (const auto& timestamp : X.clonesTimestamps())
+  {
+    MatrixEquality(X_dense.clone(timestamp).asMatrix(), X_streaming.clone(timestamp).asMatrix(), 1e-6);
+  }
+  MatrixEquality(X_dense.cov(), X_streaming.cov(), 1e-6);
+}
+
+TEST(UpdaterTest, TrackSelectionTest)
+{
+  MSCEqFOptions opts = updaterTestOptions(1e-3);
+  opts.state_options_.num_persistent_features_ = 0;
+  opts.updater_options_.update_time_budget_ = 0;
+  opts.updater_options_.streaming_update_ = false;
+  opts.updater_options_.selection_max_parallax_ = 1.0;
+  opts.updater_options_.selection_grid_size_ = 8;
+
+  SystemState xi0(opts.state_options_);
+  MSCEqFState X(opts.state_options_, xi0);
+  const size_t num_clones = opts.updater_options_.min_track_lenght_ + 2;
+  for (size_t k = 0; k < num_clones; ++k)
+  {
+    X.updateLeft(MSCEqFStateElementName::E, 0.05 * Vector6::Random());
+    X.stochasticCloning(0.1 * k);
+  }
+  const std::vector<fp> timestamps = X.clonesTimestamps();
+
+  // Noise-free track of a feature seen at the given normalized coordinates and depth from the last clone
+  auto track = [&](const Vector2& uvn, const fp& depth) {
+    const Vector3 G0_f = X.clone(timestamps.back()) * (depth * uvn.homogeneous());
+    Track t;
+    for (const auto& timestamp : timestamps)
+    {
+      const Vector3 C_f = X.clone(timestamp).inv() * G0_f;
+      t.uvs_.emplace_back(C_f(0) / C_f(2), C_f(1) / C_f(2));
+      t.normalized_uvs_.emplace_back(C_f(0) / C_f(2), C_f(1) / C_f(2));
+      t.timestamps_.emplace_back(timestamp);
+    }
+    return t;
+  };
+
+  // Three tracks in the same cell, the closer the feature the larger the parallax and the score, and a far feature
+  // with a low score alone in the opposite corner of the grid
+  Tracks tracks;
+  tracks[0] = track(Vector2(-0.3, -0.3), 1.0);
+  tracks[1] = track(Vector2(-0.295, -0.295), 2.0);
+  tracks[2] = track(Vector2(-0.29, -0.29), 4.0);
+  tracks[3] = track(Vector2(0.3, 0.3), 30.0);
+
+  // Rows of an anchored euclidean track with the unit plane projection
+  const uint track_rows = 2 * num_clones - 3;
+
+  // Budget of two tracks, the far feature covers its cell before the second best track of the crowded cell
+  opts.updater_options_.max_update_rows_ = 2 * track_rows;
+  std::unordered_set<uint> ids = {0, 1, 2, 3};
+  MSCEqFState X_two(X);
+  Updater two(opts.updater_options_, xi0);
+  two.mscUpdate(X_two, tracks, ids);
+  EXPECT_EQ(ids, std::unordered_set<uint>({0, 3}));
+
+  // Budget of three tracks, once the grid is covered the remaining budget goes to the best scores
+  opts.updater_options_.max_update_rows_ = 3 * track_rows;
+  ids = {0, 1, 2, 3};
+  MSCEqFState X_three(X);
+  Updater three(opts.updater_options_, xi0);
+  three.mscUpdate(X_three, tracks, ids);
+  EXPECT_EQ(ids, std::unordered_set<uint>({0, 1, 3}));
+}
+
+TEST(UpdaterTest, KeyframeParallaxTest)
+{
+  MSCEqFOptions opts = updaterTestOptions(1e-3);
+  SystemState xi0(opts.state_options_);
+  Updater updater(opts.updater_options_, xi0);
+  const fp fx = opts.state_options_.initial_camera_intrinsics_.k()(0);
+
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    MSCEqFState X(opts.state_options_, xi0);
+    ColsMap cols_map;
+    randomClones(X, 3, cols_map);
+    const std::vector<fp> timestamps = X.clonesTimestamps();
+    const fp& a = timestamps.front();
+    const fp& b = timestamps.back();
+    const Matrix3 R = X.clone(b, 0).R().transpose() * X.clone(a, 0).R();
+
+    // Track observed at a, and at b with the given offset from its rotation-compensated bearing
+    auto track = [&](const Vector2& offset) {
+      Vector3 b_f, a_f;
+      do
+      {
+        b_f = Vector2::Random().homogeneous();
+        a_f = R.transpose() * b_f;
+      } while (a_f(2) <= 0);
+      Track t;
+      t.cam_id_ = 0;
+      for (const auto& timestamp : timestamps)
+      {
+        const Vector2 uvn = timestamp == a ? Vector2(a_f.head<2>() / a_f(2)) : Vector2(b_f.head<2>() + offset);
+        t.uvs_.emplace_back(uvn(0), uvn(1));
+        t.normalized_uvs_.emplace_back(uvn(0), uvn(1));
+        t.timestamps_.emplace_back(timestamp);
+      }
+      return t;
+    };
+
+    // Without tracks observed at both timestamps the parallax is not available
+    Tracks tracks;
+    EXPECT_LT(updater.parallax(X, tracks, a, b), 0);
+    tracks[0] = track(Vector2::Zero());
+    tracks[0].normalized_uvs_.pop_back();
+    tracks[0].uvs_.pop_back();
+    tracks[0].timestamps_.pop_back();
+    EXPECT_LT(updater.parallax(X, tracks, a, b), 0);
+
+    // The rotation between the clones is compensated
+    tracks[0] = track(Vector2::Zero());
+    EXPECT_NEAR(updater.parallax(X, tracks, a, b), 0, 1e-6);
+
+    // Mean of the parallax of the tracks, in pixels
+    tracks[1] = track(Vector2(3e-3, 0));
+    tracks[2] = track(Vector2(0, -6e-3));
+    EXPECT_NEAR(updater.parallax(X, tracks, a, b), fx * 3e-3, 1e-6 * fx);
+  }
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_UPDATER_HPP
@@ -0,0 +1,254 @@
+// Copyright (C) 2023 Alessandro Fornasier.
+// Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the authors at <alessandro.fornasier@ieee.org>
+
+#ifndef TEST_ZERO_VELOCITY_HPP
+#define TEST_ZERO_VELOCITY_HPP
+
+#include <cmath>
+
+#include "msceqf/filter/checker/checker.hpp"
+#include "msceqf/filter/propagator/propagator.hpp"
+#include "msceqf/filter/updater/zero_velocity_updater.hpp"
+
+namespace msceqf
+{
+/**
+ * @brief Get the options for the IMU-based standstill detection tests (window of 0.5s)
+ *
+ * @param zero_velocity_update Zero velocity update method
+ * @return MSCEqF options
+ */
+MSCEqFOptions standstillTestOptions(const ZeroVelocityUpdate& zero_velocity_update)
+{
+  MSCEqFOptions opts = parseTestOptions();
+  opts.zvupdater_options_.zero_velocity_update_ = zero_velocity_update;
+  opts.zvupdater_options_.imu_standstill_detection_ = true;
+  opts.zvupdater_options_.imu_standstill_window_ = 0.5;
+  opts.zvupdater_options_.imu_standstill_acc_threshold_ = 0.05;
+  opts.zvupdater_options_.imu_standstill_ang_threshold_ = 1e-3;
+  return opts;
+}
+
+/**
+ * @brief Insert an IMU reading into the given propagator
+ *
+ * @param propagator Propagator
+ * @param X MSCEqF state
+ * @param xi0 Origin state
+ * @param timestamp Timestamp of the IMU reading
+ * @param acc Acceleration
+ * @param ang Angular velocity
+ */
+void insertImu(Propagator& propagator,
+               MSCEqFState& X,
+               const SystemState& xi0,
+               const fp& timestamp,
+               const Vector3& acc,
+               const Vector3& ang)
+{
+  Imu imu;
+  imu.acc_ = acc;
+  imu.ang_ = ang;
+  imu.timestamp_ = timestamp;
+  fp state_timestamp = 0;
+  propagator.insertImu(X, xi0, imu, state_timestamp);
+}
+
+TEST(ZeroVelocityTest, ImuVarianceTest)
+{
+  const MSCEqFOptions opts = standstillTestOptions(ZeroVelocityUpdate::ENABLE);
+  SystemState xi0(opts.state_options_);
+  MSCEqFState X(opts.state_options_, xi0);
+
+  for (int i = 0; i < N_TESTS; ++i)
+  {
+    Propagator propagator(opts.propagator_options_);
+    fp acc_var = -1;
+    fp ang_var = -1;
+
+    // At least two readings are needed
+    EXPECT_FALSE(propagator.imuVariance(0, 1, acc_var, ang_var));
+    insertImu(propagator, X, xi0, 0, Vector3::Random(), Vector3::Random());
+    EXPECT_FALSE(propagator.imuVariance(0, 1, acc_var, ang_var));
+
+    // Constant readings have zero variance
+    const Vector3 acc = 10 * Vector3::Random();
+    const Vector3 ang = Vector3::Random();
+    for (int k = 1; k <= 10; ++k)
+    {
+      insertImu(propagator, X, xi0, 0.01 * k, acc, ang);
+    }
+    ASSERT_TRUE(propagator.imuVariance(0.01, 0.1, acc_var, ang_var));
+    EXPECT_NEAR(acc_var, 0, 1e-12);
+    EXPECT_NEAR(ang_var, 0, 1e-12);
+
+    // Random readings, the variance is the trace of the sample covariance of the readings within the given interval
+    std::vector<Imu> readings;
+    for (int k = 11; k <= 30; ++k)
+    {
+      Imu imu;
+      imu.acc_ = 10 * Vector3::Random();
+      imu.ang_ = Vector3::Random();
+      imu.timestamp_ = 0.01 * k;
+      insertImu(propagator, X, xi0, imu.timestamp_, imu.acc_, imu.ang_);
+      if (k >= 15 && k <= 25)
+      {
+        readings.push_back(imu);
+      }
+    }
+
+    Vector3 acc_mean = Vector3::Zero();
+    Vector3 ang_mean = Vector3::Zero();
+    for (const auto& imu : readings)
+    {
+      acc_mean += imu.acc_ / readings.size();
+      ang_mean += imu.ang_ / readings.size();
+    }
+    fp acc_expected = 0;
+    fp ang_expected = 0;
+    for (const auto& imu : readings)
+    {
+      acc_expected += (imu.acc_ - acc_mean).squaredNorm() / (readings.size() - 1);
+      ang_expected += (imu.ang_ - ang_mean).squaredNorm() / (readings.size() - 1);
+    }
+
+    ASSERT_TRUE(propagator.imuVariance(0.15, 0.25, acc_var, ang_var));
+    EXPECT_NEAR(acc_var, acc_expected, 1e-9);
+    EXPECT_NEAR(ang_var, ang_expected, 1e-9);
+  }
+}
+
+TEST(ZeroVelocityTest, StandstillWindowTest)
+{
+  const MSCEqFOptions opts = standstillTestOptions(ZeroVelocityUpdate::ENABLE);
+  Checker checker(opts.checker_options_);
+  ZeroVelocityUpdater zvupdater(opts.zvupdater_options_, checker);
+
+  const fp& acc_threshold = opts.zvupdater_options_.imu_standstill_acc_threshold_;
+  const fp& ang_threshold = opts.zvupdater_options_.imu_standstill_ang_threshold_;
+  const fp dt = 0.125;
+
+  // Readings below threshold are accumulated until they cross the standstill window
+  for (int k = 0; k < 3; ++k)
+  {
+    EXPECT_FALSE(zvupdater.isStandstill(0, 0, dt));
+  }
+  EXPECT_TRUE(zvupdater.isStandstill(0, 0, dt));
+  EXPECT_TRUE(zvupdater.isStandstill(0.5 * acc_threshold, 0.5 * ang_threshold, dt));
+
+  // A single noisy sample resets the accumulated time, either on the acceleration or on the angular velocity
+  for (const auto& [acc_var, ang_var] :
+       {std::make_pair(2 * acc_threshold, fp(0)), std::make_pair(fp(0), 2 * ang_threshold)})
+  {
+    EXPECT_FALSE(zvupdater.isStandstill(acc_var, ang_var, dt));
+    for (int k = 0; k < 3; ++k)
+    {
+      EXPECT_FALSE(zvupdater.isStandstill(0, 0, dt));
+    }
+    EXPECT_TRUE(zvupdater.isStandstill(0, 0, dt));
+  }
+
+  // A single long interval below threshold is enough
+  EXPECT_FALSE(zvupdater.isStandstill(acc_threshold, 0, dt));
+  EXPECT_TRUE(zvupdater.isStandstill(0, 0, opts.zvupdater_options_.imu_standstill_window_));
+
+  // With the zero velocity update always enabled, standstill is detected also after the platform moved
+  zvupdater.setMotion();
+  EXPECT_TRUE(zvupdater.isStandstill(0, 0, dt));
+}
+
+TEST(ZeroVelocityTest, StandstillGatingTest)
+{
+  const fp window = standstillTestOptions(ZeroVelocityUpdate::ENABLE).zvupdater_options_.imu_standstill_window_;
+
+  // Standstill is never detected with the zero velocity update or the IMU-based detection disabled
+  {
+    const MSCEqFOptions opts = standstillTestOptions(ZeroVelocityUpdate::DISABLE);
+    Checker checker(opts.checker_options_);
+    ZeroVelocityUpdater zvupdater(opts.zvupdater_options_, checker);
+    for (int k = 0; k < 10; ++k)
+    {
+      EXPECT_FALSE(zvupdater.isStandstill(0, 0, window));
+    }
+  }
+  {
+    MSCEqFOptions opts = standstillTestOptions(ZeroVelocityUpdate::ENABLE);
+    opts.zvupdater_options_.imu_standstill_detection_ = false;
+    Checker checker(opts.checker_options_);
+    ZeroVelocityUpdater zvupdater(opts.zvupdater_options_, checker);
+    for (int k = 0; k < 10; ++k)
+    {
+      EXPECT_FALSE(zvupdater.isStandstill(0, 0, window));
+    }
+  }
+
+  // With the zero velocity update at the beginning only, standstill is not detected once the platform moved
+  {
+    const MSCEqFOptions opts = standstillTestOptions(ZeroVelocityUpdate::BEGINNING);
+    Checker checker(opts.checker_options_);
+    ZeroVelocityUpdater zvupdater(opts.zvupdater_options_, checker);
+    EXPECT_TRUE(zvupdater.isStandstill(0, 0, window));
+    zvupdater.setMotion();
+    for (int k = 0; k < 10; ++k)
+    {
+      EXPECT_FALSE(zvupdater.isStandstill(0, 0, window));
+    }
+  }
+}
+
+TEST(ZeroVelocityTest, ImuStandstillDetectionTest)
+{
+  const MSCEqFOptions opts = standstillTestOptions(ZeroVelocityUpdate::ENABLE);
+  SystemState xi0(opts.state_options_);
+  MSCEqFState X(opts.state_options_, xi0);
+  Propagator propagator(opts.propagator_options_);
+  Checker checker(opts.checker_options_);
+  ZeroVelocityUpdater zvupdater(opts.zvupdater_options_, checker);
+
+  // IMU readings at 256Hz, at rest with small noise, with a single bump at 0.625s. The detection runs at 16Hz on the
+  // readings since the previous check, as in the filter step
+  const Vector3 gravity(0, 0, 9.81);
+  const fp imu_dt = 1.0 / 256;
+  const fp cam_dt = 1.0 / 16;
+  const fp bump_timestamp = 0.625;
+  for (int k = 0; k <= 512; ++k)
+  {
+    const fp timestamp = k * imu_dt;
+    const fp bump = std::abs(timestamp - bump_timestamp) < 1e-9 ? 5.0 : 0.0;
+    insertImu(propagator, X, xi0, timestamp, gravity + 1e-2 * Vector3::Random() + Vector3::Constant(bump),
+              1e-3 * Vector3::Random());
+  }
+
+  std::vector<fp> standstill;
+  fp acc_var = 0;
+  fp ang_var = 0;
+  for (fp t = cam_dt; t < 2.0 - 1e-9; t += cam_dt)
+  {
+    ASSERT_TRUE(propagator.imuVariance(t - cam_dt, t, acc_var, ang_var));
+    if (zvupdater.isStandstill(acc_var, ang_var, cam_dt))
+    {
+      standstill.push_back(t);
+    }
+  }
+
+  // Standstill is detected once the window is filled, lost at the bump, and detected again one window later
+  ASSERT_FALSE(standstill.empty());
+  EXPECT_NEAR(standstill.front(), opts.zvupdater_options_.imu_standstill_window_, 1e-9);
+  for (const auto& t : standstill)
+  {
+    EXPECT_TRUE(t < bump_timestamp || t > bump_timestamp + opts.zvupdater_options_.imu_standstill_window_);
+  }
+  EXPECT_NEAR(standstill.back(), 2.0 - cam_dt, 1e-9);
+}
+
+}  // namespace msceqf
+
+#endif  // TEST_ZERO_VELOCITY_HPP
@@ -18,9 +18,19 @@
 #include "utils/logger.hpp"
 #include "utils/tools.hpp"
 #include "test_common.hpp"
+#include "test_data_parser.hpp"
+#include "test_feature_budget.hpp"
 #include "test_groups.hpp"
+#include "test_latency_histogram.hpp"
+#include "test_logger.hpp"
+#include "test_measurement_scheduler.hpp"
+#include "test_projection.hpp"
 #include "test_state.hpp"
 #include "test_symmetry.hpp"
+#include "test_track_manager.hpp"
+#include "test_trajectory_evaluation.hpp"
+#include "test_updater.hpp"
+#include "test_zero_velocity.hpp"
 
 int main(int argc, char **argv)
 {
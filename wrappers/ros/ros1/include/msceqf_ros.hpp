@@ -26,6 +26,7 @@
 #include <rosbag/bag.h>
 
 #include "msceqf/msceqf.hpp"
+#include "msceqf/scheduler/measurement_scheduler.hpp"
 
 class MSCEqFRos
 {
@@ -97,9 +98,8 @@ class MSCEqFRos
   sensor_msgs::CameraInfo intrinsics_;             //!< Intrinsics message
   geometry_msgs::PoseStamped origin_;              //!< Origin message
 
-  std::deque<msceqf::Camera> cams_;       //!< Camera measurements
-  std::mutex mutex_;                      //!< Camera measurements mutex
-  std::atomic<bool> processing_ = false;  //!< Camera measurements processing flag
+  msceqf::MeasurementScheduler scheduler_;  //!< Camera measurements scheduler
+  std::atomic<bool> processing_ = false;    //!< Camera measurements processing flag
 
   bool record_;      //!< Record flag
   rosbag::Bag bag_;  //!< Bagfile
@@ -27,7 +27,7 @@ MSCEqFRos::MSCEqFRos(const ros::NodeHandle &nh,
                      const std::string &origin_topic,
                      const bool &record,
                      const std::string &bagfile)
-    : nh_(nh), sys_(msceqf_config_filepath)
+    : nh_(nh), sys_(msceqf_config_filepath), scheduler_(sys_)
 {
   sub_cam_ = nh_.subscribe(cam_topic, 10, &MSCEqFRos::callback_image, this);
   sub_imu_ = nh_.subscribe(imu_topic, 1000, &MSCEqFRos::callback_imu, this);
@@ -69,16 +69,16 @@ void MSCEqFRos::callback_image(const sensor_msgs::Image::ConstPtr &msg)
     return;
   }
 
-  msceqf::Camera cam;
+  // Borrow the image buffer of the message (no copy), the view keeps the message alive until it is processed
+  const cv::Mat& image = cv_ptr->image;
+  msceqf::CameraView cam(image.data,
+                         image.cols,
+                         image.rows,
+                         image.step,
+                         cv_ptr->header.stamp.toSec(),
+                         [cv_ptr]() {});
 
-  cam.timestamp_ = cv_ptr->header.stamp.toSec();
-  cam.image_ = cv_ptr->image.clone();
-
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    cams_.push_back(cam);
-    std::sort(cams_.begin(), cams_.end());
-  }
+  scheduler_.push(std::move(cam));
 }
 
 void MSCEqFRos::callback_imu(const sensor_msgs::Imu::ConstPtr &msg)
@@ -91,21 +91,13 @@ void MSCEqFRos::callback_imu(const sensor_msgs::Imu::ConstPtr &msg)
   imu.ang_ << msg->angular_velocity.x, msg->angular_velocity.y, msg->angular_velocity.z;
   imu.acc_ << msg->linear_acceleration.x, msg->linear_acceleration.y, msg->linear_acceleration.z;
 
-  sys_.processMeasurement(imu);
+  scheduler_.push(imu);
 
   if (!processing_)
   {
     processing_ = true;
     std::thread th([&, timestamp] {
-      {
-        std::lock_guard<std::mutex> lock(mutex_);
-        while (!cams_.empty() && cams_.front().timestamp_ < timestamp)
-        {
-          sys_.processMeasurement(cams_.front());
-          publish(cams_.front());
-          cams_.pop_front();
-        }
-      }
+      scheduler_.process(timestamp, [this](const msceqf::Camera &cam) { publish(cam); });
       processing_ = false;
     });
     th.detach();
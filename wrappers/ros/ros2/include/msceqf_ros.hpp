@@ -26,6 +26,7 @@
 #include <rosbag2_cpp/writer.hpp>
 
 #include "msceqf/msceqf.hpp"
+#include "msceqf/scheduler/measurement_scheduler.hpp"
 
 class MSCEqFRos
 {
@@ -117,9 +118,8 @@ class MSCEqFRos
   sensor_msgs::msg::CameraInfo intrinsics_;             //<! Intrinsics message
   geometry_msgs::msg::PoseStamped origin_;              //<! Origin message
 
-  std::deque<msceqf::Camera> cams_;       //!< Camera measurements
-  std::mutex mutex_;                      //!< Camera measurements mutex
-  std::atomic<bool> processing_ = false;  //!< Camera measurements processing flag
+  msceqf::MeasurementScheduler scheduler_;  //!< Camera measurements scheduler
+  std::atomic<bool> processing_ = false;    //!< Camera measurements processing flag
 
   bool record_;                                      //<! Flag to record a bagfile
   std::unique_ptr<rosbag2_cpp::Writer> bag_writer_;  //<! Bagfile writer
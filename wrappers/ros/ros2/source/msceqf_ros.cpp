@@ -27,7 +27,7 @@ MSCEqFRos::MSCEqFRos(std::shared_ptr<rclcpp::Node> node,
                      const std::string &origin_topic,
                      const bool &record,
                      const std::string &bagfile)
-    : node_(node), sys_(msceqf_config_filepath)
+    : node_(node), sys_(msceqf_config_filepath), scheduler_(sys_)
 {
   sub_cam_ = node_->create_subscription<sensor_msgs::msg::Image>(
       cam_topic, rclcpp::SensorDataQoS(), std::bind(&MSCEqFRos::callback_image, this, std::placeholders::_1));
@@ -72,16 +72,16 @@ void MSCEqFRos::callback_image(const sensor_msgs::msg::Image::SharedPtr &msg)
     return;
   }
 
-  msceqf::Camera cam;
+  // Borrow the image buffer of the message (no copy), the view keeps the message alive until it is processed
+  const cv::Mat& image = cv_ptr->image;
+  msceqf::CameraView cam(image.data,
+                         image.cols,
+                         image.rows,
+                         image.step,
+                         cv_ptr->header.stamp.sec + 1.0e9 * cv_ptr->header.stamp.nanosec,
+                         [cv_ptr]() {});
 
-  cam.timestamp_ = cv_ptr->header.stamp.sec + 1.0e9 * cv_ptr->header.stamp.nanosec;
-  cam.image_ = cv_ptr->image.clone();
-
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    cams_.push_back(cam);
-    std::sort(cams_.begin(), cams_.end());
-  }
+  scheduler_.push(std::move(cam));
 }
 
 void MSCEqFRos::callback_imu(const sensor_msgs::msg::Imu::SharedPtr &msg)
@@ -94,21 +94,13 @@ void MSCEqFRos::callback_imu(const sensor_msgs::msg::Imu::SharedPtr &msg)
   imu.ang_ << msg->angular_velocity.x, msg->angular_velocity.y, msg->angular_velocity.z;
   imu.acc_ << msg->linear_acceleration.x, msg->linear_acceleration.y, msg->linear_acceleration.z;
 
-  sys_.processMeasurement(imu);
+  scheduler_.push(imu);
 
   if (!processing_)
   {
     processing_ = true;
     std::thread th([&, timestamp] {
-      {
-        std::lock_guard<std::mutex> lock(mutex_);
-        while (!cams_.empty() && cams_.front().timestamp_ < timestamp)
-        {
-          sys_.processMeasurement(cams_.front());
-          publish(cams_.front());
-          cams_.pop_front();
-        }
-      }
+      scheduler_.process(timestamp, [this](const msceqf::Camera &cam) { publish(cam); });
       processing_ = false;
     });
     th.detach();